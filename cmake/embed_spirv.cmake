@@ -0,0 +1,35 @@
+# Writes the compiled shaders 'SPIRV_FILES' into a C source file, as the 'wo_embedded_shaders'
+# table 'renderer.c' looks shaders up in before reading them from disk.
+# Each shader is keyed by its file name, like the 'WO_UBERSHADER_*_FILENAME' in 'config.h'.
+#
+# Usage: cmake -DSPIRV_FILES=<file.spv>|<file.spv>|... -DOUTPUT=<file.c> -P embed_spirv.cmake
+# (paths are separated by '|': a ';'-separated list would be split into several arguments)
+
+string(REPLACE "|" ";" SPIRV_FILES "${SPIRV_FILES}")
+
+set(CODE "// generated by 'cmake/embed_spirv.cmake', do not edit.\n\n#include <stddef.h>\n\n")
+string(APPEND CODE "typedef struct EmbeddedShader EmbeddedShader;\n")
+string(APPEND CODE "struct EmbeddedShader {\n    char const* file_name;\n    unsigned char const* code;\n    size_t code_size;\n};\n\n")
+
+set(TABLE "")
+set(INDEX 0)
+foreach(SPIRV_FILE ${SPIRV_FILES})
+    get_filename_component(SPIRV_FILE_NAME "${SPIRV_FILE}" NAME)
+    file(READ "${SPIRV_FILE}" SPIRV_HEX HEX)
+    string(LENGTH "${SPIRV_HEX}" SPIRV_HEX_LENGTH)
+    math(EXPR SPIRV_SIZE "${SPIRV_HEX_LENGTH} / 2")
+    string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," SPIRV_BYTES "${SPIRV_HEX}")
+    # (SPIR-V is read as 32-bit words, so each array keeps their alignment)
+    string(APPEND CODE "static _Alignas(4) unsigned char const shader_${INDEX}[${SPIRV_SIZE}] = {${SPIRV_BYTES}};\n")
+    string(APPEND TABLE "    {\"${SPIRV_FILE_NAME}\", shader_${INDEX}, ${SPIRV_SIZE}},\n")
+    math(EXPR INDEX "${INDEX} + 1")
+endforeach()
+
+if (INDEX EQUAL 0)
+    # (C has no empty arrays)
+    string(APPEND TABLE "    {NULL, NULL, 0},\n")
+endif()
+string(APPEND CODE "\nEmbeddedShader const wo_embedded_shaders[] = {\n${TABLE}};\n")
+string(APPEND CODE "size_t const wo_embedded_shader_count = ${INDEX};\n")
+
+file(WRITE "${OUTPUT}" "${CODE}")
@@ -1,12 +1,21 @@
 #include "app.h"
 
 #include "platform.h"
+#include "config.h"
 #include "renderer/renderer.h"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
 #include <assert.h>
 #include <stddef.h>
 #include <string.h>
+#include <time.h>
+#include <stdatomic.h>
+
+#if WO_THREADED_UPDATES
+#include <threads.h>
+#endif
 
 //
 // App implementation:
@@ -21,9 +30,41 @@ Wo_App* app_new(
     Wo_DeInitCallbackPtr extension_de_init_cb
 );
 bool app_run(Wo_App* app);
+void app_update(Wo_App* app);
+
+bool app_set_update_snapshots(
+    Wo_App* app,
+    size_t snapshot_size, void const* opt_initial_snapshot,
+    Wo_ApplySnapshotCallbackPtr apply_snapshot_cb,
+    bool threaded
+);
+void app_publish_snapshot(Wo_App* app);
+void app_apply_latest_snapshot(Wo_App* app);
+void app_free_update_snapshots(Wo_App* app);
+#if WO_THREADED_UPDATES
+int app_update_thread_main(void* app);
+#endif
+void app_start_update_thread(Wo_App* app);
+void app_join_update_thread(Wo_App* app);
+void app_get_stats(Wo_App* app, Wo_App_Stats* out_stats);
 
 void glfw_error_handler(int code, char const* message);
 
+// Snapshots are exchanged through a triple buffer: the update loop owns the back slot and the
+// render loop the front one, and each swaps its slot with the middle one, atomically, to publish
+// or take a snapshot. The middle slot's index is tagged with FRESH while it holds a snapshot
+// the render loop has not taken yet.
+// see: https://en.wikipedia.org/wiki/Multiple_buffering#Triple_buffering
+#define WO_SNAPSHOT_SLOT_COUNT (3)
+#define WO_SNAPSHOT_SLOT_INDEX_MASK (0x3u)
+#define WO_SNAPSHOT_SLOT_FRESH_BIT (0x4u)
+
+typedef struct SnapshotSlot SnapshotSlot;
+struct SnapshotSlot {
+    void* data;
+    double publish_time_sec;
+};
+
 struct Wo_App {
     Wo_InitCallbackPtr extension_init_cb;
     Wo_UpdateCallbackPtr extension_update_cb;
@@ -38,6 +79,35 @@ struct Wo_App {
     uint32_t window_width;
     uint32_t window_height;
     char const* window_caption;
+
+    // update snapshots: (see 'wo_app_set_update_snapshots')
+    Wo_ApplySnapshotCallbackPtr apply_snapshot_cb;
+    size_t snapshot_size;
+    bool has_update_snapshots;
+    bool is_threaded;
+    // owned by the update loop:
+    void* update_snapshot;
+    uint32_t back_snapshot_slot;
+    // owned by the render loop:
+    uint32_t front_snapshot_slot;
+    // shared:
+    SnapshotSlot snapshot_slots[WO_SNAPSHOT_SLOT_COUNT];
+    atomic_uint middle_snapshot_slot;
+#if WO_THREADED_UPDATES
+    thrd_t update_thread;
+    bool update_thread_running;
+    atomic_bool update_thread_should_stop;
+#endif
+
+    // stats: (the update loop's are atomic, since the render loop reads them)
+    atomic_uint_fast64_t update_count;
+    atomic_uint_fast64_t published_snapshot_count;
+    atomic_uint_fast64_t dropped_snapshot_count;
+    uint64_t applied_snapshot_count;
+    uint64_t frames_without_snapshot_count;
+    double snapshot_latency_last_sec;
+    double snapshot_latency_sum_sec;
+    double snapshot_latency_max_sec;
 };
 
 bool the_app_in_use = false;
@@ -67,6 +137,29 @@ Wo_App* app_new(
 
         app->updates_per_sec = updates_per_sec;
         app->update_time_sec = 1.0 / app->updates_per_sec;
+
+        app->apply_snapshot_cb = NULL;
+        app->snapshot_size = 0;
+        app->has_update_snapshots = false;
+        app->is_threaded = false;
+        app->update_snapshot = NULL;
+        app->back_snapshot_slot = 0;
+        app->front_snapshot_slot = 1;
+        memset(app->snapshot_slots, 0, sizeof(app->snapshot_slots));
+        atomic_init(&app->middle_snapshot_slot, 2);
+#if WO_THREADED_UPDATES
+        app->update_thread_running = false;
+        atomic_init(&app->update_thread_should_stop, false);
+#endif
+
+        atomic_init(&app->update_count, 0);
+        atomic_init(&app->published_snapshot_count, 0);
+        atomic_init(&app->dropped_snapshot_count, 0);
+        app->applied_snapshot_count = 0;
+        app->frames_without_snapshot_count = 0;
+        app->snapshot_latency_last_sec = 0.0;
+        app->snapshot_latency_sum_sec = 0.0;
+        app->snapshot_latency_max_sec = 0.0;
     }
     return app;
 }
@@ -84,7 +177,7 @@ bool app_run(Wo_App* app) {
 
     // Create a windowed mode window and its OpenGL context
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
-    glfwWindowHint(GLFW_RESIZABLE, GLFW_FALSE);
+    glfwWindowHint(GLFW_RESIZABLE, GLFW_TRUE);
     app->glfw_window = glfwCreateWindow(
         app->window_width, app->window_height, 
         app->window_caption, 
@@ -118,6 +211,9 @@ bool app_run(Wo_App* app) {
         }
     }
 
+    // Threaded updates start once the scene was set up:
+    app_start_update_thread(app);
+
     // Loop until the user closes the window
     double time_at_last_frame_sec = glfwGetTime();
     double total_running_behind_by_sec = 0.0;
@@ -147,10 +243,10 @@ bool app_run(Wo_App* app) {
             total_running_behind_by_sec += time_difference_sec;
             
             // and then running updates at the desired resolution until we aren't running behind
-            // by a frame anymore:
-            while (app->extension_update_cb != NULL && total_running_behind_by_sec >= app->update_time_sec) {
+            // by a frame anymore: (unless they run on their own thread)
+            while (!app->is_threaded && app->extension_update_cb != NULL && total_running_behind_by_sec >= app->update_time_sec) {
                 total_running_behind_by_sec -= app->update_time_sec;
-                app->extension_update_cb(app, app->update_time_sec);
+                app_update(app);
             }
 
             // updating frame time reports:
@@ -168,24 +264,54 @@ bool app_run(Wo_App* app) {
                     printf("... See above (printing reports too frequently)\n");
                 } else {
                     double sx2 = sum_of_sq_frame_time_diffs_sec_sq;
-                    size_t sx = sum_of_frame_time_diffs_sec;
+                    double sx = sum_of_frame_time_diffs_sec;
                     size_t n = frames_counted_since_last_report;
 
                     // using 'a naive algorithm to calculate estimated variance'
                     // https://en.wikipedia.org/wiki/Algorithms_for_calculating_variance
                     double fps = n / interval_between_frametime_reports_sec;
                     double mean_ft_sec = sx / n;
-                    double stddev_ft = (
+                    double variance_ft = (
                         (sx2 - (sx * sx / n)) / 
                         (n - 1)
                     );
+                    // (rounding may take the naive estimate slightly below 0)
+                    double stddev_ft = sqrt(variance_ft > 0 ? variance_ft : 0);
                     printf(
                         "[Wololo][Stats] | %zu frames / %.3lf sec = %.3lf fps | Avg. Frame-Time: %.3lf sec | Stddev. Frame-Time: %.3lf |\n",
                         n, interval_between_frametime_reports_sec, fps,
                         mean_ft_sec,
                         stddev_ft
                     );
-                    
+                    if (app->renderer != NULL) {
+                        Wo_Renderer_Stats renderer_stats;
+                        wo_renderer_get_stats(app->renderer, &renderer_stats);
+                        printf(
+                            "[Wololo][Stats] | GPU Frame-Time: %.3lf sec (trace %.3lf, blit %.3lf) | CPU Submit-Time: %.3lf sec | Render Scale: %.3f (%u changes) |\n",
+                            renderer_stats.gpu_frame_time.mean_sec,
+                            renderer_stats.gpu_trace_time.mean_sec,
+                            renderer_stats.gpu_blit_time.mean_sec,
+                            renderer_stats.cpu_submit_time.mean_sec,
+                            renderer_stats.render_scale,
+                            renderer_stats.render_scale_change_count
+                        );
+                    }
+                    if (app->has_update_snapshots) {
+                        Wo_App_Stats app_stats;
+                        app_get_stats(app, &app_stats);
+                        printf(
+                            "[Wololo][Stats] | Updates: %llu (%s) | Snapshots: %llu published, %llu applied, %llu dropped | Frames w/o Snapshot: %llu | Snapshot Latency: %.3lf sec (max %.3lf) |\n",
+                            (unsigned long long)app_stats.update_count,
+                            app_stats.is_threaded ? "threaded" : "in render loop",
+                            (unsigned long long)app_stats.published_snapshot_count,
+                            (unsigned long long)app_stats.applied_snapshot_count,
+                            (unsigned long long)app_stats.dropped_snapshot_count,
+                            (unsigned long long)app_stats.frames_without_snapshot_count,
+                            app_stats.snapshot_latency_mean_sec,
+                            app_stats.snapshot_latency_max_sec
+                        );
+                    }
+
                     // resetting metrics:
                     frames_counted_since_last_report = 0;
                     sum_of_frame_time_diffs_sec = 0;
@@ -194,7 +320,8 @@ bool app_run(Wo_App* app) {
             }
         }
 
-        // Rendering here using renderer:
+        // Applying the latest update snapshot, then rendering here using renderer:
+        app_apply_latest_snapshot(app);
         wo_renderer_draw_frame(app->renderer);
         
         // Swap front and back buffers
@@ -204,19 +331,207 @@ bool app_run(Wo_App* app) {
         glfwPollEvents();
     }
 
-    // Extension quit:
+    // Stopping updates, then extension quit:
+    app_join_update_thread(app);
     if (app->extension_de_init_cb != NULL) {
         app->extension_de_init_cb(app);
     }
+    app_free_update_snapshots(app);
 
     glfwTerminate();
     return true;
 }
+void app_update(Wo_App* app) {
+    app->extension_update_cb(app, app->update_time_sec);
+    atomic_fetch_add_explicit(&app->update_count, 1, memory_order_relaxed);
+    if (app->has_update_snapshots) {
+        app_publish_snapshot(app);
+    }
+}
 
 void app_swap_scene(Wo_App* app, Wo_Renderer* renderer) {
     app->renderer = renderer;
 }
 
+bool app_set_update_snapshots(
+    Wo_App* app,
+    size_t snapshot_size, void const* opt_initial_snapshot,
+    Wo_ApplySnapshotCallbackPtr apply_snapshot_cb,
+    bool threaded
+) {
+    // (e.g. from the init callback, which runs before the update thread starts)
+#if WO_THREADED_UPDATES
+    assert(!app->update_thread_running && "update snapshots must be set before updates start");
+#endif
+    app_free_update_snapshots(app);
+
+    // the update snapshot and every slot start as copies of the initial snapshot:
+    size_t const buffer_size = (snapshot_size > 0 ? snapshot_size : 1);
+    bool alloc_ok = true;
+    app->update_snapshot = malloc(buffer_size);
+    alloc_ok = alloc_ok && (app->update_snapshot != NULL);
+    for (int slot = 0; slot < WO_SNAPSHOT_SLOT_COUNT; slot++) {
+        app->snapshot_slots[slot].data = malloc(buffer_size);
+        alloc_ok = alloc_ok && (app->snapshot_slots[slot].data != NULL);
+    }
+    if (!alloc_ok) {
+        printf("[Wololo] Failed to allocate update snapshots.\n");
+        app_free_update_snapshots(app);
+        return false;
+    }
+    if (opt_initial_snapshot != NULL) {
+        memcpy(app->update_snapshot, opt_initial_snapshot, snapshot_size);
+    } else {
+        memset(app->update_snapshot, 0, buffer_size);
+    }
+    for (int slot = 0; slot < WO_SNAPSHOT_SLOT_COUNT; slot++) {
+        memcpy(app->snapshot_slots[slot].data, app->update_snapshot, buffer_size);
+        app->snapshot_slots[slot].publish_time_sec = 0.0;
+    }
+    app->back_snapshot_slot = 0;
+    app->front_snapshot_slot = 1;
+    atomic_store_explicit(&app->middle_snapshot_slot, 2, memory_order_relaxed);
+
+    app->apply_snapshot_cb = apply_snapshot_cb;
+    app->snapshot_size = snapshot_size;
+    app->has_update_snapshots = true;
+#if WO_THREADED_UPDATES
+    app->is_threaded = threaded;
+#else
+    if (threaded) {
+        printf("[Wololo] Threaded updates need C11 threads; running updates in the render loop.\n");
+    }
+    app->is_threaded = false;
+#endif
+    return true;
+}
+void app_publish_snapshot(Wo_App* app) {
+    // copying the update snapshot into the back slot, then swapping it with the middle one:
+    // (release, so the render loop sees the copy; acquire, so the slot we get back is no
+    // longer read by the render loop)
+    SnapshotSlot* slot = &app->snapshot_slots[app->back_snapshot_slot];
+    memcpy(slot->data, app->update_snapshot, app->snapshot_size);
+    slot->publish_time_sec = glfwGetTime();
+    unsigned int const old_middle_slot = atomic_exchange_explicit(
+        &app->middle_snapshot_slot,
+        app->back_snapshot_slot | WO_SNAPSHOT_SLOT_FRESH_BIT,
+        memory_order_acq_rel
+    );
+    app->back_snapshot_slot = old_middle_slot & WO_SNAPSHOT_SLOT_INDEX_MASK;
+    atomic_fetch_add_explicit(&app->published_snapshot_count, 1, memory_order_relaxed);
+    if (old_middle_slot & WO_SNAPSHOT_SLOT_FRESH_BIT) {
+        // the render loop never took the snapshot we replaced:
+        atomic_fetch_add_explicit(&app->dropped_snapshot_count, 1, memory_order_relaxed);
+    }
+}
+void app_apply_latest_snapshot(Wo_App* app) {
+    if (!app->has_update_snapshots) {
+        return;
+    }
+    // taking the middle slot if it holds a snapshot published since the last frame, else
+    // keeping the scene as it is (never waiting for an update):
+    if (!(atomic_load_explicit(&app->middle_snapshot_slot, memory_order_relaxed) & WO_SNAPSHOT_SLOT_FRESH_BIT)) {
+        app->frames_without_snapshot_count++;
+        return;
+    }
+    unsigned int const old_middle_slot = atomic_exchange_explicit(
+        &app->middle_snapshot_slot,
+        app->front_snapshot_slot,
+        memory_order_acq_rel
+    );
+    app->front_snapshot_slot = old_middle_slot & WO_SNAPSHOT_SLOT_INDEX_MASK;
+
+    SnapshotSlot const* slot = &app->snapshot_slots[app->front_snapshot_slot];
+    double const latency_sec = glfwGetTime() - slot->publish_time_sec;
+    app->applied_snapshot_count++;
+    app->snapshot_latency_last_sec = latency_sec;
+    app->snapshot_latency_sum_sec += latency_sec;
+    if (latency_sec > app->snapshot_latency_max_sec) {
+        app->snapshot_latency_max_sec = latency_sec;
+    }
+    if (app->apply_snapshot_cb != NULL) {
+        app->apply_snapshot_cb(app, app->renderer, slot->data);
+    }
+}
+void app_free_update_snapshots(Wo_App* app) {
+    free(app->update_snapshot);
+    app->update_snapshot = NULL;
+    for (int slot = 0; slot < WO_SNAPSHOT_SLOT_COUNT; slot++) {
+        free(app->snapshot_slots[slot].data);
+        app->snapshot_slots[slot].data = NULL;
+    }
+    app->has_update_snapshots = false;
+    app->is_threaded = false;
+}
+#if WO_THREADED_UPDATES
+int app_update_thread_main(void* app_p) {
+    Wo_App* app = app_p;
+    // running updates at the desired resolution, sleeping until each is due, and catching up
+    // without sleeping if running behind:
+    double time_of_next_update_sec = glfwGetTime() + app->update_time_sec;
+    while (!atomic_load_explicit(&app->update_thread_should_stop, memory_order_relaxed)) {
+        double const time_sec = glfwGetTime();
+        if (time_sec < time_of_next_update_sec) {
+            double const sleep_sec = time_of_next_update_sec - time_sec;
+            struct timespec sleep_duration;
+            sleep_duration.tv_sec = (time_t)sleep_sec;
+            sleep_duration.tv_nsec = (long)((sleep_sec - (double)sleep_duration.tv_sec) * 1e9);
+            thrd_sleep(&sleep_duration, NULL);
+            continue;
+        }
+        time_of_next_update_sec += app->update_time_sec;
+        app_update(app);
+    }
+    return 0;
+}
+#endif
+void app_start_update_thread(Wo_App* app) {
+    // until joined, the update thread owns the update snapshot and back slot, and calls
+    // nothing but 'glfwGetTime' (which any thread may call).
+#if WO_THREADED_UPDATES
+    if (!app->is_threaded || app->extension_update_cb == NULL) {
+        return;
+    }
+    assert(!app->update_thread_running);
+    atomic_store_explicit(&app->update_thread_should_stop, false, memory_order_relaxed);
+    if (thrd_create(&app->update_thread, app_update_thread_main, app) == thrd_success) {
+        app->update_thread_running = true;
+        return;
+    }
+    printf("[Wololo] Failed to start an update thread; running updates in the render loop.\n");
+    app->is_threaded = false;
+#else
+    (void)app;
+#endif
+}
+void app_join_update_thread(Wo_App* app) {
+#if WO_THREADED_UPDATES
+    if (app->update_thread_running) {
+        atomic_store_explicit(&app->update_thread_should_stop, true, memory_order_relaxed);
+        thrd_join(app->update_thread, NULL);
+        app->update_thread_running = false;
+    }
+#else
+    (void)app;
+#endif
+}
+void app_get_stats(Wo_App* app, Wo_App_Stats* out_stats) {
+    memset(out_stats, 0, sizeof(Wo_App_Stats));
+    out_stats->is_threaded = app->is_threaded;
+    out_stats->update_count = atomic_load_explicit(&app->update_count, memory_order_relaxed);
+    out_stats->published_snapshot_count = atomic_load_explicit(&app->published_snapshot_count, memory_order_relaxed);
+    out_stats->applied_snapshot_count = app->applied_snapshot_count;
+    out_stats->dropped_snapshot_count = atomic_load_explicit(&app->dropped_snapshot_count, memory_order_relaxed);
+    out_stats->frames_without_snapshot_count = app->frames_without_snapshot_count;
+    out_stats->snapshot_latency_last_sec = app->snapshot_latency_last_sec;
+    out_stats->snapshot_latency_mean_sec = (
+        app->applied_snapshot_count > 0 ?
+        app->snapshot_latency_sum_sec / (double)app->applied_snapshot_count :
+        0.0
+    );
+    out_stats->snapshot_latency_max_sec = app->snapshot_latency_max_sec;
+}
+
 void glfw_error_handler(int code, char const* message) {
     printf("[GLFW] %s (%d)\n", message, code);
 }
@@ -251,3 +566,20 @@ void wo_app_swap_scene(Wo_App* app_ref, Wo_Renderer* new_scene_renderer) {
 GLFWwindow* wo_app_glfw_window(Wo_App* app) {
     return app->glfw_window;
 }
+
+bool wo_app_set_update_snapshots(
+    Wo_App* app,
+    size_t snapshot_size, void const* opt_initial_snapshot,
+    Wo_ApplySnapshotCallbackPtr apply_snapshot_cb,
+    bool threaded
+) {
+    return app_set_update_snapshots(app, snapshot_size, opt_initial_snapshot, apply_snapshot_cb, threaded);
+}
+
+void* wo_app_update_snapshot(Wo_App* app) {
+    return app->update_snapshot;
+}
+
+void wo_app_get_stats(Wo_App* app, Wo_App_Stats* out_stats) {
+    app_get_stats(app, out_stats);
+}
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -31,4 +32,47 @@ Wo_App* wo_app_new(
 );
 bool wo_app_run(Wo_App* app_ref);
 void wo_app_swap_scene(Wo_App* app_ref, Wo_Renderer* new_scene_renderer);
-GLFWwindow* wo_app_glfw_window(Wo_App* app);
\ No newline at end of file
+GLFWwindow* wo_app_glfw_window(Wo_App* app);
+
+// Update snapshots hand the update callback's state to the render loop instead of letting it
+// touch the renderer: the update callback edits the update snapshot (of 'snapshot_size' bytes,
+// starting as a copy of 'opt_initial_snapshot', or zeroed), which is published after each
+// update; before each frame, the latest snapshot published since the last frame (if any) is
+// passed to the apply callback, along with the app's renderer (see 'wo_app_swap_scene'; NULL if
+// none), which moves the renderer's nodes to match it.
+// - threaded: the update callback runs on its own thread, at 'target_updates_per_sec', so slow
+//   updates and slow frames no longer hold each other up. Snapshots are exchanged through a
+//   lock-free triple buffer: publishing never waits for the render loop, and the render loop
+//   never waits for an update (it draws the last snapshot again instead). The update callback
+//   must then only touch the update snapshot (not the renderer, nor GLFW).
+// - otherwise (or without C11 threads), updates run in the render loop, as without snapshots.
+// Must be called before updates start: before 'wo_app_run', or from the init callback (e.g. once
+// it built the scene the snapshot drives). Returns false if out of memory.
+typedef void(*Wo_ApplySnapshotCallbackPtr)(Wo_App* app, Wo_Renderer* renderer, void const* snapshot);
+bool wo_app_set_update_snapshots(
+    Wo_App* app,
+    size_t snapshot_size, void const* opt_initial_snapshot,
+    Wo_ApplySnapshotCallbackPtr apply_snapshot_cb,
+    bool threaded
+);
+// the snapshot the update callback edits: (NULL without update snapshots)
+void* wo_app_update_snapshot(Wo_App* app);
+
+// Counters accumulated since the app started running, to check neither loop starves the other:
+// - updates run, and snapshots published (one per update), applied by the render loop, and
+//   dropped (replaced by a newer one before the render loop took them),
+// - frames drawn without a new snapshot to apply,
+// - snapshot latency: from a snapshot's publication to its application, last, mean and max.
+typedef struct Wo_App_Stats Wo_App_Stats;
+struct Wo_App_Stats {
+    bool is_threaded;
+    uint64_t update_count;
+    uint64_t published_snapshot_count;
+    uint64_t applied_snapshot_count;
+    uint64_t dropped_snapshot_count;
+    uint64_t frames_without_snapshot_count;
+    double snapshot_latency_last_sec;
+    double snapshot_latency_mean_sec;
+    double snapshot_latency_max_sec;
+};
+void wo_app_get_stats(Wo_App* app, Wo_App_Stats* out_stats);
\ No newline at end of file
@@ -2,5 +2,42 @@
 
 #define WO_DEBUG (1)
 
-#define WO_UBERSHADER_VERT_FILEPATH ("src/wololo/renderer/ubershader1.vert.spv")
-#define WO_UBERSHADER_FRAG_FILEPATH ("src/wololo/renderer/ubershader1.frag.spv")
+// the directory the compiled shaders are read from: CMake compiles them into its build directory,
+// else 'shader-build.sh' compiles them next to their sources (relative to the working directory).
+#ifndef WO_SHADER_DIR
+#define WO_SHADER_DIR "src/wololo/renderer/"
+#endif
+#define WO_UBERSHADER_VERT_FILENAME "ubershader1.vert.spv"
+#define WO_UBERSHADER_FRAG_FILENAME "ubershader1.frag.spv"
+#define WO_UBERSHADER_COMP_FILENAME "ubershader1.comp.spv"
+#define WO_UBERSHADER_RQ_COMP_FILENAME "ubershader1-rq.comp.spv"
+#define WO_UBERSHADER_VERT_FILEPATH (WO_SHADER_DIR WO_UBERSHADER_VERT_FILENAME)
+#define WO_UBERSHADER_FRAG_FILEPATH (WO_SHADER_DIR WO_UBERSHADER_FRAG_FILENAME)
+#define WO_UBERSHADER_COMP_FILEPATH (WO_SHADER_DIR WO_UBERSHADER_COMP_FILENAME)
+#define WO_UBERSHADER_RQ_COMP_FILEPATH (WO_SHADER_DIR WO_UBERSHADER_RQ_COMP_FILENAME)
+
+// the renderer's pipeline cache, relative to the working directory: (created on first run)
+#define WO_PIPELINE_CACHE_FILEPATH ("wololo-pipeline-cache.bin")
+
+// committed scenes are pruned, deduplicated and rebalanced (see 'renderer/optimize.h'):
+#define WO_OPTIMIZE_SCENES (1)
+
+// shaders are read from the paths above unless CMake embeds them (option 'WOLOLO_EMBED_SHADERS'):
+#ifndef WO_EMBEDDED_SHADERS
+#define WO_EMBEDDED_SHADERS (0)
+#endif
+
+// creating the compute pipelines on a worker thread while the renderer initializes needs C11 threads:
+#if !defined(__STDC_NO_THREADS__) && !defined(__APPLE__)
+#define WO_ASYNC_PIPELINE_CREATION (1)
+#else
+#define WO_ASYNC_PIPELINE_CREATION (0)
+#endif
+
+
+// running app updates on their own thread (see 'wo_app_set_update_snapshots') needs C11 threads too:
+#if !defined(__STDC_NO_THREADS__) && !defined(__APPLE__)
+#define WO_THREADED_UPDATES (1)
+#else
+#define WO_THREADED_UPDATES (0)
+#endif
\ No newline at end of file
@@ -0,0 +1,477 @@
+#include "bvh.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+//
+// Local implementation:
+//
+
+typedef struct BvhBuildItem BvhBuildItem;
+struct BvhBuildItem {
+    float min[3];
+    float max[3];
+    float centroid[3];
+    uint32_t root;
+};
+
+static void set_infinite_bounds(GpuNodeBounds* bounds);
+static uint32_t first_child_index(FlatScene const* flat_scene, uint32_t node_index);
+static void bound_node(FlatScene const* flat_scene, GpuNodeBounds* node_bounds, uint32_t node_index);
+static float surface_area(float const min[3], float const max[3]);
+static bool bitset_has(uint64_t const* bitset, uint32_t index);
+static void bitset_set(uint64_t* bitset, uint32_t index);
+static void swap_build_items(BvhBuildItem* a, BvhBuildItem* b);
+static void select_build_item(BvhBuildItem* items, uint32_t lo, uint32_t hi, uint32_t nth, int axis);
+static void build_bvh_range(
+    BvhBuildItem* items, uint32_t lo, uint32_t hi,
+    GpuBvhNode* nodes, uint32_t node_index, uint32_t* node_count
+);
+
+static void set_infinite_bounds(GpuNodeBounds* bounds) {
+    for (int i = 0; i < 3; i++) {
+        bounds->min[i] = -WO_GPU_BOUNDS_INFINITY;
+        bounds->max[i] = +WO_GPU_BOUNDS_INFINITY;
+    }
+}
+static uint32_t first_child_index(FlatScene const* flat_scene, uint32_t node_index) {
+    // the second operand visited is emitted right before its parent, and the first right
+    // before the second's subtree:
+    uint32_t second_child_index = node_index - 1;
+    return second_child_index - flat_scene->nodes[second_child_index].subtree_size;
+}
+static void bound_node(FlatScene const* flat_scene, GpuNodeBounds* node_bounds, uint32_t node_index) {
+    // (children precede their parents in post-order, so must be bounded first)
+    GpuSceneNode const* node = &flat_scene->nodes[node_index];
+    GpuNodeBounds* bounds = &node_bounds[node_index];
+    switch ((NodeType)node->type) {
+        case WO_LEAF_SPHERE: {
+            // world-to-local maps are rigid, so the sphere's center is '-A^T * b':
+            float const (*m)[4] = node->world_to_local;
+            float radius = node->params[0];
+            for (int axis = 0; axis < 3; axis++) {
+                float center = -(m[0][axis]*m[0][3] + m[1][axis]*m[1][3] + m[2][axis]*m[2][3]);
+                bounds->min[axis] = center - radius;
+                bounds->max[axis] = center + radius;
+            }
+        } break;
+        case WO_LEAF_INFINITE_PLANAR_PARTITION: {
+            set_infinite_bounds(bounds);
+        } break;
+        case WO_NODE_INSTANCE: {
+            // the prototype's box (in its own space, emitted first) mapped back into world
+            // space by the inverse 'p -> A^T * (p - b)', bounding each axis like Arvo does:
+            // see: Arvo, 'Transforming Axis-Aligned Bounding Boxes' (Graphics Gems, 1990)
+            GpuNodeBounds const* prototype = &node_bounds[gpu_node_prototype_root(node)];
+            if (bounds_are_empty(prototype->min, prototype->max) || bounds_are_infinite(prototype->min, prototype->max)) {
+                memcpy(bounds->min, prototype->min, sizeof(bounds->min));
+                memcpy(bounds->max, prototype->max, sizeof(bounds->max));
+                break;
+            }
+            float const (*m)[4] = node->world_to_local;
+            for (int axis = 0; axis < 3; axis++) {
+                float center = -(m[0][axis]*m[0][3] + m[1][axis]*m[1][3] + m[2][axis]*m[2][3]);
+                bounds->min[axis] = bounds->max[axis] = center;
+                for (int k = 0; k < 3; k++) {
+                    float lo = m[k][axis] * prototype->min[k];
+                    float hi = m[k][axis] * prototype->max[k];
+                    bounds->min[axis] += lo < hi ? lo : hi;
+                    bounds->max[axis] += lo < hi ? hi : lo;
+                }
+            }
+        } break;
+        case WO_NODE_BINOP_UNION_OF:
+        case WO_NODE_BINOP_INTERSECTION_OF:
+        case WO_NODE_BINOP_DIFFERENCE_OF: {
+            uint32_t first_child = first_child_index(flat_scene, node_index);
+            uint32_t second_child = node_index - 1;
+            bool swapped = (node->flags & WO_GPU_NODE_FLAG_OPERANDS_SWAPPED) != 0;
+            GpuNodeBounds const* left = &node_bounds[swapped ? second_child : first_child];
+            GpuNodeBounds const* right = &node_bounds[swapped ? first_child : second_child];
+            for (int axis = 0; axis < 3; axis++) {
+                if (node->type == WO_NODE_BINOP_UNION_OF) {
+                    bounds->min[axis] = left->min[axis] < right->min[axis] ? left->min[axis] : right->min[axis];
+                    bounds->max[axis] = left->max[axis] > right->max[axis] ? left->max[axis] : right->max[axis];
+                } else if (node->type == WO_NODE_BINOP_INTERSECTION_OF) {
+                    bounds->min[axis] = left->min[axis] > right->min[axis] ? left->min[axis] : right->min[axis];
+                    bounds->max[axis] = left->max[axis] < right->max[axis] ? left->max[axis] : right->max[axis];
+                } else {
+                    bounds->min[axis] = left->min[axis];
+                    bounds->max[axis] = left->max[axis];
+                }
+            }
+        } break;
+        case WO_NODE_FREE: {
+            // (never flattened)
+        } break;
+    }
+}
+static float surface_area(float const min[3], float const max[3]) {
+    float dx = max[0] - min[0];
+    float dy = max[1] - min[1];
+    float dz = max[2] - min[2];
+    return 2.0f * (dx*dy + dy*dz + dz*dx);
+}
+static bool bitset_has(uint64_t const* bitset, uint32_t index) {
+    return (bitset[index/64] & (((uint64_t)1) << (index%64))) != 0;
+}
+static void bitset_set(uint64_t* bitset, uint32_t index) {
+    bitset[index/64] |= ((uint64_t)1) << (index%64);
+}
+
+static void swap_build_items(BvhBuildItem* a, BvhBuildItem* b) {
+    BvhBuildItem t = *a;
+    *a = *b;
+    *b = t;
+}
+static void select_build_item(BvhBuildItem* items, uint32_t lo, uint32_t hi, uint32_t nth, int axis) {
+    // reorders items[lo, hi) so that items[nth] has the centroid it would have if sorted along
+    // 'axis', with no greater one before it and no smaller one after it (quickselect, in place
+    // and without global state, so renderers may build BVHs on several threads at once).
+    // Partitions three ways around the middle item's centroid, so equal centroids stay linear.
+    while (hi - lo > 1) {
+        float pivot = items[lo + (hi - lo) / 2].centroid[axis];
+        uint32_t lt = lo;
+        uint32_t gt = hi;
+        uint32_t i = lo;
+        while (i < gt) {
+            float c = items[i].centroid[axis];
+            if (c < pivot) {
+                swap_build_items(&items[lt++], &items[i++]);
+            } else if (c > pivot) {
+                swap_build_items(&items[i], &items[--gt]);
+            } else {
+                i++;
+            }
+        }
+        if (nth < lt) {
+            hi = lt;
+        } else if (nth >= gt) {
+            lo = gt;
+        } else {
+            return;
+        }
+    }
+}
+static void build_bvh_range(
+    BvhBuildItem* items, uint32_t lo, uint32_t hi,
+    GpuBvhNode* nodes, uint32_t node_index, uint32_t* node_count
+) {
+    // bounding the items' boxes and centroids:
+    GpuBvhNode* node = &nodes[node_index];
+    float centroid_min[3];
+    float centroid_max[3];
+    for (int i = 0; i < 3; i++) {
+        node->min[i] = items[lo].min[i];
+        node->max[i] = items[lo].max[i];
+        centroid_min[i] = centroid_max[i] = items[lo].centroid[i];
+    }
+    for (uint32_t item = lo + 1; item < hi; item++) {
+        for (int i = 0; i < 3; i++) {
+            if (items[item].min[i] < node->min[i]) node->min[i] = items[item].min[i];
+            if (items[item].max[i] > node->max[i]) node->max[i] = items[item].max[i];
+            if (items[item].centroid[i] < centroid_min[i]) centroid_min[i] = items[item].centroid[i];
+            if (items[item].centroid[i] > centroid_max[i]) centroid_max[i] = items[item].centroid[i];
+        }
+    }
+
+    if (hi - lo == 1) {
+        node->index = items[lo].root;
+        node->is_leaf = 1;
+        return;
+    }
+
+    // splitting at the median along the axis the centroids spread the most on:
+    // (median splits keep the tree's depth at most 'ceil(log2(n))')
+    int axis = 0;
+    for (int i = 1; i < 3; i++) {
+        if (centroid_max[i] - centroid_min[i] > centroid_max[axis] - centroid_min[axis]) {
+            axis = i;
+        }
+    }
+    uint32_t mid = lo + (hi - lo) / 2;
+    select_build_item(items, lo, hi, mid, axis);
+
+    uint32_t left_index = *node_count;
+    *node_count += 2;
+    node->index = left_index;
+    node->is_leaf = 0;
+    build_bvh_range(items, lo, mid, nodes, left_index, node_count);
+    build_bvh_range(items, mid, hi, nodes, left_index + 1, node_count);
+}
+
+//
+// Implementation:
+//
+
+void bound_flat_scene(FlatScene const* flat_scene, GpuNodeBounds* out_node_bounds) {
+    // bounding every node, children first:
+    for (uint32_t i = 0; i < flat_scene->node_count; i++) {
+        GpuSceneNode const* node = &flat_scene->nodes[i];
+        GpuNodeBounds* bounds = &out_node_bounds[i];
+        bounds->cull_root = i;
+        bounds->first_child = i;
+        bound_node(flat_scene, out_node_bounds, i);
+        if (!node_type_is_leaf((NodeType)node->type)) {
+            bounds->first_child = first_child_index(flat_scene, i);
+
+            // the subtree rooted here starts at the same node as its first child's:
+            // ancestors are bounded after their descendants, so the highest one wins.
+            uint32_t subtree_first = i - node->subtree_size + 1;
+            out_node_bounds[subtree_first].cull_root = i;
+        }
+    }
+}
+bool build_scene_accel(FlatScene const* flat_scene, SceneAccel* out_scene_accel) {
+    memset(out_scene_accel, 0, sizeof(SceneAccel));
+    uint32_t node_count = flat_scene->node_count;
+    out_scene_accel->node_count = node_count;
+
+    uint32_t* component_stack = NULL;
+    BvhBuildItem* items = NULL;
+    if (node_count == 0) {
+        return true;
+    }
+
+    out_scene_accel->node_bounds = malloc(node_count * sizeof(GpuNodeBounds));
+    out_scene_accel->empty_components = malloc(node_count * sizeof(uint32_t));
+    component_stack = malloc(node_count * sizeof(uint32_t));
+    items = malloc(node_count * sizeof(BvhBuildItem));
+    out_scene_accel->unbounded_components = malloc(node_count * sizeof(GpuBvhNode));
+    // a binary tree over 'n' leaves has '2n - 1' nodes:
+    out_scene_accel->bvh_nodes = malloc((2 * node_count) * sizeof(GpuBvhNode));
+    if (
+        out_scene_accel->node_bounds == NULL ||
+        out_scene_accel->empty_components == NULL ||
+        component_stack == NULL ||
+        items == NULL ||
+        out_scene_accel->unbounded_components == NULL ||
+        out_scene_accel->bvh_nodes == NULL
+    ) {
+        goto fatal_error;
+    }
+
+    bound_flat_scene(flat_scene, out_scene_accel->node_bounds);
+
+    // collecting components by descending through the unions below the scene root:
+    uint32_t component_stack_count = 0;
+    uint32_t item_count = 0;
+    component_stack[component_stack_count++] = node_count - 1;
+    while (component_stack_count > 0) {
+        uint32_t i = component_stack[--component_stack_count];
+        GpuSceneNode const* node = &flat_scene->nodes[i];
+        if (node->type == WO_NODE_BINOP_UNION_OF) {
+            component_stack[component_stack_count++] = first_child_index(flat_scene, i);
+            component_stack[component_stack_count++] = i - 1;
+            continue;
+        }
+        GpuNodeBounds const* bounds = &out_scene_accel->node_bounds[i];
+        if (bounds_are_empty(bounds->min, bounds->max)) {
+            // e.g. the intersection of disjoint spheres: no ray can hit it.
+            out_scene_accel->empty_components[out_scene_accel->empty_component_count++] = i;
+            continue;
+        }
+        if (bounds_are_infinite(bounds->min, bounds->max)) {
+            GpuBvhNode* unbounded = &out_scene_accel->unbounded_components[out_scene_accel->unbounded_component_count++];
+            memset(unbounded, 0, sizeof(GpuBvhNode));
+            for (int axis = 0; axis < 3; axis++) {
+                unbounded->min[axis] = -WO_GPU_BOUNDS_INFINITY;
+                unbounded->max[axis] = +WO_GPU_BOUNDS_INFINITY;
+            }
+            unbounded->index = i;
+            unbounded->is_leaf = 1;
+        } else {
+            BvhBuildItem* item = &items[item_count++];
+            for (int axis = 0; axis < 3; axis++) {
+                item->min[axis] = bounds->min[axis];
+                item->max[axis] = bounds->max[axis];
+                item->centroid[axis] = 0.5f * (bounds->min[axis] + bounds->max[axis]);
+            }
+            item->root = i;
+        }
+    }
+
+    // building the BVH over bounded components:
+    out_scene_accel->bounded_component_count = item_count;
+    if (item_count > 0) {
+        out_scene_accel->bvh_node_count = 1;
+        build_bvh_range(
+            items, 0, item_count,
+            out_scene_accel->bvh_nodes, 0, &out_scene_accel->bvh_node_count
+        );
+        assert(out_scene_accel->bvh_node_count == 2 * item_count - 1);
+    }
+    out_scene_accel->build_sah_cost = scene_accel_sah_cost(out_scene_accel);
+
+    free(component_stack);
+    free(items);
+    return true;
+
+  fatal_error:
+    fprintf(stderr, "[Wololo] Failed to allocate memory while building the scene's BVH.\n");
+    free(component_stack);
+    free(items);
+    free_scene_accel(out_scene_accel);
+    return false;
+}
+void free_scene_accel(SceneAccel* scene_accel) {
+    free(scene_accel->node_bounds);
+    free(scene_accel->bvh_nodes);
+    free(scene_accel->unbounded_components);
+    free(scene_accel->empty_components);
+    memset(scene_accel, 0, sizeof(SceneAccel));
+}
+
+bool refit_scene_accel(FlatScene const* flat_scene, uint64_t const* flat_dirty_bitset, SceneAccel* scene_accel) {
+    uint32_t node_count = flat_scene->node_count;
+    assert(node_count == scene_accel->node_count);
+    if (node_count == 0) {
+        return true;
+    }
+
+    // finding the nodes to refit: the dirty nodes moved (their world-to-local maps changed),
+    // and their ancestors must be re-bounded.
+    uint64_t* affected_bitset = calloc(node_count/64 + 1, sizeof(uint64_t));
+    uint8_t* bvh_node_is_dirty = calloc(scene_accel->bvh_node_count + 1, 1);
+    if (affected_bitset == NULL || bvh_node_is_dirty == NULL) {
+        fprintf(stderr, "[Wololo] Failed to allocate memory while refitting the scene's BVH.\n");
+        free(affected_bitset);
+        free(bvh_node_is_dirty);
+        return false;
+    }
+    // (instances are re-bounded with their prototypes, which precede them)
+    for (uint32_t i = 0; i < node_count; i++) {
+        bool is_dirty = bitset_has(flat_dirty_bitset, i) || (
+            flat_scene->nodes[i].type == WO_NODE_INSTANCE &&
+            bitset_has(affected_bitset, gpu_node_prototype_root(&flat_scene->nodes[i]))
+        );
+        if (!is_dirty) {
+            continue;
+        }
+        bitset_set(affected_bitset, i);
+        for (
+            uint32_t j = flat_scene->nodes[i].parent_index;
+            j != WO_GPU_NODE_NO_PARENT && !bitset_has(affected_bitset, j);
+            j = flat_scene->nodes[j].parent_index
+        ) {
+            bitset_set(affected_bitset, j);
+        }
+    }
+
+    // refitting the node bounds, children first like 'build_scene_accel':
+    for (uint32_t i = 0; i < node_count; i++) {
+        if (bitset_has(affected_bitset, i)) {
+            bound_node(flat_scene, scene_accel->node_bounds, i);
+        }
+    }
+
+    // components must stay in the same category to keep the BVH's shape:
+    bool refit_ok = true;
+    for (uint32_t i = 0; refit_ok && i < scene_accel->empty_component_count; i++) {
+        GpuNodeBounds const* bounds = &scene_accel->node_bounds[scene_accel->empty_components[i]];
+        refit_ok = bounds_are_empty(bounds->min, bounds->max);
+    }
+    for (uint32_t i = 0; refit_ok && i < scene_accel->unbounded_component_count; i++) {
+        GpuNodeBounds const* bounds = &scene_accel->node_bounds[scene_accel->unbounded_components[i].index];
+        refit_ok = bounds_are_infinite(bounds->min, bounds->max) && !bounds_are_empty(bounds->min, bounds->max);
+    }
+
+    // refitting the BVH bottom-up: children are allocated after their parents.
+    for (uint32_t i = scene_accel->bvh_node_count; refit_ok && i-- > 0;) {
+        GpuBvhNode* bvh_node = &scene_accel->bvh_nodes[i];
+        if (bvh_node->is_leaf) {
+            if (!bitset_has(affected_bitset, bvh_node->index)) {
+                continue;
+            }
+            GpuNodeBounds const* bounds = &scene_accel->node_bounds[bvh_node->index];
+            if (bounds_are_empty(bounds->min, bounds->max) || bounds_are_infinite(bounds->min, bounds->max)) {
+                refit_ok = false;
+                break;
+            }
+            memcpy(bvh_node->min, bounds->min, sizeof(bvh_node->min));
+            memcpy(bvh_node->max, bounds->max, sizeof(bvh_node->max));
+        } else {
+            if (!bvh_node_is_dirty[bvh_node->index] && !bvh_node_is_dirty[bvh_node->index + 1]) {
+                continue;
+            }
+            GpuBvhNode const* left = &scene_accel->bvh_nodes[bvh_node->index];
+            GpuBvhNode const* right = &scene_accel->bvh_nodes[bvh_node->index + 1];
+            for (int axis = 0; axis < 3; axis++) {
+                bvh_node->min[axis] = left->min[axis] < right->min[axis] ? left->min[axis] : right->min[axis];
+                bvh_node->max[axis] = left->max[axis] > right->max[axis] ? left->max[axis] : right->max[axis];
+            }
+        }
+        bvh_node_is_dirty[i] = 1;
+    }
+    free(affected_bitset);
+    free(bvh_node_is_dirty);
+
+    // rebuilding once the refit BVH is too much worse than a rebuilt one:
+    return refit_ok && (
+        scene_accel_sah_cost(scene_accel) <= WO_BVH_REFIT_MAX_COST_RATIO * scene_accel->build_sah_cost
+    );
+}
+float scene_accel_sah_cost(SceneAccel const* scene_accel) {
+    // the expected number of BVH nodes a ray through the root visits:
+    // each node is visited with probability proportional to its surface area.
+    if (scene_accel->bvh_node_count == 0) {
+        return 0.0f;
+    }
+    float root_area = surface_area(scene_accel->bvh_nodes[0].min, scene_accel->bvh_nodes[0].max);
+    if (root_area <= 0.0f) {
+        return (float)scene_accel->bvh_node_count;
+    }
+    float total_area = 0.0f;
+    for (uint32_t i = 0; i < scene_accel->bvh_node_count; i++) {
+        total_area += surface_area(scene_accel->bvh_nodes[i].min, scene_accel->bvh_nodes[i].max);
+    }
+    return total_area / root_area;
+}
+
+size_t scene_accel_gpu_size_in_bytes(SceneAccel const* scene_accel) {
+    return (
+        sizeof(GpuSceneAccelHeader) +
+        sizeof(GpuNodeBounds) * scene_accel->node_count +
+        sizeof(GpuBvhNode) * scene_accel->bvh_node_count +
+        sizeof(GpuBvhNode) * scene_accel->unbounded_component_count
+    );
+}
+void scene_accel_write_gpu_layout(SceneAccel const* scene_accel, void* dst) {
+    GpuSceneAccelHeader header;
+    memset(&header, 0, sizeof(header));
+    header.node_count = scene_accel->node_count;
+    header.bvh_node_count = scene_accel->bvh_node_count;
+    header.bounded_component_count = scene_accel->bounded_component_count;
+    header.unbounded_component_count = scene_accel->unbounded_component_count;
+
+    uint8_t* cursor = dst;
+    memcpy(cursor, &header, sizeof(header));
+    cursor += sizeof(header);
+    if (scene_accel->node_count > 0) {
+        memcpy(cursor, scene_accel->node_bounds, sizeof(GpuNodeBounds) * scene_accel->node_count);
+        cursor += sizeof(GpuNodeBounds) * scene_accel->node_count;
+    }
+    if (scene_accel->bvh_node_count > 0) {
+        memcpy(cursor, scene_accel->bvh_nodes, sizeof(GpuBvhNode) * scene_accel->bvh_node_count);
+        cursor += sizeof(GpuBvhNode) * scene_accel->bvh_node_count;
+    }
+    if (scene_accel->unbounded_component_count > 0) {
+        memcpy(cursor, scene_accel->unbounded_components, sizeof(GpuBvhNode) * scene_accel->unbounded_component_count);
+    }
+}
+void scene_accel_write_component_aabbs(SceneAccel const* scene_accel, GpuComponentAabb* dst) {
+    uint32_t aabb_count = 0;
+    for (uint32_t i = 0; i < scene_accel->bvh_node_count; i++) {
+        GpuBvhNode const* bvh_node = &scene_accel->bvh_nodes[i];
+        if (bvh_node->is_leaf) {
+            GpuComponentAabb* aabb = &dst[aabb_count++];
+            memcpy(aabb->min, bvh_node->min, sizeof(aabb->min));
+            memcpy(aabb->max, bvh_node->max, sizeof(aabb->max));
+            aabb->component_root = bvh_node->index;
+            aabb->_pad = 0;
+        }
+    }
+    assert(aabb_count == scene_accel->bounded_component_count);
+}
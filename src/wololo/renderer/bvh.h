@@ -0,0 +1,143 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scene.h"
+
+//
+// BVH builds the acceleration structures read alongside the flattened scene:
+//
+// - conservative world-space bounds for every flattened node, used to cull subtrees the
+//   ray misses: a leaf is bounded by its sphere (planar partitions are unbounded), a union
+//   by the union of its operands' boxes, an intersection by their intersection and a
+//   difference by its left operand's box.
+// - a BVH over the scene's 'components': the operands of the top-level chain of unions
+//   (for a forest of unions, its leaves). The first hit of a union is the nearest first
+//   hit of its operands, so components can be traced independently and in any order.
+//   Unbounded components (e.g. those containing a planar partition) are kept in a separate
+//   list that every ray traces.
+//   Instanced components (see 'scene.h') are bounded by their prototype's box in world
+//   space, while their prototype's nodes are bounded in its own space: a two-level structure,
+//   with the BVH over instances and the node bounds culling within prototypes.
+//
+// GPU layout: a header followed by 32-byte records (std430):
+//   [node bounds: node_count] [BVH nodes: bvh_node_count] [unbounded: unbounded_component_count]
+//
+// When only transforms change, the structures can be refit instead of rebuilt: bounds are
+// recomputed for the moved subtrees and their ancestors, and propagated up the BVH without
+// changing its shape. Refit BVH nodes may overlap more than rebuilt ones, so a refit fails
+// (and the caller rebuilds) once the BVH's SAH cost grows past 'WO_BVH_REFIT_MAX_COST_RATIO'
+// times its cost when built.
+//
+
+// boxes of unbounded nodes span '[-WO_GPU_BOUNDS_INFINITY, +WO_GPU_BOUNDS_INFINITY]'
+// NOTE: mirrored by 'T_INFINITY' in the ubershader.
+#define WO_GPU_BOUNDS_INFINITY (1e30f)
+
+#define WO_BVH_REFIT_MAX_COST_RATIO (1.5f)
+
+typedef struct GpuSceneAccelHeader GpuSceneAccelHeader;
+struct GpuSceneAccelHeader {
+    uint32_t node_count;
+    uint32_t bvh_node_count;
+    uint32_t bounded_component_count;
+    uint32_t unbounded_component_count;
+};
+
+typedef struct GpuNodeBounds GpuNodeBounds;
+struct GpuNodeBounds {
+    float min[3];
+    // the highest ancestor whose subtree starts at this node (itself if none):
+    // the first subtree the evaluator can skip when it reaches this node.
+    uint32_t cull_root;
+    float max[3];
+    // binops only: the operand visited (and emitted) first, whose subtree starts where
+    // this node's does.
+    uint32_t first_child;
+};
+
+typedef struct GpuBvhNode GpuBvhNode;
+struct GpuBvhNode {
+    float min[3];
+    // leaves: flat index of the component's root node
+    // interior nodes: index of the left child, the right child follows it.
+    uint32_t index;
+    float max[3];
+    uint32_t is_leaf;
+};
+
+// one per bounded component, in the layout of an acceleration structure's AABB geometry
+// (see 'VkAabbPositionsKHR', with a 32-byte stride): lets hardware ray queries stand in for
+// the BVH, with 'component_root' mapping a primitive index back to its component.
+typedef struct GpuComponentAabb GpuComponentAabb;
+struct GpuComponentAabb {
+    float min[3];
+    float max[3];
+    uint32_t component_root;
+    uint32_t _pad;
+};
+
+_Static_assert(sizeof(GpuSceneAccelHeader) == 16, "GpuSceneAccelHeader must be 16 bytes for std430.");
+_Static_assert(sizeof(GpuNodeBounds) == 32, "GpuNodeBounds must be 32 bytes for std430.");
+_Static_assert(sizeof(GpuBvhNode) == 32, "GpuBvhNode must be 32 bytes for std430.");
+_Static_assert(sizeof(GpuComponentAabb) == 32, "GpuComponentAabb must be 32 bytes for std430.");
+
+typedef struct SceneAccel SceneAccel;
+struct SceneAccel {
+    GpuNodeBounds* node_bounds;
+    uint32_t node_count;
+
+    GpuBvhNode* bvh_nodes;
+    uint32_t bvh_node_count;
+    uint32_t bounded_component_count;
+
+    // leaves with infinite boxes, one per unbounded component:
+    GpuBvhNode* unbounded_components;
+    uint32_t unbounded_component_count;
+
+    // CPU-only, kept for refits:
+    // - the roots of components culled for having empty bounds
+    // - the BVH's SAH cost (relative to its root's surface area) when it was built
+    uint32_t* empty_components;
+    uint32_t empty_component_count;
+    float build_sah_cost;
+};
+
+inline static bool bounds_are_infinite(float const min[3], float const max[3]) {
+    for (int i = 0; i < 3; i++) {
+        if (min[i] <= -WO_GPU_BOUNDS_INFINITY || max[i] >= WO_GPU_BOUNDS_INFINITY) {
+            return true;
+        }
+    }
+    return false;
+}
+inline static bool bounds_are_empty(float const min[3], float const max[3]) {
+    for (int i = 0; i < 3; i++) {
+        if (min[i] > max[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// bounds every node of 'flat_scene' (see above), writing one record per node to 'out_node_bounds':
+void bound_flat_scene(FlatScene const* flat_scene, GpuNodeBounds* out_node_bounds);
+
+bool build_scene_accel(FlatScene const* flat_scene, SceneAccel* out_scene_accel);
+void free_scene_accel(SceneAccel* scene_accel);
+
+// refits 'scene_accel' (built from 'flat_scene' before its nodes set in 'flat_dirty_bitset' were
+// moved, see 'flat_scene_compose_world_transforms') to the moved nodes.
+// Returns false if the BVH must be rebuilt instead: if a component's bounds became empty or
+// unbounded (or stopped being so), if the refit BVH degraded past 'WO_BVH_REFIT_MAX_COST_RATIO',
+// or if out of memory. The node bounds are refit even then.
+bool refit_scene_accel(FlatScene const* flat_scene, uint64_t const* flat_dirty_bitset, SceneAccel* scene_accel);
+float scene_accel_sah_cost(SceneAccel const* scene_accel);
+
+size_t scene_accel_gpu_size_in_bytes(SceneAccel const* scene_accel);
+void scene_accel_write_gpu_layout(SceneAccel const* scene_accel, void* dst);
+
+// writes the 'bounded_component_count' BVH leaves' boxes to 'dst'.
+void scene_accel_write_component_aabbs(SceneAccel const* scene_accel, GpuComponentAabb* dst);
@@ -0,0 +1,352 @@
+#include "gpu_arena.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+//
+// Local implementation:
+//
+
+static bool category_is_linear(Wo_Gpu_Memory_Category category);
+static VkDeviceSize align_up(VkDeviceSize offset, VkDeviceSize alignment);
+static bool find_memory_type(
+    GpuArena const* arena,
+    uint32_t type_filter,
+    VkMemoryPropertyFlags properties,
+    uint32_t* out_type_index
+);
+static bool new_block(
+    GpuArena* arena,
+    uint32_t memory_type_index,
+    Wo_Gpu_Memory_Category category,
+    VkDeviceSize size,
+    bool is_dedicated,
+    uint32_t* out_block_index
+);
+static void free_block(GpuArena* arena, uint32_t block_index);
+static bool block_allocate(GpuArenaBlock* block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* out_offset);
+static void block_free(GpuArenaBlock* block, VkDeviceSize offset, VkDeviceSize size);
+static bool insert_free_range(GpuArenaBlock* block, uint32_t index, VkDeviceSize offset, VkDeviceSize size);
+
+static bool category_is_linear(Wo_Gpu_Memory_Category category) {
+    return category == WO_GPU_MEMORY_STAGING;
+}
+static VkDeviceSize align_up(VkDeviceSize offset, VkDeviceSize alignment) {
+    // (Vulkan alignments are powers of 2)
+    if (alignment <= 1) {
+        return offset;
+    }
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+static bool find_memory_type(
+    GpuArena const* arena,
+    uint32_t type_filter,
+    VkMemoryPropertyFlags properties,
+    uint32_t* out_type_index
+) {
+    for (uint32_t i = 0; i < arena->memory_properties.memoryTypeCount; i++) {
+        bool bit_supported = type_filter & (1 << i);
+        bool props_supported = properties == (arena->memory_properties.memoryTypes[i].propertyFlags & properties);
+        if (bit_supported && props_supported) {
+            *out_type_index = i;
+            return true;
+        }
+    }
+    return false;
+}
+static bool new_block(
+    GpuArena* arena,
+    uint32_t memory_type_index,
+    Wo_Gpu_Memory_Category category,
+    VkDeviceSize size,
+    bool is_dedicated,
+    uint32_t* out_block_index
+) {
+    // reusing a freed slot if possible, so block indices stay stable:
+    uint32_t block_index = arena->block_count;
+    for (uint32_t i = 0; i < arena->block_count; i++) {
+        if (arena->blocks[i].memory == VK_NULL_HANDLE) {
+            block_index = i;
+            break;
+        }
+    }
+    if (block_index == arena->block_count && arena->block_count == arena->block_capacity) {
+        uint32_t new_capacity = arena->block_capacity > 0 ? 2 * arena->block_capacity : 8;
+        GpuArenaBlock* new_blocks = realloc(arena->blocks, new_capacity * sizeof(GpuArenaBlock));
+        if (new_blocks == NULL) {
+            return false;
+        }
+        arena->blocks = new_blocks;
+        arena->block_capacity = new_capacity;
+    }
+
+    VkMemoryAllocateInfo alloc_info;
+    memset(&alloc_info, 0, sizeof(alloc_info));
+    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    alloc_info.allocationSize = size;
+    alloc_info.memoryTypeIndex = memory_type_index;
+
+    // buffers read through device addresses (acceleration structure inputs) need memory
+    // allocated for it: since any buffer block may hold one, all of them are.
+    VkMemoryAllocateFlagsInfo alloc_flags_info;
+    memset(&alloc_flags_info, 0, sizeof(alloc_flags_info));
+    alloc_flags_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    alloc_flags_info.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+    if (arena->device_address_enabled && category != WO_GPU_MEMORY_IMAGES) {
+        alloc_info.pNext = &alloc_flags_info;
+    }
+
+    GpuArenaBlock block;
+    memset(&block, 0, sizeof(block));
+    if (vkAllocateMemory(arena->device, &alloc_info, NULL, &block.memory) != VK_SUCCESS) {
+        printf("[Wololo] Failed to allocate a %llu byte Vulkan memory block.\n", (unsigned long long)size);
+        return false;
+    }
+    block.size = size;
+    block.memory_type_index = memory_type_index;
+    block.category = category;
+    block.is_dedicated = is_dedicated;
+    if (arena->memory_properties.memoryTypes[memory_type_index].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+        void* mapped = NULL;
+        if (vkMapMemory(arena->device, block.memory, 0, size, 0, &mapped) != VK_SUCCESS) {
+            printf("[Wololo] Failed to map a Vulkan memory block.\n");
+            vkFreeMemory(arena->device, block.memory, NULL);
+            return false;
+        }
+        block.mapped = mapped;
+    }
+    if (!category_is_linear(category) && !insert_free_range(&block, 0, 0, size)) {
+        if (block.mapped) {
+            vkUnmapMemory(arena->device, block.memory);
+        }
+        vkFreeMemory(arena->device, block.memory, NULL);
+        return false;
+    }
+
+    arena->blocks[block_index] = block;
+    if (block_index == arena->block_count) {
+        arena->block_count++;
+    }
+    arena->reserved_bytes[category] += size;
+    *out_block_index = block_index;
+    return true;
+}
+static void free_block(GpuArena* arena, uint32_t block_index) {
+    GpuArenaBlock* block = &arena->blocks[block_index];
+    if (block->memory == VK_NULL_HANDLE) {
+        return;
+    }
+    if (block->mapped) {
+        vkUnmapMemory(arena->device, block->memory);
+    }
+    vkFreeMemory(arena->device, block->memory, NULL);
+    arena->reserved_bytes[block->category] -= block->size;
+    free(block->free_ranges);
+    memset(block, 0, sizeof(GpuArenaBlock));
+}
+static bool block_allocate(GpuArenaBlock* block, VkDeviceSize size, VkDeviceSize alignment, VkDeviceSize* out_offset) {
+    if (category_is_linear(block->category)) {
+        VkDeviceSize offset = align_up(block->linear_offset, alignment);
+        if (offset + size > block->size) {
+            return false;
+        }
+        block->linear_offset = offset + size;
+        *out_offset = offset;
+        return true;
+    }
+
+    // first-fit: the padding before an aligned allocation stays free.
+    for (uint32_t i = 0; i < block->free_range_count; i++) {
+        GpuArenaRange range = block->free_ranges[i];
+        VkDeviceSize offset = align_up(range.offset, alignment);
+        if (offset + size > range.offset + range.size) {
+            continue;
+        }
+        VkDeviceSize padding = offset - range.offset;
+        VkDeviceSize tail = range.offset + range.size - (offset + size);
+        if (padding > 0 && tail > 0) {
+            // splitting the range in two:
+            block->free_ranges[i].size = padding;
+            if (!insert_free_range(block, i + 1, offset + size, tail)) {
+                block->free_ranges[i] = range;
+                return false;
+            }
+        } else if (padding > 0) {
+            block->free_ranges[i].size = padding;
+        } else if (tail > 0) {
+            block->free_ranges[i].offset = offset + size;
+            block->free_ranges[i].size = tail;
+        } else {
+            memmove(
+                &block->free_ranges[i], &block->free_ranges[i + 1],
+                (block->free_range_count - i - 1) * sizeof(GpuArenaRange)
+            );
+            block->free_range_count--;
+        }
+        *out_offset = offset;
+        return true;
+    }
+    return false;
+}
+static void block_free(GpuArenaBlock* block, VkDeviceSize offset, VkDeviceSize size) {
+    if (category_is_linear(block->category)) {
+        if (block->live_allocation_count == 0) {
+            block->linear_offset = 0;
+        } else if (offset + size == block->linear_offset) {
+            block->linear_offset = offset;
+        }
+        return;
+    }
+
+    // inserting the range in order, coalescing it with its neighbors:
+    uint32_t i = 0;
+    while (i < block->free_range_count && block->free_ranges[i].offset < offset) {
+        i++;
+    }
+    bool merges_prev = i > 0 && block->free_ranges[i - 1].offset + block->free_ranges[i - 1].size == offset;
+    bool merges_next = i < block->free_range_count && offset + size == block->free_ranges[i].offset;
+    if (merges_prev && merges_next) {
+        block->free_ranges[i - 1].size += size + block->free_ranges[i].size;
+        memmove(
+            &block->free_ranges[i], &block->free_ranges[i + 1],
+            (block->free_range_count - i - 1) * sizeof(GpuArenaRange)
+        );
+        block->free_range_count--;
+    } else if (merges_prev) {
+        block->free_ranges[i - 1].size += size;
+    } else if (merges_next) {
+        block->free_ranges[i].offset = offset;
+        block->free_ranges[i].size += size;
+    } else if (!insert_free_range(block, i, offset, size)) {
+        // out of memory: leaking the range until the block is freed.
+        printf("[Wololo] Failed to return %llu bytes to a Vulkan memory block.\n", (unsigned long long)size);
+    }
+}
+static bool insert_free_range(GpuArenaBlock* block, uint32_t index, VkDeviceSize offset, VkDeviceSize size) {
+    if (block->free_range_count == block->free_range_capacity) {
+        uint32_t new_capacity = block->free_range_capacity > 0 ? 2 * block->free_range_capacity : 16;
+        GpuArenaRange* new_ranges = realloc(block->free_ranges, new_capacity * sizeof(GpuArenaRange));
+        if (new_ranges == NULL) {
+            return false;
+        }
+        block->free_ranges = new_ranges;
+        block->free_range_capacity = new_capacity;
+    }
+    memmove(
+        &block->free_ranges[index + 1], &block->free_ranges[index],
+        (block->free_range_count - index) * sizeof(GpuArenaRange)
+    );
+    block->free_ranges[index].offset = offset;
+    block->free_ranges[index].size = size;
+    block->free_range_count++;
+    return true;
+}
+
+//
+// Implementation:
+//
+
+void new_gpu_arena(
+    VkPhysicalDevice physical_device,
+    VkDevice device,
+    bool device_address_enabled,
+    GpuArena* out_arena
+) {
+    memset(out_arena, 0, sizeof(GpuArena));
+    out_arena->device = device;
+    out_arena->device_address_enabled = device_address_enabled;
+    vkGetPhysicalDeviceMemoryProperties(physical_device, &out_arena->memory_properties);
+}
+void del_gpu_arena(GpuArena* arena) {
+    for (uint32_t i = 0; i < arena->block_count; i++) {
+        free_block(arena, i);
+    }
+    free(arena->blocks);
+    memset(arena, 0, sizeof(GpuArena));
+}
+
+bool gpu_arena_allocate(
+    GpuArena* arena,
+    Wo_Gpu_Memory_Category category,
+    VkMemoryRequirements const* requirements,
+    VkMemoryPropertyFlags properties,
+    GpuAllocation* out_allocation
+) {
+    memset(out_allocation, 0, sizeof(GpuAllocation));
+    uint32_t memory_type_index = 0;
+    if (!find_memory_type(arena, requirements->memoryTypeBits, properties, &memory_type_index)) {
+        printf("[Wololo] Failed to find a suitable Vulkan memory type.\n");
+        return false;
+    }
+
+    // sub-allocating from the first block of the same kind with room left, else from a new one:
+    uint32_t block_index = arena->block_count;
+    VkDeviceSize offset = 0;
+    if (requirements->size <= WO_GPU_ARENA_BLOCK_SIZE / 2) {
+        for (uint32_t i = 0; i < arena->block_count; i++) {
+            GpuArenaBlock* block = &arena->blocks[i];
+            bool same_kind = (
+                block->memory != VK_NULL_HANDLE &&
+                !block->is_dedicated &&
+                block->memory_type_index == memory_type_index &&
+                block->category == category
+            );
+            if (same_kind && block_allocate(block, requirements->size, requirements->alignment, &offset)) {
+                block_index = i;
+                break;
+            }
+        }
+        if (block_index == arena->block_count) {
+            if (!new_block(arena, memory_type_index, category, WO_GPU_ARENA_BLOCK_SIZE, false, &block_index)) {
+                return false;
+            }
+            bool allocate_ok = block_allocate(&arena->blocks[block_index], requirements->size, requirements->alignment, &offset);
+            assert(allocate_ok && "An empty Vulkan memory block is too small.");
+            (void)allocate_ok;
+        }
+    } else {
+        if (!new_block(arena, memory_type_index, category, requirements->size, true, &block_index)) {
+            return false;
+        }
+    }
+
+    GpuArenaBlock* block = &arena->blocks[block_index];
+    block->live_allocation_count++;
+    out_allocation->memory = block->memory;
+    out_allocation->offset = offset;
+    out_allocation->size = requirements->size;
+    out_allocation->mapped = block->mapped ? block->mapped + offset : NULL;
+    out_allocation->block_index = block_index;
+    out_allocation->category = category;
+    arena->in_use_bytes[category] += requirements->size;
+    arena->allocation_count[category]++;
+    return true;
+}
+void gpu_arena_free(GpuArena* arena, GpuAllocation* allocation) {
+    if (allocation->memory == VK_NULL_HANDLE) {
+        return;
+    }
+    GpuArenaBlock* block = &arena->blocks[allocation->block_index];
+    assert(block->memory == allocation->memory && block->live_allocation_count > 0);
+    block->live_allocation_count--;
+    arena->in_use_bytes[allocation->category] -= allocation->size;
+    arena->allocation_count[allocation->category]--;
+    if (block->is_dedicated) {
+        free_block(arena, allocation->block_index);
+    } else {
+        block_free(block, allocation->offset, allocation->size);
+    }
+    memset(allocation, 0, sizeof(GpuAllocation));
+}
+
+uint32_t gpu_arena_block_count(GpuArena const* arena) {
+    uint32_t count = 0;
+    for (uint32_t i = 0; i < arena->block_count; i++) {
+        if (arena->blocks[i].memory != VK_NULL_HANDLE) {
+            count++;
+        }
+    }
+    return count;
+}
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "wololo/platform.h"
+#include "renderer.h"
+
+//
+// GpuArena sub-allocates buffers' and images' device memory from large blocks, so that the
+// renderer makes a handful of 'vkAllocateMemory' calls (bounded by 'maxMemoryAllocationCount')
+// rather than one per buffer.
+//
+// - blocks are allocated per memory type and per category (see 'Wo_Gpu_Memory_Category'), so
+//   buffers and images never share a block (no 'bufferImageGranularity' padding is needed).
+// - staging blocks are linear: allocations bump an offset, which is rolled back when the last
+//   allocation is freed first (e.g. scoped uploads), and reset once the block is empty.
+// - other blocks keep a sorted, coalesced free-list, allocated from first-fit.
+// - requests larger than half a block get a dedicated block, freed along with them.
+// - host-visible blocks are mapped once, for the arena's lifetime: allocations are handed a
+//   pointer into the mapping rather than mapping their memory themselves.
+//
+
+#define WO_GPU_ARENA_BLOCK_SIZE ((VkDeviceSize)64 << 20)
+
+typedef struct GpuAllocation GpuAllocation;
+struct GpuAllocation {
+    VkDeviceMemory memory;
+    VkDeviceSize offset;
+    VkDeviceSize size;
+    // NULL unless host-visible:
+    uint8_t* mapped;
+    uint32_t block_index;
+    Wo_Gpu_Memory_Category category;
+};
+
+typedef struct GpuArenaRange GpuArenaRange;
+struct GpuArenaRange {
+    VkDeviceSize offset;
+    VkDeviceSize size;
+};
+
+typedef struct GpuArenaBlock GpuArenaBlock;
+struct GpuArenaBlock {
+    // VK_NULL_HANDLE once freed, so the slot can be reused:
+    VkDeviceMemory memory;
+    VkDeviceSize size;
+    uint32_t memory_type_index;
+    Wo_Gpu_Memory_Category category;
+    bool is_dedicated;
+    uint8_t* mapped;
+    uint32_t live_allocation_count;
+
+    // linear blocks only:
+    VkDeviceSize linear_offset;
+
+    // free-list blocks only:
+    GpuArenaRange* free_ranges;
+    uint32_t free_range_count;
+    uint32_t free_range_capacity;
+};
+
+typedef struct GpuArena GpuArena;
+struct GpuArena {
+    VkDevice device;
+    VkPhysicalDeviceMemoryProperties memory_properties;
+    // whether buffer memory is allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT, which
+    // requires the 'bufferDeviceAddress' feature:
+    bool device_address_enabled;
+
+    GpuArenaBlock* blocks;
+    uint32_t block_count;
+    uint32_t block_capacity;
+
+    uint64_t in_use_bytes[WO_GPU_MEMORY_CATEGORY_COUNT];
+    uint64_t reserved_bytes[WO_GPU_MEMORY_CATEGORY_COUNT];
+    uint32_t allocation_count[WO_GPU_MEMORY_CATEGORY_COUNT];
+};
+
+void new_gpu_arena(
+    VkPhysicalDevice physical_device,
+    VkDevice device,
+    bool device_address_enabled,
+    GpuArena* out_arena
+);
+// NOTE: every allocation must have been freed (their memory is freed regardless).
+void del_gpu_arena(GpuArena* arena);
+
+// returns false (leaving 'out_allocation' zeroed) if no memory type or memory is available.
+bool gpu_arena_allocate(
+    GpuArena* arena,
+    Wo_Gpu_Memory_Category category,
+    VkMemoryRequirements const* requirements,
+    VkMemoryPropertyFlags properties,
+    GpuAllocation* out_allocation
+);
+// frees 'allocation' (if any) and zeroes it.
+void gpu_arena_free(GpuArena* arena, GpuAllocation* allocation);
+
+uint32_t gpu_arena_block_count(GpuArena const* arena);
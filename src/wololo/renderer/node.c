@@ -0,0 +1,52 @@
+#include "node.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+
+//
+// Implementation:
+//
+
+bool node_store_reserve(NodeStore* store, size_t begin_node, size_t end_node) {
+    if (end_node <= begin_node) {
+        return true;
+    }
+    size_t first_chunk = begin_node / WO_NODE_CHUNK_SIZE;
+    size_t last_chunk = (end_node - 1) / WO_NODE_CHUNK_SIZE;
+    if (last_chunk >= WO_NODE_MAX_CHUNK_COUNT) {
+        return false;
+    }
+    for (size_t chunk_index = first_chunk; chunk_index <= last_chunk; chunk_index++) {
+        // scene builders on other threads may be reserving the same chunk: whoever installs theirs
+        // first wins, and the others free theirs.
+        _Atomic(NodeChunk*)* slot = &store->chunks[chunk_index];
+        if (atomic_load_explicit(slot, memory_order_acquire) != NULL) {
+            continue;
+        }
+        NodeChunk* chunk = calloc(1, sizeof(NodeChunk));
+        if (chunk == NULL) {
+            fprintf(stderr, "[Wololo] Failed to allocate %zu bytes for a node chunk.\n", sizeof(NodeChunk));
+            return false;
+        }
+        NodeChunk* expected = NULL;
+        if (!atomic_compare_exchange_strong_explicit(slot, &expected, chunk, memory_order_acq_rel, memory_order_acquire)) {
+            free(chunk);
+        }
+    }
+    return true;
+}
+void node_store_free(NodeStore* store) {
+    for (size_t chunk_index = 0; chunk_index < WO_NODE_MAX_CHUNK_COUNT; chunk_index++) {
+        free(store->chunks[chunk_index]);
+        store->chunks[chunk_index] = NULL;
+    }
+}
+size_t node_store_size_in_bytes(NodeStore const* store) {
+    size_t size = 0;
+    for (size_t chunk_index = 0; chunk_index < WO_NODE_MAX_CHUNK_COUNT; chunk_index++) {
+        if (store->chunks[chunk_index] != NULL) {
+            size += sizeof(NodeChunk);
+        }
+    }
+    return size;
+}
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "renderer.h"
+#include "wololo/wmath.h"
+
+//
+// Nodes: representation of an algebraic expression
+// (shared between the renderer's translation units, not part of the interface)
+//
+
+// NOTE: these values are mirrored by the 'NODE_TYPE_*' constants in ubershader1-common.glsl;
+//       keep both in sync.
+typedef enum NodeType NodeType;
+typedef union NodeInfo NodeInfo;
+enum NodeType {
+    WO_LEAF_SPHERE = 0,
+    WO_LEAF_INFINITE_PLANAR_PARTITION = 1,
+    WO_NODE_BINOP_UNION_OF = 2,
+    WO_NODE_BINOP_INTERSECTION_OF = 3,
+    WO_NODE_BINOP_DIFFERENCE_OF = 4,
+    // never in the node tables: stands in for a shared component of the scene once flattened,
+    // referring to the single copy of its subtree (see 'flatten_scene'):
+    WO_NODE_INSTANCE = 5,
+    // removed nodes, chained into the renderer's free-list until reused (never flattened, so
+    // not mirrored by the shaders):
+    WO_NODE_FREE = 6
+};
+union NodeInfo {
+    struct {
+        Wo_Scalar radius;
+        Wo_Material material;
+    } sphere;
+
+    struct {
+        Wo_Vec3 normal;
+        Wo_Material material;
+    } infinite_planar_partition;
+
+    struct {
+        Wo_Node_Argument left;
+        Wo_Node_Argument right;
+    } binop_of;
+
+    struct {
+        // the next free node, or WO_NODE_NONE:
+        Wo_Node next;
+    } free;
+};
+
+inline static bool node_type_is_leaf(NodeType type) {
+    return (
+        type == WO_LEAF_SPHERE ||
+        type == WO_LEAF_INFINITE_PLANAR_PARTITION ||
+        type == WO_NODE_INSTANCE
+    );
+}
+
+//
+// Node storage: the node tables are split into chunks of WO_NODE_CHUNK_SIZE nodes, allocated as
+// nodes are added. Chunks never move once allocated, so Wo_Nodes (and pointers into the tables)
+// stay valid as the scene grows; only the chunk table, which has room for
+// WO_NODE_MAX_CHUNK_COUNT chunks, is reserved up front.
+// Each chunk keeps the tables' SoA layout (and its own slice of the per-node bitsets), so
+// 'node / WO_NODE_CHUNK_SIZE' picks the chunk and 'node % WO_NODE_CHUNK_SIZE' the slots in it.
+//
+
+#define WO_NODE_CHUNK_SIZE (4096)
+#define WO_NODE_MAX_CHUNK_COUNT (WO_RENDERER_MAX_NODE_COUNT / WO_NODE_CHUNK_SIZE)
+
+typedef struct NodeChunk NodeChunk;
+struct NodeChunk {
+    NodeType type_table[WO_NODE_CHUNK_SIZE];
+    NodeInfo info_table[WO_NODE_CHUNK_SIZE];
+    // how many binop operands refer to each node (so whether removing one frees it):
+    // (atomic, like the non-root bits, since scene builders on different threads may refer to
+    // the same nodes, and mark nodes sharing a word)
+    _Atomic uint32_t reference_count_table[WO_NODE_CHUNK_SIZE];
+    _Atomic uint64_t is_nonroot_bitset[WO_NODE_CHUNK_SIZE / 64];
+    uint64_t is_dirty_bitset[WO_NODE_CHUNK_SIZE / 64];
+};
+
+typedef struct NodeStore NodeStore;
+struct NodeStore {
+    // NULL until the first node in the chunk is reserved: (atomic, since scene builders on
+    // different threads may reserve the same chunk, see 'node_store_reserve')
+    _Atomic(NodeChunk*) chunks[WO_NODE_MAX_CHUNK_COUNT];
+};
+
+// allocates (zeroed) every chunk holding a node in [begin_node, end_node) that is not allocated
+// yet; safe to call from several threads at once. Returns false if out of memory.
+bool node_store_reserve(NodeStore* store, size_t begin_node, size_t end_node);
+// frees every allocated chunk.
+void node_store_free(NodeStore* store);
+// bytes allocated by chunks:
+size_t node_store_size_in_bytes(NodeStore const* store);
+
+// NOTE: 'node' must have been reserved.
+// (relaxed: a node's chunk was reserved by whoever writes the node, which synchronized with it)
+inline static NodeChunk* node_chunk(NodeStore const* store, Wo_Node node) {
+    return atomic_load_explicit(&store->chunks[node / WO_NODE_CHUNK_SIZE], memory_order_relaxed);
+}
+inline static NodeType* node_type(NodeStore const* store, Wo_Node node) {
+    return &node_chunk(store, node)->type_table[node % WO_NODE_CHUNK_SIZE];
+}
+inline static NodeInfo* node_info(NodeStore const* store, Wo_Node node) {
+    return &node_chunk(store, node)->info_table[node % WO_NODE_CHUNK_SIZE];
+}
+inline static _Atomic uint32_t* node_reference_count(NodeStore const* store, Wo_Node node) {
+    return &node_chunk(store, node)->reference_count_table[node % WO_NODE_CHUNK_SIZE];
+}
+// the bitset words holding 'node''s bit, and its mask:
+inline static _Atomic uint64_t* node_nonroot_word(NodeStore const* store, Wo_Node node) {
+    return &node_chunk(store, node)->is_nonroot_bitset[(node % WO_NODE_CHUNK_SIZE) / 64];
+}
+inline static uint64_t* node_dirty_word(NodeStore const* store, Wo_Node node) {
+    return &node_chunk(store, node)->is_dirty_bitset[(node % WO_NODE_CHUNK_SIZE) / 64];
+}
+inline static uint64_t node_bit(Wo_Node node) {
+    return ((uint64_t)1) << (node % 64);
+}
+inline static bool node_is_root(NodeStore const* store, Wo_Node node) {
+    return !(*node_nonroot_word(store, node) & node_bit(node));
+}
@@ -0,0 +1,839 @@
+#include "optimize.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+#include <math.h>
+
+#include "bvh.h"
+
+//
+// Local implementation:
+//
+
+// the result of flattened nodes whose solid is provably empty:
+#define OPT_NODE_EMPTY (0xFFFFFFFFu)
+
+// a node of the optimized tree, emitted into the output scene once every rewrite is done.
+typedef struct OptNode OptNode;
+struct OptNode {
+    // the flattened node this one copies (type, params and flags), or WO_FLAT_NODE_NONE for
+    // unions added by rebalancing:
+    uint32_t flat_index;
+    uint32_t type;
+    // binops only, in operand (not visiting) order:
+    uint32_t operands[2];
+    float world_to_local[3][4];
+    float min[3];
+    float max[3];
+    // equal for solids that are identical in world space (but may collide):
+    uint64_t hash;
+    // of the subtree rooted here, set before emission, and where this node was emitted:
+    uint32_t stack_depth;
+    uint32_t height;
+    uint32_t out_index;
+};
+
+typedef struct OptSortKey OptSortKey;
+struct OptSortKey {
+    float key;
+    uint64_t hash;
+    uint32_t node;
+};
+
+typedef enum BoxSide BoxSide;
+enum BoxSide {
+    BOX_STRADDLES,
+    BOX_INSIDE,
+    BOX_OUTSIDE
+};
+
+typedef struct Optimizer Optimizer;
+struct Optimizer {
+    FlatScene const* flat_scene;
+    GpuNodeBounds* flat_bounds;
+    // per flattened node: the OptNode evaluating the same solid (or OPT_NODE_EMPTY)
+    uint32_t* results;
+    // per flattened node: whether a rewrite was applied to its subtree, then (see
+    // 'mark_optimized_sources') whether it lies in such a subtree.
+    uint64_t* rewritten_bitset;
+
+    // the nodes of the optimized tree: flattened nodes map to at most one each, plus the
+    // unions added by rebalancing.
+    OptNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+
+    // scratch space sized for every node: explicit DFS stacks, chain operands, sort keys
+    uint32_t* stack;
+    uint32_t* pair_stack;
+    uint32_t* chain_items;
+    OptSortKey* sort_keys;
+
+    // how many balanced levels rebalancing may add to the CSG stack:
+    uint32_t rebalance_level_budget;
+    SceneOptimizeStats stats;
+};
+
+static bool bit_is_set(uint64_t const* bitset, uint32_t index);
+static void set_bit(uint64_t* bitset, uint32_t index);
+static void flat_operands(FlatScene const* flat_scene, uint32_t node_index, uint32_t out_operands[2]);
+static uint64_t hash_mix(uint64_t hash, uint64_t value);
+static uint64_t hash_floats(uint64_t hash, float const* values, size_t count);
+static bool type_is_commutative(uint32_t type);
+static uint32_t push_copy_node(Optimizer* opt, uint32_t flat_index, uint32_t const opt_operands[2]);
+static uint32_t push_union_node(Optimizer* opt, uint32_t left, uint32_t right, float const world_to_local[3][4]);
+static bool opt_nodes_are_equal(Optimizer* opt, uint32_t a, uint32_t b);
+static bool boxes_are_disjoint(OptNode const* a, OptNode const* b);
+static BoxSide classify_box(Optimizer const* opt, OptNode const* half_space, OptNode const* boxed);
+static uint32_t optimize_binop(Optimizer* opt, uint32_t flat_index, uint32_t const opt_operands[2]);
+static void optimize_flat_nodes(Optimizer* opt);
+static int compare_sort_keys(void const* a, void const* b);
+static uint32_t build_union_tree(
+    Optimizer* opt, uint32_t* items, uint32_t count, uint32_t levels,
+    float const world_to_local[3][4]
+);
+static uint32_t rebuild_union_chain(Optimizer* opt, uint32_t chain_root);
+static void rebalance_union_chains(Optimizer* opt, uint32_t root);
+static uint32_t compute_stack_depths(Optimizer* opt, uint32_t root);
+static void compose_parent_to_local(float const child[3][4], float const parent[3][4], float out[3][4]);
+static void emit_tree(
+    Optimizer* opt, uint32_t root, FlatScene* out,
+    uint32_t* out_flat_indices, uint64_t* intact_bitset, uint32_t* emitted_count
+);
+static bool emit_flat_scene(Optimizer* opt, FlatScene* out_flat_scene);
+static bool run_optimizer(FlatScene const* flat_scene, uint32_t rebalance_level_budget, FlatScene* out_flat_scene, SceneOptimizeStats* out_stats);
+
+static bool bit_is_set(uint64_t const* bitset, uint32_t index) {
+    return (bitset[index/64] >> (index%64)) & 1;
+}
+static void set_bit(uint64_t* bitset, uint32_t index) {
+    bitset[index/64] |= ((uint64_t)1) << (index%64);
+}
+static void flat_operands(FlatScene const* flat_scene, uint32_t node_index, uint32_t out_operands[2]) {
+    // (see 'flat_scene_refresh_operand_transforms')
+    uint32_t second_child = node_index - 1;
+    uint32_t first_child = second_child - flat_scene->nodes[second_child].subtree_size;
+    bool swapped = (flat_scene->nodes[node_index].flags & WO_GPU_NODE_FLAG_OPERANDS_SWAPPED) != 0;
+    out_operands[0] = swapped ? second_child : first_child;
+    out_operands[1] = swapped ? first_child : second_child;
+}
+static uint64_t hash_mix(uint64_t hash, uint64_t value) {
+    // see: https://en.wikipedia.org/wiki/Fowler%E2%80%93Noll%E2%80%93Vo_hash_function (per 64-bit word)
+    hash ^= value;
+    hash *= 0x100000001b3ull;
+    return hash ^ (hash >> 29);
+}
+static uint64_t hash_floats(uint64_t hash, float const* values, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        uint32_t bits;
+        memcpy(&bits, &values[i], sizeof(bits));
+        hash = hash_mix(hash, bits);
+    }
+    return hash;
+}
+static bool type_is_commutative(uint32_t type) {
+    return type == WO_NODE_BINOP_UNION_OF || type == WO_NODE_BINOP_INTERSECTION_OF;
+}
+static uint32_t push_copy_node(Optimizer* opt, uint32_t flat_index, uint32_t const opt_operands[2]) {
+    assert(opt->node_count < opt->node_capacity);
+    uint32_t index = opt->node_count++;
+    GpuSceneNode const* flat_node = &opt->flat_scene->nodes[flat_index];
+    GpuNodeBounds const* bounds = &opt->flat_bounds[flat_index];
+    OptNode* node = &opt->nodes[index];
+    memset(node, 0, sizeof(OptNode));
+    node->flat_index = flat_index;
+    node->type = flat_node->type;
+    memcpy(node->world_to_local, flat_node->world_to_local, sizeof(node->world_to_local));
+    memcpy(node->min, bounds->min, sizeof(node->min));
+    memcpy(node->max, bounds->max, sizeof(node->max));
+
+    // leaves hash their world-space shape, binops their operands' (composed transforms make
+    // their own irrelevant):
+    uint64_t hash = hash_mix(0xcbf29ce484222325ull, node->type);
+    if (node_type_is_leaf((NodeType)node->type)) {
+        node->operands[0] = node->operands[1] = OPT_NODE_EMPTY;
+        hash = hash_mix(hash, flat_node->flags >> WO_GPU_NODE_MATERIAL_SHIFT);
+        hash = hash_floats(hash, flat_node->params, 4);
+        hash = hash_floats(hash, &node->world_to_local[0][0], 12);
+    } else {
+        node->operands[0] = opt_operands[0];
+        node->operands[1] = opt_operands[1];
+        uint64_t a = opt->nodes[opt_operands[0]].hash;
+        uint64_t b = opt->nodes[opt_operands[1]].hash;
+        if (type_is_commutative(node->type) && a > b) {
+            uint64_t t = a; a = b; b = t;
+        }
+        hash = hash_mix(hash_mix(hash, a), b);
+    }
+    node->hash = hash;
+    return index;
+}
+static uint32_t push_union_node(Optimizer* opt, uint32_t left, uint32_t right, float const world_to_local[3][4]) {
+    assert(opt->node_count < opt->node_capacity);
+    uint32_t index = opt->node_count++;
+    OptNode const* a = &opt->nodes[left];
+    OptNode const* b = &opt->nodes[right];
+    OptNode* node = &opt->nodes[index];
+    memset(node, 0, sizeof(OptNode));
+    node->flat_index = WO_FLAT_NODE_NONE;
+    node->type = WO_NODE_BINOP_UNION_OF;
+    node->operands[0] = left;
+    node->operands[1] = right;
+    memcpy(node->world_to_local, world_to_local, sizeof(node->world_to_local));
+    for (int axis = 0; axis < 3; axis++) {
+        node->min[axis] = a->min[axis] < b->min[axis] ? a->min[axis] : b->min[axis];
+        node->max[axis] = a->max[axis] > b->max[axis] ? a->max[axis] : b->max[axis];
+    }
+    uint64_t ha = a->hash < b->hash ? a->hash : b->hash;
+    uint64_t hb = a->hash < b->hash ? b->hash : a->hash;
+    node->hash = hash_mix(hash_mix(hash_mix(0xcbf29ce484222325ull, node->type), ha), hb);
+    return index;
+}
+static bool opt_nodes_are_equal(Optimizer* opt, uint32_t a, uint32_t b) {
+    // comparing pairs of subtrees with an explicit stack: commutative operands are compared in
+    // hash order, so equal solids whose operands' hashes tie may compare unequal (which only
+    // misses a rewrite).
+    if (opt->nodes[a].hash != opt->nodes[b].hash) {
+        return false;
+    }
+    uint32_t pair_count = 0;
+    opt->pair_stack[2*pair_count] = a;
+    opt->pair_stack[2*pair_count + 1] = b;
+    pair_count++;
+    while (pair_count > 0) {
+        pair_count--;
+        OptNode const* x = &opt->nodes[opt->pair_stack[2*pair_count]];
+        OptNode const* y = &opt->nodes[opt->pair_stack[2*pair_count + 1]];
+        if (x == y) {
+            continue;
+        }
+        if (x->type != y->type || x->hash != y->hash) {
+            return false;
+        }
+        if (node_type_is_leaf((NodeType)x->type)) {
+            GpuSceneNode const* fx = &opt->flat_scene->nodes[x->flat_index];
+            GpuSceneNode const* fy = &opt->flat_scene->nodes[y->flat_index];
+            if (
+                (fx->flags >> WO_GPU_NODE_MATERIAL_SHIFT) != (fy->flags >> WO_GPU_NODE_MATERIAL_SHIFT) ||
+                0 != memcmp(fx->params, fy->params, sizeof(fx->params)) ||
+                0 != memcmp(x->world_to_local, y->world_to_local, sizeof(x->world_to_local))
+            ) {
+                return false;
+            }
+            continue;
+        }
+        uint32_t xo[2] = {x->operands[0], x->operands[1]};
+        uint32_t yo[2] = {y->operands[0], y->operands[1]};
+        if (type_is_commutative(x->type)) {
+            if (opt->nodes[xo[0]].hash > opt->nodes[xo[1]].hash) {
+                uint32_t t = xo[0]; xo[0] = xo[1]; xo[1] = t;
+            }
+            if (opt->nodes[yo[0]].hash > opt->nodes[yo[1]].hash) {
+                uint32_t t = yo[0]; yo[0] = yo[1]; yo[1] = t;
+            }
+        }
+        // (every pair is of distinct nodes below the compared ones, so the stack fits)
+        for (int k = 0; k < 2; k++) {
+            opt->pair_stack[2*pair_count] = xo[k];
+            opt->pair_stack[2*pair_count + 1] = yo[k];
+            pair_count++;
+        }
+    }
+    return true;
+}
+static bool boxes_are_disjoint(OptNode const* a, OptNode const* b) {
+    for (int axis = 0; axis < 3; axis++) {
+        if (a->max[axis] < b->min[axis] || b->max[axis] < a->min[axis]) {
+            return true;
+        }
+    }
+    return false;
+}
+static BoxSide classify_box(Optimizer const* opt, OptNode const* half_space, OptNode const* boxed) {
+    // the half-space is 'dot(n, p_local) <= 0' with 'p_local = A * p + t' (see the ubershader's
+    // 'hit_infinite_planar_partition'), i.e. 'dot(A^T * n, p) + dot(n, t) <= 0' in world space.
+    if (bounds_are_infinite(boxed->min, boxed->max)) {
+        return BOX_STRADDLES;
+    }
+    float const* n = opt->flat_scene->nodes[half_space->flat_index].params;
+    float const (*m)[4] = half_space->world_to_local;
+    float offset = n[0]*m[0][3] + n[1]*m[1][3] + n[2]*m[2][3];
+    float lo = offset;
+    float hi = offset;
+    float scale = fabsf(offset);
+    for (int axis = 0; axis < 3; axis++) {
+        float coefficient = n[0]*m[0][axis] + n[1]*m[1][axis] + n[2]*m[2][axis];
+        float near = coefficient > 0.0f ? boxed->min[axis] : boxed->max[axis];
+        float far = coefficient > 0.0f ? boxed->max[axis] : boxed->min[axis];
+        lo += coefficient * near;
+        hi += coefficient * far;
+        scale += fabsf(coefficient) * (fabsf(near) + fabsf(far));
+    }
+    // (a margin, so that surfaces touching the plane are never dropped)
+    float margin = 1e-5f * scale + 1e-6f;
+    if (hi < -margin) {
+        return BOX_INSIDE;
+    } else if (lo > margin) {
+        return BOX_OUTSIDE;
+    } else {
+        return BOX_STRADDLES;
+    }
+}
+static uint32_t optimize_binop(Optimizer* opt, uint32_t flat_index, uint32_t const opt_operands[2]) {
+    // returns the node evaluating the same solid as the flattened binop given the results of
+    // its operands, counting (and marking) any rewrite.
+    uint32_t type = opt->flat_scene->nodes[flat_index].type;
+    uint32_t a = opt_operands[0];
+    uint32_t b = opt_operands[1];
+    bool const is_union = type == WO_NODE_BINOP_UNION_OF;
+    bool const is_intersection = type == WO_NODE_BINOP_INTERSECTION_OF;
+    bool const is_difference = type == WO_NODE_BINOP_DIFFERENCE_OF;
+
+    uint32_t result = OPT_NODE_EMPTY;
+    bool pruned = false;
+    bool deduplicated = false;
+    if (a == OPT_NODE_EMPTY || b == OPT_NODE_EMPTY) {
+        // 'A | 0 = A', 'A & 0 = 0', 'A - 0 = A', '0 - B = 0':
+        pruned = true;
+        if (is_union) {
+            result = (a == OPT_NODE_EMPTY) ? b : a;
+        } else if (is_difference) {
+            result = a;
+        }
+    } else if (opt_nodes_are_equal(opt, a, b)) {
+        // 'A | A = A & A = A', 'A - A = 0':
+        deduplicated = true;
+        result = is_difference ? OPT_NODE_EMPTY : a;
+    } else if (is_difference && boxes_are_disjoint(&opt->nodes[a], &opt->nodes[b])) {
+        pruned = true;
+        result = a;
+    } else {
+        // with a half-space operand, testing the other operand's box against its plane:
+        for (int k = 0; k < 2 && !pruned; k++) {
+            uint32_t half_space = opt_operands[k];
+            uint32_t other = opt_operands[1 - k];
+            if (opt->nodes[half_space].type != WO_LEAF_INFINITE_PLANAR_PARTITION) {
+                continue;
+            }
+            if (is_difference && k == 0) {
+                // (a half-space minus a box has no simpler form)
+                continue;
+            }
+            BoxSide side = classify_box(opt, &opt->nodes[half_space], &opt->nodes[other]);
+            if (side == BOX_INSIDE) {
+                pruned = true;
+                result = is_intersection ? other : (is_union ? half_space : OPT_NODE_EMPTY);
+            } else if (side == BOX_OUTSIDE && !is_union) {
+                pruned = true;
+                result = is_intersection ? OPT_NODE_EMPTY : other;
+            }
+        }
+    }
+    if (pruned || deduplicated) {
+        set_bit(opt->rewritten_bitset, flat_index);
+        if (pruned) {
+            opt->stats.pruned_subtree_count++;
+        } else {
+            opt->stats.deduplicated_subtree_count++;
+        }
+        return result;
+    }
+    return push_copy_node(opt, flat_index, opt_operands);
+}
+static void optimize_flat_nodes(Optimizer* opt) {
+    // rewriting bottom-up: children precede their parents in post-order.
+    FlatScene const* flat_scene = opt->flat_scene;
+    for (uint32_t i = 0; i < flat_scene->node_count; i++) {
+        GpuNodeBounds const* bounds = &opt->flat_bounds[i];
+        if (bounds_are_empty(bounds->min, bounds->max)) {
+            // e.g. the intersection of disjoint spheres:
+            set_bit(opt->rewritten_bitset, i);
+            opt->stats.pruned_subtree_count++;
+            opt->results[i] = OPT_NODE_EMPTY;
+        } else if (node_type_is_leaf((NodeType)flat_scene->nodes[i].type)) {
+            opt->results[i] = push_copy_node(opt, i, NULL);
+        } else {
+            uint32_t operands[2];
+            flat_operands(flat_scene, i, operands);
+            uint32_t opt_operands[2] = {opt->results[operands[0]], opt->results[operands[1]]};
+            opt->results[i] = optimize_binop(opt, i, opt_operands);
+        }
+    }
+}
+static int compare_sort_keys(void const* a, void const* b) {
+    OptSortKey const* ka = a;
+    OptSortKey const* kb = b;
+    if (ka->key != kb->key) {
+        return ka->key < kb->key ? -1 : 1;
+    }
+    if (ka->hash != kb->hash) {
+        return ka->hash < kb->hash ? -1 : 1;
+    }
+    return (ka->node > kb->node) - (ka->node < kb->node);
+}
+static uint32_t build_union_tree(
+    Optimizer* opt, uint32_t* items, uint32_t count, uint32_t levels,
+    float const world_to_local[3][4]
+) {
+    // splits the items at the median of their centroids along the axis they spread most on,
+    // 'levels' times, then joins each group with a (left-deep) chain.
+    assert(count > 0);
+    if (levels == 0 || count <= 2) {
+        uint32_t chain = items[0];
+        for (uint32_t i = 1; i < count; i++) {
+            chain = push_union_node(opt, chain, items[i], world_to_local);
+        }
+        return chain;
+    }
+    float centroid_min[3] = {INFINITY, INFINITY, INFINITY};
+    float centroid_max[3] = {-INFINITY, -INFINITY, -INFINITY};
+    for (uint32_t i = 0; i < count; i++) {
+        OptNode const* node = &opt->nodes[items[i]];
+        if (bounds_are_infinite(node->min, node->max)) {
+            continue;
+        }
+        for (int axis = 0; axis < 3; axis++) {
+            float centroid = 0.5f * (node->min[axis] + node->max[axis]);
+            centroid_min[axis] = centroid < centroid_min[axis] ? centroid : centroid_min[axis];
+            centroid_max[axis] = centroid > centroid_max[axis] ? centroid : centroid_max[axis];
+        }
+    }
+    int split_axis = 0;
+    for (int axis = 1; axis < 3; axis++) {
+        if (centroid_max[axis] - centroid_min[axis] > centroid_max[split_axis] - centroid_min[split_axis]) {
+            split_axis = axis;
+        }
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        OptNode const* node = &opt->nodes[items[i]];
+        // (unbounded operands go last, so they share as few groups as possible)
+        opt->sort_keys[i].key = (
+            bounds_are_infinite(node->min, node->max) ?
+            INFINITY :
+            0.5f * (node->min[split_axis] + node->max[split_axis])
+        );
+        opt->sort_keys[i].hash = node->hash;
+        opt->sort_keys[i].node = items[i];
+    }
+    qsort(opt->sort_keys, count, sizeof(OptSortKey), compare_sort_keys);
+    for (uint32_t i = 0; i < count; i++) {
+        items[i] = opt->sort_keys[i].node;
+    }
+    uint32_t half = count / 2;
+    uint32_t left = build_union_tree(opt, items, half, levels - 1, world_to_local);
+    uint32_t right = build_union_tree(opt, items + half, count - half, levels - 1, world_to_local);
+    return push_union_node(opt, left, right, world_to_local);
+}
+static uint32_t rebuild_union_chain(Optimizer* opt, uint32_t chain_root) {
+    // collecting the chain's operands, by descending through its unions:
+    uint32_t item_count = 0;
+    uint32_t stack_count = 0;
+    uint32_t* chain_stack = opt->pair_stack;
+    chain_stack[stack_count++] = chain_root;
+    while (stack_count > 0) {
+        uint32_t node = chain_stack[--stack_count];
+        if (opt->nodes[node].type == WO_NODE_BINOP_UNION_OF) {
+            chain_stack[stack_count++] = opt->nodes[node].operands[1];
+            chain_stack[stack_count++] = opt->nodes[node].operands[0];
+        } else {
+            opt->chain_items[item_count++] = node;
+        }
+    }
+
+    // dropping duplicate operands: sorting by hash groups the candidates.
+    for (uint32_t i = 0; i < item_count; i++) {
+        opt->sort_keys[i].key = 0.0f;
+        opt->sort_keys[i].hash = opt->nodes[opt->chain_items[i]].hash;
+        opt->sort_keys[i].node = opt->chain_items[i];
+    }
+    qsort(opt->sort_keys, item_count, sizeof(OptSortKey), compare_sort_keys);
+    uint32_t kept_count = 0;
+    uint32_t group_start = 0;
+    for (uint32_t i = 0; i < item_count; i++) {
+        if (i > 0 && opt->sort_keys[i].hash != opt->sort_keys[i-1].hash) {
+            group_start = kept_count;
+        }
+        bool is_duplicate = false;
+        for (uint32_t j = group_start; j < kept_count && !is_duplicate; j++) {
+            is_duplicate = opt_nodes_are_equal(opt, opt->chain_items[j], opt->sort_keys[i].node);
+        }
+        if (!is_duplicate) {
+            opt->chain_items[kept_count++] = opt->sort_keys[i].node;
+        }
+    }
+    uint32_t duplicate_count = item_count - kept_count;
+
+    uint32_t levels = 0;
+    if (kept_count >= WO_OPTIMIZE_MIN_REBALANCED_CHAIN_LENGTH) {
+        // balanced levels leave groups of 2 to 4 operands:
+        uint32_t log2_count = 0;
+        while ((2u << log2_count) <= kept_count) {
+            log2_count++;
+        }
+        levels = log2_count - 1;
+        if (levels > opt->rebalance_level_budget) {
+            levels = opt->rebalance_level_budget;
+        }
+    }
+    if (duplicate_count == 0 && levels == 0) {
+        return chain_root;
+    }
+
+    OptNode const* root = &opt->nodes[chain_root];
+    assert(root->flat_index != WO_FLAT_NODE_NONE);
+    set_bit(opt->rewritten_bitset, root->flat_index);
+    opt->stats.deduplicated_subtree_count += duplicate_count;
+    if (levels > 0) {
+        opt->stats.rebalanced_chain_count++;
+    }
+    float world_to_local[3][4];
+    memcpy(world_to_local, root->world_to_local, sizeof(world_to_local));
+    return build_union_tree(opt, opt->chain_items, kept_count, levels, world_to_local);
+}
+static void rebalance_union_chains(Optimizer* opt, uint32_t root) {
+    // visiting the tree top-down, rebuilding every chain of unions that is the operand of
+    // another binop (the chain at the root forms the scene's components):
+    uint32_t stack_count = 0;
+    opt->stack[stack_count++] = root;
+    while (stack_count > 0) {
+        uint32_t node_index = opt->stack[--stack_count];
+        uint32_t type = opt->nodes[node_index].type;
+        if (node_type_is_leaf((NodeType)type)) {
+            continue;
+        }
+        for (int k = 0; k < 2; k++) {
+            uint32_t operand = opt->nodes[node_index].operands[k];
+            if (type != WO_NODE_BINOP_UNION_OF && opt->nodes[operand].type == WO_NODE_BINOP_UNION_OF) {
+                operand = rebuild_union_chain(opt, operand);
+                opt->nodes[node_index].operands[k] = operand;
+            }
+            opt->stack[stack_count++] = operand;
+        }
+    }
+}
+static uint32_t compute_stack_depths(Optimizer* opt, uint32_t root) {
+    // post-order, with an explicit stack: a node is pushed again (negated, '~index') to be
+    // visited after its operands. Returns the number of nodes in the tree.
+    uint32_t tree_node_count = 0;
+    uint32_t stack_count = 0;
+    opt->stack[stack_count++] = root;
+    while (stack_count > 0) {
+        uint32_t entry = opt->stack[--stack_count];
+        bool operands_done = entry >= opt->node_capacity;
+        OptNode* node = &opt->nodes[operands_done ? ~entry : entry];
+        if (node_type_is_leaf((NodeType)node->type)) {
+            node->stack_depth = 1;
+            node->height = 1;
+            tree_node_count++;
+        } else if (!operands_done) {
+            opt->stack[stack_count++] = ~entry;
+            opt->stack[stack_count++] = node->operands[1];
+            opt->stack[stack_count++] = node->operands[0];
+        } else {
+            // (see 'compute_node_stack_depths' in 'scene.c')
+            OptNode const* a = &opt->nodes[node->operands[0]];
+            OptNode const* b = &opt->nodes[node->operands[1]];
+            node->stack_depth = (
+                a->stack_depth == b->stack_depth ?
+                a->stack_depth + 1 :
+                (a->stack_depth > b->stack_depth ? a->stack_depth : b->stack_depth)
+            );
+            node->height = 1 + (a->height > b->height ? a->height : b->height);
+            tree_node_count++;
+        }
+    }
+    return tree_node_count;
+}
+static void compose_parent_to_local(float const child[3][4], float const parent[3][4], float out[3][4]) {
+    // 'child = out * parent' for rigid maps, so 'out = child * parent^-1', where the inverse of
+    // 'p -> R*p + t' is 'p -> R^T*p - R^T*t':
+    for (int row = 0; row < 3; row++) {
+        float translation = child[row][3];
+        for (int col = 0; col < 3; col++) {
+            float v = 0.0f;
+            for (int k = 0; k < 3; k++) {
+                v += child[row][k] * parent[col][k];
+            }
+            out[row][col] = v;
+            translation -= v * parent[col][3];
+        }
+        out[row][3] = translation;
+    }
+}
+static void emit_tree(
+    Optimizer* opt, uint32_t root, FlatScene* out,
+    uint32_t* out_flat_indices, uint64_t* intact_bitset, uint32_t* emitted_count
+) {
+    // the stack holds the nodes being visited, 'pair_stack' how many of their operands were
+    // visited, and 'emitted_operands' where those were emitted.
+    FlatScene const* in = opt->flat_scene;
+    uint32_t* emitted_operands = opt->chain_items;
+    uint32_t stack_count = 1;
+    opt->stack[0] = root;
+    opt->pair_stack[0] = 0;
+    while (stack_count > 0) {
+        uint32_t node_index = opt->stack[stack_count - 1];
+        OptNode const* node = &opt->nodes[node_index];
+        uint32_t visited = opt->pair_stack[stack_count - 1];
+        bool swapped = (
+            !node_type_is_leaf((NodeType)node->type) &&
+            opt->nodes[node->operands[1]].stack_depth > opt->nodes[node->operands[0]].stack_depth
+        );
+        if (!node_type_is_leaf((NodeType)node->type) && visited < 2) {
+            // descending into the next operand, in visiting order:
+            bool visit_left = (visited == 0) != swapped;
+            opt->pair_stack[stack_count - 1] = visited + 1;
+            opt->stack[stack_count] = node->operands[visit_left ? 0 : 1];
+            opt->pair_stack[stack_count] = 0;
+            stack_count++;
+            continue;
+        }
+
+        uint32_t out_index = (*emitted_count)++;
+        opt->nodes[node_index].out_index = out_index;
+        GpuSceneNode* gpu_node = &out->nodes[out_index];
+        memset(gpu_node, 0, sizeof(GpuSceneNode));
+        gpu_node->type = node->type;
+        gpu_node->parent_index = WO_GPU_NODE_NO_PARENT;
+        memcpy(gpu_node->world_to_local, node->world_to_local, sizeof(gpu_node->world_to_local));
+        out->node_type_mask |= 1u << node->type;
+        out_flat_indices[out_index] = node->flat_index;
+        if (node_type_is_leaf((NodeType)node->type)) {
+            GpuSceneNode const* flat_node = &in->nodes[node->flat_index];
+            memcpy(gpu_node->params, flat_node->params, sizeof(gpu_node->params));
+            gpu_node->flags = flat_node->flags;
+            gpu_node->subtree_size = 1;
+            set_bit(intact_bitset, node->flat_index);
+            if (node->type == WO_NODE_INSTANCE) {
+                // (prototypes are emitted first; instances of empty ones are pruned too)
+                uint32_t prototype = opt->results[gpu_node_prototype_root(flat_node)];
+                assert(prototype != OPT_NODE_EMPTY);
+                gpu_node_set_prototype_root(gpu_node, opt->nodes[prototype].out_index);
+                out->instance_count++;
+            }
+        } else {
+            // the operands were emitted in visiting order, right before this node:
+            uint32_t second = emitted_operands[2*(stack_count - 1) + 1];
+            uint32_t first = emitted_operands[2*(stack_count - 1)];
+            out->nodes[first].parent_index = out_index;
+            out->nodes[second].parent_index = out_index;
+            gpu_node->subtree_size = out->nodes[first].subtree_size + out->nodes[second].subtree_size + 1;
+            if (swapped) {
+                gpu_node->flags |= WO_GPU_NODE_FLAG_OPERANDS_SWAPPED;
+            }
+            if (node->flat_index != WO_FLAT_NODE_NONE) {
+                uint32_t flat_ops[2];
+                flat_operands(in, node->flat_index, flat_ops);
+                if (
+                    opt->nodes[node->operands[0]].flat_index == flat_ops[0] &&
+                    opt->nodes[node->operands[1]].flat_index == flat_ops[1]
+                ) {
+                    set_bit(intact_bitset, node->flat_index);
+                }
+            }
+        }
+
+        // popping, reporting the emitted index to the parent frame:
+        stack_count--;
+        if (stack_count > 0) {
+            emitted_operands[2*(stack_count - 1) + opt->pair_stack[stack_count - 1] - 1] = out_index;
+        }
+    }
+    if (root != opt->results[in->node_count - 1]) {
+        out->prototype_count++;
+    }
+    out->stack_depth = opt->nodes[root].stack_depth > out->stack_depth ? opt->nodes[root].stack_depth : out->stack_depth;
+    out->tree_height = opt->nodes[root].height > out->tree_height ? opt->nodes[root].height : out->tree_height;
+}
+static bool emit_flat_scene(Optimizer* opt, FlatScene* out) {
+    // emits the optimized trees in post-order (visiting operands in Sethi-Ullman order, like
+    // 'flatten_scene'), wiring up transforms and the emission chains of intact Wo_Nodes.
+    // Trees are emitted in their original order: prototypes, then the scene root's.
+    FlatScene const* in = opt->flat_scene;
+    uint32_t node_count = 0;
+    for (uint32_t i = 0; i < in->node_count; i++) {
+        if (in->nodes[i].parent_index == WO_GPU_NODE_NO_PARENT && opt->results[i] != OPT_NODE_EMPTY) {
+            node_count += compute_stack_depths(opt, opt->results[i]);
+        }
+    }
+    uint32_t const allocated_count = node_count > 0 ? node_count : 1;
+    memset(out, 0, sizeof(FlatScene));
+    out->nodes = malloc(allocated_count * sizeof(GpuSceneNode));
+    out->source_nodes = malloc(allocated_count * sizeof(uint32_t));
+    out->next_emissions = malloc(allocated_count * sizeof(uint32_t));
+    out->parent_to_local = malloc(allocated_count * sizeof(float[3][4]));
+    out->first_emissions = malloc((in->source_node_count + 1) * sizeof(uint32_t));
+    out->optimized_source_bitset = calloc(in->source_node_count/64 + 1, sizeof(uint64_t));
+    out->source_node_count = in->source_node_count;
+    out->node_capacity = allocated_count;
+    uint32_t* out_flat_indices = malloc(allocated_count * sizeof(uint32_t));
+    uint64_t* intact_bitset = calloc(in->node_count/64 + 1, sizeof(uint64_t));
+    if (
+        out->nodes == NULL || out->source_nodes == NULL || out->next_emissions == NULL ||
+        out->parent_to_local == NULL || out->first_emissions == NULL ||
+        out->optimized_source_bitset == NULL || out_flat_indices == NULL || intact_bitset == NULL
+    ) {
+        free(out_flat_indices);
+        free(intact_bitset);
+        free_flat_scene(out);
+        return false;
+    }
+
+    uint32_t emitted_count = 0;
+    for (uint32_t i = 0; i < in->node_count; i++) {
+        if (in->nodes[i].parent_index == WO_GPU_NODE_NO_PARENT && opt->results[i] != OPT_NODE_EMPTY) {
+            emit_tree(opt, opt->results[i], out, out_flat_indices, intact_bitset, &emitted_count);
+        }
+    }
+    assert(emitted_count == node_count);
+    out->node_count = node_count;
+
+    // parent-to-local maps: kept where a node's parent is its original one, else re-derived
+    // from the (rigid) world maps.
+    for (uint32_t i = 0; i < node_count; i++) {
+        uint32_t parent = out->nodes[i].parent_index;
+        uint32_t flat_index = out_flat_indices[i];
+        bool has_original_parent = flat_index != WO_FLAT_NODE_NONE && (
+            parent == WO_GPU_NODE_NO_PARENT ?
+            in->nodes[flat_index].parent_index == WO_GPU_NODE_NO_PARENT :
+            out_flat_indices[parent] == in->nodes[flat_index].parent_index
+        );
+        if (has_original_parent) {
+            memcpy(out->parent_to_local[i], in->parent_to_local[flat_index], sizeof(float[3][4]));
+        } else if (parent == WO_GPU_NODE_NO_PARENT) {
+            memcpy(out->parent_to_local[i], out->nodes[i].world_to_local, sizeof(float[3][4]));
+        } else {
+            compose_parent_to_local(out->nodes[i].world_to_local, out->nodes[parent].world_to_local, out->parent_to_local[i]);
+        }
+    }
+
+    // a Wo_Node can be patched in place if none of its emissions were rewritten or lie below a
+    // rewrite: moving a node below a rewrite may invalidate it.
+    // (parents follow their children, so a node's parent is marked first)
+    for (uint32_t i = in->node_count; i-- > 0;) {
+        uint32_t flat_parent = in->nodes[i].parent_index;
+        if (flat_parent != WO_GPU_NODE_NO_PARENT && bit_is_set(opt->rewritten_bitset, flat_parent)) {
+            set_bit(opt->rewritten_bitset, i);
+        }
+        uint32_t source = in->source_nodes[i];
+        if (source != WO_FLAT_NODE_NONE && (bit_is_set(opt->rewritten_bitset, i) || !bit_is_set(intact_bitset, i))) {
+            set_bit(out->optimized_source_bitset, source);
+        }
+    }
+    for (size_t node = 0; node < in->source_node_count; node++) {
+        out->first_emissions[node] = WO_FLAT_NODE_NONE;
+    }
+    for (uint32_t i = 0; i < node_count; i++) {
+        uint32_t flat_index = out_flat_indices[i];
+        uint32_t source = (flat_index == WO_FLAT_NODE_NONE) ? WO_FLAT_NODE_NONE : in->source_nodes[flat_index];
+        out->source_nodes[i] = WO_FLAT_NODE_NONE;
+        out->next_emissions[i] = WO_FLAT_NODE_NONE;
+        if (source != WO_FLAT_NODE_NONE && !bit_is_set(out->optimized_source_bitset, source)) {
+            out->source_nodes[i] = source;
+            out->next_emissions[i] = out->first_emissions[source];
+            out->first_emissions[source] = i;
+        }
+    }
+
+    free(out_flat_indices);
+    free(intact_bitset);
+    return true;
+}
+static bool run_optimizer(FlatScene const* flat_scene, uint32_t rebalance_level_budget, FlatScene* out_flat_scene, SceneOptimizeStats* out_stats) {
+    // Returns false if out of memory; 'out_flat_scene' is only written if a rewrite applied.
+    uint32_t const flat_count = flat_scene->node_count;
+    Optimizer opt;
+    memset(&opt, 0, sizeof(Optimizer));
+    opt.flat_scene = flat_scene;
+    opt.rebalance_level_budget = rebalance_level_budget;
+    opt.stats.input_node_count = flat_count;
+    opt.stats.output_node_count = flat_count;
+    // (rebalancing a chain adds at most as many unions as it had, leaving those unreachable)
+    opt.node_capacity = 2*flat_count + 1;
+    opt.flat_bounds = malloc((flat_count + 1) * sizeof(GpuNodeBounds));
+    opt.results = malloc((flat_count + 1) * sizeof(uint32_t));
+    opt.rewritten_bitset = calloc(flat_count/64 + 1, sizeof(uint64_t));
+    opt.nodes = malloc(opt.node_capacity * sizeof(OptNode));
+    // (the emission stack holds up to 3 entries per tree level)
+    opt.stack = malloc(3 * opt.node_capacity * sizeof(uint32_t));
+    opt.pair_stack = malloc(3 * opt.node_capacity * sizeof(uint32_t));
+    opt.chain_items = malloc(2 * opt.node_capacity * sizeof(uint32_t));
+    opt.sort_keys = malloc(opt.node_capacity * sizeof(OptSortKey));
+    bool ok = (
+        opt.flat_bounds != NULL && opt.results != NULL && opt.rewritten_bitset != NULL &&
+        opt.nodes != NULL && opt.stack != NULL && opt.pair_stack != NULL &&
+        opt.chain_items != NULL && opt.sort_keys != NULL
+    );
+    if (ok && flat_count > 0) {
+        bound_flat_scene(flat_scene, opt.flat_bounds);
+        optimize_flat_nodes(&opt);
+        // (a prototype's top-level chain is traced as a single component, so is rebalanced too)
+        for (uint32_t i = 0; i < flat_count; i++) {
+            if (flat_scene->nodes[i].parent_index != WO_GPU_NODE_NO_PARENT || opt.results[i] == OPT_NODE_EMPTY) {
+                continue;
+            }
+            if (i != flat_count - 1 && opt.nodes[opt.results[i]].type == WO_NODE_BINOP_UNION_OF) {
+                opt.results[i] = rebuild_union_chain(&opt, opt.results[i]);
+            }
+            rebalance_union_chains(&opt, opt.results[i]);
+        }
+        bool changed = (
+            opt.stats.pruned_subtree_count +
+            opt.stats.deduplicated_subtree_count +
+            opt.stats.rebalanced_chain_count
+        ) > 0;
+        if (changed) {
+            ok = emit_flat_scene(&opt, out_flat_scene);
+            if (ok) {
+                opt.stats.output_node_count = out_flat_scene->node_count;
+            }
+        }
+    }
+    free(opt.flat_bounds);
+    free(opt.results);
+    free(opt.rewritten_bitset);
+    free(opt.nodes);
+    free(opt.stack);
+    free(opt.pair_stack);
+    free(opt.chain_items);
+    free(opt.sort_keys);
+    *out_stats = opt.stats;
+    return ok;
+}
+
+//
+// Implementation:
+//
+
+bool optimize_flat_scene(FlatScene* flat_scene, SceneOptimizeStats* out_stats) {
+    // rebalancing may use the stack depth the scene leaves unused, and is dropped if nested
+    // chains together still take too much.
+    uint32_t budget = (
+        flat_scene->stack_depth < WO_CSG_STACK_CAPACITY ?
+        WO_CSG_STACK_CAPACITY - flat_scene->stack_depth :
+        0
+    );
+    FlatScene optimized;
+    memset(&optimized, 0, sizeof(FlatScene));
+    bool ok = run_optimizer(flat_scene, budget, &optimized, out_stats);
+    if (ok && out_stats->rebalanced_chain_count > 0 && optimized.stack_depth > WO_CSG_STACK_CAPACITY) {
+        free_flat_scene(&optimized);
+        ok = run_optimizer(flat_scene, 0, &optimized, out_stats);
+    }
+    if (!ok) {
+        fprintf(stderr, "[Wololo] Failed to allocate memory while optimizing the scene.\n");
+        free_flat_scene(&optimized);
+        *out_stats = (SceneOptimizeStats) {
+            .input_node_count = flat_scene->node_count,
+            .output_node_count = flat_scene->node_count
+        };
+        return false;
+    }
+    if (out_stats->output_node_count != out_stats->input_node_count || optimized.nodes != NULL) {
+        free_flat_scene(flat_scene);
+        *flat_scene = optimized;
+    }
+    return true;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "scene.h"
+
+//
+// OPTIMIZE simplifies flattened scenes when they are committed, so rays evaluate fewer nodes:
+//
+// - pruning: subtrees that provably cannot change their parent's solid are dropped, using the
+//   nodes' world-space bounds (see 'bvh.h'): empty intersections, differences whose right
+//   operand's box misses the left's, and intersections, unions or differences with a
+//   half-space (planar partition) whose plane misses the other operand's box.
+// - deduplication: operands identical in world space (by hash, then compared) are redundant
+//   beneath unions and intersections, and empty beneath differences.
+// - rebalancing: long chains of unions below another binop are rebuilt as trees split along
+//   their operands' centroids, so rays missing a group's box skip the whole group.
+//   The chains at the top of the scene are its components, which the BVH culls already.
+//   Rebalancing deepens the CSG stack, so only as far as 'WO_CSG_STACK_CAPACITY' allows.
+//   Prototypes (see 'scene.h') are traced as single components, so their top-level chains
+//   are rebalanced too.
+//
+// Optimized scenes are only patched in place where nothing was rewritten: Wo_Nodes emitted
+// inside a rewritten subtree are marked in 'optimized_source_bitset', and moving them needs
+// a commit.
+//
+
+// union chains with fewer operands are only deduplicated:
+#define WO_OPTIMIZE_MIN_REBALANCED_CHAIN_LENGTH (8)
+
+typedef struct SceneOptimizeStats SceneOptimizeStats;
+struct SceneOptimizeStats {
+    uint32_t input_node_count;
+    uint32_t output_node_count;
+    uint32_t pruned_subtree_count;
+    uint32_t deduplicated_subtree_count;
+    uint32_t rebalanced_chain_count;
+};
+
+// replaces '*flat_scene' (flattened, with composed 'world_to_local' maps) by its optimized
+// equivalent, if any rewrite applies. Returns false (leaving 'flat_scene' unoptimized) if out
+// of memory.
+bool optimize_flat_scene(FlatScene* flat_scene, SceneOptimizeStats* out_stats);
@@ -0,0 +1,322 @@
+// RENDER FARM spreads frames over one headless renderer per Vulkan device, each holding its own
+// copy of the scene (see 'Wo_Render_Farm' in 'renderer.h').
+
+#include "renderer.h"
+
+#include <stddef.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+//
+// Render farm implementation:
+//
+
+typedef struct FarmDevice FarmDevice;
+struct FarmDevice {
+    Wo_Renderer* renderer;
+    // the rows of the frame the device draws: (all of them, but for split frames)
+    uint32_t region_y;
+    uint32_t region_height;
+    uint64_t drawn_frame_count;
+};
+
+struct Wo_Render_Farm {
+    Wo_Render_Farm_Mode mode;
+    uint32_t width;
+    uint32_t height;
+    uint32_t frames_in_flight;
+    uint32_t device_count;
+    FarmDevice devices[WO_RENDER_FARM_MAX_DEVICE_COUNT];
+
+    // frames drawn and not read back yet, oldest first: for alternate frames, the device each
+    // was drawn on (at most 'frames_in_flight' per device, as each one buffers); for split
+    // frames, every device drew a region of each (so at most 'frames_in_flight').
+    uint32_t pending_frame_devices[WO_RENDER_FARM_MAX_DEVICE_COUNT * WO_RENDERER_MAX_FRAMES_IN_FLIGHT];
+    uint32_t first_pending_frame;
+    uint32_t pending_frame_count;
+    // alternate frames: the device drawing the next frame.
+    uint32_t next_device;
+
+    uint64_t drawn_frame_count;
+    uint64_t read_frame_count;
+    uint64_t dropped_frame_count;
+    struct timespec start_time;
+};
+
+Wo_Render_Farm* new_render_farm(
+    char const* name, size_t initial_node_capacity,
+    uint32_t width, uint32_t height, uint32_t frames_in_flight,
+    Wo_Render_Farm_Mode mode, uint32_t max_device_count
+);
+void del_render_farm(Wo_Render_Farm* farm);
+bool load_render_farm_scene_mmap(Wo_Render_Farm* farm, char const* file_path);
+void draw_render_farm_frame(Wo_Render_Farm* farm);
+bool read_render_farm_frame(Wo_Render_Farm* farm, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size);
+void get_render_farm_stats(Wo_Render_Farm* farm, Wo_Render_Farm_Stats* out_stats);
+double get_render_farm_time_sec(Wo_Render_Farm* farm);
+
+Wo_Render_Farm* new_render_farm(
+    char const* name, size_t initial_node_capacity,
+    uint32_t width, uint32_t height, uint32_t frames_in_flight,
+    Wo_Render_Farm_Mode mode, uint32_t max_device_count
+) {
+    if (width == 0 || height == 0) {
+        printf("[Wololo] Render farm \"%s\" cannot draw %u x %u frames.\n", name, width, height);
+        return NULL;
+    }
+    Wo_Render_Farm* farm = calloc(1, sizeof(Wo_Render_Farm));
+    if (farm == NULL) {
+        printf("[Wololo] Failed to allocate %zu bytes for Wo_Render_Farm.\n", sizeof(Wo_Render_Farm));
+        return NULL;
+    }
+    if (frames_in_flight == 0) {
+        frames_in_flight = WO_RENDERER_DEFAULT_FRAMES_IN_FLIGHT;
+    }
+    if (frames_in_flight > WO_RENDERER_MAX_FRAMES_IN_FLIGHT) {
+        frames_in_flight = WO_RENDERER_MAX_FRAMES_IN_FLIGHT;
+    }
+    farm->mode = mode;
+    farm->width = width;
+    farm->height = height;
+    farm->frames_in_flight = frames_in_flight;
+
+    // using every device, up to 'max_device_count' (and, splitting frames, a row per device):
+    uint32_t device_count = wo_renderer_device_count();
+    if (max_device_count > 0 && device_count > max_device_count) {
+        device_count = max_device_count;
+    }
+    if (device_count > WO_RENDER_FARM_MAX_DEVICE_COUNT) {
+        device_count = WO_RENDER_FARM_MAX_DEVICE_COUNT;
+    }
+    if (mode == WO_RENDER_FARM_SPLIT_FRAME && device_count > height) {
+        device_count = height;
+    }
+
+    // creating a renderer per device, skipping devices it fails on:
+    // (split frames are cut into bands of rows, as even as can be, between the devices created)
+    Wo_Renderer* renderers[WO_RENDER_FARM_MAX_DEVICE_COUNT];
+    uint32_t renderer_count = 0;
+    for (uint32_t device_index = 0; device_index < device_count; device_index++) {
+        uint32_t region_height = height;
+        if (mode == WO_RENDER_FARM_SPLIT_FRAME) {
+            region_height = height * (device_index + 1) / device_count - height * device_index / device_count;
+        }
+        Wo_Renderer* renderer = wo_renderer_new_headless_on_device(
+            name, initial_node_capacity,
+            width, region_height, frames_in_flight,
+            device_index
+        );
+        if (renderer == NULL) {
+            printf("[Wololo] Render farm \"%s\" could not use device %u; skipping it.\n", name, device_index);
+            continue;
+        }
+        renderers[renderer_count++] = renderer;
+    }
+    if (renderer_count == 0) {
+        printf("[Wololo] Render farm \"%s\" could not create a renderer on any device.\n", name);
+        free(farm);
+        return NULL;
+    }
+    if (mode == WO_RENDER_FARM_SPLIT_FRAME && renderer_count != device_count) {
+        // re-creating the renderers with bands sized for the devices that worked:
+        for (uint32_t i = 0; i < renderer_count; i++) {
+            Wo_Renderer_Stats renderer_stats;
+            wo_renderer_get_stats(renderers[i], &renderer_stats);
+            uint32_t const device_index = renderer_stats.device_index;
+            wo_renderer_del(renderers[i]);
+            renderers[i] = NULL;
+            uint32_t const region_y = height * i / renderer_count;
+            uint32_t const region_height = height * (i + 1) / renderer_count - region_y;
+            renderers[i] = wo_renderer_new_headless_on_device(
+                name, initial_node_capacity,
+                width, region_height, frames_in_flight,
+                device_index
+            );
+            if (renderers[i] == NULL) {
+                printf("[Wololo] Render farm \"%s\" could not re-create its renderer on device %u.\n", name, device_index);
+                for (uint32_t j = 0; j < i; j++) {
+                    wo_renderer_del(renderers[j]);
+                }
+                for (uint32_t j = i + 1; j < renderer_count; j++) {
+                    wo_renderer_del(renderers[j]);
+                }
+                free(farm);
+                return NULL;
+            }
+        }
+    }
+    for (uint32_t i = 0; i < renderer_count; i++) {
+        FarmDevice* device = &farm->devices[i];
+        device->renderer = renderers[i];
+        device->region_y = 0;
+        device->region_height = height;
+        if (mode == WO_RENDER_FARM_SPLIT_FRAME) {
+            device->region_y = height * i / renderer_count;
+            device->region_height = height * (i + 1) / renderer_count - device->region_y;
+            wo_renderer_set_frame_region(device->renderer, width, height, 0, device->region_y);
+        }
+    }
+    farm->device_count = renderer_count;
+    printf(
+        "[Wololo] Render farm \"%s\" draws %s on %u device(s).\n",
+        name, mode == WO_RENDER_FARM_SPLIT_FRAME ? "split frames" : "alternate frames", renderer_count
+    );
+    timespec_get(&farm->start_time, TIME_UTC);
+    return farm;
+}
+void del_render_farm(Wo_Render_Farm* farm) {
+    if (farm != NULL) {
+        for (uint32_t i = 0; i < farm->device_count; i++) {
+            wo_renderer_del(farm->devices[i].renderer);
+        }
+        free(farm);
+    }
+}
+bool load_render_farm_scene_mmap(Wo_Render_Farm* farm, char const* file_path) {
+    // (each device maps the file and uploads its GPU scene in turn; the pages stay cached)
+    bool ok = true;
+    for (uint32_t i = 0; i < farm->device_count; i++) {
+        ok = wo_renderer_load_scene_mmap(farm->devices[i].renderer, file_path) && ok;
+    }
+    return ok;
+}
+void draw_render_farm_frame(Wo_Render_Farm* farm) {
+    // drawing calls only wait on the device drawn on, for its oldest frame in flight, so the
+    // devices work in parallel: each draws while the others are submitted to.
+    uint32_t const pending_frame_capacity = (
+        farm->mode == WO_RENDER_FARM_SPLIT_FRAME ?
+        farm->frames_in_flight :
+        farm->frames_in_flight * farm->device_count
+    );
+    if (farm->pending_frame_count == pending_frame_capacity) {
+        // dropping the oldest unread frame, as its renderers do (round robin, the device drawing
+        // next is the oldest frame's):
+        farm->first_pending_frame = (farm->first_pending_frame + 1) % pending_frame_capacity;
+        farm->pending_frame_count--;
+        farm->dropped_frame_count++;
+    }
+    uint32_t const pending_frame = (farm->first_pending_frame + farm->pending_frame_count) % pending_frame_capacity;
+    if (farm->mode == WO_RENDER_FARM_SPLIT_FRAME) {
+        for (uint32_t i = 0; i < farm->device_count; i++) {
+            wo_renderer_draw_frame(farm->devices[i].renderer);
+            farm->devices[i].drawn_frame_count++;
+        }
+        farm->pending_frame_devices[pending_frame] = 0;
+    } else {
+        FarmDevice* device = &farm->devices[farm->next_device];
+        wo_renderer_draw_frame(device->renderer);
+        device->drawn_frame_count++;
+        farm->pending_frame_devices[pending_frame] = farm->next_device;
+        farm->next_device = (farm->next_device + 1) % farm->device_count;
+    }
+    farm->pending_frame_count++;
+    farm->drawn_frame_count++;
+}
+bool read_render_farm_frame(Wo_Render_Farm* farm, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size) {
+    if (farm->pending_frame_count == 0) {
+        return false;
+    }
+    size_t const pixel_size = (format == WO_PIXEL_FORMAT_RGBA8) ? 4 : 4 * sizeof(float);
+    size_t const row_size = (size_t)farm->width * pixel_size;
+    if (out_pixels_size < row_size * farm->height) {
+        printf("[Wololo] Cannot read back a %u x %u frame into %zu bytes.\n", farm->width, farm->height, out_pixels_size);
+        return false;
+    }
+    uint32_t const pending_frame_capacity = (
+        farm->mode == WO_RENDER_FARM_SPLIT_FRAME ?
+        farm->frames_in_flight :
+        farm->frames_in_flight * farm->device_count
+    );
+    uint32_t const device_index = farm->pending_frame_devices[farm->first_pending_frame];
+    farm->first_pending_frame = (farm->first_pending_frame + 1) % pending_frame_capacity;
+    farm->pending_frame_count--;
+
+    bool ok = true;
+    if (farm->mode == WO_RENDER_FARM_SPLIT_FRAME) {
+        // each device's band of rows lies contiguously in the frame: (rows are tightly packed)
+        for (uint32_t i = 0; i < farm->device_count; i++) {
+            FarmDevice* device = &farm->devices[i];
+            ok = wo_renderer_read_frame(
+                device->renderer, format,
+                (uint8_t*)out_pixels + device->region_y * row_size,
+                device->region_height * row_size
+            ) && ok;
+        }
+    } else {
+        ok = wo_renderer_read_frame(farm->devices[device_index].renderer, format, out_pixels, out_pixels_size);
+    }
+    if (ok) {
+        farm->read_frame_count++;
+    }
+    return ok;
+}
+void get_render_farm_stats(Wo_Render_Farm* farm, Wo_Render_Farm_Stats* out_stats) {
+    memset(out_stats, 0, sizeof(Wo_Render_Farm_Stats));
+    out_stats->mode = farm->mode;
+    out_stats->device_count = farm->device_count;
+    out_stats->drawn_frame_count = farm->drawn_frame_count;
+    out_stats->read_frame_count = farm->read_frame_count;
+    out_stats->dropped_frame_count = farm->dropped_frame_count;
+    out_stats->running_time_sec = get_render_farm_time_sec(farm);
+    for (uint32_t i = 0; i < farm->device_count; i++) {
+        FarmDevice const* device = &farm->devices[i];
+        Wo_Render_Farm_Device_Stats* device_stats = &out_stats->devices[i];
+        Wo_Renderer_Stats renderer_stats;
+        wo_renderer_get_stats(device->renderer, &renderer_stats);
+        device_stats->device_index = renderer_stats.device_index;
+        memcpy(device_stats->device_name, renderer_stats.device_name, sizeof(device_stats->device_name));
+        device_stats->region_y = device->region_y;
+        device_stats->region_height = device->region_height;
+        device_stats->drawn_frame_count = device->drawn_frame_count;
+        // (the GPU time of every frame completed so far, so 0 without timestamp queries)
+        device_stats->gpu_busy_sec = renderer_stats.gpu_frame_time.total_sec;
+        if (out_stats->running_time_sec > 0.0) {
+            device_stats->utilization = device_stats->gpu_busy_sec / out_stats->running_time_sec;
+        }
+    }
+}
+double get_render_farm_time_sec(Wo_Render_Farm* farm) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (
+        (double)(now.tv_sec - farm->start_time.tv_sec) +
+        (double)(now.tv_nsec - farm->start_time.tv_nsec) * 1e-9
+    );
+}
+
+//
+// Interface:
+//
+
+Wo_Render_Farm* wo_render_farm_new(
+    char const* name, size_t initial_node_capacity,
+    uint32_t width, uint32_t height, uint32_t frames_in_flight,
+    Wo_Render_Farm_Mode mode, uint32_t max_device_count
+) {
+    return new_render_farm(name, initial_node_capacity, width, height, frames_in_flight, mode, max_device_count);
+}
+void wo_render_farm_del(Wo_Render_Farm* farm) {
+    del_render_farm(farm);
+}
+uint32_t wo_render_farm_device_count(Wo_Render_Farm* farm) {
+    return farm->device_count;
+}
+Wo_Renderer* wo_render_farm_renderer(Wo_Render_Farm* farm, uint32_t device) {
+    return device < farm->device_count ? farm->devices[device].renderer : NULL;
+}
+bool wo_render_farm_load_scene_mmap(Wo_Render_Farm* farm, char const* file_path) {
+    return load_render_farm_scene_mmap(farm, file_path);
+}
+void wo_render_farm_draw_frame(Wo_Render_Farm* farm) {
+    draw_render_farm_frame(farm);
+}
+bool wo_render_farm_read_frame(Wo_Render_Farm* farm, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size) {
+    return read_render_farm_frame(farm, format, out_pixels, out_pixels_size);
+}
+void wo_render_farm_get_stats(Wo_Render_Farm* farm, Wo_Render_Farm_Stats* out_stats) {
+    get_render_farm_stats(farm, out_stats);
+}
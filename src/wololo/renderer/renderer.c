@@ -3,12 +3,14 @@
 // 
 // Most of this code is based on a tutorial at
 //  vulkan-tutorial.com/en
-//
-// Pending features:
-// 1.   Swap chain recreation (resize, sub-optimal e.g. monitor change)
-//      https://vulkan-tutorial.com/en/Drawing_a_triangle/Swap_chain_recreation
 
 #include "renderer.h"
+#include "node.h"
+#include "scene.h"
+#include "bvh.h"
+#include "optimize.h"
+#include "scene_file.h"
+#include "gpu_arena.h"
 
 #include <stddef.h>
 #include <stdlib.h>
@@ -17,6 +19,9 @@
 #include <stdio.h>
 #include <string.h>
 #include <assert.h>
+#include <math.h>
+#include <time.h>
+#include <stdatomic.h>
 
 #include "wololo/wmath.h"
 #include "wololo/platform.h"
@@ -26,6 +31,20 @@
 
 #include <vulkan/vulkan.h>
 
+#if WO_ASYNC_PIPELINE_CREATION
+#include <threads.h>
+#endif
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 #define MIN(A,B) (A < B ? A : B)
 #define MAX(A,B) (A > B ? A : B)
 
@@ -46,9 +65,133 @@ static char const* minimum_vk_device_extension_names[MINIMUM_VK_DEVICE_EXTENSION
     "VK_KHR_swapchain"
 };
 
+// ray query extensions are optional: if the device (and Vulkan 1.2) supports all of them,
+// bounded components are traced against a hardware TLAS instead of the software BVH.
+#define RAY_QUERY_VK_DEVICE_EXTENSION_COUNT (3)
+static char const* ray_query_vk_device_extension_names[RAY_QUERY_VK_DEVICE_EXTENSION_COUNT] = {
+    "VK_KHR_acceleration_structure",
+    "VK_KHR_ray_query",
+    "VK_KHR_deferred_host_operations"
+};
+
+// SPIR-V bytecode, either mapped from a file or embedded at build time:
+typedef struct SpirvCode SpirvCode;
+struct SpirvCode {
+    uint32_t const* words;
+    size_t size;
+    bool is_mapped;
+};
+#if WO_EMBEDDED_SHADERS
+// generated from the '.spv' files by 'cmake/embed_spirv.cmake', keyed by their 'WO_UBERSHADER_*_FILENAME':
+typedef struct EmbeddedShader EmbeddedShader;
+struct EmbeddedShader {
+    char const* file_name;
+    unsigned char const* code;
+    size_t code_size;
+};
+extern EmbeddedShader const wo_embedded_shaders[];
+extern size_t const wo_embedded_shader_count;
+#endif
+
+// Trace pipelines are specialized per scene (see 'get_trace_pipeline') through the ubershaders'
+// specialization constants, 'constant_id' 0 to 3 in the order of 'PipelineVariantKey':
+// NOTE: mirrors the 'SCENE_NODE_TYPES', 'CSG_STACK_CAPACITY', 'MAX_BOUNCE_COUNT' and 'DEBUG_VIEW'
+//       specialization constants of the ubershaders; keep both in sync.
+// At most WO_MAX_PIPELINE_VARIANT_COUNT variants are cached, beyond which the generic pipelines
+// (created at initialization with the default constants) are used.
+#define WO_MAX_PIPELINE_VARIANT_COUNT (32)
+#define WO_PIPELINE_VARIANT_CONSTANT_COUNT (4)
+#define WO_ALL_NODE_TYPES_MASK ((1u << WO_NODE_FREE) - 1u)
+typedef struct PipelineVariantKey PipelineVariantKey;
+struct PipelineVariantKey {
+    // bit '1 << type' set for every NodeType in the scene:
+    uint32_t node_type_mask;
+    // the power of two (up to WO_CSG_STACK_CAPACITY) covering the scene's CSG stack depth:
+    uint32_t csg_stack_capacity;
+    // the most bounces paths are traced for (WO_RENDERER_MAX_BOUNCE_COUNT unless path tracing):
+    uint32_t max_bounce_count;
+    uint32_t debug_view;
+};
+typedef struct PipelineVariant PipelineVariant;
+struct PipelineVariant {
+    PipelineVariantKey key;
+    Wo_Trace_Path trace_path;
+    // VK_NULL_HANDLE if it failed to compile (using the generic pipeline instead of retrying),
+    // or while it compiles (see 'compiling_pipeline_variant_index'):
+    VkPipeline pipeline;
+    double compile_time_sec;
+};
+_Static_assert(
+    sizeof(PipelineVariantKey) == WO_PIPELINE_VARIANT_CONSTANT_COUNT * sizeof(uint32_t),
+    "PipelineVariantKey is the specialization data, and must have no padding."
+);
+
+// 'WO_PIPELINE_CACHE_FILEPATH' holds this header, then the 'vkGetPipelineCacheData' blob:
+// the blob is only reused by the device and driver it was saved by.
+#define WO_PIPELINE_CACHE_FILE_MAGIC (0x43504F57u)
+typedef struct PipelineCacheFileHeader PipelineCacheFileHeader;
+struct PipelineCacheFileHeader {
+    uint32_t magic;
+    uint32_t vendor_id;
+    uint32_t device_id;
+    uint32_t driver_version;
+    uint8_t pipeline_cache_uuid[VK_UUID_SIZE];
+    uint64_t data_size;
+};
+
 // 'frames in flight' refer to the number of swapchain images we can render to simultaneously:
 // see: https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation#page_Submitting-the-command-buffer
-#define MAX_FRAMES_IN_FLIGHT (2)
+// (the renderer's 'frames_in_flight' is chosen at creation, up to this many)
+#define MAX_FRAMES_IN_FLIGHT (WO_RENDERER_MAX_FRAMES_IN_FLIGHT)
+
+// size of each frame's segment of the incremental update staging ring:
+// updates that do not fit fall back to a full commit.
+#define WO_UPDATE_STAGING_BYTES_PER_FRAME (4 << 20)
+
+// uploads on a dedicated transfer queue (see 'vk_upload_to_device_local_buffer') are left in
+// flight, and retired once their fences signal: at most WO_MAX_PENDING_UPLOAD_COUNT at once,
+// beyond which the oldest is waited for.
+#define WO_MAX_PENDING_UPLOAD_COUNT (16)
+typedef struct PendingUpload PendingUpload;
+struct PendingUpload {
+    VkBuffer staging_buffer;
+    GpuAllocation staging_buffer_allocation;
+    // the copy and the release of the buffer's ownership (on the transfer queue), the
+    // acquisition of its ownership (on the graphics queue), the semaphore ordering both, and
+    // the fence signaled once the acquisition completed:
+    VkCommandBuffer transfer_command_buffer;
+    VkCommandBuffer acquire_command_buffer;
+    VkSemaphore transfer_semaphore;
+    VkFence acquire_fence;
+};
+
+// the storage image traced into by the compute path, then blitted onto swapchain images:
+// NOTE: must match the 'rgba8' format qualifier in 'ubershader1.comp'.
+#define WO_TRACE_IMAGE_FORMAT (VK_FORMAT_R8G8B8A8_UNORM)
+// the running average of the compute path's samples in progressive mode:
+// NOTE: must match the 'rgba32f' format qualifier in 'ubershader1.comp'.
+#define WO_ACCUMULATION_IMAGE_FORMAT (VK_FORMAT_R32G32B32A32_SFLOAT)
+// the most samples per pixel a frame's ray budget buys when path tracing:
+#define WO_MAX_SAMPLES_PER_PIXEL (16)
+// adaptive resolution: render scales are multiples of 1/WO_RENDER_SCALE_STEPS, and are only
+// changed again once WO_RENDER_SCALE_SETTLE_FRAMES frames were timed at the current one.
+#define WO_RENDER_SCALE_STEPS (16)
+#define WO_RENDER_SCALE_SETTLE_FRAMES (16)
+// timestamps written per frame (see 'FrameTimestamp'), and per incremental update:
+#define WO_FRAME_TIMESTAMP_COUNT (4)
+#define WO_UPLOAD_TIMESTAMP_COUNT (2)
+// rolling timings are averaged over their last WO_TIMING_WINDOW_LENGTH samples:
+#define WO_TIMING_WINDOW_LENGTH (64)
+// the compute path's tile size, i.e. the ubershader1.comp workgroup size:
+#define WO_TRACE_TILE_SIZE (8)
+
+// the images headless renderers draw into in place of swapchain images: (like the
+// swapchain's preferred B8G8R8A8_SRGB, but in the channel order readbacks return)
+#define WO_OFFSCREEN_IMAGE_FORMAT (VK_FORMAT_R8G8B8A8_SRGB)
+
+// buffers read through device addresses are aligned to at least this much, which covers
+// 'minAccelerationStructureScratchOffsetAlignment' on current hardware: (at most 256)
+#define WO_DEVICE_ADDRESS_ALIGNMENT (256)
 
 // creating a Vulkan error callback:
 // see: https://vulkan-tutorial.com/Drawing_a_triangle/Setup/Validation_layers#page_Message-callback
@@ -77,35 +220,87 @@ struct FragmentUniformBufferObject {
     // field 2: vec2 resolution
     float resolution_x;
     float resolution_y;
+
+    // field 3: uint progressive
+    // field 4: uint accumulated_sample_count (see 'Wo_Renderer.accumulated_sample_count')
+    uint32_t progressive;
+    uint32_t accumulated_sample_count;
+
+    // field 5: uint path_tracing
+    // field 6: uint max_bounce_count
+    // field 7: uint samples_per_pixel (see 'help_fit_ray_budget')
+    uint32_t path_tracing;
+    uint32_t max_bounce_count;
+    uint32_t samples_per_pixel;
+
+    // field 8: float camera_aspect_ratio
+    // field 9: vec2 region_st_offset
+    // field 10: vec2 region_st_scale (see 'wo_renderer_set_frame_region')
+    float camera_aspect_ratio;
+    float region_st_offset_x;
+    float region_st_offset_y;
+    float region_st_scale_x;
+    float region_st_scale_y;
 };
 
-// Vulkan buffer creation:
-uint32_t help_find_vk_buffer_memory_type(
-    VkPhysicalDevice physical_device,
-    uint32_t type_filter,
-    VkMemoryPropertyFlags properties
-) {
-    VkPhysicalDeviceMemoryProperties mem_properties;
-    vkGetPhysicalDeviceMemoryProperties(physical_device, &mem_properties);
-    for (uint32_t i = 0; i < mem_properties.memoryTypeCount; i++) {
-        bool bit_supported = type_filter & (1 << i);
-        bool props_supported = properties == (mem_properties.memoryTypes[i].propertyFlags & properties);
-        if (bit_supported && props_supported) {
-            return i;
+// Frame timestamps: written after each pass of a frame's command buffer, so consecutive ones
+// bracket the passes. (The fragment path has no blit: its blit timestamp follows its trace's.)
+typedef enum FrameTimestamp FrameTimestamp;
+enum FrameTimestamp {
+    FRAME_TIMESTAMP_BEGIN = 0,
+    FRAME_TIMESTAMP_TRACED = 1,
+    FRAME_TIMESTAMP_BLITTED = 2,
+    FRAME_TIMESTAMP_END = 3
+};
+
+// Rolling timings: the last WO_TIMING_WINDOW_LENGTH samples of a timing, summarized by
+// 'get_timing' into a 'Wo_Renderer_Timing'.
+typedef struct TimingWindow TimingWindow;
+struct TimingWindow {
+    double samples_sec[WO_TIMING_WINDOW_LENGTH];
+    uint32_t next_index;
+    uint32_t window_sample_count;
+    uint64_t sample_count;
+    double last_sec;
+    double total_sec;
+};
+static void record_timing(TimingWindow* window, double sample_sec) {
+    window->samples_sec[window->next_index] = sample_sec;
+    window->next_index = (window->next_index + 1) % WO_TIMING_WINDOW_LENGTH;
+    if (window->window_sample_count < WO_TIMING_WINDOW_LENGTH) {
+        window->window_sample_count++;
+    }
+    window->sample_count++;
+    window->last_sec = sample_sec;
+    window->total_sec += sample_sec;
+}
+static void get_timing(TimingWindow const* window, Wo_Renderer_Timing* out_timing) {
+    memset(out_timing, 0, sizeof(*out_timing));
+    out_timing->last_sec = window->last_sec;
+    out_timing->sample_count = window->sample_count;
+    out_timing->total_sec = window->total_sec;
+    for (uint32_t i = 0; i < window->window_sample_count; i++) {
+        out_timing->mean_sec += window->samples_sec[i];
+        if (window->samples_sec[i] > out_timing->max_sec) {
+            out_timing->max_sec = window->samples_sec[i];
         }
     }
-
-    assert(0 && "Failed to find suitable Vulkan buffer memory type.");
-    return -1;
+    if (window->window_sample_count > 0) {
+        out_timing->mean_sec /= window->window_sample_count;
+    }
 }
-void new_vk_buffer(
-    VkPhysicalDevice physical_device,
+
+// Vulkan buffer creation:
+// (memory is sub-allocated from the renderer's 'GpuArena')
+static bool new_vk_buffer(
     VkDevice device,
+    GpuArena* arena,
+    Wo_Gpu_Memory_Category category,
     VkDeviceSize size,
     VkBufferUsageFlags usage,
     VkMemoryPropertyFlags properties,
     VkBuffer* buffer_p,
-    VkDeviceMemory* buffer_memory_p
+    GpuAllocation* allocation_p
 ) {
     VkBufferCreateInfo buffer_info; {
         memset(&buffer_info, 0, sizeof(buffer_info));
@@ -122,84 +317,66 @@ void new_vk_buffer(
     );
     if (buffer_ok != VK_SUCCESS) {
         printf("[Wololo] Failed to create Vulkan buffer.\n");
-        assert(0 && "Vulkan buffer creation failed.");
+        *buffer_p = VK_NULL_HANDLE;
+        memset(allocation_p, 0, sizeof(GpuAllocation));
+        return false;
     }
 
     VkMemoryRequirements mem_requirements;
     memset(&mem_requirements, 0, sizeof(mem_requirements));
     vkGetBufferMemoryRequirements(device, *buffer_p, &mem_requirements);
 
-    VkMemoryAllocateInfo alloc_info;
-    memset(&alloc_info, 0, sizeof(alloc_info));
-    alloc_info.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-    alloc_info.allocationSize = mem_requirements.size;
-    alloc_info.memoryTypeIndex = help_find_vk_buffer_memory_type(
-        physical_device,
-        mem_requirements.memoryTypeBits,
-        properties
-    );
-    VkResult alloc_ok = vkAllocateMemory(
-        device, &alloc_info, NULL,
-        buffer_memory_p
-    );
-    if (alloc_ok != VK_SUCCESS) {
+    // buffers read through device addresses may be acceleration structure storage or scratch
+    // space, whose addresses must be aligned further than their memory requirements say:
+    if ((usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT) && mem_requirements.alignment < WO_DEVICE_ADDRESS_ALIGNMENT) {
+        mem_requirements.alignment = WO_DEVICE_ADDRESS_ALIGNMENT;
+    }
+    if (!gpu_arena_allocate(arena, category, &mem_requirements, properties, allocation_p)) {
         printf("[Wololo] Failed to allocate Vulkan buffer.\n");
-        assert(0 && "Vulkan buffer allocation failed.");
+        vkDestroyBuffer(device, *buffer_p, NULL);
+        *buffer_p = VK_NULL_HANDLE;
+        return false;
     }
 
     // finally, associating the buffer's ID with the memory:
     vkBindBufferMemory(
         device,
         *buffer_p,
-        *buffer_memory_p,
-        0
+        allocation_p->memory,
+        allocation_p->offset
     );
+    return true;
 }
-void new_vk_uniform_buffer(
-    VkPhysicalDevice physical_device,
+static bool new_vk_uniform_buffer(
     VkDevice device,
+    GpuArena* arena,
     VkDeviceSize size,
     VkBuffer* buffer_p,
-    VkDeviceMemory* buffer_memory_p
+    GpuAllocation* allocation_p
 ) {
-    new_vk_buffer(
-        physical_device,
+    return new_vk_buffer(
         device,
+        arena,
+        WO_GPU_MEMORY_UNIFORMS,
         size,
         VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT,
         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
         buffer_p,
-        buffer_memory_p
+        allocation_p
     );
 }
-
-//
-// Nodes: representation of an algebraic expression
-//
-
-typedef enum NodeType NodeType;
-typedef union NodeInfo NodeInfo;
-enum NodeType {
-    WO_LEAF_SPHERE,
-    WO_LEAF_INFINITE_PLANAR_PARTITION,
-    WO_NODE_BINOP_UNION_OF,
-    WO_NODE_BINOP_INTERSECTION_OF,
-    WO_NODE_BINOP_DIFFERENCE_OF
-};
-union NodeInfo {
-    struct {
-        Wo_Scalar radius;
-    } sphere;
-
-    struct {
-        Wo_Vec3 normal;
-    } infinite_planar_partition;
-
-    struct {
-        Wo_Node_Argument left;
-        Wo_Node_Argument right;
-    } binop_of;
-};
+static void del_vk_buffer(
+    VkDevice device,
+    GpuArena* arena,
+    VkBuffer* buffer_p,
+    GpuAllocation* allocation_p
+) {
+    if (*buffer_p != VK_NULL_HANDLE) {
+        vkDestroyBuffer(device, *buffer_p, NULL);
+        *buffer_p = VK_NULL_HANDLE;
+    }
+    gpu_arena_free(arena, allocation_p);
+}
 
 //
 // Scenes: contain all nodes and their components
@@ -210,19 +387,38 @@ typedef enum RequiredVkQueueFamily RequiredVkQueueFamily;
 typedef struct Wo_Renderer Wo_Renderer;
 struct Wo_Renderer {
     // Own properties:
-    size_t max_node_count;
+    // nodes [0, current_node_count) are in use, in chunks that grow with them; removed nodes are
+    // chained through their infos from 'free_node_list_head', to be reused first:
     size_t current_node_count;
-    NodeType* node_type_table;
-    NodeInfo* node_info_table;
-    uint64_t* node_is_nonroot_bitset;
+    NodeStore node_store;
+    Wo_Node free_node_list_head;
+    size_t free_node_count;
     char* name;
+    // NULL if headless:
     Wo_App* app;
 
+    // set whenever the node tables change, cleared once they are uploaded:
+    bool scene_needs_commit;
+
+    // between 'begin_scene_build' and 'end_scene_build', nodes are added by scene builders, which
+    // reserve IDs by bumping 'scene_build_reserved_node_count' (so it may overshoot
+    // WO_RENDERER_MAX_NODE_COUNT once IDs run out):
+    bool scene_build_in_progress;
+    atomic_size_t scene_build_reserved_node_count;
+    // set if a builder could not allocate the chunks for its range (see 'end_scene_build'):
+    atomic_bool scene_build_failed;
+
+    // set for binops whose arguments were moved since the last frame (see 'set_node_argument'),
+    // in their chunks' dirty bitsets: patched into the committed scene without a full commit.
+    bool scene_has_dirty_nodes;
+
     // Vulkan instances & devices:
     VkInstance vk_instance;
     VkPhysicalDevice vk_physical_device;
     uint32_t vk_physical_device_count;
     VkPhysicalDevice* vk_physical_devices;
+    // the index of 'vk_physical_device' in 'vk_physical_devices', as requested at creation:
+    uint32_t vk_physical_device_index;
     
     // Vulkan validation layers:
     bool are_vk_validation_layers_enabled;
@@ -239,6 +435,11 @@ struct Wo_Renderer {
     uint32_t vk_present_queue_family_index;
     VkQueue vk_graphics_queue;
     VkQueue vk_present_queue;
+    // uploads go through a transfer-only family's queue if the device has one, else this is the
+    // graphics queue (see 'vk_upload_to_device_local_buffer'):
+    uint32_t vk_transfer_queue_family_index;
+    VkQueue vk_transfer_queue;
+    bool vk_has_dedicated_transfer_queue;
 
     // Vulkan devices and extensions:
     VkDevice vk_device;
@@ -246,6 +447,18 @@ struct Wo_Renderer {
     VkExtensionProperties* vk_available_device_extensions;
     uint32_t vk_enabled_device_extension_count;
     char const** vk_enabled_device_extension_names;
+    uint32_t vk_instance_api_version;
+
+    // hardware ray queries (optional, see 'ray_query_vk_device_extension_names'):
+    // the extension's functions are not exported by the loader, so they are fetched
+    // with 'vkGetDeviceProcAddr'.
+    bool vk_ray_query_supported;
+    PFN_vkCreateAccelerationStructureKHR vk_create_acceleration_structure;
+    PFN_vkDestroyAccelerationStructureKHR vk_destroy_acceleration_structure;
+    PFN_vkGetAccelerationStructureBuildSizesKHR vk_get_acceleration_structure_build_sizes;
+    PFN_vkCmdBuildAccelerationStructuresKHR vk_cmd_build_acceleration_structures;
+    PFN_vkGetAccelerationStructureDeviceAddressKHR vk_get_acceleration_structure_device_address;
+    PFN_vkGetBufferDeviceAddress vk_get_buffer_device_address;
 
     // surface to present to
     // chosen format + modes from after surface creation:
@@ -272,6 +485,32 @@ struct Wo_Renderer {
     // the swapchain's framebuffers:
     VkFramebuffer* vk_swapchain_framebuffers;
     uint32_t vk_swapchain_fbs_ok_count;
+    // the window's framebuffer size when the swapchain was created, and whether presentation
+    // reported it out-of-date/sub-optimal:
+    int swapchain_window_width;
+    int swapchain_window_height;
+    bool swapchain_needs_recreation;
+    // the layout frames are left in by the render pass or compute blit: ready for presentation,
+    // or for the readback copy if headless.
+    VkImageLayout vk_frame_final_layout;
+
+    // headless renderers have no surface or swapchain: they draw into one offscreen image per
+    // frame in flight (standing in for the swapchain's images above), each of which is copied
+    // into a host-visible readback buffer at the end of its frame.
+    bool is_headless;
+    struct timespec headless_start_time;
+    GpuAllocation offscreen_image_allocations[MAX_FRAMES_IN_FLIGHT];
+    VkBuffer readback_buffers[MAX_FRAMES_IN_FLIGHT];
+    GpuAllocation readback_buffer_allocations[MAX_FRAMES_IN_FLIGHT];
+    // drawn frames not yet read back, oldest first:
+    uint32_t readback_first_pending_frame;
+    uint32_t readback_pending_frame_count;
+    // the part of a larger frame drawn instead of a whole one (see 'wo_renderer_set_frame_region'):
+    bool has_frame_region;
+    uint32_t frame_region_full_width;
+    uint32_t frame_region_full_height;
+    uint32_t frame_region_x;
+    uint32_t frame_region_y;
 
     // shader modules:
     bool vk_shaders_loaded_ok;
@@ -286,75 +525,449 @@ struct Wo_Renderer {
     bool vk_render_pass_ok;
     bool vk_descriptor_set_layout_ok;
 
+    // the pipeline cache, loaded from and saved to 'WO_PIPELINE_CACHE_FILEPATH':
+    VkPipelineCache vk_pipeline_cache;
+    size_t vk_pipeline_cache_saved_size;
+
+    // the worker thread creating the compute pipelines during initialization, then each
+    // pipeline variant the first time it is drawn (see 'get_trace_pipeline'), one at a time:
+#if WO_ASYNC_PIPELINE_CREATION
+    thrd_t vk_pipeline_worker;
+    atomic_bool vk_pipeline_worker_done;
+#endif
+    bool vk_pipeline_worker_running;
+
     // the graphics pipeline
     VkPipeline vk_graphics_pipeline;
     bool vk_graphics_pipeline_ok;
+
+    // the compute pipeline, tracing tiles into 'vk_trace_image' (optional):
+    VkShaderModule vk_comp_shader_module;
+    VkPipeline vk_compute_pipeline;
+    bool vk_compute_pipeline_ok;
+    bool vk_swapchain_supports_blit_dst;
+
+    // the ray query variant of the compute pipeline, tracing 'scene_tlas' (optional):
+    VkShaderModule vk_rq_comp_shader_module;
+    VkPipeline vk_ray_query_pipeline;
+    bool vk_ray_query_pipeline_ok;
+    Wo_Trace_Path trace_path;
     
     // command pools:
     VkCommandPool vk_command_buffer_pool;
     bool vk_command_buffer_pool_ok;
+    VkCommandPool vk_transfer_command_pool;
+    bool vk_transfer_command_pool_ok;
     VkCommandBuffer* vk_command_buffers;
     bool vk_command_buffers_ok;
 
-    // uniform buffers, per-swapchain image:
-    VkBuffer* uniform_buffers;
-    VkDeviceMemory* uniform_buffers_memory;
+    // device memory, sub-allocated for every buffer and image below:
+    GpuArena gpu_arena;
+    bool gpu_arena_ok;
+
+    // uniform buffer objects: one host-coherent buffer mapped for the renderer's lifetime,
+    // with a slot per swapchain image ('uniform_buffer_stride' apart, bound with a dynamic
+    // offset by that image's command buffer):
+    VkBuffer uniform_buffer;
+    GpuAllocation uniform_buffer_allocation;
+    VkDeviceSize uniform_buffer_stride;
     // descriptor queues, used to bind uniform buffers:
     VkDescriptorPool vk_descriptor_pool;
     VkDescriptorSet* vk_descriptor_sets;
     bool vk_descriptor_pool_ok;
 
+    // see 'wo_renderer_get_stats':
+    Wo_Renderer_Stats stats;
+
+    // CPU copies of the last committed scene buffers, patched by incremental updates:
+    // 'committed_flat_dirty_bitset' has a bit per flattened node, set while patching.
+    FlatScene committed_flat_scene;
+    SceneAccel committed_scene_accel;
+    uint64_t* committed_flat_dirty_bitset;
+    void* committed_accel_gpu_data;
+    size_t committed_accel_gpu_size;
+    GpuComponentAabb* committed_component_aabbs;
+    uint32_t committed_component_aabb_count;
+
+    // uploads still in flight on the dedicated transfer queue, oldest first:
+    PendingUpload pending_uploads[WO_MAX_PENDING_UPLOAD_COUNT];
+    uint32_t first_pending_upload;
+    uint32_t pending_upload_count;
+
+    // per-frame staging ring (one persistently mapped segment per frame in flight) and command
+    // buffers recording the incremental updates' copies:
+    VkBuffer update_staging_buffer;
+    GpuAllocation update_staging_buffer_allocation;
+    VkCommandBuffer vk_update_command_buffers[MAX_FRAMES_IN_FLIGHT];
+
+    // flattened scene nodes, device-local storage buffer shared by all frames:
+    // (scene buffers may be larger than their contents: see 'vk_replace_storage_buffer')
+    VkBuffer scene_buffer;
+    GpuAllocation scene_buffer_allocation;
+    VkDeviceSize scene_buffer_size;
+    VkDeviceSize scene_buffer_capacity;
+    uint32_t scene_gpu_node_count;
+    // before 'optimize_flat_scene' (equal to the above if disabled or nothing was rewritten):
+    uint32_t scene_unoptimized_gpu_node_count;
+    uint32_t scene_prototype_count;
+    uint32_t scene_instance_count;
+    uint32_t scene_bvh_node_count;
+    uint32_t scene_bounded_component_count;
+    uint32_t scene_unbounded_component_count;
+    // set if the committed scene was uploaded prebuilt from a scene file: it has no CPU copies
+    // (below), so moving its nodes re-commits it.
+    bool is_committed_scene_prebuilt;
+
+    // node bounds and the BVH over them, built alongside the scene buffer:
+    VkBuffer scene_accel_buffer;
+    GpuAllocation scene_accel_buffer_allocation;
+    VkDeviceSize scene_accel_buffer_size;
+    VkDeviceSize scene_accel_buffer_capacity;
+
+    // the ray query path's acceleration structures: a BLAS with one AABB per bounded component
+    // (the AABB buffer doubles as the storage buffer mapping primitives to components), and a
+    // TLAS with a single instance of it.
+    VkBuffer scene_component_aabb_buffer;
+    GpuAllocation scene_component_aabb_buffer_allocation;
+    VkDeviceSize scene_component_aabb_buffer_size;
+    VkDeviceSize scene_component_aabb_buffer_capacity;
+    VkAccelerationStructureKHR scene_blas;
+    VkBuffer scene_blas_buffer;
+    GpuAllocation scene_blas_buffer_allocation;
+    VkAccelerationStructureKHR scene_tlas;
+    VkBuffer scene_tlas_buffer;
+    GpuAllocation scene_tlas_buffer_allocation;
+    VkBuffer scene_tlas_instance_buffer;
+    GpuAllocation scene_tlas_instance_buffer_allocation;
+    VkBuffer scene_as_scratch_buffer;
+    GpuAllocation scene_as_scratch_buffer_allocation;
+    uint32_t scene_blas_primitive_count;
+
+    // storage image the compute path traces into, blitted onto the swapchain image:
+    VkImage vk_trace_image;
+    GpuAllocation vk_trace_image_allocation;
+    VkImageView vk_trace_image_view;
+    // ...and the float image its samples are averaged in, in progressive mode:
+    // (always in VK_IMAGE_LAYOUT_GENERAL)
+    VkImage vk_accumulation_image;
+    GpuAllocation vk_accumulation_image_allocation;
+    VkImageView vk_accumulation_image_view;
+
+    // progressive mode: each frame traces one jittered sample per pixel, averaged with the
+    // 'accumulated_sample_count' samples since the scene, trace path or resolution last changed.
+    bool is_progressive;
+    uint32_t accumulated_sample_count;
+
+    // materials, indexed by Wo_Material (uploaded along with the scene, so materials assigned
+    // since are seen after the next commit):
+    GpuMaterial materials[WO_RENDERER_MAX_MATERIAL_COUNT];
+    uint32_t material_count;
+    VkBuffer material_buffer;
+    GpuAllocation material_buffer_allocation;
+    VkDeviceSize material_buffer_size;
+    VkDeviceSize material_buffer_capacity;
+
+    // path tracing (see 'wo_renderer_set_path_tracing'):
+    bool is_path_tracing;
+    uint32_t path_trace_max_bounce_count;
+    uint64_t path_trace_ray_budget_per_frame;
+
+    // trace pipelines specialized to the committed scene's shape, the path tracer's bounces and
+    // the debug view (see 'get_trace_pipeline'):
+    uint32_t scene_node_type_mask;
+    uint32_t scene_stack_depth;
+    Wo_Debug_View debug_view;
+    PipelineVariant pipeline_variants[WO_MAX_PIPELINE_VARIANT_COUNT];
+    uint32_t pipeline_variant_count;
+    // the variant the pipeline worker is compiling, or WO_MAX_PIPELINE_VARIANT_COUNT if none:
+    uint32_t compiling_pipeline_variant_index;
+
+    // the compute paths count the rays they trace into one persistently mapped slot per
+    // swapchain image, read back (and reset) once that image's previous frame completed;
+    // the rate is measured over windows of about a second:
+    VkBuffer ray_counter_buffer;
+    GpuAllocation ray_counter_buffer_allocation;
+    VkDeviceSize ray_counter_stride;
+    double ray_rate_window_start_sec;
+    uint64_t ray_rate_window_ray_count;
+
+    // GPU timings: WO_FRAME_TIMESTAMP_COUNT timestamps in each swapchain image's command buffer,
+    // and WO_UPLOAD_TIMESTAMP_COUNT in each frame in flight's update command buffer, read back
+    // once the frame that wrote them completed (if the queue supports timestamps).
+    bool vk_timestamps_supported;
+    float vk_timestamp_period_ns;
+    VkQueryPool vk_timestamp_query_pool;
+    bool* vk_timestamps_written;
+    VkQueryPool vk_upload_timestamp_query_pool;
+    bool upload_timestamps_written[MAX_FRAMES_IN_FLIGHT];
+
+    // rolling timings (see 'Wo_Renderer_Stats'):
+    TimingWindow gpu_frame_timing;
+    TimingWindow gpu_trace_timing;
+    TimingWindow gpu_blit_timing;
+    TimingWindow gpu_readback_timing;
+    TimingWindow gpu_upload_timing;
+    TimingWindow cpu_submit_timing;
+    TimingWindow pipeline_variant_compile_timing;
+
+    // adaptive resolution (compute paths only): only the trace image's top-left 'render_scale'
+    // is traced (see 'get_trace_extent'), then upscaled onto the frame by the blit. The scale
+    // follows the smoothed GPU frame time towards 'frame_time_target_sec' (0 if disabled).
+    // Changing it invalidates the recorded command buffers, which are re-recorded one by one as
+    // their images come up (so no frame waits for the device to idle).
+    double frame_time_target_sec;
+    float render_scale;
+    double gpu_frame_time_smoothed_sec;
+    uint32_t frames_since_render_scale_change;
+    bool* vk_command_buffers_stale;
+
     // drawing routine semaphores:
     VkSemaphore vk_image_available_semaphores[MAX_FRAMES_IN_FLIGHT];
     VkSemaphore vk_render_finished_semaphores[MAX_FRAMES_IN_FLIGHT];
     VkFence vk_inflight_fences[MAX_FRAMES_IN_FLIGHT];
     VkFence* vk_images_inflight_fences;
     size_t current_frame_index;
+    uint32_t frames_in_flight;
     bool vk_semaphores_oks[MAX_FRAMES_IN_FLIGHT];
 };
 
 
-Wo_Renderer* new_renderer(Wo_App* app, char const* name, size_t max_node_count);
-Wo_Renderer* allocate_renderer(char const* name, size_t max_node_count);
+Wo_Renderer* new_renderer(Wo_App* app, char const* name, size_t initial_node_capacity, uint32_t frames_in_flight);
+Wo_Renderer* new_headless_renderer(char const* name, size_t initial_node_capacity, uint32_t width, uint32_t height, uint32_t frames_in_flight, uint32_t device_index);
+uint32_t count_vk_physical_devices(void);
+Wo_Renderer* allocate_renderer(char const* name, size_t initial_node_capacity, uint32_t frames_in_flight);
+double get_renderer_time_sec(Wo_Renderer* renderer);
 Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer);
+bool load_spirv(char const* file_path, SpirvCode* out_code);
+void unload_spirv(SpirvCode* code);
 VkShaderModule vk_load_shader_module(Wo_Renderer* renderer, char const* file_path);
+bool vk_create_compute_pipeline(
+    Wo_Renderer* renderer,
+    char const* file_path,
+    VkShaderModule* shader_module_p,
+    VkPipeline* pipeline_p
+);
+bool vk_create_specialized_graphics_pipeline(
+    Wo_Renderer* renderer,
+    VkSpecializationInfo const* specialization,
+    VkPipeline* pipeline_p
+);
+bool vk_create_specialized_compute_pipeline(
+    Wo_Renderer* renderer,
+    VkShaderModule shader_module,
+    VkSpecializationInfo const* specialization,
+    VkPipeline* pipeline_p
+);
+void vk_create_compute_pipelines(Wo_Renderer* renderer);
+void vk_run_pipeline_worker_job(Wo_Renderer* renderer);
+#if WO_ASYNC_PIPELINE_CREATION
+int vk_pipeline_worker_main(void* renderer);
+#endif
+void vk_start_pipeline_worker(Wo_Renderer* renderer);
+bool vk_pipeline_worker_is_done(Wo_Renderer* renderer);
+void vk_join_pipeline_worker(Wo_Renderer* renderer);
+void help_get_pipeline_cache_file_header(Wo_Renderer* renderer, uint64_t data_size, PipelineCacheFileHeader* out_header);
+void vk_create_pipeline_cache(Wo_Renderer* renderer);
+void vk_save_pipeline_cache(Wo_Renderer* renderer);
+bool vk_create_swapchain(Wo_Renderer* renderer, VkSwapchainKHR old_swapchain);
+void vk_destroy_swapchain_image_views(Wo_Renderer* renderer);
+bool vk_create_framebuffers(Wo_Renderer* renderer);
+void vk_destroy_framebuffers(Wo_Renderer* renderer);
+bool vk_create_storage_image(
+    Wo_Renderer* renderer,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkImage* image_p,
+    GpuAllocation* allocation_p,
+    VkImageView* view_p
+);
+bool vk_create_trace_image(Wo_Renderer* renderer);
+void vk_destroy_trace_image(Wo_Renderer* renderer);
+bool vk_create_swapchain_image_resources(Wo_Renderer* renderer);
+void vk_destroy_swapchain_image_resources(Wo_Renderer* renderer);
+void vk_write_storage_buffer_descriptors(Wo_Renderer* renderer, uint32_t binding, VkBuffer buffer, VkDeviceSize size);
+void vk_write_trace_image_descriptors(Wo_Renderer* renderer);
+void vk_write_tlas_descriptors(Wo_Renderer* renderer);
+bool recreate_swapchain(Wo_Renderer* renderer);
+bool vk_create_offscreen_targets(Wo_Renderer* renderer);
+void vk_destroy_offscreen_targets(Wo_Renderer* renderer);
+void vk_record_readback(Wo_Renderer* renderer, uint32_t i);
+bool vk_record_command_buffers(Wo_Renderer* renderer);
+bool vk_record_command_buffer(Wo_Renderer* renderer, uint32_t i);
+VkExtent2D get_trace_extent(Wo_Renderer* renderer);
+void vk_record_compute_trace(Wo_Renderer* renderer, uint32_t i);
+VkCommandBuffer vk_begin_one_time_command_buffer(Wo_Renderer* renderer);
+bool vk_submit_one_time_command_buffer(Wo_Renderer* renderer, VkCommandBuffer command_buffer);
+bool vk_upload_to_device_local_buffer(Wo_Renderer* renderer, VkBuffer dst_buffer, void const* data, VkDeviceSize size);
+bool vk_submit_transfer_upload(
+    Wo_Renderer* renderer,
+    VkBuffer staging_buffer,
+    GpuAllocation const* staging_buffer_allocation,
+    VkBuffer dst_buffer,
+    VkDeviceSize size
+);
+void vk_retire_pending_uploads(Wo_Renderer* renderer, uint32_t max_pending_count);
+void vk_free_pending_upload(Wo_Renderer* renderer, PendingUpload* upload);
+bool vk_replace_storage_buffer(
+    Wo_Renderer* renderer,
+    uint32_t binding,
+    VkBufferUsageFlags extra_usage,
+    VkBuffer* buffer_p,
+    GpuAllocation* buffer_allocation_p,
+    VkDeviceSize* buffer_size_p,
+    VkDeviceSize* buffer_capacity_p,
+    void const* data,
+    VkDeviceSize size
+);
+VkDeviceAddress vk_buffer_device_address(Wo_Renderer* renderer, VkBuffer buffer);
+void vk_destroy_scene_acceleration_structures(Wo_Renderer* renderer);
+void vk_get_scene_as_build_info(
+    Wo_Renderer* renderer,
+    int level,
+    VkAccelerationStructureGeometryKHR* out_geometry,
+    VkAccelerationStructureBuildGeometryInfoKHR* out_build_info,
+    uint32_t* out_primitive_count
+);
+void vk_cmd_build_scene_acceleration_structures(Wo_Renderer* renderer, VkCommandBuffer command_buffer);
+bool vk_build_scene_acceleration_structures(Wo_Renderer* renderer, uint32_t aabb_count);
+bool commit_scene(Wo_Renderer* renderer);
+bool upload_scene(
+    Wo_Renderer* renderer,
+    void const* scene_gpu_data, size_t scene_gpu_size,
+    void const* accel_gpu_data, size_t accel_gpu_size,
+    GpuComponentAabb const* component_aabbs_gpu_data, uint32_t component_aabb_count
+);
+bool help_stage_dirty_records(
+    uint8_t* staging_segment,
+    VkDeviceSize staging_segment_offset,
+    VkDeviceSize* staging_used_p,
+    void const* src_records,
+    uint32_t record_count,
+    VkDeviceSize record_size,
+    uint64_t const* dirty_bitset,
+    VkDeviceSize dst_offset,
+    VkBufferCopy* regions,
+    uint32_t* region_count_p
+);
+void help_diff_records(
+    void const* old_records,
+    void const* new_records,
+    uint32_t record_count,
+    size_t record_size,
+    uint64_t* out_dirty_bitset
+);
+bool update_scene(Wo_Renderer* renderer);
+void record_bvh_refit_time(Wo_Renderer* renderer, double time_sec);
+void record_bvh_rebuild_time(Wo_Renderer* renderer, double time_sec);
+bool set_node_argument(Wo_Renderer* renderer, Wo_Node node, Wo_Node_Side side, Wo_Node_Argument arg);
+bool set_trace_path(Wo_Renderer* renderer, Wo_Trace_Path trace_path);
+bool set_progressive(Wo_Renderer* renderer, bool progressive);
+bool set_frame_region(Wo_Renderer* renderer, uint32_t full_width, uint32_t full_height, uint32_t x, uint32_t y);
+void help_fit_ray_budget(Wo_Renderer* renderer, uint32_t* out_max_bounce_count, uint32_t* out_samples_per_pixel);
+bool set_path_tracing(Wo_Renderer* renderer, bool path_tracing, uint32_t max_bounce_count, uint64_t ray_budget_per_frame);
+void get_pipeline_variant_key(Wo_Renderer* renderer, Wo_Trace_Path trace_path, PipelineVariantKey* out_key);
+VkPipeline get_trace_pipeline(Wo_Renderer* renderer, Wo_Trace_Path trace_path);
+void vk_compile_pipeline_variant(Wo_Renderer* renderer, PipelineVariant* variant);
+void finish_pipeline_variant_compile(Wo_Renderer* renderer);
+void set_debug_view(Wo_Renderer* renderer, Wo_Debug_View debug_view);
+void read_ray_counter(Wo_Renderer* renderer, uint32_t image_index);
+void read_gpu_frame_time(Wo_Renderer* renderer, uint32_t image_index);
+void read_gpu_upload_time(Wo_Renderer* renderer, uint32_t frame_index);
+void vk_cmd_write_frame_timestamp(Wo_Renderer* renderer, uint32_t i, FrameTimestamp timestamp);
+void get_stats(Wo_Renderer* renderer, Wo_Renderer_Stats* out_stats);
+void update_render_scale(Wo_Renderer* renderer, double gpu_frame_time_sec);
+void set_render_scale(Wo_Renderer* renderer, float render_scale);
+bool set_frame_time_target(Wo_Renderer* renderer, double target_frame_time_sec);
+Wo_Material add_material(Wo_Renderer* renderer, GpuMaterial material);
+bool set_node_material(Wo_Renderer* renderer, Wo_Node node, Wo_Material material);
 
 void del_renderer(Wo_Renderer* renderer);
 void draw_frame_with_renderer(Wo_Renderer* renderer);
+bool read_frame(Wo_Renderer* renderer, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size);
 bool allocate_node(Wo_Renderer* renderer, Wo_Node* out_node);
+void free_node(Wo_Renderer* renderer, Wo_Node node);
+void clear_dirty_nodes(Wo_Renderer* renderer);
 void set_nonroot_node(Wo_Renderer* renderer, Wo_Node node);
+void add_node_reference(Wo_Renderer* renderer, Wo_Node node);
+bool remove_subtree(Wo_Renderer* renderer, Wo_Node root);
+bool compact_nodes(Wo_Renderer* renderer, Wo_Node* out_new_nodes, size_t out_new_node_count);
+bool save_scene(Wo_Renderer* renderer, char const* file_path);
+bool load_scene_mmap(Wo_Renderer* renderer, char const* file_path);
+void write_sphere_node(Wo_Renderer* renderer, Wo_Node node, Wo_Scalar radius);
+void write_infinite_planar_partition_node(Wo_Renderer* renderer, Wo_Node node, Wo_Vec3 outward_facing_normal);
+bool write_binop_node(Wo_Renderer* renderer, Wo_Node node, NodeType type, Wo_Node_Argument left, Wo_Node_Argument right);
+
+bool begin_scene_build(Wo_Renderer* renderer);
+bool end_scene_build(Wo_Renderer* renderer);
+void init_scene_builder(Wo_Scene_Builder* builder, Wo_Renderer* renderer);
+void finish_scene_builder(Wo_Scene_Builder* builder);
+bool scene_builder_allocate_node(Wo_Scene_Builder* builder, Wo_Node* out_node);
 
 //
 // Implementation:
 //
 
-Wo_Renderer* new_renderer(Wo_App* app, char const* name, size_t max_node_count) {
+Wo_Renderer* new_renderer(Wo_App* app, char const* name, size_t initial_node_capacity, uint32_t frames_in_flight) {
     // allocating all the memory we need:
-    Wo_Renderer* renderer = allocate_renderer(name, max_node_count);
-    renderer = vk_init_renderer(app, renderer);
-    renderer->current_frame_index = 0;
-    return renderer;
+    Wo_Renderer* renderer = allocate_renderer(name, initial_node_capacity, frames_in_flight);
+    if (renderer == NULL) {
+        return NULL;
+    }
+    return vk_init_renderer(app, renderer);
+}
+Wo_Renderer* new_headless_renderer(char const* name, size_t initial_node_capacity, uint32_t width, uint32_t height, uint32_t frames_in_flight, uint32_t device_index) {
+    if (width == 0 || height == 0) {
+        printf("[Wololo] Headless renderer \"%s\" cannot draw %u x %u frames.\n", name, width, height);
+        return NULL;
+    }
+    Wo_Renderer* renderer = allocate_renderer(name, initial_node_capacity, frames_in_flight);
+    if (renderer == NULL) {
+        return NULL;
+    }
+    renderer->is_headless = true;
+    renderer->vk_frame_extent.width = width;
+    renderer->vk_frame_extent.height = height;
+    renderer->vk_physical_device_index = device_index;
+    timespec_get(&renderer->headless_start_time, TIME_UTC);
+    return vk_init_renderer(NULL, renderer);
+}
+uint32_t count_vk_physical_devices(void) {
+    // creating a bare instance just to enumerate the physical devices, as 'vk_init_renderer' does:
+    VkApplicationInfo app_info;
+    memset(&app_info, 0, sizeof(app_info));
+    app_info.sType = VK_STRUCTURE_TYPE_APPLICATION_INFO;
+    app_info.pEngineName = "Wololo Csg Renderer";
+    app_info.engineVersion = VK_MAKE_VERSION(0, 0, 0);
+    app_info.apiVersion = VK_API_VERSION_1_0;
+    VkInstanceCreateInfo create_info;
+    memset(&create_info, 0, sizeof(create_info));
+    create_info.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
+    create_info.pApplicationInfo = &app_info;
+    VkInstance instance = VK_NULL_HANDLE;
+    if (vkCreateInstance(&create_info, NULL, &instance) != VK_SUCCESS) {
+        printf("[Wololo] Failed to create a Vulkan instance!\n");
+        return 0;
+    }
+    uint32_t physical_device_count = 0;
+    vkEnumeratePhysicalDevices(instance, &physical_device_count, NULL);
+    vkDestroyInstance(instance, NULL);
+    return physical_device_count;
 }
-Wo_Renderer* allocate_renderer(char const* name, size_t max_node_count) {
+Wo_Renderer* allocate_renderer(char const* name, size_t initial_node_capacity, uint32_t frames_in_flight) {
+    // (the node tables are allocated separately, chunk by chunk, as they grow)
     size_t subslab0_renderer_size_in_bytes = sizeof(Wo_Renderer);
-    size_t subslab1_type_table_size_in_bytes = sizeof(NodeType) * max_node_count;
-    size_t subslab2_info_table_size_in_bytes = sizeof(NodeInfo) * max_node_count;
-    size_t subslab3_root_bitset_size_in_bytes = ((max_node_count/64 + 1)*64) / 8;
-    size_t subslab4_name_size_in_bytes = 0; {
+    size_t subslab1_name_size_in_bytes = 0; {
         size_t name_length = strlen(name);
         if (name_length > 0) {
-            subslab4_name_size_in_bytes = 1+name_length;
+            subslab1_name_size_in_bytes = 1+name_length;
         }
     }
-    if (subslab4_name_size_in_bytes == 1) {
-        subslab4_name_size_in_bytes = 0;
+    if (subslab1_name_size_in_bytes == 1) {
+        subslab1_name_size_in_bytes = 0;
     }
     size_t slab_size_in_bytes = (
         subslab0_renderer_size_in_bytes +
-        subslab1_type_table_size_in_bytes + 
-        subslab2_info_table_size_in_bytes +
-        subslab3_root_bitset_size_in_bytes +
-        subslab4_name_size_in_bytes
+        subslab1_name_size_in_bytes
     );
 
     // 0-initializing the Renderer and all its slab data:
@@ -365,32 +978,69 @@ Wo_Renderer* allocate_renderer(char const* name, size_t max_node_count) {
     }
 
     Wo_Renderer* renderer = (void*)(mem_slab + 0);
-    renderer->max_node_count = max_node_count;
     renderer->current_node_count = 0;
-    renderer->node_type_table = (void*)&mem_slab[
-        subslab0_renderer_size_in_bytes
-    ];
-    renderer->node_info_table = (void*)&mem_slab[
-        subslab0_renderer_size_in_bytes + 
-        subslab1_type_table_size_in_bytes
-    ];
-    renderer->node_is_nonroot_bitset = (void*)&mem_slab[
-        subslab0_renderer_size_in_bytes + 
-        subslab1_type_table_size_in_bytes + 
-        subslab2_info_table_size_in_bytes
-    ];
+    renderer->free_node_list_head = WO_NODE_NONE;
+    renderer->free_node_count = 0;
+    renderer->compiling_pipeline_variant_index = WO_MAX_PIPELINE_VARIANT_COUNT;
     renderer->name = NULL;
-    if (subslab4_name_size_in_bytes > 0) {
+    if (subslab1_name_size_in_bytes > 0) {
         renderer->name = (void*)&mem_slab[
-            subslab0_renderer_size_in_bytes + 
-            subslab1_type_table_size_in_bytes + 
-            subslab2_info_table_size_in_bytes +
-            subslab3_root_bitset_size_in_bytes
+            subslab0_renderer_size_in_bytes
         ];
-        renderer->name = strncpy(renderer->name, name, subslab4_name_size_in_bytes);
+        renderer->name = strncpy(renderer->name, name, subslab1_name_size_in_bytes);
+    }
+
+    // reserving chunks for the nodes expected up front (more are allocated as nodes are added):
+    if (initial_node_capacity > WO_RENDERER_MAX_NODE_COUNT) {
+        initial_node_capacity = WO_RENDERER_MAX_NODE_COUNT;
+    }
+    if (!node_store_reserve(&renderer->node_store, 0, initial_node_capacity)) {
+        node_store_free(&renderer->node_store);
+        free(renderer);
+        return NULL;
+    }
+
+    if (frames_in_flight == 0) {
+        frames_in_flight = WO_RENDERER_DEFAULT_FRAMES_IN_FLIGHT;
+    }
+    if (frames_in_flight > MAX_FRAMES_IN_FLIGHT) {
+        printf(
+            "[Wololo] Renderer \"%s\" cannot have %u frames in flight, using %d.\n",
+            name, frames_in_flight, MAX_FRAMES_IN_FLIGHT
+        );
+        frames_in_flight = MAX_FRAMES_IN_FLIGHT;
+    }
+    renderer->frames_in_flight = frames_in_flight;
+    renderer->current_frame_index = 0;
+
+    // every leaf starts with the default material (see 'WO_MATERIAL_DEFAULT'):
+    GpuMaterial default_material; {
+        memset(&default_material, 0, sizeof(default_material));
+        default_material.kind = WO_GPU_MATERIAL_LAMBERTIAN;
+        default_material.albedo[0] = 0.5f;
+        default_material.albedo[1] = 0.5f;
+        default_material.albedo[2] = 0.5f;
     }
+    renderer->materials[WO_MATERIAL_DEFAULT] = default_material;
+    renderer->material_count = 1;
+    renderer->path_trace_max_bounce_count = 8;
+    renderer->render_scale = 1.0f;
+    renderer->stats.render_scale = 1.0f;
     return renderer;
 }
+double get_renderer_time_sec(Wo_Renderer* renderer) {
+    // GLFW's timer is only available with a window (i.e. an app), so headless renderers keep
+    // their own, counting from their creation:
+    if (!renderer->is_headless) {
+        return glfwGetTime();
+    }
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (
+        (double)(now.tv_sec - renderer->headless_start_time.tv_sec) +
+        (double)(now.tv_nsec - renderer->headless_start_time.tv_nsec) * 1e-9
+    );
+}
 Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
     // setting ambient state variables:
     renderer->app = app;
@@ -399,7 +1049,8 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
     // we know all pointers are NULL-initialized, so if non-NULL, we know there's an error.
 
     // checking that GLFW supports Vulkan:
-    assert(glfwVulkanSupported() == GLFW_TRUE && "GLFW should support Vulkan.");
+    // (headless renderers never touch GLFW, which may not even be initialized without a display)
+    assert((renderer->is_headless || glfwVulkanSupported() == GLFW_TRUE) && "GLFW should support Vulkan.");
 
     // creating a Vulkan instance, applying validation layers:
     // https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Instance
@@ -411,7 +1062,20 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             app_info.applicationVersion = VK_MAKE_VERSION(0, 0, 0);
             app_info.pEngineName = "Wololo Csg Renderer";
             app_info.engineVersion = VK_MAKE_VERSION(0, 0, 0);
-            app_info.apiVersion = VK_API_VERSION_1_0;
+
+            // requesting Vulkan 1.2 where the loader supports it, for the ray query backend:
+            renderer->vk_instance_api_version = VK_API_VERSION_1_0;
+            PFN_vkEnumerateInstanceVersion enumerate_instance_version = (PFN_vkEnumerateInstanceVersion)(
+                vkGetInstanceProcAddr(NULL, "vkEnumerateInstanceVersion")
+            );
+            if (enumerate_instance_version != NULL) {
+                uint32_t loader_api_version = VK_API_VERSION_1_0;
+                enumerate_instance_version(&loader_api_version);
+                if (loader_api_version >= VK_API_VERSION_1_2) {
+                    renderer->vk_instance_api_version = VK_API_VERSION_1_2;
+                }
+            }
+            app_info.apiVersion = renderer->vk_instance_api_version;
         }
 
         VkInstanceCreateInfo create_info; {
@@ -420,9 +1084,12 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             create_info.pApplicationInfo = &app_info;
             create_info.enabledLayerCount = 0;
             
+            // (presenting to a window surface needs GLFW's extensions; headless rendering, none)
             uint32_t glfw_extension_count = 0;
             char const** glfw_extensions = NULL;
-            glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+            if (!renderer->is_headless) {
+                glfw_extensions = glfwGetRequiredInstanceExtensions(&glfw_extension_count);
+            }
             create_info.enabledExtensionCount = glfw_extension_count;
             create_info.ppEnabledExtensionNames = glfw_extensions;
             
@@ -516,8 +1183,15 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             renderer->vk_physical_devices
         );
     
-        // just picking the first device:
-        renderer->vk_physical_device = renderer->vk_physical_devices[0];
+        // picking the requested device (the first, unless headless):
+        if (renderer->vk_physical_device_index >= renderer->vk_physical_device_count) {
+            printf(
+                "[Wololo] Could not find physical device %u: only %u support Vulkan.\n",
+                renderer->vk_physical_device_index, renderer->vk_physical_device_count
+            );
+            goto fatal_error;
+        }
+        renderer->vk_physical_device = renderer->vk_physical_devices[renderer->vk_physical_device_index];
 
         // reporting:
         {
@@ -531,19 +1205,131 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
                 "[Wololo] Initializing with Physical Device \"%s\"\n",
                 physical_device_properties.deviceName
             );
+            renderer->stats.device_index = renderer->vk_physical_device_index;
+            snprintf(
+                renderer->stats.device_name, sizeof(renderer->stats.device_name),
+                "%s", physical_device_properties.deviceName
+            );
         }
     }
     
-    // creating a logical device, setting command queues + queue indices:
+    // creating a window surface to present to:
+    // https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Window_surface#page_Querying-for-presentation-support
+    if (!renderer->is_headless) {
+        // renderer->vk_present_surface:
+        GLFWwindow* glfw_window = wo_app_glfw_window(renderer->app);
+        VkResult result = glfwCreateWindowSurface(
+            renderer->vk_instance,
+            glfw_window,
+            NULL,
+            &renderer->vk_present_surface
+        );
+        if (result != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan surface using GLFW.\n");
+            goto fatal_error;
+        }
+    }
+
+    // choosing the device's queue families, using the new surface:
+    // https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Physical_devices_and_queue_families
+    {
+        uint32_t queue_family_count = 0;
+        vkGetPhysicalDeviceQueueFamilyProperties(renderer->vk_physical_device, &queue_family_count, NULL);
+        renderer->vk_queue_family_count = queue_family_count;
+        renderer->vk_graphics_queue_family_index = renderer->vk_queue_family_count;
+        renderer->vk_present_queue_family_index = renderer->vk_queue_family_count;
+        renderer->vk_transfer_queue_family_index = renderer->vk_queue_family_count;
+
+        renderer->vk_queue_family_properties = calloc(queue_family_count, sizeof(VkQueueFamilyProperties));
+        vkGetPhysicalDeviceQueueFamilyProperties(renderer->vk_physical_device, &queue_family_count, renderer->vk_queue_family_properties);
+
+        for (uint32_t index = 0; index < renderer->vk_queue_family_count; index++) {
+            VkQueueFamilyProperties family_properties = renderer->vk_queue_family_properties[index];
+            if (family_properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+                renderer->vk_graphics_queue_family_index = index;
+            }
+
+            // (headless renderers never present: their present queue is the graphics queue)
+            VkBool32 present_supported = false;
+            if (renderer->is_headless) {
+                present_supported = (family_properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) != 0;
+            } else {
+                vkGetPhysicalDeviceSurfaceSupportKHR(
+                    renderer->vk_physical_device,
+                    index,
+                    renderer->vk_present_surface,
+                    &present_supported
+                );
+            }
+            if (present_supported) {
+                renderer->vk_present_queue_family_index = index;
+            }
+
+            // if all indices have been assigned, we needn't search further:
+            bool indices_are_complete = (
+                (renderer->vk_graphics_queue_family_index != renderer->vk_queue_family_count) &&
+                (renderer->vk_present_queue_family_index != renderer->vk_queue_family_count) &&
+                (true)
+            );
+            if (indices_are_complete) {
+                break;
+            }
+        }
+        if (renderer->vk_graphics_queue_family_index == renderer->vk_queue_family_count) {
+            printf("[Wololo] No queue family with VK_QUEUE_GRAPHICS_BIT was found.\n");
+            goto fatal_error;
+        }
+        if (renderer->vk_present_queue_family_index == renderer->vk_queue_family_count) {
+            printf("[Wololo] No queue family with VK_QUEUE_PRESENT_BIT was found.\n");
+            goto fatal_error;
+        }
+
+        // preferring a transfer-only family for uploads (typically the device's copy engines, which
+        // run alongside rendering), else uploading on the graphics queue:
+        for (uint32_t index = 0; index < renderer->vk_queue_family_count; index++) {
+            VkQueueFlags const queue_flags = renderer->vk_queue_family_properties[index].queueFlags;
+            bool is_transfer_only = (
+                (queue_flags & VK_QUEUE_TRANSFER_BIT) &&
+                !(queue_flags & (VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT))
+            );
+            if (is_transfer_only) {
+                renderer->vk_transfer_queue_family_index = index;
+                break;
+            }
+        }
+        renderer->vk_has_dedicated_transfer_queue = (renderer->vk_transfer_queue_family_index != renderer->vk_queue_family_count);
+        if (!renderer->vk_has_dedicated_transfer_queue) {
+            renderer->vk_transfer_queue_family_index = renderer->vk_graphics_queue_family_index;
+        }
+    }
+
+    // creating a logical device, with a queue from each chosen family:
     // https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Logical_device_and_queues
     {
-        VkDeviceQueueCreateInfo queue_create_info;
-        memset(&queue_create_info, 0, sizeof(queue_create_info));
-        queue_create_info.sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
-        queue_create_info.queueFamilyIndex = renderer->vk_graphics_queue_family_index;
-        queue_create_info.queueCount = 1;
+        // one queue per distinct family chosen above:
+        uint32_t const queue_family_indices[3] = {
+            renderer->vk_graphics_queue_family_index,
+            renderer->vk_present_queue_family_index,
+            renderer->vk_transfer_queue_family_index
+        };
+        VkDeviceQueueCreateInfo queue_create_infos[3];
+        uint32_t queue_create_info_count = 0;
         float const queue_priority = 1.0f;
-        queue_create_info.pQueuePriorities = &queue_priority;
+        for (uint32_t i = 0; i < 3; i++) {
+            bool is_new_family = true;
+            for (uint32_t j = 0; j < queue_create_info_count; j++) {
+                is_new_family = is_new_family && (queue_create_infos[j].queueFamilyIndex != queue_family_indices[i]);
+            }
+            if (!is_new_family) {
+                continue;
+            }
+            VkDeviceQueueCreateInfo* queue_create_info = &queue_create_infos[queue_create_info_count++];
+            memset(queue_create_info, 0, sizeof(VkDeviceQueueCreateInfo));
+            queue_create_info->sType = VK_STRUCTURE_TYPE_DEVICE_QUEUE_CREATE_INFO;
+            queue_create_info->queueFamilyIndex = queue_family_indices[i];
+            queue_create_info->queueCount = 1;
+            queue_create_info->pQueuePriorities = &queue_priority;
+        }
 
         // don't need any special device features:
         VkPhysicalDeviceFeatures device_features;
@@ -555,8 +1341,8 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         create_info.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
 
         // setting up queues:
-        create_info.pQueueCreateInfos = &queue_create_info;
-        create_info.queueCreateInfoCount = 1;
+        create_info.pQueueCreateInfos = queue_create_infos;
+        create_info.queueCreateInfoCount = queue_create_info_count;
         create_info.pEnabledFeatures = &device_features;
     
         // loading extensions (like the Swap-chain extension) into create_info:
@@ -595,12 +1381,17 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         // storing all enabled extensions' names:
         uint32_t max_extension_count = (
             MINIMUM_VK_DEVICE_EXTENSION_COUNT + 
+            RAY_QUERY_VK_DEVICE_EXTENSION_COUNT +
             0
         );
         renderer->vk_enabled_device_extension_count = 0;
         renderer->vk_enabled_device_extension_names = calloc(max_extension_count, sizeof(char const*));
         for (uint32_t min_ext_index = 0; min_ext_index < MINIMUM_VK_DEVICE_EXTENSION_COUNT; min_ext_index++) {
             char const* ext_name = minimum_vk_device_extension_names[min_ext_index];
+            if (renderer->is_headless && 0 == strcmp(ext_name, "VK_KHR_swapchain")) {
+                // headless renderers do not present, so need no swapchain.
+                continue;
+            }
             
             // searching for this extension:
             bool ext_found = false;
@@ -625,6 +1416,77 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             }
         }
         
+        // enabling the ray query extensions and features if all of them are supported:
+        VkPhysicalDeviceBufferDeviceAddressFeatures buffer_device_address_features;
+        VkPhysicalDeviceAccelerationStructureFeaturesKHR acceleration_structure_features;
+        VkPhysicalDeviceRayQueryFeaturesKHR ray_query_features;
+        {
+            VkPhysicalDeviceProperties physical_device_properties;
+            vkGetPhysicalDeviceProperties(renderer->vk_physical_device, &physical_device_properties);
+            bool ray_query_supported = (
+                renderer->vk_instance_api_version >= VK_API_VERSION_1_2 &&
+                physical_device_properties.apiVersion >= VK_API_VERSION_1_2
+            );
+            for (uint32_t rq_ext_index = 0; ray_query_supported && rq_ext_index < RAY_QUERY_VK_DEVICE_EXTENSION_COUNT; rq_ext_index++) {
+                char const* ext_name = ray_query_vk_device_extension_names[rq_ext_index];
+                bool ext_found = false;
+                for (uint32_t available_ext_index = 0; available_ext_index < renderer->vk_available_device_extension_count; available_ext_index++) {
+                    if (0 == strcmp(renderer->vk_available_device_extensions[available_ext_index].extensionName, ext_name)) {
+                        ext_found = true;
+                        break;
+                    }
+                }
+                ray_query_supported = ext_found;
+            }
+
+            memset(&buffer_device_address_features, 0, sizeof(buffer_device_address_features));
+            buffer_device_address_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+            memset(&acceleration_structure_features, 0, sizeof(acceleration_structure_features));
+            acceleration_structure_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+            acceleration_structure_features.pNext = &buffer_device_address_features;
+            memset(&ray_query_features, 0, sizeof(ray_query_features));
+            ray_query_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+            ray_query_features.pNext = &acceleration_structure_features;
+            if (ray_query_supported) {
+                VkPhysicalDeviceFeatures2 features2;
+                memset(&features2, 0, sizeof(features2));
+                features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+                features2.pNext = &ray_query_features;
+                vkGetPhysicalDeviceFeatures2(renderer->vk_physical_device, &features2);
+                ray_query_supported = (
+                    ray_query_features.rayQuery &&
+                    acceleration_structure_features.accelerationStructure &&
+                    buffer_device_address_features.bufferDeviceAddress
+                );
+            }
+
+            renderer->vk_ray_query_supported = ray_query_supported;
+            if (ray_query_supported) {
+                for (uint32_t rq_ext_index = 0; rq_ext_index < RAY_QUERY_VK_DEVICE_EXTENSION_COUNT; rq_ext_index++) {
+                    char const* ext_name = ray_query_vk_device_extension_names[rq_ext_index];
+                    printf("[Wololo] Initializing Vulkan device extension \"%s\"\n", ext_name);
+                    uint32_t index = renderer->vk_enabled_device_extension_count++;
+                    renderer->vk_enabled_device_extension_names[index] = ext_name;
+                }
+
+                // requesting only the features we use:
+                memset(&buffer_device_address_features, 0, sizeof(buffer_device_address_features));
+                buffer_device_address_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+                buffer_device_address_features.bufferDeviceAddress = VK_TRUE;
+                memset(&acceleration_structure_features, 0, sizeof(acceleration_structure_features));
+                acceleration_structure_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_ACCELERATION_STRUCTURE_FEATURES_KHR;
+                acceleration_structure_features.pNext = &buffer_device_address_features;
+                acceleration_structure_features.accelerationStructure = VK_TRUE;
+                memset(&ray_query_features, 0, sizeof(ray_query_features));
+                ray_query_features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_RAY_QUERY_FEATURES_KHR;
+                ray_query_features.pNext = &acceleration_structure_features;
+                ray_query_features.rayQuery = VK_TRUE;
+                create_info.pNext = &ray_query_features;
+            } else {
+                printf("[Wololo] Vulkan device does not support ray queries; tracing with the software BVH.\n");
+            }
+        }
+
         // setting extension request args:
         create_info.enabledExtensionCount = renderer->vk_enabled_device_extension_count;
         create_info.ppEnabledExtensionNames = renderer->vk_enabled_device_extension_names;
@@ -648,102 +1510,97 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             printf("[Wololo] Failed to create a Vulkan logical device.\n");
             goto fatal_error;
         }
-    }
 
-    // creating a window surface to present to:
-    // https://vulkan-tutorial.com/Drawing_a_triangle/Presentation/Window_surface#page_Querying-for-presentation-support
-    {
-        // renderer->vk_present_surface:
-        GLFWwindow* glfw_window = wo_app_glfw_window(renderer->app);
-        VkResult result = glfwCreateWindowSurface(
-            renderer->vk_instance,
-            glfw_window,
-            NULL,
-            &renderer->vk_present_surface
+        // (buffer device addresses were enabled along with ray queries)
+        new_gpu_arena(
+            renderer->vk_physical_device,
+            renderer->vk_device,
+            renderer->vk_ray_query_supported,
+            &renderer->gpu_arena
         );
-        if (result != VK_SUCCESS) {
-            printf("[Wololo] Failed to create Vulkan surface using GLFW.\n");
-            goto fatal_error;
+        renderer->gpu_arena_ok = true;
+
+        // fetching the ray query extensions' functions:
+        if (renderer->vk_ray_query_supported) {
+            renderer->vk_create_acceleration_structure = (PFN_vkCreateAccelerationStructureKHR)(
+                vkGetDeviceProcAddr(renderer->vk_device, "vkCreateAccelerationStructureKHR")
+            );
+            renderer->vk_destroy_acceleration_structure = (PFN_vkDestroyAccelerationStructureKHR)(
+                vkGetDeviceProcAddr(renderer->vk_device, "vkDestroyAccelerationStructureKHR")
+            );
+            renderer->vk_get_acceleration_structure_build_sizes = (PFN_vkGetAccelerationStructureBuildSizesKHR)(
+                vkGetDeviceProcAddr(renderer->vk_device, "vkGetAccelerationStructureBuildSizesKHR")
+            );
+            renderer->vk_cmd_build_acceleration_structures = (PFN_vkCmdBuildAccelerationStructuresKHR)(
+                vkGetDeviceProcAddr(renderer->vk_device, "vkCmdBuildAccelerationStructuresKHR")
+            );
+            renderer->vk_get_acceleration_structure_device_address = (PFN_vkGetAccelerationStructureDeviceAddressKHR)(
+                vkGetDeviceProcAddr(renderer->vk_device, "vkGetAccelerationStructureDeviceAddressKHR")
+            );
+            renderer->vk_get_buffer_device_address = (PFN_vkGetBufferDeviceAddress)(
+                vkGetDeviceProcAddr(renderer->vk_device, "vkGetBufferDeviceAddress")
+            );
+            renderer->vk_ray_query_supported = (
+                renderer->vk_create_acceleration_structure != NULL &&
+                renderer->vk_destroy_acceleration_structure != NULL &&
+                renderer->vk_get_acceleration_structure_build_sizes != NULL &&
+                renderer->vk_cmd_build_acceleration_structures != NULL &&
+                renderer->vk_get_acceleration_structure_device_address != NULL &&
+                renderer->vk_get_buffer_device_address != NULL
+            );
+            if (!renderer->vk_ray_query_supported) {
+                printf("[Wololo] Failed to load Vulkan ray query functions; tracing with the software BVH.\n");
+            }
         }
     }
 
-    // assigning device queues using the new surface:
+    // getting the device queues:
     {
-        // checking the device's queue properties:
-        // https://vulkan-tutorial.com/en/Drawing_a_triangle/Setup/Physical_devices_and_queue_families
-        {   
-            uint32_t queue_family_count = 0;
-            vkGetPhysicalDeviceQueueFamilyProperties(renderer->vk_physical_device, &queue_family_count, NULL);
-            renderer->vk_queue_family_count = queue_family_count;
-            renderer->vk_graphics_queue_family_index = renderer->vk_queue_family_count;
-            renderer->vk_present_queue_family_index = renderer->vk_queue_family_count;
-            
-            renderer->vk_queue_family_properties = calloc(queue_family_count, sizeof(VkQueueFamilyProperties));
-            vkGetPhysicalDeviceQueueFamilyProperties(renderer->vk_physical_device, &queue_family_count, renderer->vk_queue_family_properties);
-
-            for (uint32_t index = 0; index < renderer->vk_queue_family_count; index++) {
-                VkQueueFamilyProperties family_properties = renderer->vk_queue_family_properties[index];
-                if (family_properties.queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-                    renderer->vk_graphics_queue_family_index = index;
-                }
+        // renderer->vk_graphics_queue:
+        vkGetDeviceQueue(
+            renderer->vk_device,
+            renderer->vk_graphics_queue_family_index,
+            0,
+            &renderer->vk_graphics_queue
+        );
+        printf("[Wololo] Vulkan graphics queue loaded.\n");
 
-                VkBool32 present_supported = false;
-                vkGetPhysicalDeviceSurfaceSupportKHR(
-                    renderer->vk_physical_device,
-                    index,
-                    renderer->vk_present_surface,
-                    &present_supported
-                );
-                if (present_supported) {
-                    renderer->vk_present_queue_family_index = index;
-                }
+        // renderer->vk_present_queue:
+        vkGetDeviceQueue(
+            renderer->vk_device,
+            renderer->vk_present_queue_family_index,
+            0,
+            &renderer->vk_present_queue
+        );
+        printf("[Wololo] Vulkan present queue loaded.\n");
 
-                // if all indices have been assigned, we needn't search further:
-                bool indices_are_complete = (
-                    (renderer->vk_graphics_queue_family_index != renderer->vk_queue_family_count) &&
-                    (renderer->vk_present_queue_family_index != renderer->vk_queue_family_count) &&
-                    (true)
-                );
-                if (indices_are_complete) {
-                    break;
-                }
-            }
-            if (renderer->vk_graphics_queue_family_index == renderer->vk_queue_family_count) {
-                printf("[Wololo] No queue family with VK_QUEUE_GRAPHICS_BIT was found.\n");
-                goto fatal_error;
-            } else {
-                printf("[Wololo] Vulkan graphics queue loaded.\n");
-            }
-            if (renderer->vk_present_queue_family_index == renderer->vk_queue_family_count) {
-                printf("[Wololo] No queue family with VK_QUEUE_PRESENT_BIT was found.\n");
-                goto fatal_error;
-            } else {
-                printf("[Wololo] Vulkan present queue loaded.\n");
-            }
+        // renderer->vk_transfer_queue:
+        vkGetDeviceQueue(
+            renderer->vk_device,
+            renderer->vk_transfer_queue_family_index,
+            0,
+            &renderer->vk_transfer_queue
+        );
+        if (renderer->vk_has_dedicated_transfer_queue) {
+            printf("[Wololo] Vulkan dedicated transfer queue loaded (queue family %u).\n", renderer->vk_transfer_queue_family_index);
+        } else {
+            printf("[Wololo] Vulkan device has no transfer-only queue family; uploading on the graphics queue.\n");
         }
+    }
 
-        // getting the device queue:
-        {
-            // renderer->vk_graphics_queue:
-            vkGetDeviceQueue(
-                renderer->vk_device,
-                renderer->vk_graphics_queue_family_index,
-                0,
-                &renderer->vk_graphics_queue
-            );
 
-            // renderer->vk_present_queue:
-            vkGetDeviceQueue(
-                renderer->vk_device,
-                renderer->vk_present_queue_family_index,
-                0,
-                &renderer->vk_present_queue
-            );
+    // creating offscreen images to draw frames into when headless, in place of the swapchain:
+    if (renderer->is_headless) {
+        renderer->vk_frame_final_layout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        if (!vk_create_offscreen_targets(renderer)) {
+            goto fatal_error;
         }
     }
 
     // creating the swapchain:
-    {
+    if (!renderer->is_headless) {
+        renderer->vk_frame_final_layout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
         // Querying GPU swap chain capabilities:
         bool swap_chain_adequate = false;
         {
@@ -853,210 +1710,16 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             }
         }
 
-        // Choosing swap extent:
-        {
-            if (renderer->vk_present_surface_capabilities.currentExtent.width != UINT32_MAX) {
-                // special case; pick best resolution from minImageExtent to maxImageExtent bounds.
-                renderer->vk_frame_extent = renderer->vk_present_surface_capabilities.currentExtent;
-            } else {
-                int width, height;
-                glfwGetFramebufferSize(
-                    wo_app_glfw_window(renderer->app), 
-                    &width, &height
-                );
-
-                // initializing width and height to the frame-buffer size:
-                renderer->vk_frame_extent.width = (uint32_t)width;
-                renderer->vk_frame_extent.height = (uint32_t)height;
-                
-                // clamping width and height against minimum/maximum allowed:
-                renderer->vk_frame_extent.width = MAX(
-                    renderer->vk_present_surface_capabilities.minImageExtent.width,
-                    renderer->vk_frame_extent.width
-                );
-                renderer->vk_frame_extent.width = MIN(
-                    renderer->vk_present_surface_capabilities.maxImageExtent.width,
-                    renderer->vk_frame_extent.width
-                );
-                renderer->vk_frame_extent.height = MAX(
-                    renderer->vk_present_surface_capabilities.minImageExtent.height,
-                    renderer->vk_frame_extent.height
-                );
-                renderer->vk_frame_extent.height = MIN(
-                    renderer->vk_present_surface_capabilities.maxImageExtent.height,
-                    renderer->vk_frame_extent.height
-                );
-            }
-
-            // Finally creating the swapchain:
-        
-            // requesting number of images in the swap chain.
-            // always requesting 1 extra so the GPU is never starved for frames while we render (double-buffer or better)
-            // note '0' is a special value meaning no maximum.
-            uint32_t image_count = MIN(
-                1 + renderer->vk_present_surface_capabilities.minImageCount,
-                renderer->vk_present_surface_capabilities.maxImageCount
-            );
-
-            VkSwapchainCreateInfoKHR swapchain_create_info;
-            uint32_t queue_family_indices[2] = {
-                renderer->vk_graphics_queue_family_index,
-                renderer->vk_present_queue_family_index
-            };
-            {
-                memset(&swapchain_create_info, 0, sizeof(swapchain_create_info));
-
-                swapchain_create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
-                swapchain_create_info.surface = renderer->vk_present_surface;
-                swapchain_create_info.minImageCount = image_count;
-                swapchain_create_info.imageFormat = renderer->vk_chosen_present_surface_format.format;
-                swapchain_create_info.imageColorSpace = renderer->vk_chosen_present_surface_format.colorSpace;
-                swapchain_create_info.imageExtent = renderer->vk_frame_extent;
-                swapchain_create_info.imageArrayLayers = 1;
-
-                // note: for postprocessing, use 'VK_IMAGE_USAGE_TRANSFER_DST_BIT' instead and use
-                //       a memory operation to transfer the rendered image to a swap chain image.
-                swapchain_create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
-            
-                if (renderer->vk_graphics_queue_family_index != renderer->vk_present_queue_family_index) {
-                    swapchain_create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
-                    swapchain_create_info.queueFamilyIndexCount = 2;
-                    swapchain_create_info.pQueueFamilyIndices = queue_family_indices;
-                } else {
-                    swapchain_create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
-                }
-
-                swapchain_create_info.preTransform = renderer->vk_present_surface_capabilities.currentTransform;
-                
-                // no transparent windows, thank you:
-                swapchain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
-
-                swapchain_create_info.presentMode = renderer->vk_chosen_present_surface_mode;
-                
-                swapchain_create_info.clipped = VK_TRUE;
-
-                // do not handle resizing, i.e. only ever create one swapchain:
-                swapchain_create_info.oldSwapchain = VK_NULL_HANDLE;
-            }
-
-            VkResult result = vkCreateSwapchainKHR(
-                renderer->vk_device,
-                &swapchain_create_info, NULL, 
-                &renderer->vk_swapchain
-            );
-            if (result != VK_SUCCESS) {
-                printf("[Wololo] Failed to create a Vulkan swapchain.\n");
-                goto fatal_error;
-            } else {
-                printf(
-                    "[Wololo] Successfully create a Vulkan swapchain with extent [%u x %u]\n",
-                    renderer->vk_frame_extent.width,
-                    renderer->vk_frame_extent.height
-                );
-            }
+        // Choosing swap extent, creating the swapchain, its images and their image views:
+        if (!vk_create_swapchain(renderer, VK_NULL_HANDLE)) {
+            goto fatal_error;
         }
+    }
 
-        // Retrieving the created swapchain's images:
-        {
-            // setting `renderer->vk_swapchain_images_count`
-            vkGetSwapchainImagesKHR(
-                renderer->vk_device,
-                renderer->vk_swapchain,
-                &renderer->vk_swapchain_images_count,
-                NULL
-            );
-
-            // allocating:
-            renderer->vk_swapchain_images = calloc(
-                sizeof(VkImage),
-                renderer->vk_swapchain_images_count
-            );
-
-            // setting vk_swapchain_images:
-            VkResult swapchain_images_ok = vkGetSwapchainImagesKHR(
-                renderer->vk_device,
-                renderer->vk_swapchain,
-                &renderer->vk_swapchain_images_count,
-                renderer->vk_swapchain_images
-            );
-            if (swapchain_images_ok != VK_SUCCESS) {
-                printf("[Wololo] Failed to create Vulkan swapchain images.\n");
-                goto fatal_error;
-            } else {
-                printf("[Wololo] Vulkan swapchain images created successfully.\n");
-            }
-        }
-    }
-
-    //
-    // Presentation
-    //
-
-    // creating image views:
-    // https://vulkan-tutorial.com/en/Drawing_a_triangle/Presentation/Image_views
-    // to use any VkImage, need VkImageView
-    {
-        // first, allocating the vk_swapchain_image_views array
-        // s.t. there exists a unique image-view per image
-        renderer->vk_swapchain_image_views = NULL;
-        if (renderer->vk_swapchain_images_count > 0) {
-            renderer->vk_swapchain_image_views = calloc(
-                sizeof(VkImageView),
-                renderer->vk_swapchain_images_count
-            );
-            assert(
-                renderer->vk_swapchain_image_views &&
-                "Allocation failed: renderer->vk_swapchain_image_views"
-            );
-        }
-
-        // then, calling on Vulkan to create, thereby populating the array:
-        for (size_t index = 0; index < renderer->vk_swapchain_images_count; index++) {
-            VkImageViewCreateInfo create_info;
-            {
-                memset(&create_info, 0, sizeof(create_info));
-                create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
-                create_info.image = renderer->vk_swapchain_images[index];
-                create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
-                create_info.format = renderer->vk_chosen_present_surface_format.format;
-
-                // each pixel is composed of one or more values corresponding to channels
-                // in the output image, e.g. red (R), green (G), blue (B), and alpha (A).
-                // 'swizzle' describes a linear transformation on a bit-vector, and just tells
-                // Vulkan how to access each component.
-                create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
-                create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
-                create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
-                create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
-
-                // setting up mipmapping levels, or multiple layers (for stereographic 3D)
-                create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-                create_info.subresourceRange.baseMipLevel = 0;
-                create_info.subresourceRange.levelCount = 1;
-                create_info.subresourceRange.baseArrayLayer = 0;
-                create_info.subresourceRange.layerCount = 1;
-            }
-
-            // creating the VkImageView:
-            VkResult ok = vkCreateImageView(
-                renderer->vk_device, 
-                &create_info, 
-                NULL, 
-                &renderer->vk_swapchain_image_views[index]
-            );
-            if (ok != VK_SUCCESS) {
-                printf("[Wololo] Failed to create Vulkan image view %zu/%u.\n", index+1, renderer->vk_swapchain_images_count);
-                goto fatal_error;
-            } else {
-                printf("[Wololo] Vulkan image view %zu/%u created successfully.\n", index+1, renderer->vk_swapchain_images_count);
-            }
-        }
-    }
-
-    // create render pass
-    {
-        // add a single color bufer attachment, represented by an image from the swapchain:
-        VkAttachmentDescription color_attachment_desc;
+    // create render pass
+    {
+        // add a single color bufer attachment, represented by an image from the swapchain:
+        VkAttachmentDescription color_attachment_desc;
         {
             memset(&color_attachment_desc, 0, sizeof(color_attachment_desc));
             color_attachment_desc.format = renderer->vk_chosen_present_surface_format.format;
@@ -1067,9 +1730,9 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             // forsake the stencil buffer:
             color_attachment_desc.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
             color_attachment_desc.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
-            // setting the final layout to a 'present' image layout:
+            // setting the final layout to a 'present' image layout (or the readback's source layout):
             color_attachment_desc.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-            color_attachment_desc.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+            color_attachment_desc.finalLayout = renderer->vk_frame_final_layout;
             // not mentioned in tutorial:
             color_attachment_desc.flags = 0;
         }
@@ -1101,17 +1764,25 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             
             // adding a subpass dependency to acquire the image at the top of the pipeline:
             // see: https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation#page_Submitting-the-command-buffer
-            VkSubpassDependency dependency; {
-                memset(&dependency, 0, sizeof(dependency));
-                dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
-                dependency.dstSubpass = 0;
-                dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-                dependency.srcAccessMask = 0;
-                dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-                dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+            VkSubpassDependency dependencies[2]; {
+                memset(dependencies, 0, sizeof(dependencies));
+                dependencies[0].srcSubpass = VK_SUBPASS_EXTERNAL;
+                dependencies[0].dstSubpass = 0;
+                dependencies[0].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                dependencies[0].srcAccessMask = 0;
+                dependencies[0].dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                dependencies[0].dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+                // ...and when headless, one handing the attachment over to the readback copy:
+                dependencies[1].srcSubpass = 0;
+                dependencies[1].dstSubpass = VK_SUBPASS_EXTERNAL;
+                dependencies[1].srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
+                dependencies[1].srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+                dependencies[1].dstStageMask = VK_PIPELINE_STAGE_TRANSFER_BIT;
+                dependencies[1].dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
             }
-            render_pass_create_info.dependencyCount = 1;
-            render_pass_create_info.pDependencies = &dependency;
+            render_pass_create_info.dependencyCount = renderer->is_headless ? 2 : 1;
+            render_pass_create_info.pDependencies = dependencies;
 
             VkResult render_pass_ok = vkCreateRenderPass(
                 renderer->vk_device,
@@ -1136,12 +1807,109 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
     {
         memset(&fubo_descriptor_set_layout_binding, 0, sizeof(fubo_descriptor_set_layout_binding));
         fubo_descriptor_set_layout_binding.binding = 0;
-        fubo_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+        fubo_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
         fubo_descriptor_set_layout_binding.descriptorCount = 1;
     
-        fubo_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT;
+        fubo_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
         fubo_descriptor_set_layout_binding.pImmutableSamplers = NULL;
     }
+    // ...and right next to it, the flattened scene nodes (a storage buffer):
+    VkDescriptorSetLayoutBinding scene_descriptor_set_layout_binding;
+    {
+        memset(&scene_descriptor_set_layout_binding, 0, sizeof(scene_descriptor_set_layout_binding));
+        scene_descriptor_set_layout_binding.binding = 1;
+        scene_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        scene_descriptor_set_layout_binding.descriptorCount = 1;
+
+        scene_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+        scene_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    // ...followed by the node bounds and BVH built over them:
+    VkDescriptorSetLayoutBinding scene_accel_descriptor_set_layout_binding;
+    {
+        memset(&scene_accel_descriptor_set_layout_binding, 0, sizeof(scene_accel_descriptor_set_layout_binding));
+        scene_accel_descriptor_set_layout_binding.binding = 2;
+        scene_accel_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        scene_accel_descriptor_set_layout_binding.descriptorCount = 1;
+
+        scene_accel_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+        scene_accel_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    // ...and finally the storage image written by the compute path:
+    VkDescriptorSetLayoutBinding trace_image_descriptor_set_layout_binding;
+    {
+        memset(&trace_image_descriptor_set_layout_binding, 0, sizeof(trace_image_descriptor_set_layout_binding));
+        trace_image_descriptor_set_layout_binding.binding = 3;
+        trace_image_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        trace_image_descriptor_set_layout_binding.descriptorCount = 1;
+
+        trace_image_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        trace_image_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    // ...and the image progressive mode accumulates its samples in (see 'ubershader1.comp'):
+    VkDescriptorSetLayoutBinding accumulation_image_descriptor_set_layout_binding;
+    {
+        memset(&accumulation_image_descriptor_set_layout_binding, 0, sizeof(accumulation_image_descriptor_set_layout_binding));
+        accumulation_image_descriptor_set_layout_binding.binding = 6;
+        accumulation_image_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+        accumulation_image_descriptor_set_layout_binding.descriptorCount = 1;
+
+        accumulation_image_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        accumulation_image_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    // ...and the material table and ray counter read and written by the path tracer:
+    VkDescriptorSetLayoutBinding material_descriptor_set_layout_binding;
+    {
+        memset(&material_descriptor_set_layout_binding, 0, sizeof(material_descriptor_set_layout_binding));
+        material_descriptor_set_layout_binding.binding = 7;
+        material_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        material_descriptor_set_layout_binding.descriptorCount = 1;
+
+        material_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        material_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    VkDescriptorSetLayoutBinding ray_counter_descriptor_set_layout_binding;
+    {
+        memset(&ray_counter_descriptor_set_layout_binding, 0, sizeof(ray_counter_descriptor_set_layout_binding));
+        ray_counter_descriptor_set_layout_binding.binding = 8;
+        ray_counter_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        ray_counter_descriptor_set_layout_binding.descriptorCount = 1;
+
+        ray_counter_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        ray_counter_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    // ...and, for the ray query path only, the TLAS and the component AABBs it was built from:
+    VkDescriptorSetLayoutBinding scene_tlas_descriptor_set_layout_binding;
+    {
+        memset(&scene_tlas_descriptor_set_layout_binding, 0, sizeof(scene_tlas_descriptor_set_layout_binding));
+        scene_tlas_descriptor_set_layout_binding.binding = 4;
+        scene_tlas_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+        scene_tlas_descriptor_set_layout_binding.descriptorCount = 1;
+
+        scene_tlas_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        scene_tlas_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    VkDescriptorSetLayoutBinding scene_component_aabbs_descriptor_set_layout_binding;
+    {
+        memset(&scene_component_aabbs_descriptor_set_layout_binding, 0, sizeof(scene_component_aabbs_descriptor_set_layout_binding));
+        scene_component_aabbs_descriptor_set_layout_binding.binding = 5;
+        scene_component_aabbs_descriptor_set_layout_binding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        scene_component_aabbs_descriptor_set_layout_binding.descriptorCount = 1;
+
+        scene_component_aabbs_descriptor_set_layout_binding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+        scene_component_aabbs_descriptor_set_layout_binding.pImmutableSamplers = NULL;
+    }
+    VkDescriptorSetLayoutBinding descriptor_set_layout_bindings[9] = {
+        fubo_descriptor_set_layout_binding,
+        scene_descriptor_set_layout_binding,
+        scene_accel_descriptor_set_layout_binding,
+        trace_image_descriptor_set_layout_binding,
+        accumulation_image_descriptor_set_layout_binding,
+        material_descriptor_set_layout_binding,
+        ray_counter_descriptor_set_layout_binding,
+        scene_tlas_descriptor_set_layout_binding,
+        scene_component_aabbs_descriptor_set_layout_binding
+    };
 
     // creating the descriptor set layouts:
     VkDescriptorSetLayoutCreateInfo layout_info;
@@ -1151,8 +1919,8 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         renderer->vk_descriptor_set_layout_ok = false;
 
         layout_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
-        layout_info.bindingCount = 1;
-        layout_info.pBindings = &fubo_descriptor_set_layout_binding;
+        layout_info.bindingCount = renderer->vk_ray_query_supported ? 9 : 7;
+        layout_info.pBindings = descriptor_set_layout_bindings;
 
         VkResult ok = vkCreateDescriptorSetLayout(
             renderer->vk_device,
@@ -1175,6 +1943,69 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         }
     }
 
+    // 
+    // Creating the Pipelines:
+    //
+
+    // setting up the pipeline layout (for uniforms), shared by every pipeline:
+    {
+        VkPipelineLayoutCreateInfo pipeline_layout_create_info; {
+            memset(&pipeline_layout_create_info, 0, sizeof(pipeline_layout_create_info));
+            pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+            pipeline_layout_create_info.setLayoutCount = 1;
+            pipeline_layout_create_info.pSetLayouts = &renderer->vk_descriptor_set_layout;
+            pipeline_layout_create_info.pushConstantRangeCount = 0;
+            pipeline_layout_create_info.pPushConstantRanges = NULL;
+        }
+        VkResult pipeline_create_ok = vkCreatePipelineLayout(
+            renderer->vk_device,
+            &pipeline_layout_create_info,
+            NULL,
+            &renderer->vk_pipeline_layout
+        );
+        if (pipeline_create_ok != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan pipeline layout.\n");
+            renderer->vk_pipeline_layout_created_ok = false;
+            goto fatal_error;
+        } else {
+            renderer->vk_pipeline_layout_created_ok = true;
+        }
+    }
+
+    // loading the pipeline cache from previous runs on this device, so that pipelines below can
+    // skip compiling shaders, and saving it again once they are all created:
+    vk_create_pipeline_cache(renderer);
+
+    // creating the compute pipeline:
+    // this path is optional, so failures here just leave the fragment path in use.
+    {
+        renderer->vk_compute_pipeline_ok = false;
+        renderer->vk_ray_query_pipeline_ok = false;
+
+        VkFormatProperties trace_format_properties;
+        vkGetPhysicalDeviceFormatProperties(
+            renderer->vk_physical_device,
+            WO_TRACE_IMAGE_FORMAT,
+            &trace_format_properties
+        );
+        VkFormatFeatureFlags required_trace_format_features = (
+            VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT |
+            VK_FORMAT_FEATURE_BLIT_SRC_BIT
+        );
+        bool compute_path_supported = (
+            renderer->vk_swapchain_supports_blit_dst &&
+            required_trace_format_features == (trace_format_properties.optimalTilingFeatures & required_trace_format_features)
+        );
+        if (!compute_path_supported) {
+            printf("[Wololo] Vulkan device cannot blit a storage image onto the swapchain; compute path disabled.\n");
+        } else {
+            // compiling the compute uber-shaders is the slowest part of a cold start, so they
+            // are compiled while the rest of the renderer initializes below, until
+            // 'vk_join_pipeline_worker':
+            vk_start_pipeline_worker(renderer);
+        }
+    }
+
     // 
     // Creating + Initializing the Graphics Pipeline:
     //
@@ -1198,47 +2029,6 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             renderer->vk_shaders_loaded_ok = true;
         }
 
-        VkPipelineShaderStageCreateInfo vert_shader_stage_info;
-        memset(&vert_shader_stage_info, 0, sizeof(vert_shader_stage_info));
-        vert_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        vert_shader_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
-        vert_shader_stage_info.module = renderer->vk_vert_shader_module;
-        vert_shader_stage_info.pName = "main";
-
-        VkPipelineShaderStageCreateInfo frag_shader_stage_info;
-        memset(&frag_shader_stage_info, 0, sizeof(frag_shader_stage_info));
-        frag_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
-        frag_shader_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
-        frag_shader_stage_info.module = renderer->vk_frag_shader_module;
-        frag_shader_stage_info.pName = "main";
-
-        VkPipelineShaderStageCreateInfo shader_stages[2] = {
-            vert_shader_stage_info,
-            frag_shader_stage_info
-        };
-
-        // loading vertex shader data:
-        // (currently no data to load)
-        VkPipelineVertexInputStateCreateInfo vertex_input_info; {
-            memset(&vertex_input_info, 0, sizeof(vertex_input_info));
-            vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-            
-            vertex_input_info.vertexBindingDescriptionCount = 0;
-            vertex_input_info.pVertexBindingDescriptions = NULL;
-            
-            vertex_input_info.vertexAttributeDescriptionCount = 0;
-            vertex_input_info.pVertexAttributeDescriptions = NULL;
-        }
-
-        // specifying the input assembly, incl.
-        // - pipeline 'topology': what geometric primitives to draw
-        VkPipelineInputAssemblyStateCreateInfo input_assembly; {
-            memset(&input_assembly, 0, sizeof(input_assembly));
-            input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
-            input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
-            input_assembly.primitiveRestartEnable = VK_FALSE;
-        }
-
         // specifying the viewport size (the whole monitor * DPI):
         {
             renderer->vk_viewport.x = 0.0f;
@@ -1249,162 +2039,16 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
             renderer->vk_viewport.maxDepth = 1.0f;
         }
 
-        // specifying the scissor rectangle: anything outside the scissor is 
-        // discarded by the rasterizer:
-        VkRect2D scissor; {
-            scissor.offset.x = 0;
-            scissor.offset.y = 0;
-            scissor.extent = renderer->vk_frame_extent;
-        }
-
-        // tying it all together, setting up the viewport(s):
-        // just one
-        VkPipelineViewportStateCreateInfo viewport_state_create_info; {
-            memset(&viewport_state_create_info, 0, sizeof(viewport_state_create_info));
-            viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
-            viewport_state_create_info.viewportCount = 1;
-            viewport_state_create_info.pViewports = &renderer->vk_viewport;
-            viewport_state_create_info.scissorCount = 1;
-            viewport_state_create_info.pScissors = &scissor;
-        }
-
-        // setting up the rasterizer:
-        VkPipelineRasterizationStateCreateInfo rasterizer_create_info; {
-            memset(&rasterizer_create_info, 0, sizeof(rasterizer_create_info));
-            rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
-            rasterizer_create_info.depthClampEnable = VK_FALSE;
-            rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
-            rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
-            // note: using any fill mode other than fill requires specifying lineWidth;
-            // filled anyway for safety:
-            rasterizer_create_info.lineWidth = 1.0f;
-            // setting cull mode:
-            rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
-            rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
-            // disabling depth bias,
-            rasterizer_create_info.depthBiasEnable = VK_FALSE;
-            // optional properties to config depthBias:
-            rasterizer_create_info.depthBiasConstantFactor = 0.0f;
-            rasterizer_create_info.depthBiasClamp = 0.0f;
-            rasterizer_create_info.depthBiasSlopeFactor = 0.0f;
-        }
-
-        // setting up multisampling (disabled)
-        VkPipelineMultisampleStateCreateInfo multisampling_create_info; {
-            memset(&multisampling_create_info, 0, sizeof(multisampling_create_info));
-            multisampling_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
-            multisampling_create_info.sampleShadingEnable = VK_FALSE;
-            multisampling_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
-            multisampling_create_info.minSampleShading = 1.0f;
-            multisampling_create_info.pSampleMask = NULL;
-            multisampling_create_info.alphaToCoverageEnable = VK_FALSE;
-            multisampling_create_info.alphaToOneEnable = VK_FALSE;
-        }
-
-        // disabling depth testing; will ignore
-        // VkPipelineDepthStencilStateCreateInfo
-
-        // color blending: no alpha
-        // https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Fixed_functions#page_Color-blending
-        VkPipelineColorBlendAttachmentState color_blend_attachment; {
-            color_blend_attachment.colorWriteMask = (
-                VK_COLOR_COMPONENT_R_BIT |
-                VK_COLOR_COMPONENT_G_BIT |
-                VK_COLOR_COMPONENT_B_BIT |
-                VK_COLOR_COMPONENT_A_BIT
-            );
-            color_blend_attachment.blendEnable = VK_FALSE;
-            color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
-            color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
-            color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
-            color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
-            color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
-            color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
-        }
-
-        VkPipelineColorBlendStateCreateInfo color_blending_create_info; {
-            memset(&color_blending_create_info, 0, sizeof(color_blending_create_info));
-            color_blending_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
-            color_blending_create_info.logicOpEnable = VK_FALSE;
-            color_blending_create_info.logicOp = VK_LOGIC_OP_COPY;
-            color_blending_create_info.attachmentCount = 1;
-            color_blending_create_info.pAttachments = &color_blend_attachment;
-            color_blending_create_info.blendConstants[0] = 0.0f;
-            color_blending_create_info.blendConstants[1] = 0.0f;
-            color_blending_create_info.blendConstants[2] = 0.0f;
-            color_blending_create_info.blendConstants[3] = 0.0f;
-        }
-
-        // in order to change the above properties, we must specify which states are dynamic:
-        uint32_t dynamic_state_count = 1;
-        VkDynamicState dynamic_states[] = {
-            VK_DYNAMIC_STATE_VIEWPORT
-        };
-        VkPipelineDynamicStateCreateInfo dynamic_state_create_info; {
-            memset(&dynamic_state_create_info, 0, sizeof(dynamic_state_create_info));
-            dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-            dynamic_state_create_info.dynamicStateCount = dynamic_state_count;
-            dynamic_state_create_info.pDynamicStates = dynamic_states;
-        }
-
-        // setting up pipeline layout (for uniforms)
-        VkPipelineLayoutCreateInfo pipeline_layout_create_info; {
-            memset(&pipeline_layout_create_info, 0, sizeof(pipeline_layout_create_info));
-            pipeline_layout_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-            pipeline_layout_create_info.setLayoutCount = 1;
-            pipeline_layout_create_info.pSetLayouts = &renderer->vk_descriptor_set_layout;
-            pipeline_layout_create_info.pushConstantRangeCount = 0;
-            pipeline_layout_create_info.pPushConstantRanges = NULL;
-        }
-        VkResult pipeline_create_ok = vkCreatePipelineLayout(
-            renderer->vk_device,
-            &pipeline_layout_create_info,
-            NULL,
-            &renderer->vk_pipeline_layout
-        );
-        if (pipeline_create_ok != VK_SUCCESS) {
-            printf("[Wololo] Failed to create Vulkan pipeline layout.\n");
-            renderer->vk_pipeline_layout_created_ok = false;
-            goto fatal_error;
-        } else {
-            renderer->vk_pipeline_layout_created_ok = true;
-        }
-
-        // finally, creating the graphics pipeline:
-        VkGraphicsPipelineCreateInfo pipeline_create_info; {
-            memset(&pipeline_create_info, 0, sizeof(pipeline_create_info));
-            pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-            pipeline_create_info.stageCount = 2;
-            pipeline_create_info.pStages = shader_stages;
-            pipeline_create_info.pVertexInputState = &vertex_input_info;
-            pipeline_create_info.pInputAssemblyState = &input_assembly;
-            pipeline_create_info.pViewportState = &viewport_state_create_info;
-            pipeline_create_info.pRasterizationState = &rasterizer_create_info;
-            pipeline_create_info.pMultisampleState = &multisampling_create_info;
-            pipeline_create_info.pDepthStencilState = NULL;
-            pipeline_create_info.pColorBlendState = &color_blending_create_info;
-            pipeline_create_info.pDynamicState = &dynamic_state_create_info;
-            pipeline_create_info.layout = renderer->vk_pipeline_layout;
-            pipeline_create_info.renderPass = renderer->vk_render_pass;
-            pipeline_create_info.subpass = 0;
-            pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
-            pipeline_create_info.basePipelineIndex = -1;
-            pipeline_create_info.pTessellationState = NULL;
-        }
-
-        VkResult graphics_pipeline_ok = vkCreateGraphicsPipelines(
-            renderer->vk_device, VK_NULL_HANDLE, 
-            1, &pipeline_create_info,
-            NULL,
+        // using the default specialization constants, which support every scene:
+        renderer->vk_graphics_pipeline_ok = vk_create_specialized_graphics_pipeline(
+            renderer, NULL,
             &renderer->vk_graphics_pipeline
         );
-        if (graphics_pipeline_ok != VK_SUCCESS) {
+        if (!renderer->vk_graphics_pipeline_ok) {
             printf("[Wololo] Failed to create a Vulkan graphics pipeline.\n");
-            renderer->vk_graphics_pipeline_ok = false;
             goto fatal_error;
         } else {
             printf("[Wololo] Vulkan graphics pipeline created successfully.\n");
-            renderer->vk_graphics_pipeline_ok = true;
         }
     }
 
@@ -1413,43 +2057,8 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
     //
 
     // creating swapchain framebuffers:
-    // see: https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Framebuffers
-    {
-        renderer->vk_swapchain_framebuffers = calloc(
-            renderer->vk_swapchain_images_count,
-            sizeof(VkFramebuffer)
-        );
-        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
-            VkFramebuffer* fbp = &renderer->vk_swapchain_framebuffers[i];
-            
-            uint32_t attachment_count = 1;
-            VkImageView attachments[] = {
-                renderer->vk_swapchain_image_views[i]
-            };
-            
-            VkFramebufferCreateInfo fb_create_info;
-            memset(&fb_create_info, 0, sizeof(fb_create_info));
-            fb_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
-            fb_create_info.renderPass = renderer->vk_render_pass;
-            fb_create_info.attachmentCount = attachment_count;
-            fb_create_info.pAttachments = attachments;
-            fb_create_info.width = renderer->vk_frame_extent.width;
-            fb_create_info.height = renderer->vk_frame_extent.height;
-            fb_create_info.layers = 1;
-
-            VkResult swapchain_framebuffer_res = vkCreateFramebuffer(
-                renderer->vk_device, 
-                &fb_create_info, 
-                NULL, 
-                fbp
-            );
-            if (swapchain_framebuffer_res != VK_SUCCESS) {
-                printf("[Wololo] Failed to create Vulkan framebuffer %d/%d\n", i+1, renderer->vk_swapchain_images_count);
-            } else {
-                printf("[Wololo] Vulkan framebuffer %d/%d created successfully.\n", i+1, renderer->vk_swapchain_images_count);
-                renderer->vk_swapchain_fbs_ok_count = i;
-            }
-        }
+    if (!vk_create_framebuffers(renderer)) {
+        goto fatal_error;
     }
 
     // creating command buffer pool:
@@ -1460,6 +2069,8 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         memset(&pool_info, 0, sizeof(VkCommandPoolCreateInfo));
         pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
         pool_info.queueFamilyIndex = renderer->vk_graphics_queue_family_index;
+        // command buffers are re-recorded whenever the scene is committed:
+        pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
         VkResult ok = vkCreateCommandPool(
             renderer->vk_device,
@@ -1475,269 +2086,105 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         }
     }
 
-    // creating command buffers (managed by the command buffer pool)
-    {
-        renderer->vk_command_buffers_ok = false;
-        renderer->vk_command_buffers = calloc(
-            sizeof(VkCommandBuffer),
-            renderer->vk_swapchain_images_count
+    // creating the dedicated transfer queue's command pool, whose command buffers each record
+    // a single upload:
+    if (renderer->vk_has_dedicated_transfer_queue) {
+        VkCommandPoolCreateInfo pool_info;
+        memset(&pool_info, 0, sizeof(VkCommandPoolCreateInfo));
+        pool_info.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+        pool_info.queueFamilyIndex = renderer->vk_transfer_queue_family_index;
+        pool_info.flags = VK_COMMAND_POOL_CREATE_TRANSIENT_BIT;
+
+        VkResult ok = vkCreateCommandPool(
+            renderer->vk_device,
+            &pool_info,
+            NULL, &renderer->vk_transfer_command_pool
         );
-        assert(renderer->vk_command_buffers != NULL);
-        
+        if (ok != VK_SUCCESS) {
+            // uploading on the graphics queue instead:
+            printf("[Wololo] Failed to create Vulkan Command-Pool for the transfer queue; uploading on the graphics queue.\n");
+            renderer->vk_has_dedicated_transfer_queue = false;
+        } else {
+            printf("[Wololo] Vulkan Command-Pool for the transfer queue created successfully.\n");
+            renderer->vk_transfer_command_pool_ok = true;
+        }
+    }
+
+    // creating the incremental updates' command buffers (re-recorded every frame that has
+    // updates, one per frame in flight) and their staging ring:
+    {
         VkCommandBufferAllocateInfo alloc_info;
         memset(&alloc_info, 0, sizeof(VkCommandBufferAllocateInfo));
         alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
         alloc_info.commandPool = renderer->vk_command_buffer_pool;
         alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-        alloc_info.commandBufferCount = renderer->vk_swapchain_images_count;
+        alloc_info.commandBufferCount = renderer->frames_in_flight;
+        if (vkAllocateCommandBuffers(renderer->vk_device, &alloc_info, renderer->vk_update_command_buffers) != VK_SUCCESS) {
+            printf("[Wololo] Failed to allocate Vulkan update command buffers.\n");
+            goto fatal_error;
+        }
 
-        VkResult ok = vkAllocateCommandBuffers(
+        VkDeviceSize staging_size = (VkDeviceSize)WO_UPDATE_STAGING_BYTES_PER_FRAME * renderer->frames_in_flight;
+        bool staging_ok = new_vk_buffer(
             renderer->vk_device,
-            &alloc_info,
-            renderer->vk_command_buffers
+            &renderer->gpu_arena,
+            WO_GPU_MEMORY_STAGING,
+            staging_size,
+            VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &renderer->update_staging_buffer,
+            &renderer->update_staging_buffer_allocation
         );
-        if (ok != VK_SUCCESS) {
-            printf("[Wololo] Failed to allocate Vulkan command buffers.\n");
+        if (!staging_ok) {
+            printf("[Wololo] Failed to create the Vulkan update staging ring.\n");
             goto fatal_error;
-        } else {
-            renderer->vk_command_buffers_ok = true;
-            printf("[Wololo] Vulkan command buffers allocated successfully.\n");
         }
     }
 
-    // Initializing buffer objects, like:
-    // - uniform buffer objects
+    // creating the updates' timestamp queries, if the graphics queue supports timestamps:
+    // (the frames' are created with the per-swapchain-image resources)
     {
-        assert(renderer->vk_swapchain_images_count > 0);
-
-        renderer->uniform_buffers = calloc(
-            renderer->vk_swapchain_images_count,
-            sizeof(VkBuffer)
-        );
-        renderer->uniform_buffers_memory = calloc(
-            renderer->vk_swapchain_images_count,
-            sizeof(VkDeviceMemory)
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(renderer->vk_physical_device, &physical_device_properties);
+        renderer->vk_timestamps_supported = (
+            physical_device_properties.limits.timestampComputeAndGraphics &&
+            physical_device_properties.limits.timestampPeriod > 0
         );
-        assert(renderer->uniform_buffers && renderer->uniform_buffers_memory);
-
-        uint32_t buf_count = renderer->vk_swapchain_images_count;
-        for (uint32_t i = 0; i < buf_count; i++) {
-            new_vk_uniform_buffer(
-                renderer->vk_physical_device,
+        renderer->vk_timestamp_period_ns = physical_device_properties.limits.timestampPeriod;
+        if (renderer->vk_timestamps_supported) {
+            VkQueryPoolCreateInfo query_pool_info;
+            memset(&query_pool_info, 0, sizeof(query_pool_info));
+            query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query_pool_info.queryCount = WO_UPLOAD_TIMESTAMP_COUNT * renderer->frames_in_flight;
+            VkResult query_pool_ok = vkCreateQueryPool(
                 renderer->vk_device,
-                sizeof(FragmentUniformBufferObject),
-                &renderer->uniform_buffers[i],
-                &renderer->uniform_buffers_memory[i]
+                &query_pool_info,
+                NULL,
+                &renderer->vk_upload_timestamp_query_pool
             );
+            if (query_pool_ok != VK_SUCCESS) {
+                printf("[Wololo] Failed to create a Vulkan timestamp query pool, GPU timings are unavailable.\n");
+                renderer->vk_upload_timestamp_query_pool = VK_NULL_HANDLE;
+                renderer->vk_timestamps_supported = false;
+            }
         }
     }
 
-    // initializing a descriptor pool to bind uniforms to shader:
-    // https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets
-    {
-        renderer->vk_descriptor_pool_ok = false;
+    // waiting for the compute pipelines, then saving any shaders they compiled:
+    vk_join_pipeline_worker(renderer);
+    vk_save_pipeline_cache(renderer);
 
-        // configuring maximum descriptor pool size:
-        VkDescriptorPoolSize pool_size; {
-            memset(&pool_size, 0, sizeof(pool_size));
-            pool_size.type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-            pool_size.descriptorCount = renderer->vk_swapchain_images_count;
-        }
+    // Initializing the storage image for the compute path:
+    if (renderer->vk_compute_pipeline_ok && !vk_create_trace_image(renderer)) {
+        goto fatal_error;
+    }
 
-        // and the maximum number of pools:
-        VkDescriptorPoolCreateInfo pool_info; {
-            memset(&pool_info, 0, sizeof(pool_info));
-            pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
-            pool_info.poolSizeCount = 1;
-            pool_info.pPoolSizes = &pool_size;
-            pool_info.maxSets = renderer->vk_swapchain_images_count;
-            pool_info.flags = 0;
-        }
-
-        VkResult descriptor_pool_ok = vkCreateDescriptorPool(
-            renderer->vk_device,
-            &pool_info,
-            NULL,
-            &renderer->vk_descriptor_pool
-        );
-        if (descriptor_pool_ok != VK_SUCCESS) {
-            printf("[Wololo] Failed to create Vulkan descriptor pool for Uniform data.\n");
-            goto fatal_error;
-        } else {
-            printf("[Wololo] Vulkan descriptor pool for Uniform data created successfully.\n");
-            renderer->vk_descriptor_pool_ok = true;
-        }
-    }
-    // Creating descriptor sets using the descriptor pool above^
-    // see:
-    // https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets
-    {
-        VkDescriptorSetLayout* layouts = calloc(
-            renderer->vk_swapchain_images_count,
-            sizeof(VkDescriptorSetLayout)
-        );
-        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
-            layouts[i] = renderer->vk_descriptor_set_layout;
-        }
-        renderer->vk_descriptor_sets = calloc(
-            renderer->vk_swapchain_images_count,
-            sizeof(VkDescriptorSet)
-        );
-
-        VkDescriptorSetAllocateInfo alloc_info; {
-            memset(&alloc_info, 0, sizeof(alloc_info));
-            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
-            alloc_info.descriptorPool = renderer->vk_descriptor_pool;
-            alloc_info.descriptorSetCount = renderer->vk_swapchain_images_count;
-            alloc_info.pSetLayouts = layouts;
-            alloc_info.pNext = NULL;
-        }
-        VkResult desc_sets_ok = vkAllocateDescriptorSets(
-            renderer->vk_device,
-            &alloc_info,
-            renderer->vk_descriptor_sets
-        );
-
-        if (desc_sets_ok != VK_SUCCESS) {
-            printf("[Wololo] Failed to create Vulkan descriptor sets for Uniform data.\n");
-            goto fatal_error;
-        }
-
-        // if allocation was successful, configuring each descriptor:
-        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
-            VkDescriptorBufferInfo buffer_info; {
-                memset(&buffer_info, 0, sizeof(buffer_info));
-                buffer_info.buffer = renderer->uniform_buffers[i];
-                buffer_info.offset = 0;
-                buffer_info.range = sizeof(FragmentUniformBufferObject);
-            }
-            VkWriteDescriptorSet w_desc; {
-                memset(&w_desc, 0, sizeof(w_desc));
-
-                w_desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-                w_desc.dstSet = renderer->vk_descriptor_sets[i];
-                w_desc.dstBinding = 0;
-                w_desc.dstArrayElement = 0;
-                w_desc.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-                w_desc.descriptorCount = 1;
-
-                w_desc.pBufferInfo = &buffer_info;
-                w_desc.pImageInfo = NULL;
-                w_desc.pTexelBufferView = NULL;
-            }
-
-            vkUpdateDescriptorSets(
-                renderer->vk_device,
-                1, &w_desc,
-                0, NULL
-            );
-        }
-
-        printf("Vulkan descriptor sets for Uniform data created successfully.\n");
-    }
-
-    // Recording the render command buffer (that can be replayed per-frame):
-    // (will eventually just plaster a quad to the screen)
-    // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Command_buffers#page_Starting-command-buffer-recording
-    {
-        // recall there is one command buffer per swapchain image.
-        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
-            VkCommandBufferBeginInfo begin_info;
-            memset(&begin_info, 0, sizeof(begin_info));
-            begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-            begin_info.flags = 0;
-            begin_info.pInheritanceInfo = NULL;
-
-            VkResult command_buffer_ok = vkBeginCommandBuffer(
-                renderer->vk_command_buffers[i],
-                &begin_info
-            );
-            if (command_buffer_ok != VK_SUCCESS) {
-                printf("[Wololo] Failed to begin recording Vulkan command buffer %u\n", i+1);
-                goto fatal_error;
-            } else {
-                printf("[Wololo] Vulkan command buffer %u now recording...\n", i+1);
-            }
-
-            // beginning the render pass:
-            VkRenderPassBeginInfo render_pass_info;
-            {
-                memset(&render_pass_info, 0, sizeof(render_pass_info));
-                render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-                render_pass_info.renderPass = renderer->vk_render_pass;
-                render_pass_info.framebuffer = renderer->vk_swapchain_framebuffers[i];
-                render_pass_info.renderArea.offset.x = 0;
-                render_pass_info.renderArea.offset.y = 0;
-                render_pass_info.renderArea.extent = renderer->vk_frame_extent;
-
-                // setting the clear color:
-                VkClearValue clear_color;
-                if (WO_DEBUG) {
-                    // offensive magenta, 100% opacity
-                    clear_color.color = (VkClearColorValue) {1.0f, 0.0f, 1.0f, 1.0f};
-                } else {
-                    // black, 100% opacity
-                    clear_color.color = (VkClearColorValue) {0.0f, 0.0f, 0.0f, 1.0f};
-                }
-                render_pass_info.clearValueCount = 1;
-                render_pass_info.pClearValues = &clear_color;
-            }
-            vkCmdBeginRenderPass(
-                renderer->vk_command_buffers[i],
-                &render_pass_info,
-                VK_SUBPASS_CONTENTS_INLINE
-            );
-            
-            // drawing:
-            {
-                vkCmdBindPipeline(
-                    renderer->vk_command_buffers[i],
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    renderer->vk_graphics_pipeline
-                );
-                vkCmdSetViewport(
-                    renderer->vk_command_buffers[i],
-                    0, 1,
-                    &renderer->vk_viewport
-                );
-                
-                vkCmdBindDescriptorSets(
-                    renderer->vk_command_buffers[i],
-                    VK_PIPELINE_BIND_POINT_GRAPHICS,
-                    renderer->vk_pipeline_layout,
-                    0, 
-                    1, &renderer->vk_descriptor_sets[i],
-                    0, NULL
-                );
-                vkCmdDraw(
-                    renderer->vk_command_buffers[i],
-                    6,  // vertex count: 3 x 2 for 2 tris
-                    1,  // instance count: 1 means we're not using it.
-                    0,  // first vertex
-                    0   // first instance
-                );
-                vkCmdEndRenderPass(
-                    renderer->vk_command_buffers[i]
-                );
-            }
-
-            // ending the render pass:
-            if (vkEndCommandBuffer(renderer->vk_command_buffers[i]) != VK_SUCCESS) {
-                printf(
-                    "[Wololo] Recording render pass to Vulkan command buffer %u/%u failed.\n", 
-                    i+1,
-                    renderer->vk_swapchain_images_count
-                );
-                goto fatal_error;
-            } else {
-                printf(
-                    "[Wololo] Vulkan command buffer %u/%u successfully recorded with render pass.\n", 
-                    i+1,
-                    renderer->vk_swapchain_images_count
-                );
-            }
-        }
-    }
+    // creating the per-swapchain-image command buffers, uniform buffer slots and descriptor sets:
+    if (!vk_create_swapchain_image_resources(renderer)) {
+        goto fatal_error;
+    }
+    vk_write_trace_image_descriptors(renderer);
 
     // Initializing renderer sync objects, like:
     // - semaphores (GPU-GPU sync): one per frame in flight
@@ -1746,12 +2193,6 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         // see: 
         // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation#page_Frames-in-flight
         
-        // allocating images_inflight_fences, initializing to VK_NULL_HANDLE (0):
-        renderer->vk_images_inflight_fences = calloc(
-            sizeof(VkFence),
-            renderer->vk_swapchain_images_count
-        );
-
         // creating semaphores and fences:
         VkSemaphoreCreateInfo semaphore_info;
         memset(&semaphore_info, 0, sizeof(semaphore_info));
@@ -1763,7 +2204,7 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
         fence_info.flags = VK_FENCE_CREATE_SIGNALED_BIT;
 
         // for each possible frame in flight...
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        for (uint32_t i = 0; i < renderer->frames_in_flight; i++) {
             renderer->vk_semaphores_oks[i] = false;
 
             VkResult sem1res = vkCreateSemaphore(
@@ -1781,22 +2222,28 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
 
             if (sem1res != VK_SUCCESS || sem2res != VK_SUCCESS || fence_res != VK_SUCCESS) {
                 printf(
-                    "[Wololo] Failed to create Vulkan synchronization objects for frame %d/%d.\n", 
+                    "[Wololo] Failed to create Vulkan synchronization objects for frame %u/%u.\n", 
                     i+1,
-                    MAX_FRAMES_IN_FLIGHT
+                    renderer->frames_in_flight
                 );
                 goto fatal_error;
             } else {
                 printf(
-                    "[Wololo] Vulkan synchronization objects for frame %d/%d created successfully.\n", 
+                    "[Wololo] Vulkan synchronization objects for frame %u/%u created successfully.\n", 
                     i+1,
-                    MAX_FRAMES_IN_FLIGHT
+                    renderer->frames_in_flight
                 );
                 renderer->vk_semaphores_oks[i] = true;
             }
         }
     }
 
+    // uploading the (initially empty) scene and recording the command buffers that
+    // read it:
+    if (!commit_scene(renderer)) {
+        goto fatal_error;
+    }
+
   // should never jump to this label, just flow into naturally.    
   _success:
     // reporting success, returning:
@@ -1808,41 +2255,83 @@ Wo_Renderer* vk_init_renderer(Wo_App* app, Wo_Renderer* renderer) {
     del_renderer(renderer);
     return NULL;
 }
+bool load_spirv(char const* file_path, SpirvCode* out_code) {
+    memset(out_code, 0, sizeof(SpirvCode));
+
+#if WO_EMBEDDED_SHADERS
+    // preferring shaders embedded at build time, so that we don't depend on the working directory:
+    // (looked up by file name, whichever directory 'file_path' is in)
+    char const* file_name = file_path;
+    for (char const* c = file_path; *c != '\0'; c++) {
+        if (*c == '/' || *c == '\\') {
+            file_name = c + 1;
+        }
+    }
+    for (size_t i = 0; i < wo_embedded_shader_count; i++) {
+        if (strcmp(wo_embedded_shaders[i].file_name, file_name) == 0) {
+            out_code->words = (uint32_t const*)wo_embedded_shaders[i].code;
+            out_code->size = wo_embedded_shaders[i].code_size;
+            out_code->is_mapped = false;
+            return true;
+        }
+    }
+#endif
+
+    // otherwise mapping the file: (pages are aligned far beyond the 4 bytes 'pCode' needs)
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    HANDLE mapping = NULL;
+    if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0) {
+        mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    }
+    if (mapping != NULL) {
+        out_code->words = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        out_code->size = (size_t)file_size.QuadPart;
+        // (the view keeps the file mapped once both handles are closed)
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int file = open(file_path, O_RDONLY);
+    if (file < 0) {
+        return false;
+    }
+    struct stat file_stat;
+    if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0) {
+        void* words = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+        if (words != MAP_FAILED) {
+            out_code->words = words;
+            out_code->size = (size_t)file_stat.st_size;
+        }
+    }
+    // (the mapping outlives the file descriptor)
+    close(file);
+#endif
+
+    out_code->is_mapped = (out_code->words != NULL);
+    return out_code->is_mapped;
+}
+void unload_spirv(SpirvCode* code) {
+    if (code->is_mapped) {
+#if defined(_WIN32)
+        UnmapViewOfFile(code->words);
+#else
+        munmap((void*)code->words, code->size);
+#endif
+    }
+    memset(code, 0, sizeof(SpirvCode));
+}
 VkShaderModule vk_load_shader_module(Wo_Renderer* renderer, char const* file_path) {
     // loading all bytecode:
-    char* buffer;
-    size_t code_size;
-    {
-        // attempting to open the shader:
-        FILE* shader_file = fopen(file_path, "rb");
-        assert(shader_file && "Failed to open a shader.");
-
-        // creating a buffer based on the maximum file size:
-        fseek(shader_file, 0, SEEK_END);
-        size_t max_buffer_size = ftell(shader_file);
-        buffer = calloc(max_buffer_size, 1);
-
-        // (resetting the cursor back to the beginning of the file stream)
-        fseek(shader_file, 0, SEEK_SET);
-
-        // reading all the file's content into the buffer:
-        size_t out_index = 0;
-        while (!feof(shader_file) && !ferror(shader_file)) {
-            size_t increment = fread(
-                &buffer[out_index],
-                1, 1,
-                shader_file
-            );
-            if (increment <= 0) {
-                break;
-            } else {
-                out_index += increment;
-            }
-        }
-        code_size = out_index;
-        
-        // note that SPIR-V is a binary format, so it does not need a null-terminating
-        // byte.
+    // note that SPIR-V is a binary format, so it does not need a null-terminating byte.
+    SpirvCode code;
+    if (!load_spirv(file_path, &code)) {
+        printf("[Wololo] Could not load shader '%s'.\n", file_path);
+        return VK_NULL_HANDLE;
     }
     
     VkShaderModule shader_module;
@@ -1850,8 +2339,8 @@ VkShaderModule vk_load_shader_module(Wo_Renderer* renderer, char const* file_pat
         VkShaderModuleCreateInfo create_info;
         memset(&create_info, 0, sizeof(create_info));
         create_info.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
-        create_info.codeSize = code_size;
-        create_info.pCode = (uint32_t const*)buffer;
+        create_info.codeSize = code.size;
+        create_info.pCode = code.words;
 
         VkResult shader_ok = vkCreateShaderModule(
             renderer->vk_device,
@@ -1868,71 +2357,3481 @@ VkShaderModule vk_load_shader_module(Wo_Renderer* renderer, char const* file_pat
     }
 
     // all done:
-    free(buffer);
+    unload_spirv(&code);
     return shader_module;
 }
-void del_renderer(Wo_Renderer* renderer) {
-    if (renderer != NULL) {
-        // Waiting for the device to idle:
-        if (renderer->vk_device != VK_NULL_HANDLE) {
-            vkDeviceWaitIdle(renderer->vk_device);
-        }
+bool vk_create_specialized_graphics_pipeline(
+    Wo_Renderer* renderer,
+    VkSpecializationInfo const* specialization,
+    VkPipeline* pipeline_p
+) {
+    // drawing a fullscreen quad with the (loaded) uber-shaders, specializing the fragment stage:
+    VkPipelineShaderStageCreateInfo vert_shader_stage_info;
+    memset(&vert_shader_stage_info, 0, sizeof(vert_shader_stage_info));
+    vert_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vert_shader_stage_info.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vert_shader_stage_info.module = renderer->vk_vert_shader_module;
+    vert_shader_stage_info.pName = "main";
+
+    VkPipelineShaderStageCreateInfo frag_shader_stage_info;
+    memset(&frag_shader_stage_info, 0, sizeof(frag_shader_stage_info));
+    frag_shader_stage_info.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    frag_shader_stage_info.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    frag_shader_stage_info.module = renderer->vk_frag_shader_module;
+    frag_shader_stage_info.pName = "main";
+    frag_shader_stage_info.pSpecializationInfo = specialization;
+
+    VkPipelineShaderStageCreateInfo shader_stages[2] = {
+        vert_shader_stage_info,
+        frag_shader_stage_info
+    };
 
-        // destroying semaphores required in 'draw_frame_from_renderer':
-        // see:
-        // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation
-        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
-            if (renderer->vk_semaphores_oks[i]) {
-                vkDestroySemaphore(renderer->vk_device, renderer->vk_render_finished_semaphores[i], NULL);
-                vkDestroySemaphore(renderer->vk_device, renderer->vk_image_available_semaphores[i], NULL);
-                vkDestroyFence(renderer->vk_device, renderer->vk_inflight_fences[i], NULL);
-            }
-        }
-    
-        // destroying the command pool used to address the graphics queue:
-        // see:
-        // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Command_buffers
-        {
-            if (renderer->vk_command_buffer_pool_ok) {
-                vkDestroyCommandPool(
-                    renderer->vk_device,
-                    renderer->vk_command_buffer_pool,
-                    NULL
-                );
-                renderer->vk_command_buffer_pool_ok = false;
+    // loading vertex shader data:
+    // (currently no data to load)
+    VkPipelineVertexInputStateCreateInfo vertex_input_info; {
+        memset(&vertex_input_info, 0, sizeof(vertex_input_info));
+        vertex_input_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        
+        vertex_input_info.vertexBindingDescriptionCount = 0;
+        vertex_input_info.pVertexBindingDescriptions = NULL;
+        
+        vertex_input_info.vertexAttributeDescriptionCount = 0;
+        vertex_input_info.pVertexAttributeDescriptions = NULL;
+    }
 
-                free(renderer->vk_command_buffers);
-                renderer->vk_command_buffers = NULL;
-            }
-        }
+    // specifying the input assembly, incl.
+    // - pipeline 'topology': what geometric primitives to draw
+    VkPipelineInputAssemblyStateCreateInfo input_assembly; {
+        memset(&input_assembly, 0, sizeof(input_assembly));
+        input_assembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        input_assembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+        input_assembly.primitiveRestartEnable = VK_FALSE;
+    }
 
-        // destroying the framebuffers:
-        // see:
-        // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Framebuffers
-        {
-            if (renderer->vk_swapchain_framebuffers) {
-                for (uint32_t i_fb = 0; i_fb < renderer->vk_swapchain_fbs_ok_count; i_fb++) {
-                    vkDestroyFramebuffer(
-                        renderer->vk_device, 
-                        renderer->vk_swapchain_framebuffers[i_fb],
-                        NULL
-                    );
-                }
-                free(renderer->vk_swapchain_framebuffers);
-                renderer->vk_swapchain_framebuffers = NULL;
-            }
-        }
+    // tying it all together, setting up the viewport(s):
+    // just one
+    VkPipelineViewportStateCreateInfo viewport_state_create_info; {
+        memset(&viewport_state_create_info, 0, sizeof(viewport_state_create_info));
+        viewport_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        viewport_state_create_info.viewportCount = 1;
+        // (ignored, being dynamic: not read, as variants are compiled on the pipeline worker)
+        viewport_state_create_info.pViewports = NULL;
+        // the scissor rectangle (anything outside it is discarded by the rasterizer) is
+        // dynamic, like the viewport, so that the pipeline outlives swapchain recreation:
+        viewport_state_create_info.scissorCount = 1;
+        viewport_state_create_info.pScissors = NULL;
+    }
 
-        // destroying the pipeline object:
-        // see:
-        // https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Conclusion
-        if (renderer->vk_graphics_pipeline_ok) {
-            vkDestroyPipeline(
+    // setting up the rasterizer:
+    VkPipelineRasterizationStateCreateInfo rasterizer_create_info; {
+        memset(&rasterizer_create_info, 0, sizeof(rasterizer_create_info));
+        rasterizer_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        rasterizer_create_info.depthClampEnable = VK_FALSE;
+        rasterizer_create_info.rasterizerDiscardEnable = VK_FALSE;
+        rasterizer_create_info.polygonMode = VK_POLYGON_MODE_FILL;
+        // note: using any fill mode other than fill requires specifying lineWidth;
+        // filled anyway for safety:
+        rasterizer_create_info.lineWidth = 1.0f;
+        // setting cull mode:
+        rasterizer_create_info.cullMode = VK_CULL_MODE_BACK_BIT;
+        rasterizer_create_info.frontFace = VK_FRONT_FACE_CLOCKWISE;
+        // disabling depth bias,
+        rasterizer_create_info.depthBiasEnable = VK_FALSE;
+        // optional properties to config depthBias:
+        rasterizer_create_info.depthBiasConstantFactor = 0.0f;
+        rasterizer_create_info.depthBiasClamp = 0.0f;
+        rasterizer_create_info.depthBiasSlopeFactor = 0.0f;
+    }
+
+    // setting up multisampling (disabled)
+    VkPipelineMultisampleStateCreateInfo multisampling_create_info; {
+        memset(&multisampling_create_info, 0, sizeof(multisampling_create_info));
+        multisampling_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        multisampling_create_info.sampleShadingEnable = VK_FALSE;
+        multisampling_create_info.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+        multisampling_create_info.minSampleShading = 1.0f;
+        multisampling_create_info.pSampleMask = NULL;
+        multisampling_create_info.alphaToCoverageEnable = VK_FALSE;
+        multisampling_create_info.alphaToOneEnable = VK_FALSE;
+    }
+
+    // disabling depth testing; will ignore
+    // VkPipelineDepthStencilStateCreateInfo
+
+    // color blending: no alpha
+    // https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Fixed_functions#page_Color-blending
+    VkPipelineColorBlendAttachmentState color_blend_attachment; {
+        color_blend_attachment.colorWriteMask = (
+            VK_COLOR_COMPONENT_R_BIT |
+            VK_COLOR_COMPONENT_G_BIT |
+            VK_COLOR_COMPONENT_B_BIT |
+            VK_COLOR_COMPONENT_A_BIT
+        );
+        color_blend_attachment.blendEnable = VK_FALSE;
+        color_blend_attachment.srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment.dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+        color_blend_attachment.colorBlendOp = VK_BLEND_OP_ADD;
+        color_blend_attachment.srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+        color_blend_attachment.dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+        color_blend_attachment.alphaBlendOp = VK_BLEND_OP_ADD;
+    }
+
+    VkPipelineColorBlendStateCreateInfo color_blending_create_info; {
+        memset(&color_blending_create_info, 0, sizeof(color_blending_create_info));
+        color_blending_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        color_blending_create_info.logicOpEnable = VK_FALSE;
+        color_blending_create_info.logicOp = VK_LOGIC_OP_COPY;
+        color_blending_create_info.attachmentCount = 1;
+        color_blending_create_info.pAttachments = &color_blend_attachment;
+        color_blending_create_info.blendConstants[0] = 0.0f;
+        color_blending_create_info.blendConstants[1] = 0.0f;
+        color_blending_create_info.blendConstants[2] = 0.0f;
+        color_blending_create_info.blendConstants[3] = 0.0f;
+    }
+
+    // in order to change the above properties, we must specify which states are dynamic:
+    uint32_t dynamic_state_count = 2;
+    VkDynamicState dynamic_states[] = {
+        VK_DYNAMIC_STATE_VIEWPORT,
+        VK_DYNAMIC_STATE_SCISSOR
+    };
+    VkPipelineDynamicStateCreateInfo dynamic_state_create_info; {
+        memset(&dynamic_state_create_info, 0, sizeof(dynamic_state_create_info));
+        dynamic_state_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        dynamic_state_create_info.dynamicStateCount = dynamic_state_count;
+        dynamic_state_create_info.pDynamicStates = dynamic_states;
+    }
+
+    // finally, creating the graphics pipeline:
+    VkGraphicsPipelineCreateInfo pipeline_create_info; {
+        memset(&pipeline_create_info, 0, sizeof(pipeline_create_info));
+        pipeline_create_info.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        pipeline_create_info.stageCount = 2;
+        pipeline_create_info.pStages = shader_stages;
+        pipeline_create_info.pVertexInputState = &vertex_input_info;
+        pipeline_create_info.pInputAssemblyState = &input_assembly;
+        pipeline_create_info.pViewportState = &viewport_state_create_info;
+        pipeline_create_info.pRasterizationState = &rasterizer_create_info;
+        pipeline_create_info.pMultisampleState = &multisampling_create_info;
+        pipeline_create_info.pDepthStencilState = NULL;
+        pipeline_create_info.pColorBlendState = &color_blending_create_info;
+        pipeline_create_info.pDynamicState = &dynamic_state_create_info;
+        pipeline_create_info.layout = renderer->vk_pipeline_layout;
+        pipeline_create_info.renderPass = renderer->vk_render_pass;
+        pipeline_create_info.subpass = 0;
+        pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+        pipeline_create_info.basePipelineIndex = -1;
+        pipeline_create_info.pTessellationState = NULL;
+    }
+
+    VkResult graphics_pipeline_ok = vkCreateGraphicsPipelines(
+        renderer->vk_device, renderer->vk_pipeline_cache,
+        1, &pipeline_create_info,
+        NULL,
+        pipeline_p
+    );
+    return graphics_pipeline_ok == VK_SUCCESS;
+}
+bool vk_create_compute_pipeline(
+    Wo_Renderer* renderer,
+    char const* file_path,
+    VkShaderModule* shader_module_p,
+    VkPipeline* pipeline_p
+) {
+    // compute shaders are optional, so a missing one just disables its path:
+    *shader_module_p = vk_load_shader_module(renderer, file_path);
+    if (*shader_module_p == VK_NULL_HANDLE) {
+        printf("[Wololo] Failed to load compute shader \"%s\".\n", file_path);
+        return false;
+    }
+    // using the default specialization constants, which support every scene:
+    if (!vk_create_specialized_compute_pipeline(renderer, *shader_module_p, NULL, pipeline_p)) {
+        return false;
+    }
+    printf("[Wololo] Vulkan compute pipeline for \"%s\" created successfully.\n", file_path);
+    return true;
+}
+bool vk_create_specialized_compute_pipeline(
+    Wo_Renderer* renderer,
+    VkShaderModule shader_module,
+    VkSpecializationInfo const* specialization,
+    VkPipeline* pipeline_p
+) {
+    VkComputePipelineCreateInfo pipeline_create_info; {
+        memset(&pipeline_create_info, 0, sizeof(pipeline_create_info));
+        pipeline_create_info.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+        pipeline_create_info.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+        pipeline_create_info.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+        pipeline_create_info.stage.module = shader_module;
+        pipeline_create_info.stage.pName = "main";
+        pipeline_create_info.stage.pSpecializationInfo = specialization;
+        pipeline_create_info.layout = renderer->vk_pipeline_layout;
+        pipeline_create_info.basePipelineHandle = VK_NULL_HANDLE;
+        pipeline_create_info.basePipelineIndex = -1;
+    }
+    VkResult pipeline_ok = vkCreateComputePipelines(
+        renderer->vk_device, renderer->vk_pipeline_cache,
+        1, &pipeline_create_info,
+        NULL,
+        pipeline_p
+    );
+    return pipeline_ok == VK_SUCCESS;
+}
+void vk_create_compute_pipelines(Wo_Renderer* renderer) {
+    renderer->vk_compute_pipeline_ok = vk_create_compute_pipeline(
+        renderer, WO_UBERSHADER_COMP_FILEPATH,
+        &renderer->vk_comp_shader_module,
+        &renderer->vk_compute_pipeline
+    );
+    if (!renderer->vk_compute_pipeline_ok) {
+        printf("[Wololo] Failed to create a Vulkan compute pipeline; compute path disabled.\n");
+    }
+
+    // the ray query variant shares the compute path's output, so needs it too:
+    if (renderer->vk_compute_pipeline_ok && renderer->vk_ray_query_supported) {
+        renderer->vk_ray_query_pipeline_ok = vk_create_compute_pipeline(
+            renderer, WO_UBERSHADER_RQ_COMP_FILEPATH,
+            &renderer->vk_rq_comp_shader_module,
+            &renderer->vk_ray_query_pipeline
+        );
+        if (renderer->vk_ray_query_pipeline_ok) {
+            // the default wherever it's available: (dropped in 'commit_scene' if the TLAS build fails)
+            renderer->trace_path = WO_TRACE_PATH_RAY_QUERY;
+        } else {
+            printf("[Wololo] Failed to create a Vulkan ray query pipeline; tracing with the software BVH.\n");
+        }
+    }
+}
+void vk_run_pipeline_worker_job(Wo_Renderer* renderer) {
+    if (renderer->compiling_pipeline_variant_index < WO_MAX_PIPELINE_VARIANT_COUNT) {
+        vk_compile_pipeline_variant(renderer, &renderer->pipeline_variants[renderer->compiling_pipeline_variant_index]);
+    } else {
+        vk_create_compute_pipelines(renderer);
+    }
+}
+#if WO_ASYNC_PIPELINE_CREATION
+int vk_pipeline_worker_main(void* renderer) {
+    vk_run_pipeline_worker_job(renderer);
+    atomic_store_explicit(&((Wo_Renderer*)renderer)->vk_pipeline_worker_done, true, memory_order_release);
+    return 0;
+}
+#endif
+void vk_start_pipeline_worker(Wo_Renderer* renderer) {
+    // until joined, the worker owns the compute pipelines' fields and 'trace_path' (or the
+    // variant being compiled), and shares only the (internally synchronized) device and pipeline
+    // cache with this thread.
+#if WO_ASYNC_PIPELINE_CREATION
+    assert(!renderer->vk_pipeline_worker_running);
+    atomic_store_explicit(&renderer->vk_pipeline_worker_done, false, memory_order_relaxed);
+    if (thrd_create(&renderer->vk_pipeline_worker, vk_pipeline_worker_main, renderer) == thrd_success) {
+        renderer->vk_pipeline_worker_running = true;
+        return;
+    }
+    printf("[Wololo] Failed to start a pipeline worker thread; compiling pipelines in-line.\n");
+#endif
+    vk_run_pipeline_worker_job(renderer);
+}
+bool vk_pipeline_worker_is_done(Wo_Renderer* renderer) {
+    // (true once its job is done, so joining no longer blocks)
+#if WO_ASYNC_PIPELINE_CREATION
+    return (
+        !renderer->vk_pipeline_worker_running ||
+        atomic_load_explicit(&renderer->vk_pipeline_worker_done, memory_order_acquire)
+    );
+#else
+    (void)renderer;
+    return true;
+#endif
+}
+void vk_join_pipeline_worker(Wo_Renderer* renderer) {
+#if WO_ASYNC_PIPELINE_CREATION
+    if (renderer->vk_pipeline_worker_running) {
+        thrd_join(renderer->vk_pipeline_worker, NULL);
+        renderer->vk_pipeline_worker_running = false;
+    }
+#else
+    (void)renderer;
+#endif
+}
+void help_get_pipeline_cache_file_header(Wo_Renderer* renderer, uint64_t data_size, PipelineCacheFileHeader* out_header) {
+    VkPhysicalDeviceProperties physical_device_properties;
+    vkGetPhysicalDeviceProperties(renderer->vk_physical_device, &physical_device_properties);
+
+    memset(out_header, 0, sizeof(PipelineCacheFileHeader));
+    out_header->magic = WO_PIPELINE_CACHE_FILE_MAGIC;
+    out_header->vendor_id = physical_device_properties.vendorID;
+    out_header->device_id = physical_device_properties.deviceID;
+    out_header->driver_version = physical_device_properties.driverVersion;
+    memcpy(out_header->pipeline_cache_uuid, physical_device_properties.pipelineCacheUUID, VK_UUID_SIZE);
+    out_header->data_size = data_size;
+}
+void vk_create_pipeline_cache(Wo_Renderer* renderer) {
+    // reading back the cache saved by the last run, if it was saved by this same device and driver:
+    // (drivers check the blob's own header too, but not all of them check the driver version)
+    void* initial_data = NULL;
+    size_t initial_data_size = 0;
+    FILE* cache_file = fopen(WO_PIPELINE_CACHE_FILEPATH, "rb");
+    if (cache_file != NULL) {
+        PipelineCacheFileHeader expected_header;
+        help_get_pipeline_cache_file_header(renderer, 0, &expected_header);
+
+        PipelineCacheFileHeader header;
+        bool header_ok = (
+            fread(&header, sizeof(header), 1, cache_file) == 1 &&
+            header.magic == expected_header.magic &&
+            header.vendor_id == expected_header.vendor_id &&
+            header.device_id == expected_header.device_id &&
+            header.driver_version == expected_header.driver_version &&
+            memcmp(header.pipeline_cache_uuid, expected_header.pipeline_cache_uuid, VK_UUID_SIZE) == 0 &&
+            header.data_size > 0 &&
+            header.data_size <= SIZE_MAX
+        );
+        if (header_ok) {
+            initial_data = malloc((size_t)header.data_size);
+            if (initial_data != NULL && fread(initial_data, (size_t)header.data_size, 1, cache_file) == 1) {
+                initial_data_size = (size_t)header.data_size;
+            }
+        }
+        fclose(cache_file);
+
+        if (initial_data_size > 0) {
+            printf("[Wololo] Loaded a Vulkan pipeline cache of %zu bytes from '%s'.\n", initial_data_size, WO_PIPELINE_CACHE_FILEPATH);
+        } else {
+            printf("[Wololo] Ignoring a stale or truncated Vulkan pipeline cache at '%s'.\n", WO_PIPELINE_CACHE_FILEPATH);
+        }
+    }
+
+    VkPipelineCacheCreateInfo cache_create_info;
+    memset(&cache_create_info, 0, sizeof(cache_create_info));
+    cache_create_info.sType = VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO;
+    cache_create_info.initialDataSize = initial_data_size;
+    cache_create_info.pInitialData = initial_data_size > 0 ? initial_data : NULL;
+    VkResult cache_ok = vkCreatePipelineCache(renderer->vk_device, &cache_create_info, NULL, &renderer->vk_pipeline_cache);
+    if (cache_ok != VK_SUCCESS && initial_data_size > 0) {
+        // retrying cold, in case the driver rejected the saved blob:
+        initial_data_size = 0;
+        cache_create_info.initialDataSize = 0;
+        cache_create_info.pInitialData = NULL;
+        cache_ok = vkCreatePipelineCache(renderer->vk_device, &cache_create_info, NULL, &renderer->vk_pipeline_cache);
+    }
+    if (cache_ok != VK_SUCCESS) {
+        // pipelines are just created without one:
+        printf("[Wololo] Failed to create a Vulkan pipeline cache.\n");
+        renderer->vk_pipeline_cache = VK_NULL_HANDLE;
+    }
+    renderer->vk_pipeline_cache_saved_size = initial_data_size;
+    free(initial_data);
+}
+void vk_save_pipeline_cache(Wo_Renderer* renderer) {
+    if (renderer->vk_pipeline_cache == VK_NULL_HANDLE) {
+        return;
+    }
+
+    // the cache only ever grows, so an unchanged size means nothing new was compiled since it was
+    // loaded or last saved:
+    size_t data_size = 0;
+    VkResult size_ok = vkGetPipelineCacheData(renderer->vk_device, renderer->vk_pipeline_cache, &data_size, NULL);
+    if (size_ok != VK_SUCCESS || data_size == 0 || data_size == renderer->vk_pipeline_cache_saved_size) {
+        return;
+    }
+    void* data = malloc(data_size);
+    if (data == NULL) {
+        return;
+    }
+    if (vkGetPipelineCacheData(renderer->vk_device, renderer->vk_pipeline_cache, &data_size, data) != VK_SUCCESS) {
+        free(data);
+        return;
+    }
+
+    PipelineCacheFileHeader header;
+    help_get_pipeline_cache_file_header(renderer, data_size, &header);
+
+    // writing a temporary file and renaming it over the old cache, so that a renderer starting up
+    // concurrently never reads a partially written one:
+    char temp_file_path[1024];
+    snprintf(temp_file_path, sizeof(temp_file_path), "%s.tmp", WO_PIPELINE_CACHE_FILEPATH);
+    bool write_ok = false;
+    FILE* temp_file = fopen(temp_file_path, "wb");
+    if (temp_file != NULL) {
+        write_ok = (
+            fwrite(&header, sizeof(header), 1, temp_file) == 1 &&
+            fwrite(data, data_size, 1, temp_file) == 1
+        );
+        write_ok = (fclose(temp_file) == 0) && write_ok;
+    }
+#if defined(_WIN32)
+    // ('rename' does not replace existing files on Windows)
+    if (write_ok) {
+        remove(WO_PIPELINE_CACHE_FILEPATH);
+    }
+#endif
+    if (write_ok && rename(temp_file_path, WO_PIPELINE_CACHE_FILEPATH) == 0) {
+        printf("[Wololo] Saved a Vulkan pipeline cache of %zu bytes to '%s'.\n", data_size, WO_PIPELINE_CACHE_FILEPATH);
+        renderer->vk_pipeline_cache_saved_size = data_size;
+    } else {
+        printf("[Wololo] Failed to save the Vulkan pipeline cache to '%s'.\n", WO_PIPELINE_CACHE_FILEPATH);
+        remove(temp_file_path);
+    }
+    free(data);
+}
+bool vk_create_swapchain(Wo_Renderer* renderer, VkSwapchainKHR old_swapchain) {
+    // Creating the swapchain, its images and their image views at the surface's current extent.
+    // (the surface format and present mode are chosen once, by 'vk_init_renderer')
+    // see: https://vulkan-tutorial.com/en/Drawing_a_triangle/Swap_chain_recreation
+
+    // re-querying the surface capabilities, whose current extent follows the window:
+    vkGetPhysicalDeviceSurfaceCapabilitiesKHR(
+        renderer->vk_physical_device,
+        renderer->vk_present_surface,
+        &renderer->vk_present_surface_capabilities
+    );
+    glfwGetFramebufferSize(
+        wo_app_glfw_window(renderer->app),
+        &renderer->swapchain_window_width,
+        &renderer->swapchain_window_height
+    );
+
+    // Choosing swap extent:
+    {
+        if (renderer->vk_present_surface_capabilities.currentExtent.width != UINT32_MAX) {
+            // special case; pick best resolution from minImageExtent to maxImageExtent bounds.
+            renderer->vk_frame_extent = renderer->vk_present_surface_capabilities.currentExtent;
+        } else {
+            int width, height;
+            glfwGetFramebufferSize(
+                wo_app_glfw_window(renderer->app), 
+                &width, &height
+            );
+
+            // initializing width and height to the frame-buffer size:
+            renderer->vk_frame_extent.width = (uint32_t)width;
+            renderer->vk_frame_extent.height = (uint32_t)height;
+            
+            // clamping width and height against minimum/maximum allowed:
+            renderer->vk_frame_extent.width = MAX(
+                renderer->vk_present_surface_capabilities.minImageExtent.width,
+                renderer->vk_frame_extent.width
+            );
+            renderer->vk_frame_extent.width = MIN(
+                renderer->vk_present_surface_capabilities.maxImageExtent.width,
+                renderer->vk_frame_extent.width
+            );
+            renderer->vk_frame_extent.height = MAX(
+                renderer->vk_present_surface_capabilities.minImageExtent.height,
+                renderer->vk_frame_extent.height
+            );
+            renderer->vk_frame_extent.height = MIN(
+                renderer->vk_present_surface_capabilities.maxImageExtent.height,
+                renderer->vk_frame_extent.height
+            );
+        }
+
+        // Finally creating the swapchain:
+    
+        // requesting number of images in the swap chain.
+        // always requesting 1 extra so the GPU is never starved for frames while we render (double-buffer or better)
+        // note '0' is a special value meaning no maximum.
+        uint32_t image_count = 1 + renderer->vk_present_surface_capabilities.minImageCount;
+        if (renderer->vk_present_surface_capabilities.maxImageCount > 0) {
+            image_count = MIN(image_count, renderer->vk_present_surface_capabilities.maxImageCount);
+        }
+
+        VkSwapchainCreateInfoKHR swapchain_create_info;
+        uint32_t queue_family_indices[2] = {
+            renderer->vk_graphics_queue_family_index,
+            renderer->vk_present_queue_family_index
+        };
+        {
+            memset(&swapchain_create_info, 0, sizeof(swapchain_create_info));
+
+            swapchain_create_info.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
+            swapchain_create_info.surface = renderer->vk_present_surface;
+            swapchain_create_info.minImageCount = image_count;
+            swapchain_create_info.imageFormat = renderer->vk_chosen_present_surface_format.format;
+            swapchain_create_info.imageColorSpace = renderer->vk_chosen_present_surface_format.colorSpace;
+            swapchain_create_info.imageExtent = renderer->vk_frame_extent;
+            swapchain_create_info.imageArrayLayers = 1;
+
+            // note: for postprocessing, use 'VK_IMAGE_USAGE_TRANSFER_DST_BIT' instead and use
+            //       a memory operation to transfer the rendered image to a swap chain image.
+            // the compute path does exactly that, so requesting it whenever the surface supports it:
+            // (re-checked by every recreation, as the surface's supported usages may change)
+            swapchain_create_info.imageUsage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+            renderer->vk_swapchain_supports_blit_dst = false;
+            if (renderer->vk_present_surface_capabilities.supportedUsageFlags & VK_IMAGE_USAGE_TRANSFER_DST_BIT) {
+                swapchain_create_info.imageUsage |= VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+
+                VkFormatProperties format_properties;
+                vkGetPhysicalDeviceFormatProperties(
+                    renderer->vk_physical_device,
+                    renderer->vk_chosen_present_surface_format.format,
+                    &format_properties
+                );
+                renderer->vk_swapchain_supports_blit_dst = (
+                    (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0
+                );
+            }
+        
+            if (renderer->vk_graphics_queue_family_index != renderer->vk_present_queue_family_index) {
+                swapchain_create_info.imageSharingMode = VK_SHARING_MODE_CONCURRENT;
+                swapchain_create_info.queueFamilyIndexCount = 2;
+                swapchain_create_info.pQueueFamilyIndices = queue_family_indices;
+            } else {
+                swapchain_create_info.imageSharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            }
+
+            swapchain_create_info.preTransform = renderer->vk_present_surface_capabilities.currentTransform;
+            
+            // no transparent windows, thank you:
+            swapchain_create_info.compositeAlpha = VK_COMPOSITE_ALPHA_OPAQUE_BIT_KHR;
+
+            swapchain_create_info.presentMode = renderer->vk_chosen_present_surface_mode;
+            
+            swapchain_create_info.clipped = VK_TRUE;
+
+            // when recreating, the old swapchain's resources may be reused (and any of its
+            // images still being presented stay valid until it is destroyed):
+            swapchain_create_info.oldSwapchain = old_swapchain;
+        }
+
+        VkResult result = vkCreateSwapchainKHR(
+            renderer->vk_device,
+            &swapchain_create_info, NULL, 
+            &renderer->vk_swapchain
+        );
+        if (result != VK_SUCCESS) {
+            printf("[Wololo] Failed to create a Vulkan swapchain.\n");
+            return false;
+        } else {
+            printf(
+                "[Wololo] Successfully create a Vulkan swapchain with extent [%u x %u]\n",
+                renderer->vk_frame_extent.width,
+                renderer->vk_frame_extent.height
+            );
+        }
+    }
+
+    // Retrieving the created swapchain's images:
+    {
+        // setting `renderer->vk_swapchain_images_count`
+        vkGetSwapchainImagesKHR(
+            renderer->vk_device,
+            renderer->vk_swapchain,
+            &renderer->vk_swapchain_images_count,
+            NULL
+        );
+
+        // allocating:
+        renderer->vk_swapchain_images = calloc(
+            sizeof(VkImage),
+            renderer->vk_swapchain_images_count
+        );
+
+        // setting vk_swapchain_images:
+        VkResult swapchain_images_ok = vkGetSwapchainImagesKHR(
+            renderer->vk_device,
+            renderer->vk_swapchain,
+            &renderer->vk_swapchain_images_count,
+            renderer->vk_swapchain_images
+        );
+        if (swapchain_images_ok != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan swapchain images.\n");
+            return false;
+        } else {
+            printf("[Wololo] Vulkan swapchain images created successfully.\n");
+        }
+    }
+
+    // creating image views:
+    // https://vulkan-tutorial.com/en/Drawing_a_triangle/Presentation/Image_views
+    // to use any VkImage, need VkImageView
+    {
+        // first, allocating the vk_swapchain_image_views array
+        // s.t. there exists a unique image-view per image
+        renderer->vk_swapchain_image_views = NULL;
+        if (renderer->vk_swapchain_images_count > 0) {
+            renderer->vk_swapchain_image_views = calloc(
+                sizeof(VkImageView),
+                renderer->vk_swapchain_images_count
+            );
+            assert(
+                renderer->vk_swapchain_image_views &&
+                "Allocation failed: renderer->vk_swapchain_image_views"
+            );
+        }
+
+        // then, calling on Vulkan to create, thereby populating the array:
+        for (size_t index = 0; index < renderer->vk_swapchain_images_count; index++) {
+            VkImageViewCreateInfo create_info;
+            {
+                memset(&create_info, 0, sizeof(create_info));
+                create_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+                create_info.image = renderer->vk_swapchain_images[index];
+                create_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                create_info.format = renderer->vk_chosen_present_surface_format.format;
+
+                // each pixel is composed of one or more values corresponding to channels
+                // in the output image, e.g. red (R), green (G), blue (B), and alpha (A).
+                // 'swizzle' describes a linear transformation on a bit-vector, and just tells
+                // Vulkan how to access each component.
+                create_info.components.r = VK_COMPONENT_SWIZZLE_IDENTITY;
+                create_info.components.g = VK_COMPONENT_SWIZZLE_IDENTITY;
+                create_info.components.b = VK_COMPONENT_SWIZZLE_IDENTITY;
+                create_info.components.a = VK_COMPONENT_SWIZZLE_IDENTITY;
+
+                // setting up mipmapping levels, or multiple layers (for stereographic 3D)
+                create_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+                create_info.subresourceRange.baseMipLevel = 0;
+                create_info.subresourceRange.levelCount = 1;
+                create_info.subresourceRange.baseArrayLayer = 0;
+                create_info.subresourceRange.layerCount = 1;
+            }
+
+            // creating the VkImageView:
+            VkResult ok = vkCreateImageView(
+                renderer->vk_device, 
+                &create_info, 
+                NULL, 
+                &renderer->vk_swapchain_image_views[index]
+            );
+            if (ok != VK_SUCCESS) {
+                printf("[Wololo] Failed to create Vulkan image view %zu/%u.\n", index+1, renderer->vk_swapchain_images_count);
+                return false;
+            } else {
+                printf("[Wololo] Vulkan image view %zu/%u created successfully.\n", index+1, renderer->vk_swapchain_images_count);
+            }
+        }
+    }
+
+    return true;
+}
+void vk_destroy_swapchain_image_views(Wo_Renderer* renderer) {
+    // destroying the swapchain's image views and forgetting its images, but not the swapchain
+    // itself: recreation passes it as 'oldSwapchain' first.
+    if (renderer->vk_swapchain_image_views != NULL) {
+        for (size_t index = 0; index < renderer->vk_swapchain_images_count; index++) {
+            if (renderer->vk_swapchain_image_views[index] != VK_NULL_HANDLE) {
+                vkDestroyImageView(
+                    renderer->vk_device,
+                    renderer->vk_swapchain_image_views[index],
+                    NULL
+                );
+            }
+        }
+        free(renderer->vk_swapchain_image_views);
+        renderer->vk_swapchain_image_views = NULL;
+    }
+    free(renderer->vk_swapchain_images);
+    renderer->vk_swapchain_images = NULL;
+}
+bool vk_create_framebuffers(Wo_Renderer* renderer) {
+    // creating swapchain framebuffers, one per swapchain image view:
+    // see: https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Framebuffers
+    renderer->vk_swapchain_framebuffers = calloc(
+        renderer->vk_swapchain_images_count,
+        sizeof(VkFramebuffer)
+    );
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        VkFramebuffer* fbp = &renderer->vk_swapchain_framebuffers[i];
+        
+        uint32_t attachment_count = 1;
+        VkImageView attachments[] = {
+            renderer->vk_swapchain_image_views[i]
+        };
+        
+        VkFramebufferCreateInfo fb_create_info;
+        memset(&fb_create_info, 0, sizeof(fb_create_info));
+        fb_create_info.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+        fb_create_info.renderPass = renderer->vk_render_pass;
+        fb_create_info.attachmentCount = attachment_count;
+        fb_create_info.pAttachments = attachments;
+        fb_create_info.width = renderer->vk_frame_extent.width;
+        fb_create_info.height = renderer->vk_frame_extent.height;
+        fb_create_info.layers = 1;
+
+        VkResult swapchain_framebuffer_res = vkCreateFramebuffer(
+            renderer->vk_device, 
+            &fb_create_info, 
+            NULL, 
+            fbp
+        );
+        if (swapchain_framebuffer_res != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan framebuffer %d/%d\n", i+1, renderer->vk_swapchain_images_count);
+            return false;
+        } else {
+            printf("[Wololo] Vulkan framebuffer %d/%d created successfully.\n", i+1, renderer->vk_swapchain_images_count);
+            renderer->vk_swapchain_fbs_ok_count = i+1;
+        }
+    }
+    return true;
+}
+void vk_destroy_framebuffers(Wo_Renderer* renderer) {
+    if (renderer->vk_swapchain_framebuffers) {
+        for (uint32_t i_fb = 0; i_fb < renderer->vk_swapchain_fbs_ok_count; i_fb++) {
+            vkDestroyFramebuffer(
+                renderer->vk_device, 
+                renderer->vk_swapchain_framebuffers[i_fb],
+                NULL
+            );
+        }
+        free(renderer->vk_swapchain_framebuffers);
+        renderer->vk_swapchain_framebuffers = NULL;
+        renderer->vk_swapchain_fbs_ok_count = 0;
+    }
+}
+bool vk_create_storage_image(
+    Wo_Renderer* renderer,
+    VkFormat format,
+    VkImageUsageFlags usage,
+    VkImage* image_p,
+    GpuAllocation* allocation_p,
+    VkImageView* view_p
+) {
+    // Creating a device-local storage image (and its view) at the frame extent:
+    VkImageCreateInfo image_info; {
+        memset(&image_info, 0, sizeof(image_info));
+        image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+        image_info.imageType = VK_IMAGE_TYPE_2D;
+        image_info.format = format;
+        image_info.extent.width = renderer->vk_frame_extent.width;
+        image_info.extent.height = renderer->vk_frame_extent.height;
+        image_info.extent.depth = 1;
+        image_info.mipLevels = 1;
+        image_info.arrayLayers = 1;
+        image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+        image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+        image_info.usage = VK_IMAGE_USAGE_STORAGE_BIT | usage;
+        image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+        image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    }
+    if (vkCreateImage(renderer->vk_device, &image_info, NULL, image_p) != VK_SUCCESS) {
+        printf("[Wololo] Failed to create a Vulkan storage image.\n");
+        return false;
+    }
+
+    VkMemoryRequirements mem_requirements;
+    vkGetImageMemoryRequirements(renderer->vk_device, *image_p, &mem_requirements);
+    bool allocate_ok = gpu_arena_allocate(
+        &renderer->gpu_arena,
+        WO_GPU_MEMORY_IMAGES,
+        &mem_requirements,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        allocation_p
+    );
+    if (!allocate_ok) {
+        printf("[Wololo] Failed to allocate a Vulkan storage image.\n");
+        return false;
+    }
+    vkBindImageMemory(
+        renderer->vk_device,
+        *image_p,
+        allocation_p->memory,
+        allocation_p->offset
+    );
+
+    VkImageViewCreateInfo view_info; {
+        memset(&view_info, 0, sizeof(view_info));
+        view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        view_info.image = *image_p;
+        view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        view_info.format = format;
+        view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        view_info.subresourceRange.baseMipLevel = 0;
+        view_info.subresourceRange.levelCount = 1;
+        view_info.subresourceRange.baseArrayLayer = 0;
+        view_info.subresourceRange.layerCount = 1;
+    }
+    if (vkCreateImageView(renderer->vk_device, &view_info, NULL, view_p) != VK_SUCCESS) {
+        printf("[Wololo] Failed to create a Vulkan storage image view.\n");
+        return false;
+    }
+    return true;
+}
+bool vk_create_trace_image(Wo_Renderer* renderer) {
+    // Creating the storage image the compute path traces into, at the frame extent, and the
+    // image progressive mode accumulates samples in:
+    bool trace_image_ok = vk_create_storage_image(
+        renderer,
+        WO_TRACE_IMAGE_FORMAT,
+        VK_IMAGE_USAGE_TRANSFER_SRC_BIT,
+        &renderer->vk_trace_image,
+        &renderer->vk_trace_image_allocation,
+        &renderer->vk_trace_image_view
+    );
+    bool accumulation_image_ok = trace_image_ok && vk_create_storage_image(
+        renderer,
+        WO_ACCUMULATION_IMAGE_FORMAT,
+        0,
+        &renderer->vk_accumulation_image,
+        &renderer->vk_accumulation_image_allocation,
+        &renderer->vk_accumulation_image_view
+    );
+    if (!accumulation_image_ok) {
+        printf("[Wololo] Failed to create the Vulkan trace images.\n");
+        return false;
+    }
+
+    // unlike the trace image, the accumulation image's contents are kept from frame to frame,
+    // so it is moved into its layout once, here, rather than in every frame:
+    VkCommandBuffer command_buffer = vk_begin_one_time_command_buffer(renderer);
+    if (command_buffer == VK_NULL_HANDLE) {
+        return false;
+    }
+    VkImageMemoryBarrier to_general; {
+        memset(&to_general, 0, sizeof(to_general));
+        to_general.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        to_general.srcAccessMask = 0;
+        to_general.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        to_general.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        to_general.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        to_general.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_general.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_general.image = renderer->vk_accumulation_image;
+        to_general.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        to_general.subresourceRange.baseMipLevel = 0;
+        to_general.subresourceRange.levelCount = 1;
+        to_general.subresourceRange.baseArrayLayer = 0;
+        to_general.subresourceRange.layerCount = 1;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &to_general
+    );
+
+    // (a new image holds no samples yet)
+    renderer->accumulated_sample_count = 0;
+    return vk_submit_one_time_command_buffer(renderer, command_buffer);
+}
+void vk_destroy_trace_image(Wo_Renderer* renderer) {
+    if (renderer->vk_trace_image_view != VK_NULL_HANDLE) {
+        vkDestroyImageView(renderer->vk_device, renderer->vk_trace_image_view, NULL);
+        renderer->vk_trace_image_view = VK_NULL_HANDLE;
+    }
+    if (renderer->vk_trace_image != VK_NULL_HANDLE) {
+        vkDestroyImage(renderer->vk_device, renderer->vk_trace_image, NULL);
+        renderer->vk_trace_image = VK_NULL_HANDLE;
+    }
+    gpu_arena_free(&renderer->gpu_arena, &renderer->vk_trace_image_allocation);
+    if (renderer->vk_accumulation_image_view != VK_NULL_HANDLE) {
+        vkDestroyImageView(renderer->vk_device, renderer->vk_accumulation_image_view, NULL);
+        renderer->vk_accumulation_image_view = VK_NULL_HANDLE;
+    }
+    if (renderer->vk_accumulation_image != VK_NULL_HANDLE) {
+        vkDestroyImage(renderer->vk_device, renderer->vk_accumulation_image, NULL);
+        renderer->vk_accumulation_image = VK_NULL_HANDLE;
+    }
+    gpu_arena_free(&renderer->gpu_arena, &renderer->vk_accumulation_image_allocation);
+}
+bool vk_create_swapchain_image_resources(Wo_Renderer* renderer) {
+    // Creating everything there is one of per swapchain image: recreated only when a new
+    // swapchain has a different number of images.
+    // (the trace image and scene descriptors are written by the caller)
+
+    // creating command buffers (managed by the command buffer pool)
+    {
+        renderer->vk_command_buffers_ok = false;
+        renderer->vk_command_buffers = calloc(
+            sizeof(VkCommandBuffer),
+            renderer->vk_swapchain_images_count
+        );
+        assert(renderer->vk_command_buffers != NULL);
+        
+        VkCommandBufferAllocateInfo alloc_info;
+        memset(&alloc_info, 0, sizeof(VkCommandBufferAllocateInfo));
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.commandPool = renderer->vk_command_buffer_pool;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = renderer->vk_swapchain_images_count;
+
+        VkResult ok = vkAllocateCommandBuffers(
+            renderer->vk_device,
+            &alloc_info,
+            renderer->vk_command_buffers
+        );
+        if (ok != VK_SUCCESS) {
+            printf("[Wololo] Failed to allocate Vulkan command buffers.\n");
+            return false;
+        } else {
+            renderer->vk_command_buffers_ok = true;
+            printf("[Wololo] Vulkan command buffers allocated successfully.\n");
+        }
+    }
+
+    // Initializing buffer objects, like:
+    // - uniform buffer objects
+    {
+        assert(renderer->vk_swapchain_images_count > 0);
+
+        // dynamic offsets must be multiples of 'minUniformBufferOffsetAlignment' (a power of 2):
+        VkPhysicalDeviceProperties physical_device_properties;
+        vkGetPhysicalDeviceProperties(renderer->vk_physical_device, &physical_device_properties);
+        VkDeviceSize alignment = physical_device_properties.limits.minUniformBufferOffsetAlignment;
+        if (alignment == 0) {
+            alignment = 1;
+        }
+        renderer->uniform_buffer_stride = (
+            (sizeof(FragmentUniformBufferObject) + alignment - 1) & ~(alignment - 1)
+        );
+
+        VkDeviceSize buffer_size = renderer->uniform_buffer_stride * renderer->vk_swapchain_images_count;
+        bool uniform_buffer_ok = new_vk_uniform_buffer(
+            renderer->vk_device,
+            &renderer->gpu_arena,
+            buffer_size,
+            &renderer->uniform_buffer,
+            &renderer->uniform_buffer_allocation
+        );
+        if (!uniform_buffer_ok) {
+            printf("[Wololo] Failed to create the Vulkan uniform buffer.\n");
+            return false;
+        }
+
+        // - ray counters, likewise one slot per image (at 'minStorageBufferOffsetAlignment'):
+        VkDeviceSize counter_alignment = physical_device_properties.limits.minStorageBufferOffsetAlignment;
+        if (counter_alignment == 0) {
+            counter_alignment = 1;
+        }
+        renderer->ray_counter_stride = (sizeof(uint32_t) + counter_alignment - 1) & ~(counter_alignment - 1);
+        bool ray_counter_buffer_ok = new_vk_buffer(
+            renderer->vk_device,
+            &renderer->gpu_arena,
+            WO_GPU_MEMORY_UNIFORMS,
+            renderer->ray_counter_stride * renderer->vk_swapchain_images_count,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+            &renderer->ray_counter_buffer,
+            &renderer->ray_counter_buffer_allocation
+        );
+        if (!ray_counter_buffer_ok) {
+            printf("[Wololo] Failed to create the Vulkan ray counter buffer.\n");
+            return false;
+        }
+        memset(
+            renderer->ray_counter_buffer_allocation.mapped, 0,
+            renderer->ray_counter_stride * renderer->vk_swapchain_images_count
+        );
+
+        // - timestamp queries, WO_FRAME_TIMESTAMP_COUNT per image:
+        if (renderer->vk_timestamps_supported) {
+            VkQueryPoolCreateInfo query_pool_info;
+            memset(&query_pool_info, 0, sizeof(query_pool_info));
+            query_pool_info.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+            query_pool_info.queryType = VK_QUERY_TYPE_TIMESTAMP;
+            query_pool_info.queryCount = WO_FRAME_TIMESTAMP_COUNT * renderer->vk_swapchain_images_count;
+            VkResult query_pool_ok = vkCreateQueryPool(
+                renderer->vk_device,
+                &query_pool_info,
+                NULL,
+                &renderer->vk_timestamp_query_pool
+            );
+            if (query_pool_ok != VK_SUCCESS) {
+                // (frame times are not essential: adaptive resolution is just unavailable)
+                printf("[Wololo] Failed to create a Vulkan timestamp query pool, GPU frame times are unavailable.\n");
+                renderer->vk_timestamp_query_pool = VK_NULL_HANDLE;
+                renderer->vk_timestamps_supported = false;
+            }
+        }
+    }
+
+    // initializing a descriptor pool to bind uniforms to shader:
+    // https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets
+    {
+        renderer->vk_descriptor_pool_ok = false;
+
+        // configuring maximum descriptor pool size:
+        // one UBO, four storage buffers (nodes, BVH, materials, ray counter) and two images
+        // (trace, accumulation) per descriptor set.
+        // (with ray queries: a TLAS and a fifth storage buffer too)
+        VkDescriptorPoolSize pool_sizes[4]; {
+            memset(pool_sizes, 0, sizeof(pool_sizes));
+            pool_sizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+            pool_sizes[0].descriptorCount = renderer->vk_swapchain_images_count;
+            pool_sizes[1].type = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            pool_sizes[1].descriptorCount = (renderer->vk_ray_query_supported ? 5 : 4) * renderer->vk_swapchain_images_count;
+            pool_sizes[2].type = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            pool_sizes[2].descriptorCount = 2 * renderer->vk_swapchain_images_count;
+            pool_sizes[3].type = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+            pool_sizes[3].descriptorCount = renderer->vk_swapchain_images_count;
+        }
+
+        // and the maximum number of pools:
+        VkDescriptorPoolCreateInfo pool_info; {
+            memset(&pool_info, 0, sizeof(pool_info));
+            pool_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+            pool_info.poolSizeCount = renderer->vk_ray_query_supported ? 4 : 3;
+            pool_info.pPoolSizes = pool_sizes;
+            pool_info.maxSets = renderer->vk_swapchain_images_count;
+            pool_info.flags = 0;
+        }
+
+        VkResult descriptor_pool_ok = vkCreateDescriptorPool(
+            renderer->vk_device,
+            &pool_info,
+            NULL,
+            &renderer->vk_descriptor_pool
+        );
+        if (descriptor_pool_ok != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan descriptor pool for Uniform data.\n");
+            return false;
+        } else {
+            printf("[Wololo] Vulkan descriptor pool for Uniform data created successfully.\n");
+            renderer->vk_descriptor_pool_ok = true;
+        }
+    }
+    // Creating descriptor sets using the descriptor pool above^
+    // see:
+    // https://vulkan-tutorial.com/Uniform_buffers/Descriptor_pool_and_sets
+    {
+        VkDescriptorSetLayout* layouts = calloc(
+            renderer->vk_swapchain_images_count,
+            sizeof(VkDescriptorSetLayout)
+        );
+        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+            layouts[i] = renderer->vk_descriptor_set_layout;
+        }
+        renderer->vk_descriptor_sets = calloc(
+            renderer->vk_swapchain_images_count,
+            sizeof(VkDescriptorSet)
+        );
+
+        VkDescriptorSetAllocateInfo alloc_info; {
+            memset(&alloc_info, 0, sizeof(alloc_info));
+            alloc_info.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+            alloc_info.descriptorPool = renderer->vk_descriptor_pool;
+            alloc_info.descriptorSetCount = renderer->vk_swapchain_images_count;
+            alloc_info.pSetLayouts = layouts;
+            alloc_info.pNext = NULL;
+        }
+        VkResult desc_sets_ok = vkAllocateDescriptorSets(
+            renderer->vk_device,
+            &alloc_info,
+            renderer->vk_descriptor_sets
+        );
+
+        if (desc_sets_ok != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan descriptor sets for Uniform data.\n");
+            free(layouts);
+            return false;
+        }
+
+        // if allocation was successful, configuring each descriptor:
+        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+            VkDescriptorBufferInfo buffer_info; {
+                memset(&buffer_info, 0, sizeof(buffer_info));
+                // (offset by each command buffer's dynamic offset)
+                buffer_info.buffer = renderer->uniform_buffer;
+                buffer_info.offset = 0;
+                buffer_info.range = sizeof(FragmentUniformBufferObject);
+            }
+            VkDescriptorBufferInfo ray_counter_buffer_info; {
+                memset(&ray_counter_buffer_info, 0, sizeof(ray_counter_buffer_info));
+                // (each set owns its image's slot)
+                ray_counter_buffer_info.buffer = renderer->ray_counter_buffer;
+                ray_counter_buffer_info.offset = i * renderer->ray_counter_stride;
+                ray_counter_buffer_info.range = sizeof(uint32_t);
+            }
+            VkWriteDescriptorSet w_descs[2]; {
+                memset(w_descs, 0, sizeof(w_descs));
+
+                w_descs[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w_descs[0].dstSet = renderer->vk_descriptor_sets[i];
+                w_descs[0].dstBinding = 0;
+                w_descs[0].dstArrayElement = 0;
+                w_descs[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+                w_descs[0].descriptorCount = 1;
+
+                w_descs[0].pBufferInfo = &buffer_info;
+                w_descs[0].pImageInfo = NULL;
+                w_descs[0].pTexelBufferView = NULL;
+
+                w_descs[1] = w_descs[0];
+                w_descs[1].dstBinding = 8;
+                w_descs[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+                w_descs[1].pBufferInfo = &ray_counter_buffer_info;
+            }
+
+            vkUpdateDescriptorSets(
+                renderer->vk_device,
+                2, w_descs,
+                0, NULL
+            );
+        }
+
+        free(layouts);
+        printf("Vulkan descriptor sets for Uniform data created successfully.\n");
+    }
+
+    // allocating images_inflight_fences, initializing to VK_NULL_HANDLE (0):
+    renderer->vk_images_inflight_fences = calloc(
+        sizeof(VkFence),
+        renderer->vk_swapchain_images_count
+    );
+    assert(renderer->vk_images_inflight_fences != NULL && "Out of memory-- calloc failed.");
+    renderer->vk_timestamps_written = calloc(sizeof(bool), renderer->vk_swapchain_images_count);
+    renderer->vk_command_buffers_stale = calloc(sizeof(bool), renderer->vk_swapchain_images_count);
+    assert(renderer->vk_timestamps_written != NULL && renderer->vk_command_buffers_stale != NULL && "Out of memory-- calloc failed.");
+
+    return true;
+}
+void vk_destroy_swapchain_image_resources(Wo_Renderer* renderer) {
+    // NOTE: the command pool must still be alive.
+    if (renderer->vk_command_buffers_ok) {
+        vkFreeCommandBuffers(
+            renderer->vk_device,
+            renderer->vk_command_buffer_pool,
+            renderer->vk_swapchain_images_count,
+            renderer->vk_command_buffers
+        );
+        renderer->vk_command_buffers_ok = false;
+    }
+    free(renderer->vk_command_buffers);
+    renderer->vk_command_buffers = NULL;
+
+    del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &renderer->uniform_buffer, &renderer->uniform_buffer_allocation);
+    del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &renderer->ray_counter_buffer, &renderer->ray_counter_buffer_allocation);
+    if (renderer->vk_timestamp_query_pool != VK_NULL_HANDLE) {
+        vkDestroyQueryPool(renderer->vk_device, renderer->vk_timestamp_query_pool, NULL);
+        renderer->vk_timestamp_query_pool = VK_NULL_HANDLE;
+    }
+    free(renderer->vk_timestamps_written);
+    renderer->vk_timestamps_written = NULL;
+    free(renderer->vk_command_buffers_stale);
+    renderer->vk_command_buffers_stale = NULL;
+
+    // (freeing the pool frees its descriptor sets)
+    if (renderer->vk_descriptor_pool_ok) {
+        vkDestroyDescriptorPool(
+            renderer->vk_device,
+            renderer->vk_descriptor_pool,
+            NULL
+        );
+        renderer->vk_descriptor_pool_ok = false;
+    }
+    free(renderer->vk_descriptor_sets);
+    renderer->vk_descriptor_sets = NULL;
+
+    free(renderer->vk_images_inflight_fences);
+    renderer->vk_images_inflight_fences = NULL;
+}
+void vk_write_storage_buffer_descriptors(Wo_Renderer* renderer, uint32_t binding, VkBuffer buffer, VkDeviceSize size) {
+    // pointing every descriptor set's 'binding' at 'buffer':
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        VkDescriptorBufferInfo buffer_info; {
+            memset(&buffer_info, 0, sizeof(buffer_info));
+            buffer_info.buffer = buffer;
+            buffer_info.offset = 0;
+            buffer_info.range = size;
+        }
+        VkWriteDescriptorSet w_desc; {
+            memset(&w_desc, 0, sizeof(w_desc));
+            w_desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w_desc.dstSet = renderer->vk_descriptor_sets[i];
+            w_desc.dstBinding = binding;
+            w_desc.dstArrayElement = 0;
+            w_desc.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            w_desc.descriptorCount = 1;
+            w_desc.pBufferInfo = &buffer_info;
+        }
+        vkUpdateDescriptorSets(renderer->vk_device, 1, &w_desc, 0, NULL);
+    }
+}
+void vk_write_trace_image_descriptors(Wo_Renderer* renderer) {
+    // pointing every descriptor set at the trace and accumulation images, if the compute path
+    // is available:
+    if (renderer->vk_trace_image_view == VK_NULL_HANDLE) {
+        return;
+    }
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        VkDescriptorImageInfo image_infos[2]; {
+            memset(image_infos, 0, sizeof(image_infos));
+            image_infos[0].imageView = renderer->vk_trace_image_view;
+            image_infos[0].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            image_infos[0].sampler = VK_NULL_HANDLE;
+            image_infos[1].imageView = renderer->vk_accumulation_image_view;
+            image_infos[1].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+            image_infos[1].sampler = VK_NULL_HANDLE;
+        }
+        VkWriteDescriptorSet w_image_descs[2]; {
+            memset(w_image_descs, 0, sizeof(w_image_descs));
+            for (int image = 0; image < 2; image++) {
+                w_image_descs[image].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+                w_image_descs[image].dstSet = renderer->vk_descriptor_sets[i];
+                w_image_descs[image].dstArrayElement = 0;
+                w_image_descs[image].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+                w_image_descs[image].descriptorCount = 1;
+                w_image_descs[image].pImageInfo = &image_infos[image];
+            }
+            w_image_descs[0].dstBinding = 3;
+            w_image_descs[1].dstBinding = 6;
+        }
+        vkUpdateDescriptorSets(
+            renderer->vk_device,
+            2, w_image_descs,
+            0, NULL
+        );
+    }
+}
+void vk_write_tlas_descriptors(Wo_Renderer* renderer) {
+    // pointing every descriptor set at the TLAS:
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        VkWriteDescriptorSetAccelerationStructureKHR tlas_info; {
+            memset(&tlas_info, 0, sizeof(tlas_info));
+            tlas_info.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET_ACCELERATION_STRUCTURE_KHR;
+            tlas_info.accelerationStructureCount = 1;
+            tlas_info.pAccelerationStructures = &renderer->scene_tlas;
+        }
+        VkWriteDescriptorSet w_desc; {
+            memset(&w_desc, 0, sizeof(w_desc));
+            w_desc.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            w_desc.pNext = &tlas_info;
+            w_desc.dstSet = renderer->vk_descriptor_sets[i];
+            w_desc.dstBinding = 4;
+            w_desc.dstArrayElement = 0;
+            w_desc.descriptorType = VK_DESCRIPTOR_TYPE_ACCELERATION_STRUCTURE_KHR;
+            w_desc.descriptorCount = 1;
+        }
+        vkUpdateDescriptorSets(renderer->vk_device, 1, &w_desc, 0, NULL);
+    }
+}
+bool recreate_swapchain(Wo_Renderer* renderer) {
+    // Recreating the swapchain and everything sized by it (image views, framebuffers, the trace
+    // image) after a resize or once presentation reported it out-of-date/sub-optimal.
+    // The device, pipelines, scene buffers and acceleration structures are kept.
+    // see: https://vulkan-tutorial.com/en/Drawing_a_triangle/Swap_chain_recreation
+
+    // while minimized, the framebuffer is 0x0 and no swapchain can be created: retrying later.
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(wo_app_glfw_window(renderer->app), &width, &height);
+    if (width == 0 || height == 0) {
+        return false;
+    }
+
+    // nothing may still be using the resources torn down below:
+    vkDeviceWaitIdle(renderer->vk_device);
+
+    vk_destroy_framebuffers(renderer);
+    vk_destroy_trace_image(renderer);
+    vk_destroy_swapchain_image_views(renderer);
+
+    uint32_t old_image_count = renderer->vk_swapchain_images_count;
+    VkSwapchainKHR old_swapchain = renderer->vk_swapchain;
+    renderer->vk_swapchain = VK_NULL_HANDLE;
+    bool swapchain_ok = vk_create_swapchain(renderer, old_swapchain);
+    vkDestroySwapchainKHR(renderer->vk_device, old_swapchain, NULL);
+    if (!swapchain_ok) {
+        printf("[Wololo] Failed to recreate the Vulkan swapchain.\n");
+        return false;
+    }
+    renderer->vk_viewport.width = (float)renderer->vk_frame_extent.width;
+    renderer->vk_viewport.height = (float)renderer->vk_frame_extent.height;
+    if (!renderer->vk_swapchain_supports_blit_dst && renderer->trace_path != WO_TRACE_PATH_FRAGMENT) {
+        // the compute paths blit their trace image onto the swapchain: (re-recorded below)
+        printf("[Wololo] The recreated Vulkan swapchain cannot be blitted onto; tracing on the fragment path.\n");
+        renderer->trace_path = WO_TRACE_PATH_FRAGMENT;
+        renderer->accumulated_sample_count = 0;
+    }
+
+    if (!vk_create_framebuffers(renderer)) {
+        return false;
+    }
+    if (renderer->vk_compute_pipeline_ok && !vk_create_trace_image(renderer)) {
+        return false;
+    }
+
+    if (renderer->vk_swapchain_images_count != old_image_count) {
+        // the per-image resources are recreated, so all their descriptors are rewritten:
+        // (the UBO's by 'vk_create_swapchain_image_resources')
+        vk_destroy_swapchain_image_resources(renderer);
+        if (!vk_create_swapchain_image_resources(renderer)) {
+            return false;
+        }
+        if (renderer->scene_buffer != VK_NULL_HANDLE) {
+            vk_write_storage_buffer_descriptors(renderer, 1, renderer->scene_buffer, renderer->scene_buffer_size);
+        }
+        if (renderer->scene_accel_buffer != VK_NULL_HANDLE) {
+            vk_write_storage_buffer_descriptors(renderer, 2, renderer->scene_accel_buffer, renderer->scene_accel_buffer_size);
+        }
+        if (renderer->material_buffer != VK_NULL_HANDLE) {
+            vk_write_storage_buffer_descriptors(renderer, 7, renderer->material_buffer, renderer->material_buffer_size);
+        }
+        if (renderer->scene_component_aabb_buffer != VK_NULL_HANDLE) {
+            vk_write_storage_buffer_descriptors(
+                renderer, 5,
+                renderer->scene_component_aabb_buffer, renderer->scene_component_aabb_buffer_size
+            );
+        }
+        if (renderer->scene_tlas != VK_NULL_HANDLE) {
+            vk_write_tlas_descriptors(renderer);
+        }
+    } else {
+        // (the device is idle, so no image is in flight any more)
+        memset(renderer->vk_images_inflight_fences, 0, sizeof(VkFence) * renderer->vk_swapchain_images_count);
+        memset(renderer->vk_timestamps_written, 0, sizeof(bool) * renderer->vk_swapchain_images_count);
+    }
+    vk_write_trace_image_descriptors(renderer);
+
+    renderer->swapchain_needs_recreation = false;
+    return vk_record_command_buffers(renderer);
+}
+bool vk_create_offscreen_targets(Wo_Renderer* renderer) {
+    // Creating the images a headless renderer draws into, in place of a swapchain's: one per
+    // frame in flight, so that frame N+1 is drawn while frame N is still being read back.
+    renderer->vk_chosen_present_surface_format.format = WO_OFFSCREEN_IMAGE_FORMAT;
+    renderer->vk_chosen_present_surface_format.colorSpace = VK_COLOR_SPACE_SRGB_NONLINEAR_KHR;
+
+    VkFormatProperties format_properties;
+    vkGetPhysicalDeviceFormatProperties(
+        renderer->vk_physical_device,
+        WO_OFFSCREEN_IMAGE_FORMAT,
+        &format_properties
+    );
+    if (!(format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_COLOR_ATTACHMENT_BIT)) {
+        printf("[Wololo] Vulkan device cannot render to offscreen images.\n");
+        return false;
+    }
+    renderer->vk_swapchain_supports_blit_dst = (
+        (format_properties.optimalTilingFeatures & VK_FORMAT_FEATURE_BLIT_DST_BIT) != 0
+    );
+
+    renderer->vk_swapchain_images_count = renderer->frames_in_flight;
+    renderer->vk_swapchain_images = calloc(renderer->vk_swapchain_images_count, sizeof(VkImage));
+    renderer->vk_swapchain_image_views = calloc(renderer->vk_swapchain_images_count, sizeof(VkImageView));
+    assert(
+        renderer->vk_swapchain_images && renderer->vk_swapchain_image_views &&
+        "Out of memory-- calloc failed."
+    );
+
+    VkDeviceSize readback_size = (VkDeviceSize)renderer->vk_frame_extent.width * renderer->vk_frame_extent.height * 4;
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        VkImageCreateInfo image_info; {
+            memset(&image_info, 0, sizeof(image_info));
+            image_info.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            image_info.imageType = VK_IMAGE_TYPE_2D;
+            image_info.format = WO_OFFSCREEN_IMAGE_FORMAT;
+            image_info.extent.width = renderer->vk_frame_extent.width;
+            image_info.extent.height = renderer->vk_frame_extent.height;
+            image_info.extent.depth = 1;
+            image_info.mipLevels = 1;
+            image_info.arrayLayers = 1;
+            image_info.samples = VK_SAMPLE_COUNT_1_BIT;
+            image_info.tiling = VK_IMAGE_TILING_OPTIMAL;
+            // (drawn by the render pass or blitted to by the compute path, then copied out)
+            image_info.usage = (
+                VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT |
+                VK_IMAGE_USAGE_TRANSFER_DST_BIT |
+                VK_IMAGE_USAGE_TRANSFER_SRC_BIT
+            );
+            image_info.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            image_info.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        }
+        if (vkCreateImage(renderer->vk_device, &image_info, NULL, &renderer->vk_swapchain_images[i]) != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan offscreen image %u/%u.\n", i+1, renderer->vk_swapchain_images_count);
+            return false;
+        }
+
+        VkMemoryRequirements mem_requirements;
+        vkGetImageMemoryRequirements(renderer->vk_device, renderer->vk_swapchain_images[i], &mem_requirements);
+        bool allocate_ok = gpu_arena_allocate(
+            &renderer->gpu_arena,
+            WO_GPU_MEMORY_IMAGES,
+            &mem_requirements,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            &renderer->offscreen_image_allocations[i]
+        );
+        if (!allocate_ok) {
+            printf("[Wololo] Failed to allocate Vulkan offscreen image %u/%u.\n", i+1, renderer->vk_swapchain_images_count);
+            return false;
+        }
+        vkBindImageMemory(
+            renderer->vk_device,
+            renderer->vk_swapchain_images[i],
+            renderer->offscreen_image_allocations[i].memory,
+            renderer->offscreen_image_allocations[i].offset
+        );
+
+        VkImageViewCreateInfo view_info; {
+            memset(&view_info, 0, sizeof(view_info));
+            view_info.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+            view_info.image = renderer->vk_swapchain_images[i];
+            view_info.viewType = VK_IMAGE_VIEW_TYPE_2D;
+            view_info.format = WO_OFFSCREEN_IMAGE_FORMAT;
+            view_info.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+            view_info.subresourceRange.baseMipLevel = 0;
+            view_info.subresourceRange.levelCount = 1;
+            view_info.subresourceRange.baseArrayLayer = 0;
+            view_info.subresourceRange.layerCount = 1;
+        }
+        if (vkCreateImageView(renderer->vk_device, &view_info, NULL, &renderer->vk_swapchain_image_views[i]) != VK_SUCCESS) {
+            printf("[Wololo] Failed to create Vulkan offscreen image view %u/%u.\n", i+1, renderer->vk_swapchain_images_count);
+            return false;
+        }
+
+        // the readback buffer is read by the CPU, so preferring cached memory where available:
+        bool readback_ok = new_vk_buffer(
+            renderer->vk_device,
+            &renderer->gpu_arena,
+            WO_GPU_MEMORY_STAGING,
+            readback_size,
+            VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+            VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT,
+            &renderer->readback_buffers[i],
+            &renderer->readback_buffer_allocations[i]
+        );
+        if (!readback_ok) {
+            readback_ok = new_vk_buffer(
+                renderer->vk_device,
+                &renderer->gpu_arena,
+                WO_GPU_MEMORY_STAGING,
+                readback_size,
+                VK_BUFFER_USAGE_TRANSFER_DST_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                &renderer->readback_buffers[i],
+                &renderer->readback_buffer_allocations[i]
+            );
+        }
+        if (!readback_ok) {
+            printf("[Wololo] Failed to create Vulkan readback buffer %u/%u.\n", i+1, renderer->vk_swapchain_images_count);
+            return false;
+        }
+    }
+    printf(
+        "[Wololo] Vulkan offscreen images created successfully with extent [%u x %u]\n",
+        renderer->vk_frame_extent.width,
+        renderer->vk_frame_extent.height
+    );
+    return true;
+}
+void vk_destroy_offscreen_targets(Wo_Renderer* renderer) {
+    // destroying the offscreen images and their views, leaving 'vk_destroy_swapchain_image_views'
+    // to free the arrays:
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        if (renderer->vk_swapchain_image_views != NULL && renderer->vk_swapchain_image_views[i] != VK_NULL_HANDLE) {
+            vkDestroyImageView(renderer->vk_device, renderer->vk_swapchain_image_views[i], NULL);
+            renderer->vk_swapchain_image_views[i] = VK_NULL_HANDLE;
+        }
+        if (renderer->vk_swapchain_images != NULL && renderer->vk_swapchain_images[i] != VK_NULL_HANDLE) {
+            vkDestroyImage(renderer->vk_device, renderer->vk_swapchain_images[i], NULL);
+            renderer->vk_swapchain_images[i] = VK_NULL_HANDLE;
+        }
+        gpu_arena_free(&renderer->gpu_arena, &renderer->offscreen_image_allocations[i]);
+        del_vk_buffer(
+            renderer->vk_device, &renderer->gpu_arena,
+            &renderer->readback_buffers[i], &renderer->readback_buffer_allocations[i]
+        );
+    }
+}
+void vk_record_readback(Wo_Renderer* renderer, uint32_t i) {
+    // Copying offscreen image 'i' (left in VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, and made
+    // visible to transfers, by the render pass or the compute path) into readback buffer 'i':
+    VkCommandBuffer command_buffer = renderer->vk_command_buffers[i];
+
+    VkBufferImageCopy region; {
+        memset(&region, 0, sizeof(region));
+        region.bufferOffset = 0;
+        // (tightly packed)
+        region.bufferRowLength = 0;
+        region.bufferImageHeight = 0;
+        region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        region.imageSubresource.mipLevel = 0;
+        region.imageSubresource.baseArrayLayer = 0;
+        region.imageSubresource.layerCount = 1;
+        region.imageExtent.width = renderer->vk_frame_extent.width;
+        region.imageExtent.height = renderer->vk_frame_extent.height;
+        region.imageExtent.depth = 1;
+    }
+    vkCmdCopyImageToBuffer(
+        command_buffer,
+        renderer->vk_swapchain_images[i], VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        renderer->readback_buffers[i],
+        1, &region
+    );
+
+    // making the copy visible to the host once the frame's fence signals:
+    VkBufferMemoryBarrier to_host; {
+        memset(&to_host, 0, sizeof(to_host));
+        to_host.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+        to_host.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        to_host.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        to_host.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_host.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_host.buffer = renderer->readback_buffers[i];
+        to_host.offset = 0;
+        to_host.size = VK_WHOLE_SIZE;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        0, NULL,
+        1, &to_host,
+        0, NULL
+    );
+}
+bool vk_record_command_buffers(Wo_Renderer* renderer) {
+    // Recording the render command buffer (that can be replayed per-frame):
+    // (plasters a quad to the screen; re-recorded whenever the scene buffer changes)
+    // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Command_buffers#page_Starting-command-buffer-recording
+    // recall there is one command buffer per swapchain image.
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        if (!vk_record_command_buffer(renderer, i)) {
+            return false;
+        }
+    }
+    return true;
+}
+bool vk_record_command_buffer(Wo_Renderer* renderer, uint32_t i) {
+    // NOTE: the command buffer must not be in use.
+    {
+        VkCommandBufferBeginInfo begin_info;
+        memset(&begin_info, 0, sizeof(begin_info));
+        begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+        begin_info.flags = 0;
+        begin_info.pInheritanceInfo = NULL;
+
+        VkResult command_buffer_ok = vkBeginCommandBuffer(
+            renderer->vk_command_buffers[i],
+            &begin_info
+        );
+        if (command_buffer_ok != VK_SUCCESS) {
+            printf("[Wololo] Failed to begin recording Vulkan command buffer %u\n", i+1);
+            return false;
+        }
+
+        // timing the frame's passes on the GPU (see 'read_gpu_frame_time'):
+        if (renderer->vk_timestamps_supported) {
+            vkCmdResetQueryPool(
+                renderer->vk_command_buffers[i],
+                renderer->vk_timestamp_query_pool,
+                WO_FRAME_TIMESTAMP_COUNT * i, WO_FRAME_TIMESTAMP_COUNT
+            );
+        }
+        vk_cmd_write_frame_timestamp(renderer, i, FRAME_TIMESTAMP_BEGIN);
+
+        if (renderer->trace_path != WO_TRACE_PATH_FRAGMENT) {
+            vk_record_compute_trace(renderer, i);
+        } else {
+            // beginning the render pass:
+            VkRenderPassBeginInfo render_pass_info;
+            {
+                memset(&render_pass_info, 0, sizeof(render_pass_info));
+                render_pass_info.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+                render_pass_info.renderPass = renderer->vk_render_pass;
+                render_pass_info.framebuffer = renderer->vk_swapchain_framebuffers[i];
+                render_pass_info.renderArea.offset.x = 0;
+                render_pass_info.renderArea.offset.y = 0;
+                render_pass_info.renderArea.extent = renderer->vk_frame_extent;
+
+                // setting the clear color:
+                VkClearValue clear_color;
+                if (WO_DEBUG) {
+                    // offensive magenta, 100% opacity
+                    clear_color.color = (VkClearColorValue) {1.0f, 0.0f, 1.0f, 1.0f};
+                } else {
+                    // black, 100% opacity
+                    clear_color.color = (VkClearColorValue) {0.0f, 0.0f, 0.0f, 1.0f};
+                }
+                render_pass_info.clearValueCount = 1;
+                render_pass_info.pClearValues = &clear_color;
+            }
+            vkCmdBeginRenderPass(
+                renderer->vk_command_buffers[i],
+                &render_pass_info,
+                VK_SUBPASS_CONTENTS_INLINE
+            );
+
+            // drawing:
+            {
+                vkCmdBindPipeline(
+                    renderer->vk_command_buffers[i],
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    get_trace_pipeline(renderer, WO_TRACE_PATH_FRAGMENT)
+                );
+                vkCmdSetViewport(
+                    renderer->vk_command_buffers[i],
+                    0, 1,
+                    &renderer->vk_viewport
+                );
+                VkRect2D scissor; {
+                    scissor.offset.x = 0;
+                    scissor.offset.y = 0;
+                    scissor.extent = renderer->vk_frame_extent;
+                }
+                vkCmdSetScissor(
+                    renderer->vk_command_buffers[i],
+                    0, 1,
+                    &scissor
+                );
+
+                uint32_t ubo_offset = (uint32_t)(i * renderer->uniform_buffer_stride);
+                vkCmdBindDescriptorSets(
+                    renderer->vk_command_buffers[i],
+                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                    renderer->vk_pipeline_layout,
+                    0, 
+                    1, &renderer->vk_descriptor_sets[i],
+                    1, &ubo_offset
+                );
+                vkCmdDraw(
+                    renderer->vk_command_buffers[i],
+                    6,  // vertex count: 3 x 2 for 2 tris
+                    1,  // instance count: 1 means we're not using it.
+                    0,  // first vertex
+                    0   // first instance
+                );
+                vkCmdEndRenderPass(
+                    renderer->vk_command_buffers[i]
+                );
+            }
+            vk_cmd_write_frame_timestamp(renderer, i, FRAME_TIMESTAMP_TRACED);
+            vk_cmd_write_frame_timestamp(renderer, i, FRAME_TIMESTAMP_BLITTED);
+        }
+
+        // copying the frame out for 'read_frame':
+        if (renderer->is_headless) {
+            vk_record_readback(renderer, i);
+        }
+        vk_cmd_write_frame_timestamp(renderer, i, FRAME_TIMESTAMP_END);
+
+        // ending the render pass:
+        if (vkEndCommandBuffer(renderer->vk_command_buffers[i]) != VK_SUCCESS) {
+            printf(
+                "[Wololo] Recording render pass to Vulkan command buffer %u/%u failed.\n", 
+                i+1,
+                renderer->vk_swapchain_images_count
+            );
+            return false;
+        }
+        renderer->vk_command_buffers_stale[i] = false;
+    }
+    return true;
+}
+void vk_cmd_write_frame_timestamp(Wo_Renderer* renderer, uint32_t i, FrameTimestamp timestamp) {
+    // (written once every previous command completed)
+    if (renderer->vk_timestamps_supported) {
+        vkCmdWriteTimestamp(
+            renderer->vk_command_buffers[i],
+            timestamp == FRAME_TIMESTAMP_BEGIN ? VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            renderer->vk_timestamp_query_pool, WO_FRAME_TIMESTAMP_COUNT * i + timestamp
+        );
+    }
+}
+VkExtent2D get_trace_extent(Wo_Renderer* renderer) {
+    // the part of the frame traced by the compute paths at the current render scale:
+    VkExtent2D extent = renderer->vk_frame_extent;
+    if (renderer->trace_path != WO_TRACE_PATH_FRAGMENT && renderer->render_scale < 1.0f) {
+        extent.width = (uint32_t)ceilf((float)extent.width * renderer->render_scale);
+        extent.height = (uint32_t)ceilf((float)extent.height * renderer->render_scale);
+        extent.width = extent.width > 0 ? extent.width : 1;
+        extent.height = extent.height > 0 ? extent.height : 1;
+    }
+    return extent;
+}
+void vk_record_compute_trace(Wo_Renderer* renderer, uint32_t i) {
+    // Tracing into the storage image with the compute pipeline, then blitting it onto
+    // swapchain image 'i' (in place of the fragment path's render pass).
+    VkCommandBuffer command_buffer = renderer->vk_command_buffers[i];
+    VkImage swapchain_image = renderer->vk_swapchain_images[i];
+
+    VkImageSubresourceRange color_range; {
+        memset(&color_range, 0, sizeof(color_range));
+        color_range.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        color_range.baseMipLevel = 0;
+        color_range.levelCount = 1;
+        color_range.baseArrayLayer = 0;
+        color_range.layerCount = 1;
+    }
+
+    // the previous frame's blit must finish reading the trace image before we overwrite it:
+    VkImageMemoryBarrier to_general; {
+        memset(&to_general, 0, sizeof(to_general));
+        to_general.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        to_general.srcAccessMask = 0;
+        to_general.dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        to_general.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        to_general.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        to_general.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_general.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_general.image = renderer->vk_trace_image;
+        to_general.subresourceRange = color_range;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &to_general
+    );
+
+    // ...and the previous frame's samples must be accumulated before we add this frame's:
+    VkImageMemoryBarrier accumulation_barrier; {
+        memset(&accumulation_barrier, 0, sizeof(accumulation_barrier));
+        accumulation_barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        accumulation_barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        accumulation_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+        accumulation_barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        accumulation_barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+        accumulation_barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        accumulation_barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        accumulation_barrier.image = renderer->vk_accumulation_image;
+        accumulation_barrier.subresourceRange = color_range;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &accumulation_barrier
+    );
+
+    // tracing: one invocation per pixel, in WO_TRACE_TILE_SIZE^2 tiles.
+    vkCmdBindPipeline(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        get_trace_pipeline(renderer, renderer->trace_path)
+    );
+    uint32_t ubo_offset = (uint32_t)(i * renderer->uniform_buffer_stride);
+    vkCmdBindDescriptorSets(
+        command_buffer,
+        VK_PIPELINE_BIND_POINT_COMPUTE,
+        renderer->vk_pipeline_layout,
+        0,
+        1, &renderer->vk_descriptor_sets[i],
+        1, &ubo_offset
+    );
+    VkExtent2D trace_extent = get_trace_extent(renderer);
+    vkCmdDispatch(
+        command_buffer,
+        (trace_extent.width + WO_TRACE_TILE_SIZE - 1) / WO_TRACE_TILE_SIZE,
+        (trace_extent.height + WO_TRACE_TILE_SIZE - 1) / WO_TRACE_TILE_SIZE,
+        1
+    );
+
+    // preparing both images for the blit:
+    VkImageMemoryBarrier to_transfer_src; {
+        memset(&to_transfer_src, 0, sizeof(to_transfer_src));
+        to_transfer_src.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        to_transfer_src.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        to_transfer_src.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        to_transfer_src.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+        to_transfer_src.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+        to_transfer_src.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_transfer_src.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_transfer_src.image = renderer->vk_trace_image;
+        to_transfer_src.subresourceRange = color_range;
+    }
+    // ...and making the ray counter visible to the host, read once the frame completes:
+    VkMemoryBarrier to_host_read; {
+        memset(&to_host_read, 0, sizeof(to_host_read));
+        to_host_read.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        to_host_read.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+        to_host_read.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_HOST_BIT,
+        0,
+        1, &to_host_read,
+        0, NULL,
+        1, &to_transfer_src
+    );
+    vk_cmd_write_frame_timestamp(renderer, i, FRAME_TIMESTAMP_TRACED);
+    VkImageMemoryBarrier to_transfer_dst; {
+        memset(&to_transfer_dst, 0, sizeof(to_transfer_dst));
+        to_transfer_dst.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        to_transfer_dst.srcAccessMask = 0;
+        to_transfer_dst.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        to_transfer_dst.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        to_transfer_dst.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        to_transfer_dst.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_transfer_dst.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_transfer_dst.image = swapchain_image;
+        to_transfer_dst.subresourceRange = color_range;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &to_transfer_dst
+    );
+
+    // blitting (rather than copying) converts to the swapchain's format, and upscales the
+    // traced part of the image if the render scale is below 1:
+    bool upscaled = (
+        trace_extent.width != renderer->vk_frame_extent.width ||
+        trace_extent.height != renderer->vk_frame_extent.height
+    );
+    VkImageBlit blit_region; {
+        memset(&blit_region, 0, sizeof(blit_region));
+        blit_region.srcSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+        blit_region.srcSubresource.mipLevel = 0;
+        blit_region.srcSubresource.baseArrayLayer = 0;
+        blit_region.srcSubresource.layerCount = 1;
+        blit_region.srcOffsets[1].x = (int32_t)trace_extent.width;
+        blit_region.srcOffsets[1].y = (int32_t)trace_extent.height;
+        blit_region.srcOffsets[1].z = 1;
+        blit_region.dstSubresource = blit_region.srcSubresource;
+        blit_region.dstOffsets[1].x = (int32_t)renderer->vk_frame_extent.width;
+        blit_region.dstOffsets[1].y = (int32_t)renderer->vk_frame_extent.height;
+        blit_region.dstOffsets[1].z = 1;
+    }
+    vkCmdBlitImage(
+        command_buffer,
+        renderer->vk_trace_image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+        swapchain_image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+        1, &blit_region,
+        upscaled ? VK_FILTER_LINEAR : VK_FILTER_NEAREST
+    );
+
+    // handing the swapchain image over to the presentation engine (or the readback copy):
+    VkImageMemoryBarrier to_present; {
+        memset(&to_present, 0, sizeof(to_present));
+        to_present.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+        to_present.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        to_present.dstAccessMask = renderer->is_headless ? VK_ACCESS_TRANSFER_READ_BIT : 0;
+        to_present.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        to_present.newLayout = renderer->vk_frame_final_layout;
+        to_present.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_present.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        to_present.image = swapchain_image;
+        to_present.subresourceRange = color_range;
+    }
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT,
+        renderer->is_headless ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        1, &to_present
+    );
+    vk_cmd_write_frame_timestamp(renderer, i, FRAME_TIMESTAMP_BLITTED);
+}
+VkCommandBuffer vk_begin_one_time_command_buffer(Wo_Renderer* renderer) {
+    // allocating + beginning a command buffer for setup work outside the frame loop:
+    // submit and free it with 'vk_submit_one_time_command_buffer'.
+    VkCommandBuffer command_buffer = VK_NULL_HANDLE;
+    VkCommandBufferAllocateInfo alloc_info;
+    memset(&alloc_info, 0, sizeof(alloc_info));
+    alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    alloc_info.commandPool = renderer->vk_command_buffer_pool;
+    alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    alloc_info.commandBufferCount = 1;
+    if (vkAllocateCommandBuffers(renderer->vk_device, &alloc_info, &command_buffer) != VK_SUCCESS) {
+        printf("[Wololo] Failed to allocate a one-time Vulkan command buffer.\n");
+        return VK_NULL_HANDLE;
+    }
+
+    VkCommandBufferBeginInfo begin_info;
+    memset(&begin_info, 0, sizeof(begin_info));
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    vkBeginCommandBuffer(command_buffer, &begin_info);
+    return command_buffer;
+}
+bool vk_submit_one_time_command_buffer(Wo_Renderer* renderer, VkCommandBuffer command_buffer) {
+    // submitting on the graphics queue and waiting for the work to finish:
+    bool ok = true;
+    vkEndCommandBuffer(command_buffer);
+
+    VkSubmitInfo submit_info;
+    memset(&submit_info, 0, sizeof(submit_info));
+    submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+    submit_info.commandBufferCount = 1;
+    submit_info.pCommandBuffers = &command_buffer;
+    if (vkQueueSubmit(renderer->vk_graphics_queue, 1, &submit_info, VK_NULL_HANDLE) != VK_SUCCESS) {
+        printf("[Wololo] Failed to submit a one-time Vulkan command buffer.\n");
+        ok = false;
+    } else {
+        vkQueueWaitIdle(renderer->vk_graphics_queue);
+    }
+    vkFreeCommandBuffers(renderer->vk_device, renderer->vk_command_buffer_pool, 1, &command_buffer);
+    return ok;
+}
+bool vk_upload_to_device_local_buffer(Wo_Renderer* renderer, VkBuffer dst_buffer, void const* data, VkDeviceSize size) {
+    renderer->stats.uploaded_bytes += size;
+    // copying 'data' into a host-visible staging buffer, then copying the staging buffer
+    // into 'dst_buffer': on the dedicated transfer queue if there is one, leaving the copy in
+    // flight (see 'vk_submit_transfer_upload'), else on the graphics queue, waiting for it.
+    // see: https://vulkan-tutorial.com/Vertex_buffers/Staging_buffer
+    VkBuffer staging_buffer = VK_NULL_HANDLE;
+    GpuAllocation staging_buffer_allocation;
+    bool staging_ok = new_vk_buffer(
+        renderer->vk_device,
+        &renderer->gpu_arena,
+        WO_GPU_MEMORY_STAGING,
+        size,
+        VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+        VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+        &staging_buffer,
+        &staging_buffer_allocation
+    );
+    if (!staging_ok) {
+        printf("[Wololo] Failed to create a Vulkan staging buffer.\n");
+        return false;
+    }
+    memcpy(staging_buffer_allocation.mapped, data, size);
+
+    // (the pending upload frees the staging buffer once the copy completed)
+    if (renderer->vk_has_dedicated_transfer_queue) {
+        if (vk_submit_transfer_upload(renderer, staging_buffer, &staging_buffer_allocation, dst_buffer, size)) {
+            return true;
+        }
+    }
+
+    // recording + submitting a one-time command buffer:
+    bool ok = false;
+    VkCommandBuffer command_buffer = vk_begin_one_time_command_buffer(renderer);
+    if (command_buffer != VK_NULL_HANDLE) {
+        VkBufferCopy copy_region;
+        memset(&copy_region, 0, sizeof(copy_region));
+        copy_region.size = size;
+        vkCmdCopyBuffer(command_buffer, staging_buffer, dst_buffer, 1, &copy_region);
+        ok = vk_submit_one_time_command_buffer(renderer, command_buffer);
+    }
+
+    del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &staging_buffer, &staging_buffer_allocation);
+    return ok;
+}
+bool vk_submit_transfer_upload(
+    Wo_Renderer* renderer,
+    VkBuffer staging_buffer,
+    GpuAllocation const* staging_buffer_allocation,
+    VkBuffer dst_buffer,
+    VkDeviceSize size
+) {
+    // copying 'staging_buffer' into 'dst_buffer' on the dedicated transfer queue, then handing
+    // 'dst_buffer' over to the graphics queue's family: buffers are exclusive to one family at
+    // a time, so the transfer queue releases it, and a submission on the graphics queue (waiting
+    // on the copy's semaphore) acquires it, ahead of any frame reading it. Neither is waited
+    // for: the upload stays pending until 'vk_retire_pending_uploads' sees its fence signaled.
+    // (the transfer queue needs no acquisition first: the buffer's previous contents are discarded)
+    // see: https://registry.khronos.org/vulkan/specs/1.3/html/chap7.html#synchronization-queue-transfers
+    // Returns false, leaving 'staging_buffer' to the caller, if the upload could not be submitted.
+    vk_retire_pending_uploads(renderer, WO_MAX_PENDING_UPLOAD_COUNT - 1);
+    uint32_t const upload_index = (renderer->first_pending_upload + renderer->pending_upload_count) % WO_MAX_PENDING_UPLOAD_COUNT;
+    PendingUpload* upload = &renderer->pending_uploads[upload_index];
+    memset(upload, 0, sizeof(PendingUpload));
+
+    bool ok = true;
+    {
+        VkCommandBufferAllocateInfo alloc_info;
+        memset(&alloc_info, 0, sizeof(alloc_info));
+        alloc_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        alloc_info.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+        alloc_info.commandBufferCount = 1;
+        alloc_info.commandPool = renderer->vk_transfer_command_pool;
+        ok = ok && (vkAllocateCommandBuffers(renderer->vk_device, &alloc_info, &upload->transfer_command_buffer) == VK_SUCCESS);
+        alloc_info.commandPool = renderer->vk_command_buffer_pool;
+        ok = ok && (vkAllocateCommandBuffers(renderer->vk_device, &alloc_info, &upload->acquire_command_buffer) == VK_SUCCESS);
+
+        VkSemaphoreCreateInfo semaphore_info;
+        memset(&semaphore_info, 0, sizeof(semaphore_info));
+        semaphore_info.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        ok = ok && (vkCreateSemaphore(renderer->vk_device, &semaphore_info, NULL, &upload->transfer_semaphore) == VK_SUCCESS);
+
+        VkFenceCreateInfo fence_info;
+        memset(&fence_info, 0, sizeof(fence_info));
+        fence_info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+        ok = ok && (vkCreateFence(renderer->vk_device, &fence_info, NULL, &upload->acquire_fence) == VK_SUCCESS);
+    }
+
+    // the stages and accesses of everything reading (or patching) the scene buffers afterwards:
+    VkPipelineStageFlags const dst_stages = (
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+        VK_PIPELINE_STAGE_TRANSFER_BIT |
+        (renderer->vk_ray_query_supported ? VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR : 0)
+    );
+    VkBufferMemoryBarrier ownership_barrier;
+    memset(&ownership_barrier, 0, sizeof(ownership_barrier));
+    ownership_barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+    ownership_barrier.srcQueueFamilyIndex = renderer->vk_transfer_queue_family_index;
+    ownership_barrier.dstQueueFamilyIndex = renderer->vk_graphics_queue_family_index;
+    ownership_barrier.buffer = dst_buffer;
+    ownership_barrier.offset = 0;
+    ownership_barrier.size = VK_WHOLE_SIZE;
+
+    VkCommandBufferBeginInfo begin_info;
+    memset(&begin_info, 0, sizeof(begin_info));
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (ok) {
+        // recording the copy and the release:
+        VkCommandBuffer command_buffer = upload->transfer_command_buffer;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        VkBufferCopy copy_region;
+        memset(&copy_region, 0, sizeof(copy_region));
+        copy_region.size = size;
+        vkCmdCopyBuffer(command_buffer, staging_buffer, dst_buffer, 1, &copy_region);
+        ownership_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        ownership_barrier.dstAccessMask = 0;
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            0,
+            0, NULL,
+            1, &ownership_barrier,
+            0, NULL
+        );
+        ok = (vkEndCommandBuffer(command_buffer) == VK_SUCCESS);
+    }
+    if (ok) {
+        // recording the acquisition:
+        VkCommandBuffer command_buffer = upload->acquire_command_buffer;
+        vkBeginCommandBuffer(command_buffer, &begin_info);
+        ownership_barrier.srcAccessMask = 0;
+        ownership_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT;
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, dst_stages,
+            0,
+            0, NULL,
+            1, &ownership_barrier,
+            0, NULL
+        );
+        ok = (vkEndCommandBuffer(command_buffer) == VK_SUCCESS);
+    }
+    if (ok) {
+        VkSubmitInfo submit_info;
+        memset(&submit_info, 0, sizeof(submit_info));
+        submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+        submit_info.commandBufferCount = 1;
+        submit_info.pCommandBuffers = &upload->transfer_command_buffer;
+        submit_info.signalSemaphoreCount = 1;
+        submit_info.pSignalSemaphores = &upload->transfer_semaphore;
+        ok = (vkQueueSubmit(renderer->vk_transfer_queue, 1, &submit_info, VK_NULL_HANDLE) == VK_SUCCESS);
+        if (ok) {
+            memset(&submit_info, 0, sizeof(submit_info));
+            submit_info.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+            submit_info.waitSemaphoreCount = 1;
+            submit_info.pWaitSemaphores = &upload->transfer_semaphore;
+            submit_info.pWaitDstStageMask = &dst_stages;
+            submit_info.commandBufferCount = 1;
+            submit_info.pCommandBuffers = &upload->acquire_command_buffer;
+            if (vkQueueSubmit(renderer->vk_graphics_queue, 1, &submit_info, upload->acquire_fence) != VK_SUCCESS) {
+                // (the copy may still be running: the caller copies again on the graphics queue)
+                vkQueueWaitIdle(renderer->vk_transfer_queue);
+                ok = false;
+            }
+        }
+    }
+    if (!ok) {
+        printf("[Wololo] Failed to submit an upload on the Vulkan transfer queue; uploading on the graphics queue.\n");
+        vk_free_pending_upload(renderer, upload);
+        return false;
+    }
+
+    upload->staging_buffer = staging_buffer;
+    upload->staging_buffer_allocation = *staging_buffer_allocation;
+    renderer->pending_upload_count++;
+    return true;
+}
+void vk_retire_pending_uploads(Wo_Renderer* renderer, uint32_t max_pending_count) {
+    // freeing the pending uploads whose acquisitions completed, oldest first (they complete in
+    // order, on the graphics queue), waiting for as many more as it takes to leave at most
+    // 'max_pending_count' pending:
+    while (renderer->pending_upload_count > 0) {
+        PendingUpload* upload = &renderer->pending_uploads[renderer->first_pending_upload];
+        if (renderer->pending_upload_count > max_pending_count) {
+            vkWaitForFences(renderer->vk_device, 1, &upload->acquire_fence, VK_TRUE, UINT64_MAX);
+        } else if (vkGetFenceStatus(renderer->vk_device, upload->acquire_fence) != VK_SUCCESS) {
+            break;
+        }
+        vk_free_pending_upload(renderer, upload);
+        renderer->first_pending_upload = (renderer->first_pending_upload + 1) % WO_MAX_PENDING_UPLOAD_COUNT;
+        renderer->pending_upload_count--;
+    }
+}
+void vk_free_pending_upload(Wo_Renderer* renderer, PendingUpload* upload) {
+    // NOTE: the caller must ensure the upload is no longer in use.
+    if (upload->transfer_command_buffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(renderer->vk_device, renderer->vk_transfer_command_pool, 1, &upload->transfer_command_buffer);
+    }
+    if (upload->acquire_command_buffer != VK_NULL_HANDLE) {
+        vkFreeCommandBuffers(renderer->vk_device, renderer->vk_command_buffer_pool, 1, &upload->acquire_command_buffer);
+    }
+    if (upload->transfer_semaphore != VK_NULL_HANDLE) {
+        vkDestroySemaphore(renderer->vk_device, upload->transfer_semaphore, NULL);
+    }
+    if (upload->acquire_fence != VK_NULL_HANDLE) {
+        vkDestroyFence(renderer->vk_device, upload->acquire_fence, NULL);
+    }
+    del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &upload->staging_buffer, &upload->staging_buffer_allocation);
+    memset(upload, 0, sizeof(PendingUpload));
+}
+bool vk_replace_storage_buffer(
+    Wo_Renderer* renderer,
+    uint32_t binding,
+    VkBufferUsageFlags extra_usage,
+    VkBuffer* buffer_p,
+    GpuAllocation* buffer_allocation_p,
+    VkDeviceSize* buffer_size_p,
+    VkDeviceSize* buffer_capacity_p,
+    void const* data,
+    VkDeviceSize size
+) {
+    // NOTE: the caller must ensure the old buffer is no longer in use.
+
+    // the buffer grows geometrically, so a scene growing commit by commit (e.g. while it is
+    // imported) reuses it rather than re-allocating it every time, and shrinks once mostly unused:
+    bool fits = (
+        *buffer_p != VK_NULL_HANDLE &&
+        size <= *buffer_capacity_p &&
+        size >= *buffer_capacity_p / 4
+    );
+    if (!fits) {
+        VkDeviceSize capacity = size;
+        if (*buffer_p != VK_NULL_HANDLE && size > *buffer_capacity_p) {
+            capacity = MAX(size, *buffer_capacity_p + *buffer_capacity_p / 2);
+        }
+        del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, buffer_p, buffer_allocation_p);
+        *buffer_size_p = 0;
+        *buffer_capacity_p = 0;
+        bool buffer_ok = new_vk_buffer(
+            renderer->vk_device,
+            &renderer->gpu_arena,
+            WO_GPU_MEMORY_SCENE,
+            capacity,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT | extra_usage,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            buffer_p,
+            buffer_allocation_p
+        );
+        if (!buffer_ok) {
+            return false;
+        }
+        *buffer_capacity_p = capacity;
+    }
+    *buffer_size_p = size;
+    if (!vk_upload_to_device_local_buffer(renderer, *buffer_p, data, size)) {
+        return false;
+    }
+
+    vk_write_storage_buffer_descriptors(renderer, binding, *buffer_p, size);
+    return true;
+}
+VkDeviceAddress vk_buffer_device_address(Wo_Renderer* renderer, VkBuffer buffer) {
+    VkBufferDeviceAddressInfo address_info;
+    memset(&address_info, 0, sizeof(address_info));
+    address_info.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    address_info.buffer = buffer;
+    return renderer->vk_get_buffer_device_address(renderer->vk_device, &address_info);
+}
+void vk_destroy_scene_acceleration_structures(Wo_Renderer* renderer) {
+    // NOTE: the caller must ensure the acceleration structures are no longer in use.
+    if (renderer->scene_tlas != VK_NULL_HANDLE) {
+        renderer->vk_destroy_acceleration_structure(renderer->vk_device, renderer->scene_tlas, NULL);
+        renderer->scene_tlas = VK_NULL_HANDLE;
+    }
+    if (renderer->scene_blas != VK_NULL_HANDLE) {
+        renderer->vk_destroy_acceleration_structure(renderer->vk_device, renderer->scene_blas, NULL);
+        renderer->scene_blas = VK_NULL_HANDLE;
+    }
+    VkBuffer* buffers[4] = {
+        &renderer->scene_tlas_buffer,
+        &renderer->scene_tlas_instance_buffer,
+        &renderer->scene_blas_buffer,
+        &renderer->scene_as_scratch_buffer
+    };
+    GpuAllocation* buffer_allocations[4] = {
+        &renderer->scene_tlas_buffer_allocation,
+        &renderer->scene_tlas_instance_buffer_allocation,
+        &renderer->scene_blas_buffer_allocation,
+        &renderer->scene_as_scratch_buffer_allocation
+    };
+    for (int i = 0; i < 4; i++) {
+        del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, buffers[i], buffer_allocations[i]);
+    }
+}
+void vk_get_scene_as_build_info(
+    Wo_Renderer* renderer,
+    int level,
+    VkAccelerationStructureGeometryKHR* out_geometry,
+    VkAccelerationStructureBuildGeometryInfoKHR* out_build_info,
+    uint32_t* out_primitive_count
+) {
+    // describing the build of the BLAS (level 0) or the TLAS (level 1) over their current
+    // inputs, without scratch space or a destination.
+    memset(out_geometry, 0, sizeof(VkAccelerationStructureGeometryKHR));
+    out_geometry->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_KHR;
+    if (level == 0) {
+        // (an empty scene builds an empty, but valid, BLAS)
+        out_geometry->geometryType = VK_GEOMETRY_TYPE_AABBS_KHR;
+        out_geometry->geometry.aabbs.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_AABBS_DATA_KHR;
+        out_geometry->geometry.aabbs.data.deviceAddress = vk_buffer_device_address(
+            renderer,
+            renderer->scene_component_aabb_buffer
+        );
+        out_geometry->geometry.aabbs.stride = sizeof(GpuComponentAabb);
+        // each component's first hit is found once, so its candidates must be reported once:
+        out_geometry->flags = VK_GEOMETRY_NO_DUPLICATE_ANY_HIT_INVOCATION_BIT_KHR;
+        *out_primitive_count = renderer->scene_blas_primitive_count;
+    } else {
+        out_geometry->geometryType = VK_GEOMETRY_TYPE_INSTANCES_KHR;
+        out_geometry->geometry.instances.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_GEOMETRY_INSTANCES_DATA_KHR;
+        out_geometry->geometry.instances.arrayOfPointers = VK_FALSE;
+        if (renderer->scene_tlas_instance_buffer != VK_NULL_HANDLE) {
+            out_geometry->geometry.instances.data.deviceAddress = vk_buffer_device_address(
+                renderer,
+                renderer->scene_tlas_instance_buffer
+            );
+        }
+        *out_primitive_count = 1;
+    }
+
+    memset(out_build_info, 0, sizeof(VkAccelerationStructureBuildGeometryInfoKHR));
+    out_build_info->sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_GEOMETRY_INFO_KHR;
+    out_build_info->type = (
+        level == 0 ?
+        VK_ACCELERATION_STRUCTURE_TYPE_BOTTOM_LEVEL_KHR :
+        VK_ACCELERATION_STRUCTURE_TYPE_TOP_LEVEL_KHR
+    );
+    out_build_info->flags = VK_BUILD_ACCELERATION_STRUCTURE_PREFER_FAST_TRACE_BIT_KHR;
+    out_build_info->mode = VK_BUILD_ACCELERATION_STRUCTURE_MODE_BUILD_KHR;
+    out_build_info->geometryCount = 1;
+    out_build_info->pGeometries = out_geometry;
+}
+void vk_cmd_build_scene_acceleration_structures(Wo_Renderer* renderer, VkCommandBuffer command_buffer) {
+    // recording the (re)build of the BLAS, then of the TLAS that reads it, in place:
+    // both share the scratch buffer, so each build must finish before the next starts.
+    // NOTE: the caller must order the writes to the component AABBs before these builds.
+    VkAccelerationStructureKHR structures[2] = {renderer->scene_blas, renderer->scene_tlas};
+    for (int level = 0; level < 2; level++) {
+        VkAccelerationStructureGeometryKHR geometry;
+        VkAccelerationStructureBuildGeometryInfoKHR build_info;
+        VkAccelerationStructureBuildRangeInfoKHR range;
+        memset(&range, 0, sizeof(range));
+        vk_get_scene_as_build_info(renderer, level, &geometry, &build_info, &range.primitiveCount);
+        build_info.dstAccelerationStructure = structures[level];
+        build_info.scratchData.deviceAddress = vk_buffer_device_address(renderer, renderer->scene_as_scratch_buffer);
+
+        VkAccelerationStructureBuildRangeInfoKHR const* range_p = &range;
+        renderer->vk_cmd_build_acceleration_structures(command_buffer, 1, &build_info, &range_p);
+
+        VkMemoryBarrier barrier;
+        memset(&barrier, 0, sizeof(barrier));
+        barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        barrier.srcAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+        barrier.dstAccessMask = VK_ACCESS_ACCELERATION_STRUCTURE_READ_BIT_KHR | VK_ACCESS_ACCELERATION_STRUCTURE_WRITE_BIT_KHR;
+        vkCmdPipelineBarrier(
+            command_buffer,
+            VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR,
+            (
+                level == 0 ?
+                VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR :
+                VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT
+            ),
+            0,
+            1, &barrier,
+            0, NULL,
+            0, NULL
+        );
+    }
+}
+bool vk_build_scene_acceleration_structures(Wo_Renderer* renderer, uint32_t aabb_count) {
+    // creating a BLAS over the 'aabb_count' component AABBs in 'scene_component_aabb_buffer'
+    // and a TLAS holding one instance of it, building both, then binding the TLAS to every
+    // descriptor set.
+    // Both can later be rebuilt in place, as long as 'aabb_count' is unchanged.
+    // NOTE: the caller must ensure the old acceleration structures are no longer in use.
+    // see: https://www.khronos.org/blog/ray-tracing-in-vulkan
+    vk_destroy_scene_acceleration_structures(renderer);
+    renderer->scene_blas_primitive_count = aabb_count;
+
+    VkAccelerationStructureKHR* structures[2] = {&renderer->scene_blas, &renderer->scene_tlas};
+    VkBuffer* structure_buffers[2] = {&renderer->scene_blas_buffer, &renderer->scene_tlas_buffer};
+    GpuAllocation* structure_buffer_allocations[2] = {&renderer->scene_blas_buffer_allocation, &renderer->scene_tlas_buffer_allocation};
+    VkDeviceSize scratch_size = 1;
+    for (int level = 0; level < 2; level++) {
+        if (level == 1) {
+            // instancing the BLAS once, untransformed: (the scene is already in world space)
+            VkAccelerationStructureDeviceAddressInfoKHR blas_address_info;
+            memset(&blas_address_info, 0, sizeof(blas_address_info));
+            blas_address_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_DEVICE_ADDRESS_INFO_KHR;
+            blas_address_info.accelerationStructure = renderer->scene_blas;
+
+            VkAccelerationStructureInstanceKHR instance;
+            memset(&instance, 0, sizeof(instance));
+            instance.transform.matrix[0][0] = 1.0f;
+            instance.transform.matrix[1][1] = 1.0f;
+            instance.transform.matrix[2][2] = 1.0f;
+            instance.instanceCustomIndex = 0;
+            instance.mask = 0xFF;
+            instance.instanceShaderBindingTableRecordOffset = 0;
+            instance.flags = 0;
+            instance.accelerationStructureReference = renderer->vk_get_acceleration_structure_device_address(
+                renderer->vk_device,
+                &blas_address_info
+            );
+
+            bool instance_buffer_ok = new_vk_buffer(
+                renderer->vk_device,
+                &renderer->gpu_arena,
+                WO_GPU_MEMORY_SCENE,
+                sizeof(instance),
+                VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+                VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                &renderer->scene_tlas_instance_buffer,
+                &renderer->scene_tlas_instance_buffer_allocation
+            );
+            if (!instance_buffer_ok) {
+                printf("[Wololo] Failed to create the Vulkan TLAS instance buffer.\n");
+                vk_destroy_scene_acceleration_structures(renderer);
+                return false;
+            }
+            memcpy(renderer->scene_tlas_instance_buffer_allocation.mapped, &instance, sizeof(instance));
+        }
+
+        // sizing the acceleration structure + its scratch space:
+        VkAccelerationStructureGeometryKHR geometry;
+        VkAccelerationStructureBuildGeometryInfoKHR build_info;
+        uint32_t primitive_count;
+        vk_get_scene_as_build_info(renderer, level, &geometry, &build_info, &primitive_count);
+        VkAccelerationStructureBuildSizesInfoKHR build_sizes; {
+            memset(&build_sizes, 0, sizeof(build_sizes));
+            build_sizes.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_BUILD_SIZES_INFO_KHR;
+        }
+        renderer->vk_get_acceleration_structure_build_sizes(
+            renderer->vk_device,
+            VK_ACCELERATION_STRUCTURE_BUILD_TYPE_DEVICE_KHR,
+            &build_info,
+            &primitive_count,
+            &build_sizes
+        );
+        if (scratch_size < build_sizes.buildScratchSize) {
+            scratch_size = build_sizes.buildScratchSize;
+        }
+
+        // creating the acceleration structure:
+        bool structure_buffer_ok = new_vk_buffer(
+            renderer->vk_device,
+            &renderer->gpu_arena,
+            WO_GPU_MEMORY_SCENE,
+            build_sizes.accelerationStructureSize,
+            VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_STORAGE_BIT_KHR | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+            VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+            structure_buffers[level],
+            structure_buffer_allocations[level]
+        );
+        if (!structure_buffer_ok) {
+            vk_destroy_scene_acceleration_structures(renderer);
+            return false;
+        }
+        VkAccelerationStructureCreateInfoKHR create_info; {
+            memset(&create_info, 0, sizeof(create_info));
+            create_info.sType = VK_STRUCTURE_TYPE_ACCELERATION_STRUCTURE_CREATE_INFO_KHR;
+            create_info.buffer = *structure_buffers[level];
+            create_info.offset = 0;
+            create_info.size = build_sizes.accelerationStructureSize;
+            create_info.type = build_info.type;
+        }
+        if (renderer->vk_create_acceleration_structure(renderer->vk_device, &create_info, NULL, structures[level]) != VK_SUCCESS) {
+            printf("[Wololo] Failed to create a Vulkan acceleration structure.\n");
+            vk_destroy_scene_acceleration_structures(renderer);
+            return false;
+        }
+    }
+
+    // building both, with scratch space kept for later rebuilds:
+    bool ok = new_vk_buffer(
+        renderer->vk_device,
+        &renderer->gpu_arena,
+        WO_GPU_MEMORY_SCENE,
+        scratch_size,
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT,
+        VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+        &renderer->scene_as_scratch_buffer,
+        &renderer->scene_as_scratch_buffer_allocation
+    );
+    if (!ok) {
+        vk_destroy_scene_acceleration_structures(renderer);
+        return false;
+    }
+    ok = false;
+    VkCommandBuffer command_buffer = vk_begin_one_time_command_buffer(renderer);
+    if (command_buffer != VK_NULL_HANDLE) {
+        vk_cmd_build_scene_acceleration_structures(renderer, command_buffer);
+        ok = vk_submit_one_time_command_buffer(renderer, command_buffer);
+    }
+    if (!ok) {
+        vk_destroy_scene_acceleration_structures(renderer);
+        return false;
+    }
+
+    vk_write_tlas_descriptors(renderer);
+    return true;
+}
+bool commit_scene(Wo_Renderer* renderer) {
+    assert(!renderer->scene_build_in_progress && "[Wololo] Cannot commit a scene mid-build: end the build instead.");
+    // flattening the node tables into the GPU layout:
+    FlatScene flat_scene;
+    bool flatten_ok = flatten_scene(
+        &renderer->node_store,
+        renderer->current_node_count,
+        &flat_scene
+    );
+    if (!flatten_ok) {
+        printf("[Wololo] Failed to flatten the scene of renderer \"%s\".\n", renderer->name);
+        return false;
+    }
+    uint32_t unoptimized_gpu_node_count = flat_scene.node_count;
+#if WO_OPTIMIZE_SCENES
+    // pruning, deduplicating and rebalancing subtrees before checking the stack depth, which
+    // pruning may reduce: (if out of memory, the unoptimized scene is committed)
+    SceneOptimizeStats optimize_stats;
+    optimize_flat_scene(&flat_scene, &optimize_stats);
+#endif
+    if (flat_scene.stack_depth > WO_CSG_STACK_CAPACITY) {
+        // keeping the last committed scene rather than retrying this every frame:
+        printf(
+            "[Wololo] Cannot commit scene of renderer \"%s\": evaluating it requires a CSG stack of depth %u "
+            "(tree height %u), but the ubershader only supports %d.\n",
+            renderer->name,
+            flat_scene.stack_depth,
+            flat_scene.tree_height,
+            WO_CSG_STACK_CAPACITY
+        );
+        free_flat_scene(&flat_scene);
+        renderer->scene_needs_commit = false;
+        return false;
+    }
+
+    // bounding the flattened nodes, building the BVH over them:
+    SceneAccel scene_accel;
+    double bvh_build_start_sec = get_renderer_time_sec(renderer);
+    if (!build_scene_accel(&flat_scene, &scene_accel)) {
+        printf("[Wololo] Failed to build the BVH of renderer \"%s\".\n", renderer->name);
+        free_flat_scene(&flat_scene);
+        return false;
+    }
+    record_bvh_rebuild_time(renderer, get_renderer_time_sec(renderer) - bvh_build_start_sec);
+
+    // (the AABB buffer is never empty, so it can always be bound)
+    uint32_t component_aabb_count = scene_accel.bounded_component_count;
+    size_t scene_gpu_size = flat_scene_gpu_size_in_bytes(&flat_scene);
+    size_t accel_gpu_size = scene_accel_gpu_size_in_bytes(&scene_accel);
+    size_t component_aabbs_gpu_size = sizeof(GpuComponentAabb) * (component_aabb_count > 0 ? component_aabb_count : 1);
+    void* scene_gpu_data = malloc(scene_gpu_size);
+    void* accel_gpu_data = malloc(accel_gpu_size);
+    GpuComponentAabb* component_aabbs_gpu_data = calloc(component_aabbs_gpu_size, 1);
+    uint64_t* flat_dirty_bitset = calloc(flat_scene.node_count/64 + 1, sizeof(uint64_t));
+    if (scene_gpu_data == NULL || accel_gpu_data == NULL || component_aabbs_gpu_data == NULL || flat_dirty_bitset == NULL) {
+        printf(
+            "[Wololo] Failed to allocate %zu bytes for the scene upload.\n",
+            scene_gpu_size + accel_gpu_size + component_aabbs_gpu_size
+        );
+        free(scene_gpu_data);
+        free(accel_gpu_data);
+        free(component_aabbs_gpu_data);
+        free(flat_dirty_bitset);
+        free_scene_accel(&scene_accel);
+        free_flat_scene(&flat_scene);
+        return false;
+    }
+    flat_scene_write_gpu_layout(&flat_scene, scene_gpu_data);
+    scene_accel_write_gpu_layout(&scene_accel, accel_gpu_data);
+    scene_accel_write_component_aabbs(&scene_accel, component_aabbs_gpu_data);
+    renderer->scene_gpu_node_count = flat_scene.node_count;
+    renderer->scene_unoptimized_gpu_node_count = unoptimized_gpu_node_count;
+    renderer->scene_prototype_count = flat_scene.prototype_count;
+    renderer->scene_instance_count = flat_scene.instance_count;
+    renderer->scene_node_type_mask = flat_scene.node_type_mask;
+    renderer->scene_stack_depth = flat_scene.stack_depth;
+    renderer->scene_bvh_node_count = scene_accel.bvh_node_count;
+    renderer->scene_bounded_component_count = scene_accel.bounded_component_count;
+    renderer->scene_unbounded_component_count = scene_accel.unbounded_component_count;
+    renderer->is_committed_scene_prebuilt = false;
+    uint32_t scene_tree_height = flat_scene.tree_height;
+
+    // keeping CPU copies of what is uploaded, so moved nodes can be patched into them:
+    // (this subsumes any pending incremental update)
+    free_flat_scene(&renderer->committed_flat_scene);
+    free_scene_accel(&renderer->committed_scene_accel);
+    renderer->committed_scene_accel = scene_accel;
+    free(renderer->committed_flat_dirty_bitset);
+    free(renderer->committed_accel_gpu_data);
+    free(renderer->committed_component_aabbs);
+    renderer->committed_flat_scene = flat_scene;
+    renderer->committed_flat_dirty_bitset = flat_dirty_bitset;
+    renderer->committed_accel_gpu_data = accel_gpu_data;
+    renderer->committed_accel_gpu_size = accel_gpu_size;
+    renderer->committed_component_aabbs = component_aabbs_gpu_data;
+    renderer->committed_component_aabb_count = component_aabb_count;
+    clear_dirty_nodes(renderer);
+    renderer->scene_has_dirty_nodes = false;
+
+    bool upload_ok = upload_scene(
+        renderer,
+        scene_gpu_data, scene_gpu_size,
+        accel_gpu_data, accel_gpu_size,
+        component_aabbs_gpu_data, component_aabb_count
+    );
+    free(scene_gpu_data);
+    if (!upload_ok) {
+        return false;
+    }
+
+    printf(
+        "[Wololo] Committed scene of renderer \"%s\": %zu nodes -> %u GPU nodes (%u before optimizing; %zu bytes, height %u, CSG stack depth %u), "
+        "%u BVH nodes + %u unbounded components (%zu bytes).\n",
+        renderer->name,
+        renderer->current_node_count,
+        renderer->scene_gpu_node_count,
+        renderer->scene_unoptimized_gpu_node_count,
+        scene_gpu_size,
+        scene_tree_height,
+        renderer->scene_stack_depth,
+        renderer->scene_bvh_node_count,
+        renderer->scene_unbounded_component_count,
+        accel_gpu_size
+    );
+    renderer->scene_needs_commit = false;
+    return true;
+}
+bool upload_scene(
+    Wo_Renderer* renderer,
+    void const* scene_gpu_data, size_t scene_gpu_size,
+    void const* accel_gpu_data, size_t accel_gpu_size,
+    GpuComponentAabb const* component_aabbs_gpu_data, uint32_t component_aabb_count
+) {
+    // uploading a flattened scene's GPU buffers (and the materials), rebinding them: shared by
+    // commits and scenes loaded prebuilt (see 'load_scene_mmap').
+    size_t component_aabbs_gpu_size = sizeof(GpuComponentAabb) * (component_aabb_count > 0 ? component_aabb_count : 1);
+
+    // the scene buffers and the command buffers reading them may still be in use:
+    vkDeviceWaitIdle(renderer->vk_device);
+
+    bool upload_ok = (
+        vk_replace_storage_buffer(
+            renderer, 1, 0,
+            &renderer->scene_buffer, &renderer->scene_buffer_allocation,
+            &renderer->scene_buffer_size, &renderer->scene_buffer_capacity,
+            scene_gpu_data, scene_gpu_size
+        ) &&
+        vk_replace_storage_buffer(
+            renderer, 2, 0,
+            &renderer->scene_accel_buffer, &renderer->scene_accel_buffer_allocation,
+            &renderer->scene_accel_buffer_size, &renderer->scene_accel_buffer_capacity,
+            accel_gpu_data, accel_gpu_size
+        ) &&
+        vk_replace_storage_buffer(
+            renderer, 7, 0,
+            &renderer->material_buffer, &renderer->material_buffer_allocation,
+            &renderer->material_buffer_size, &renderer->material_buffer_capacity,
+            renderer->materials, sizeof(GpuMaterial) * renderer->material_count
+        )
+    );
+    if (!upload_ok) {
+        printf("[Wololo] Failed to upload the scene of renderer \"%s\".\n", renderer->name);
+        return false;
+    }
+
+    // rebuilding the hardware acceleration structures, falling back to the software BVH if
+    // that fails:
+    if (renderer->vk_ray_query_pipeline_ok) {
+        bool rebuild_ok = (
+            vk_replace_storage_buffer(
+                renderer, 5,
+                VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT | VK_BUFFER_USAGE_ACCELERATION_STRUCTURE_BUILD_INPUT_READ_ONLY_BIT_KHR,
+                &renderer->scene_component_aabb_buffer,
+                &renderer->scene_component_aabb_buffer_allocation,
+                &renderer->scene_component_aabb_buffer_size,
+                &renderer->scene_component_aabb_buffer_capacity,
+                component_aabbs_gpu_data, component_aabbs_gpu_size
+            ) &&
+            vk_build_scene_acceleration_structures(renderer, component_aabb_count)
+        );
+        if (!rebuild_ok) {
+            printf("[Wololo] Failed to build the acceleration structures of renderer \"%s\".\n", renderer->name);
+            renderer->vk_ray_query_pipeline_ok = false;
+            if (renderer->trace_path == WO_TRACE_PATH_RAY_QUERY) {
+                renderer->trace_path = WO_TRACE_PATH_COMPUTE;
+            }
+        }
+    }
+
+    // updating descriptor sets invalidates the command buffers they are bound in:
+    return vk_record_command_buffers(renderer);
+}
+bool help_stage_dirty_records(
+    uint8_t* staging_segment,
+    VkDeviceSize staging_segment_offset,
+    VkDeviceSize* staging_used_p,
+    void const* src_records,
+    uint32_t record_count,
+    VkDeviceSize record_size,
+    uint64_t const* dirty_bitset,
+    VkDeviceSize dst_offset,
+    VkBufferCopy* regions,
+    uint32_t* region_count_p
+) {
+    // copying each run of consecutive dirty records into the staging segment, adding one
+    // copy region (to 'dst_offset + index * record_size') per run.
+    // Returns false if the staging segment is full.
+    uint8_t const* src = src_records;
+    uint32_t i = 0;
+    while (i < record_count) {
+        if (dirty_bitset[i/64] == 0) {
+            i = (i/64 + 1) * 64;
+            continue;
+        }
+        if (!(dirty_bitset[i/64] & (((uint64_t)1) << (i%64)))) {
+            i++;
+            continue;
+        }
+        uint32_t run_start = i;
+        while (i < record_count && (dirty_bitset[i/64] & (((uint64_t)1) << (i%64)))) {
+            i++;
+        }
+        VkDeviceSize run_size = (i - run_start) * record_size;
+        if (*staging_used_p + run_size > WO_UPDATE_STAGING_BYTES_PER_FRAME) {
+            return false;
+        }
+        memcpy(staging_segment + *staging_used_p, src + run_start * record_size, run_size);
+
+        VkBufferCopy* region = &regions[(*region_count_p)++];
+        region->srcOffset = staging_segment_offset + *staging_used_p;
+        region->dstOffset = dst_offset + run_start * record_size;
+        region->size = run_size;
+        *staging_used_p += run_size;
+    }
+    return true;
+}
+void help_diff_records(
+    void const* old_records,
+    void const* new_records,
+    uint32_t record_count,
+    size_t record_size,
+    uint64_t* out_dirty_bitset
+) {
+    uint8_t const* old_bytes = old_records;
+    uint8_t const* new_bytes = new_records;
+    for (uint32_t i = 0; i < record_count; i++) {
+        if (0 != memcmp(old_bytes + i*record_size, new_bytes + i*record_size, record_size)) {
+            out_dirty_bitset[i/64] |= ((uint64_t)1) << (i%64);
+        }
+    }
+}
+bool update_scene(Wo_Renderer* renderer) {
+    // Patching the transforms of moved nodes into the committed scene, then recording copies
+    // of only the records that changed into this frame's update command buffer.
+    // Returns true if the update command buffer was recorded, and must be submitted before
+    // this frame's drawing; sets 'scene_needs_commit' instead if the update cannot be patched in.
+    // NOTE: the caller must have waited on this frame's fence: this frame's staging segment
+    //       and update command buffer are reused.
+    if (!renderer->scene_has_dirty_nodes) {
+        return false;
+    }
+    renderer->scene_has_dirty_nodes = false;
+    if (renderer->committed_flat_dirty_bitset == NULL) {
+        // no scene was ever committed (the next commit flattens the moved nodes anyway), or it
+        // was loaded prebuilt, without the CPU copies to patch:
+        clear_dirty_nodes(renderer);
+        if (renderer->is_committed_scene_prebuilt) {
+            renderer->scene_needs_commit = true;
+        }
+        return false;
+    }
+    FlatScene* flat_scene = &renderer->committed_flat_scene;
+    uint32_t const flat_word_count = flat_scene->node_count/64 + 1;
+    memset(renderer->committed_flat_dirty_bitset, 0, flat_word_count * sizeof(uint64_t));
+
+    // patching the flattened scene:
+    bool moved_optimized_node = false;
+    for (size_t word_node = 0; word_node < renderer->current_node_count; word_node += 64) {
+        uint64_t* dirty_word = node_dirty_word(&renderer->node_store, (Wo_Node)word_node);
+        uint64_t word = *dirty_word;
+        *dirty_word = 0;
+        for (uint32_t bit = 0; word != 0; bit++, word >>= 1) {
+            if (word & 1) {
+                if (flat_scene_source_is_optimized(flat_scene, (Wo_Node)(word_node + bit))) {
+                    // (its rewrites may not hold once it moves)
+                    moved_optimized_node = true;
+                    continue;
+                }
+                // (nodes not part of the committed scene are unreachable: nothing to patch)
+                flat_scene_refresh_operand_transforms(
+                    flat_scene,
+                    &renderer->node_store,
+                    (Wo_Node)(word_node + bit),
+                    renderer->committed_flat_dirty_bitset
+                );
+            }
+        }
+    }
+    if (moved_optimized_node) {
+        renderer->scene_needs_commit = true;
+        return false;
+    }
+    // (moving a node moves its whole subtree: their GPU records are re-composed and uploaded too)
+    flat_scene_compose_world_transforms(flat_scene, renderer->committed_flat_dirty_bitset);
+
+    // re-bounding the scene: refitting the BVH to the moved nodes, or rebuilding it if that
+    // would degrade it too much. Only the records that changed are uploaded.
+    SceneAccel* scene_accel = &renderer->committed_scene_accel;
+    double bvh_refit_start_sec = get_renderer_time_sec(renderer);
+    bool refit_ok = refit_scene_accel(flat_scene, renderer->committed_flat_dirty_bitset, scene_accel);
+    record_bvh_refit_time(renderer, get_renderer_time_sec(renderer) - bvh_refit_start_sec);
+    if (!refit_ok) {
+        double bvh_build_start_sec = get_renderer_time_sec(renderer);
+        SceneAccel rebuilt_scene_accel;
+        if (!build_scene_accel(flat_scene, &rebuilt_scene_accel)) {
+            renderer->scene_needs_commit = true;
+            return false;
+        }
+        free_scene_accel(scene_accel);
+        *scene_accel = rebuilt_scene_accel;
+        record_bvh_rebuild_time(renderer, get_renderer_time_sec(renderer) - bvh_build_start_sec);
+    }
+    size_t accel_gpu_size = scene_accel_gpu_size_in_bytes(scene_accel);
+    if (
+        accel_gpu_size != renderer->committed_accel_gpu_size ||
+        scene_accel->bounded_component_count != renderer->committed_component_aabb_count
+    ) {
+        // e.g. a component moved out of (or into) an intersection: the BVH changed shape.
+        renderer->scene_needs_commit = true;
+        return false;
+    }
+    uint32_t const accel_record_count = (uint32_t)((accel_gpu_size - sizeof(GpuSceneAccelHeader)) / sizeof(GpuBvhNode));
+    uint32_t const aabb_count = renderer->committed_component_aabb_count;
+    void* accel_gpu_data = malloc(accel_gpu_size);
+    GpuComponentAabb* component_aabbs = malloc(sizeof(GpuComponentAabb) * (aabb_count > 0 ? aabb_count : 1));
+    uint64_t* accel_dirty_bitset = calloc(accel_record_count/64 + 1, sizeof(uint64_t));
+    uint64_t* aabb_dirty_bitset = calloc(aabb_count/64 + 1, sizeof(uint64_t));
+    // one region per run at most, i.e. per dirty record:
+    uint32_t const max_region_count = flat_scene->node_count + accel_record_count + aabb_count;
+    VkBufferCopy* regions = malloc(sizeof(VkBufferCopy) * (max_region_count > 0 ? max_region_count : 1));
+    bool ok = (
+        accel_gpu_data != NULL &&
+        component_aabbs != NULL &&
+        accel_dirty_bitset != NULL &&
+        aabb_dirty_bitset != NULL &&
+        regions != NULL
+    );
+    if (ok) {
+        scene_accel_write_gpu_layout(scene_accel, accel_gpu_data);
+        scene_accel_write_component_aabbs(scene_accel, component_aabbs);
+
+        // (the header is unchanged: same node, BVH node and component counts)
+        help_diff_records(
+            (uint8_t*)renderer->committed_accel_gpu_data + sizeof(GpuSceneAccelHeader),
+            (uint8_t*)accel_gpu_data + sizeof(GpuSceneAccelHeader),
+            accel_record_count, sizeof(GpuBvhNode),
+            accel_dirty_bitset
+        );
+        help_diff_records(
+            renderer->committed_component_aabbs,
+            component_aabbs,
+            aabb_count, sizeof(GpuComponentAabb),
+            aabb_dirty_bitset
+        );
+    }
+
+    // staging the dirty records of each buffer:
+    size_t const frame_index = renderer->current_frame_index;
+    VkDeviceSize const segment_offset = (VkDeviceSize)frame_index * WO_UPDATE_STAGING_BYTES_PER_FRAME;
+    uint8_t* const segment = renderer->update_staging_buffer_allocation.mapped + segment_offset;
+    VkDeviceSize staging_used = 0;
+    uint32_t scene_region_count = 0;
+    uint32_t accel_region_count = 0;
+    uint32_t aabb_region_count = 0;
+    bool const update_aabbs = renderer->vk_ray_query_pipeline_ok;
+    ok = ok && help_stage_dirty_records(
+        segment, segment_offset, &staging_used,
+        flat_scene->nodes, flat_scene->node_count, sizeof(GpuSceneNode),
+        renderer->committed_flat_dirty_bitset,
+        sizeof(GpuSceneHeader),
+        regions, &scene_region_count
+    );
+    ok = ok && help_stage_dirty_records(
+        segment, segment_offset, &staging_used,
+        (uint8_t*)accel_gpu_data + sizeof(GpuSceneAccelHeader), accel_record_count, sizeof(GpuBvhNode),
+        accel_dirty_bitset,
+        sizeof(GpuSceneAccelHeader),
+        regions + scene_region_count, &accel_region_count
+    );
+    if (update_aabbs) {
+        ok = ok && help_stage_dirty_records(
+            segment, segment_offset, &staging_used,
+            component_aabbs, aabb_count, sizeof(GpuComponentAabb),
+            aabb_dirty_bitset,
+            0,
+            regions + scene_region_count + accel_region_count, &aabb_region_count
+        );
+    }
+    free(accel_dirty_bitset);
+    free(aabb_dirty_bitset);
+    if (!ok) {
+        // out of memory or staging space: re-uploading everything instead.
+        free(accel_gpu_data);
+        free(component_aabbs);
+        free(regions);
+        renderer->scene_needs_commit = true;
+        return false;
+    }
+
+    // the new records are now what the GPU holds:
+    free(renderer->committed_accel_gpu_data);
+    renderer->committed_accel_gpu_data = accel_gpu_data;
+    free(renderer->committed_component_aabbs);
+    renderer->committed_component_aabbs = component_aabbs;
+    if (scene_region_count + accel_region_count + aabb_region_count == 0) {
+        free(regions);
+        return false;
+    }
+
+    // recording the copies:
+    // (the previous frame may still be tracing the buffers on this queue, so the copies wait
+    // on its reads first, and this frame's reads wait on the copies)
+    VkCommandBuffer command_buffer = renderer->vk_update_command_buffers[frame_index];
+    VkCommandBufferBeginInfo begin_info;
+    memset(&begin_info, 0, sizeof(begin_info));
+    begin_info.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    begin_info.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    if (vkBeginCommandBuffer(command_buffer, &begin_info) != VK_SUCCESS) {
+        printf("[Wololo] Failed to begin recording a Vulkan update command buffer.\n");
+        free(regions);
+        renderer->scene_needs_commit = true;
+        return false;
+    }
+    uint32_t const first_upload_timestamp = WO_UPLOAD_TIMESTAMP_COUNT * (uint32_t)frame_index;
+    if (renderer->vk_timestamps_supported) {
+        vkCmdResetQueryPool(command_buffer, renderer->vk_upload_timestamp_query_pool, first_upload_timestamp, WO_UPLOAD_TIMESTAMP_COUNT);
+        vkCmdWriteTimestamp(
+            command_buffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT,
+            renderer->vk_upload_timestamp_query_pool, first_upload_timestamp
+        );
+    }
+    VkPipelineStageFlags const reader_stages = (
+        VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT |
+        VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT |
+        (update_aabbs ? VK_PIPELINE_STAGE_ACCELERATION_STRUCTURE_BUILD_BIT_KHR : 0)
+    );
+    vkCmdPipelineBarrier(
+        command_buffer,
+        reader_stages, VK_PIPELINE_STAGE_TRANSFER_BIT,
+        0,
+        0, NULL,
+        0, NULL,
+        0, NULL
+    );
+    if (scene_region_count > 0) {
+        vkCmdCopyBuffer(
+            command_buffer,
+            renderer->update_staging_buffer, renderer->scene_buffer,
+            scene_region_count, regions
+        );
+    }
+    if (accel_region_count > 0) {
+        vkCmdCopyBuffer(
+            command_buffer,
+            renderer->update_staging_buffer, renderer->scene_accel_buffer,
+            accel_region_count, regions + scene_region_count
+        );
+    }
+    if (aabb_region_count > 0) {
+        vkCmdCopyBuffer(
+            command_buffer,
+            renderer->update_staging_buffer, renderer->scene_component_aabb_buffer,
+            aabb_region_count, regions + scene_region_count + accel_region_count
+        );
+    }
+    VkMemoryBarrier copied_barrier;
+    memset(&copied_barrier, 0, sizeof(copied_barrier));
+    copied_barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    copied_barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    copied_barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    vkCmdPipelineBarrier(
+        command_buffer,
+        VK_PIPELINE_STAGE_TRANSFER_BIT, reader_stages,
+        0,
+        1, &copied_barrier,
+        0, NULL,
+        0, NULL
+    );
+
+    // moved components must also be moved in the hardware acceleration structures:
+    if (aabb_region_count > 0) {
+        vk_cmd_build_scene_acceleration_structures(renderer, command_buffer);
+    }
+    if (renderer->vk_timestamps_supported) {
+        vkCmdWriteTimestamp(
+            command_buffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT,
+            renderer->vk_upload_timestamp_query_pool, first_upload_timestamp + 1
+        );
+    }
+    renderer->stats.uploaded_bytes += staging_used;
+    free(regions);
+    if (vkEndCommandBuffer(command_buffer) != VK_SUCCESS) {
+        printf("[Wololo] Failed to record a Vulkan update command buffer.\n");
+        renderer->scene_needs_commit = true;
+        return false;
+    }
+    return true;
+}
+void record_bvh_refit_time(Wo_Renderer* renderer, double time_sec) {
+    renderer->stats.bvh_refit_count++;
+    renderer->stats.bvh_refit_last_time_sec = time_sec;
+    renderer->stats.bvh_refit_total_time_sec += time_sec;
+}
+void record_bvh_rebuild_time(Wo_Renderer* renderer, double time_sec) {
+    renderer->stats.bvh_rebuild_count++;
+    renderer->stats.bvh_rebuild_last_time_sec = time_sec;
+    renderer->stats.bvh_rebuild_total_time_sec += time_sec;
+}
+bool set_node_argument(Wo_Renderer* renderer, Wo_Node node, Wo_Node_Side side, Wo_Node_Argument arg) {
+    NodeType type = (node < renderer->current_node_count ? *node_type(&renderer->node_store, node) : WO_NODE_FREE);
+    if (type == WO_NODE_FREE || node_type_is_leaf(type)) {
+        // (removed nodes are rejected too: their slots are on the free-list)
+        printf("[Wololo] Cannot set an argument of node %u: not a binop.\n", node);
+        return false;
+    }
+    NodeInfo* info = node_info(&renderer->node_store, node);
+    Wo_Node_Argument* operand = (
+        side == WO_NODE_SIDE_LEFT ?
+        &info->binop_of.left :
+        &info->binop_of.right
+    );
+    if (operand->node != arg.node) {
+        // re-parenting would change the scene's shape (and what is a root):
+        printf("[Wololo] Cannot set an argument of node %u: its operand cannot be replaced.\n", node);
+        return false;
+    }
+    *operand = arg;
+    *node_dirty_word(&renderer->node_store, node) |= node_bit(node);
+    renderer->scene_has_dirty_nodes = true;
+    return true;
+}
+bool set_trace_path(Wo_Renderer* renderer, Wo_Trace_Path trace_path) {
+    if (trace_path == WO_TRACE_PATH_COMPUTE && !renderer->vk_compute_pipeline_ok) {
+        printf("[Wololo] Compute trace path unsupported on this device, keeping the current path.\n");
+        return false;
+    }
+    if (trace_path == WO_TRACE_PATH_RAY_QUERY && (!renderer->vk_ray_query_pipeline_ok || renderer->scene_tlas == VK_NULL_HANDLE)) {
+        printf("[Wololo] Ray query trace path unsupported on this device, keeping the current path.\n");
+        return false;
+    }
+    if (trace_path != WO_TRACE_PATH_FRAGMENT && !renderer->vk_swapchain_supports_blit_dst) {
+        printf("[Wololo] The Vulkan swapchain cannot be blitted onto by the compute trace paths, keeping the current path.\n");
+        return false;
+    }
+    if (renderer->trace_path == trace_path) {
+        return true;
+    }
+
+    // the command buffers are pre-recorded per path, so re-recording them once idle:
+    vkDeviceWaitIdle(renderer->vk_device);
+    renderer->trace_path = trace_path;
+    renderer->accumulated_sample_count = 0;
+    return vk_record_command_buffers(renderer);
+}
+bool set_progressive(Wo_Renderer* renderer, bool progressive) {
+    if (progressive && !renderer->vk_compute_pipeline_ok) {
+        printf("[Wololo] Progressive mode needs the compute trace path, unsupported on this device.\n");
+        return false;
+    }
+    if (progressive && renderer->trace_path == WO_TRACE_PATH_FRAGMENT) {
+        printf("[Wololo] Progressive mode only accumulates on the compute trace paths.\n");
+    }
+    renderer->is_progressive = progressive;
+    renderer->accumulated_sample_count = 0;
+    return true;
+}
+bool set_frame_region(Wo_Renderer* renderer, uint32_t full_width, uint32_t full_height, uint32_t x, uint32_t y) {
+    // (windowed renderers' frames follow their window's size, so only headless ones have regions)
+    if (!renderer->is_headless) {
+        printf("[Wololo] Only headless renderers draw regions of a larger frame.\n");
+        return false;
+    }
+    VkExtent2D const extent = renderer->vk_frame_extent;
+    if ((uint64_t)x + extent.width > full_width || (uint64_t)y + extent.height > full_height) {
+        printf(
+            "[Wololo] Renderer \"%s\" cannot draw its %u x %u frames at (%u, %u) of a %u x %u frame.\n",
+            renderer->name, extent.width, extent.height, x, y, full_width, full_height
+        );
+        return false;
+    }
+    renderer->has_frame_region = (x != 0 || y != 0 || full_width != extent.width || full_height != extent.height);
+    renderer->frame_region_full_width = full_width;
+    renderer->frame_region_full_height = full_height;
+    renderer->frame_region_x = x;
+    renderer->frame_region_y = y;
+    renderer->accumulated_sample_count = 0;
+    return true;
+}
+void help_fit_ray_budget(Wo_Renderer* renderer, uint32_t* out_max_bounce_count, uint32_t* out_samples_per_pixel) {
+    // a path of 'b' bounces traces at most 'b + 1' rays, so the budget covers either several
+    // full-length paths per pixel, or one shortened path (but always at least the primary ray):
+    uint32_t max_bounce_count = renderer->path_trace_max_bounce_count;
+    uint32_t samples_per_pixel = 1;
+    VkExtent2D trace_extent = get_trace_extent(renderer);
+    uint64_t pixel_count = (uint64_t)trace_extent.width * trace_extent.height;
+    if (renderer->path_trace_ray_budget_per_frame > 0 && pixel_count > 0) {
+        uint64_t rays_per_pixel = renderer->path_trace_ray_budget_per_frame / pixel_count;
+        if (rays_per_pixel < (uint64_t)max_bounce_count + 1) {
+            max_bounce_count = rays_per_pixel > 0 ? (uint32_t)(rays_per_pixel - 1) : 0;
+        } else {
+            uint64_t path_count = rays_per_pixel / ((uint64_t)max_bounce_count + 1);
+            samples_per_pixel = (uint32_t)(path_count < WO_MAX_SAMPLES_PER_PIXEL ? path_count : WO_MAX_SAMPLES_PER_PIXEL);
+        }
+    }
+    *out_max_bounce_count = max_bounce_count;
+    *out_samples_per_pixel = samples_per_pixel;
+}
+void read_gpu_frame_time(Wo_Renderer* renderer, uint32_t image_index) {
+    // NOTE: the last frame drawn with this image must have completed.
+    if (!renderer->vk_timestamps_supported || !renderer->vk_timestamps_written[image_index]) {
+        return;
+    }
+    renderer->vk_timestamps_written[image_index] = false;
+    uint64_t timestamps[WO_FRAME_TIMESTAMP_COUNT];
+    VkResult query_ok = vkGetQueryPoolResults(
+        renderer->vk_device,
+        renderer->vk_timestamp_query_pool,
+        WO_FRAME_TIMESTAMP_COUNT * image_index, WO_FRAME_TIMESTAMP_COUNT,
+        sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT
+    );
+    if (query_ok != VK_SUCCESS || timestamps[FRAME_TIMESTAMP_END] < timestamps[FRAME_TIMESTAMP_BEGIN]) {
+        return;
+    }
+    double to_sec = renderer->vk_timestamp_period_ns * 1e-9;
+    double gpu_frame_time_sec = (double)(timestamps[FRAME_TIMESTAMP_END] - timestamps[FRAME_TIMESTAMP_BEGIN]) * to_sec;
+    record_timing(&renderer->gpu_frame_timing, gpu_frame_time_sec);
+    record_timing(&renderer->gpu_trace_timing, (double)(timestamps[FRAME_TIMESTAMP_TRACED] - timestamps[FRAME_TIMESTAMP_BEGIN]) * to_sec);
+    record_timing(&renderer->gpu_blit_timing, (double)(timestamps[FRAME_TIMESTAMP_BLITTED] - timestamps[FRAME_TIMESTAMP_TRACED]) * to_sec);
+    if (renderer->is_headless) {
+        record_timing(&renderer->gpu_readback_timing, (double)(timestamps[FRAME_TIMESTAMP_END] - timestamps[FRAME_TIMESTAMP_BLITTED]) * to_sec);
+    }
+    update_render_scale(renderer, gpu_frame_time_sec);
+}
+void read_gpu_upload_time(Wo_Renderer* renderer, uint32_t frame_index) {
+    // NOTE: the last frame drawn at this index must have completed.
+    if (!renderer->vk_timestamps_supported || !renderer->upload_timestamps_written[frame_index]) {
+        return;
+    }
+    renderer->upload_timestamps_written[frame_index] = false;
+    uint64_t timestamps[WO_UPLOAD_TIMESTAMP_COUNT];
+    VkResult query_ok = vkGetQueryPoolResults(
+        renderer->vk_device,
+        renderer->vk_upload_timestamp_query_pool,
+        WO_UPLOAD_TIMESTAMP_COUNT * frame_index, WO_UPLOAD_TIMESTAMP_COUNT,
+        sizeof(timestamps), timestamps, sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT
+    );
+    if (query_ok != VK_SUCCESS || timestamps[1] < timestamps[0]) {
+        return;
+    }
+    record_timing(&renderer->gpu_upload_timing, (double)(timestamps[1] - timestamps[0]) * renderer->vk_timestamp_period_ns * 1e-9);
+}
+void update_render_scale(Wo_Renderer* renderer, double gpu_frame_time_sec) {
+    if (renderer->frame_time_target_sec <= 0 || renderer->trace_path == WO_TRACE_PATH_FRAGMENT) {
+        return;
+    }
+    renderer->gpu_frame_time_smoothed_sec = (
+        renderer->frames_since_render_scale_change == 0 ?
+        gpu_frame_time_sec :
+        0.9 * renderer->gpu_frame_time_smoothed_sec + 0.1 * gpu_frame_time_sec
+    );
+    renderer->frames_since_render_scale_change++;
+    if (renderer->frames_since_render_scale_change < WO_RENDER_SCALE_SETTLE_FRAMES) {
+        return;
+    }
+
+    // tracing cost is about proportional to the traced pixel count, i.e. to the scale squared,
+    // so the scale that would just meet the target is:
+    double target_sec = renderer->frame_time_target_sec;
+    double smoothed_sec = renderer->gpu_frame_time_smoothed_sec;
+    float scale = renderer->render_scale;
+    float ideal_scale = scale * (float)sqrt(target_sec / (smoothed_sec > 1e-6 ? smoothed_sec : 1e-6));
+    float ideal_step_scale = floorf(ideal_scale * WO_RENDER_SCALE_STEPS) / WO_RENDER_SCALE_STEPS;
+    float step = 1.0f / WO_RENDER_SCALE_STEPS;
+
+    // lowering the scale as soon as the target is missed, but raising it (a step at a time)
+    // only once well under the target, so the scale does not oscillate around it:
+    float new_scale = scale;
+    if (smoothed_sec > target_sec) {
+        new_scale = ideal_step_scale < scale - step ? ideal_step_scale : scale - step;
+    } else if (smoothed_sec < 0.8 * target_sec && ideal_step_scale > scale) {
+        new_scale = scale + step;
+    }
+    if (new_scale < WO_RENDERER_MIN_RENDER_SCALE) {
+        new_scale = WO_RENDERER_MIN_RENDER_SCALE;
+    }
+    if (new_scale > 1.0f) {
+        new_scale = 1.0f;
+    }
+    if (new_scale != scale) {
+        set_render_scale(renderer, new_scale);
+    }
+}
+void set_render_scale(Wo_Renderer* renderer, float render_scale) {
+    renderer->render_scale = render_scale;
+    renderer->frames_since_render_scale_change = 0;
+    // (the accumulated samples were traced at another resolution)
+    renderer->accumulated_sample_count = 0;
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        renderer->vk_command_buffers_stale[i] = true;
+    }
+
+    // keeping the most recent scales, oldest first:
+    Wo_Renderer_Stats* stats = &renderer->stats;
+    if (stats->render_scale_history_count == WO_RENDERER_RENDER_SCALE_HISTORY_LENGTH) {
+        memmove(
+            &stats->render_scale_history[0], &stats->render_scale_history[1],
+            sizeof(float) * (WO_RENDERER_RENDER_SCALE_HISTORY_LENGTH - 1)
+        );
+        stats->render_scale_history_count--;
+    }
+    stats->render_scale_history[stats->render_scale_history_count++] = render_scale;
+    stats->render_scale = render_scale;
+    stats->render_scale_change_count++;
+}
+bool set_frame_time_target(Wo_Renderer* renderer, double target_frame_time_sec) {
+    if (target_frame_time_sec > 0 && (!renderer->vk_compute_pipeline_ok || !renderer->vk_timestamps_supported)) {
+        printf("[Wololo] Adaptive resolution needs the compute trace path and GPU timestamps, unsupported on this device.\n");
+        return false;
+    }
+    renderer->frame_time_target_sec = target_frame_time_sec > 0 ? target_frame_time_sec : 0;
+    renderer->frames_since_render_scale_change = 0;
+    if (renderer->frame_time_target_sec == 0 && renderer->render_scale != 1.0f) {
+        set_render_scale(renderer, 1.0f);
+    }
+    return true;
+}
+void get_stats(Wo_Renderer* renderer, Wo_Renderer_Stats* out_stats) {
+    *out_stats = renderer->stats;
+    for (int category = 0; category < WO_GPU_MEMORY_CATEGORY_COUNT; category++) {
+        out_stats->gpu_memory_in_use_bytes[category] = renderer->gpu_arena.in_use_bytes[category];
+        out_stats->gpu_memory_reserved_bytes[category] = renderer->gpu_arena.reserved_bytes[category];
+        out_stats->gpu_memory_allocation_count[category] = renderer->gpu_arena.allocation_count[category];
+    }
+    out_stats->gpu_memory_block_count = gpu_arena_block_count(&renderer->gpu_arena);
+
+    get_timing(&renderer->gpu_frame_timing, &out_stats->gpu_frame_time);
+    get_timing(&renderer->gpu_trace_timing, &out_stats->gpu_trace_time);
+    get_timing(&renderer->gpu_blit_timing, &out_stats->gpu_blit_time);
+    get_timing(&renderer->gpu_readback_timing, &out_stats->gpu_readback_time);
+    get_timing(&renderer->gpu_upload_timing, &out_stats->gpu_upload_time);
+    get_timing(&renderer->cpu_submit_timing, &out_stats->cpu_submit_time);
+    get_timing(&renderer->pipeline_variant_compile_timing, &out_stats->pipeline_variant_compile_time);
+    out_stats->pipeline_variant_count = renderer->pipeline_variant_count;
+
+    out_stats->node_count = (uint32_t)(renderer->current_node_count - renderer->free_node_count);
+    out_stats->free_node_count = (uint32_t)renderer->free_node_count;
+    out_stats->node_capacity = (uint32_t)(
+        node_store_size_in_bytes(&renderer->node_store) / sizeof(NodeChunk) * WO_NODE_CHUNK_SIZE
+    );
+    out_stats->gpu_node_count = renderer->scene_gpu_node_count;
+    out_stats->unoptimized_gpu_node_count = renderer->scene_unoptimized_gpu_node_count;
+    out_stats->prototype_count = renderer->scene_prototype_count;
+    out_stats->instance_count = renderer->scene_instance_count;
+    out_stats->bvh_node_count = renderer->scene_bvh_node_count;
+    out_stats->bounded_component_count = renderer->scene_bounded_component_count;
+    out_stats->unbounded_component_count = renderer->scene_unbounded_component_count;
+}
+bool set_path_tracing(Wo_Renderer* renderer, bool path_tracing, uint32_t max_bounce_count, uint64_t ray_budget_per_frame) {
+    if (path_tracing && !renderer->vk_compute_pipeline_ok) {
+        printf("[Wololo] Path tracing needs the compute trace path, unsupported on this device.\n");
+        return false;
+    }
+    if (max_bounce_count > WO_RENDERER_MAX_BOUNCE_COUNT) {
+        printf(
+            "[Wololo] Renderer \"%s\" cannot trace paths of %u bounces, using %d.\n",
+            renderer->name, max_bounce_count, WO_RENDERER_MAX_BOUNCE_COUNT
+        );
+        max_bounce_count = WO_RENDERER_MAX_BOUNCE_COUNT;
+    }
+    PipelineVariantKey old_key;
+    get_pipeline_variant_key(renderer, renderer->trace_path, &old_key);
+    renderer->is_path_tracing = path_tracing;
+    renderer->path_trace_max_bounce_count = max_bounce_count;
+    renderer->path_trace_ray_budget_per_frame = ray_budget_per_frame;
+    renderer->accumulated_sample_count = 0;
+
+    // the compute paths' pipelines are specialized to the max bounce count:
+    PipelineVariantKey new_key;
+    get_pipeline_variant_key(renderer, renderer->trace_path, &new_key);
+    if (memcmp(&old_key, &new_key, sizeof(PipelineVariantKey)) != 0) {
+        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+            renderer->vk_command_buffers_stale[i] = true;
+        }
+    }
+    return true;
+}
+void get_pipeline_variant_key(Wo_Renderer* renderer, Wo_Trace_Path trace_path, PipelineVariantKey* out_key) {
+    memset(out_key, 0, sizeof(PipelineVariantKey));
+    out_key->node_type_mask = renderer->scene_node_type_mask;
+    out_key->csg_stack_capacity = 1;
+    while (out_key->csg_stack_capacity < renderer->scene_stack_depth && out_key->csg_stack_capacity < WO_CSG_STACK_CAPACITY) {
+        out_key->csg_stack_capacity *= 2;
+    }
+    // (only the path tracer reads it)
+    out_key->max_bounce_count = (
+        trace_path != WO_TRACE_PATH_FRAGMENT && renderer->is_path_tracing ?
+        renderer->path_trace_max_bounce_count :
+        WO_RENDERER_MAX_BOUNCE_COUNT
+    );
+    out_key->debug_view = (uint32_t)renderer->debug_view;
+}
+VkPipeline get_trace_pipeline(Wo_Renderer* renderer, Wo_Trace_Path trace_path) {
+    // Returns the pipeline specialized for the committed scene on 'trace_path', starting its
+    // compilation the first time its key is drawn, or the generic pipeline until it's compiled
+    // (or if there is none).
+    VkPipeline generic_pipeline = VK_NULL_HANDLE;
+    switch (trace_path) {
+        case WO_TRACE_PATH_FRAGMENT: {
+            generic_pipeline = renderer->vk_graphics_pipeline;
+        } break;
+        case WO_TRACE_PATH_COMPUTE: {
+            generic_pipeline = renderer->vk_compute_pipeline;
+        } break;
+        case WO_TRACE_PATH_RAY_QUERY: {
+            generic_pipeline = renderer->vk_ray_query_pipeline;
+        } break;
+    }
+
+    PipelineVariantKey key;
+    get_pipeline_variant_key(renderer, trace_path, &key);
+    PipelineVariantKey generic_key; {
+        memset(&generic_key, 0, sizeof(generic_key));
+        generic_key.node_type_mask = WO_ALL_NODE_TYPES_MASK;
+        generic_key.csg_stack_capacity = WO_CSG_STACK_CAPACITY;
+        generic_key.max_bounce_count = WO_RENDERER_MAX_BOUNCE_COUNT;
+        generic_key.debug_view = WO_DEBUG_VIEW_NONE;
+    }
+    // (an empty scene only draws the background, which isn't worth compiling a variant for)
+    bool is_empty_scene = renderer->scene_node_type_mask == 0 && key.debug_view == WO_DEBUG_VIEW_NONE;
+    if (is_empty_scene || 0 == memcmp(&key, &generic_key, sizeof(PipelineVariantKey))) {
+        return generic_pipeline;
+    }
+
+    for (uint32_t i = 0; i < renderer->pipeline_variant_count; i++) {
+        PipelineVariant const* variant = &renderer->pipeline_variants[i];
+        if (variant->trace_path == trace_path && 0 == memcmp(&variant->key, &key, sizeof(PipelineVariantKey))) {
+            renderer->stats.pipeline_variant_hit_count++;
+            if (i == renderer->compiling_pipeline_variant_index) {
+                return generic_pipeline;
+            }
+            return variant->pipeline != VK_NULL_HANDLE ? variant->pipeline : generic_pipeline;
+        }
+    }
+    if (renderer->pipeline_variant_count == WO_MAX_PIPELINE_VARIANT_COUNT) {
+        return generic_pipeline;
+    }
+    // variants compile one at a time: any other requested meanwhile is requested again when the
+    // command buffers are re-recorded for the one compiling.
+    if (renderer->compiling_pipeline_variant_index < WO_MAX_PIPELINE_VARIANT_COUNT) {
+        return generic_pipeline;
+    }
+
+    // compiling the variant on the pipeline worker, drawing with the generic pipeline until it's
+    // done (see 'draw_frame_with_renderer'):
+    uint32_t variant_index = renderer->pipeline_variant_count++;
+    PipelineVariant* variant = &renderer->pipeline_variants[variant_index];
+    variant->key = key;
+    variant->trace_path = trace_path;
+    variant->pipeline = VK_NULL_HANDLE;
+    variant->compile_time_sec = 0.0;
+    renderer->compiling_pipeline_variant_index = variant_index;
+    vk_start_pipeline_worker(renderer);
+    if (renderer->vk_pipeline_worker_running) {
+        return generic_pipeline;
+    }
+    // (compiled in-line)
+    finish_pipeline_variant_compile(renderer);
+    return variant->pipeline != VK_NULL_HANDLE ? variant->pipeline : generic_pipeline;
+}
+void vk_compile_pipeline_variant(Wo_Renderer* renderer, PipelineVariant* variant) {
+    // NOTE: runs on the pipeline worker, so only reads what the pipelines are created from.
+    VkShaderModule compute_shader_module = (
+        variant->trace_path == WO_TRACE_PATH_RAY_QUERY ?
+        renderer->vk_rq_comp_shader_module :
+        renderer->vk_comp_shader_module
+    );
+
+    // (the key is laid out as the specialization data)
+    VkSpecializationMapEntry map_entries[WO_PIPELINE_VARIANT_CONSTANT_COUNT];
+    for (uint32_t i = 0; i < WO_PIPELINE_VARIANT_CONSTANT_COUNT; i++) {
+        map_entries[i].constantID = i;
+        map_entries[i].offset = i * sizeof(uint32_t);
+        map_entries[i].size = sizeof(uint32_t);
+    }
+    VkSpecializationInfo specialization; {
+        specialization.mapEntryCount = WO_PIPELINE_VARIANT_CONSTANT_COUNT;
+        specialization.pMapEntries = map_entries;
+        specialization.dataSize = sizeof(PipelineVariantKey);
+        specialization.pData = &variant->key;
+    }
+    double compile_start_sec = get_renderer_time_sec(renderer);
+    VkPipeline pipeline = VK_NULL_HANDLE;
+    bool compile_ok = (
+        variant->trace_path == WO_TRACE_PATH_FRAGMENT ?
+        vk_create_specialized_graphics_pipeline(renderer, &specialization, &pipeline) :
+        vk_create_specialized_compute_pipeline(renderer, compute_shader_module, &specialization, &pipeline)
+    );
+    variant->compile_time_sec = get_renderer_time_sec(renderer) - compile_start_sec;
+    variant->pipeline = compile_ok ? pipeline : VK_NULL_HANDLE;
+}
+void finish_pipeline_variant_compile(Wo_Renderer* renderer) {
+    // NOTE: the pipeline worker must have been joined (or the variant compiled in-line).
+    // The pipeline cache is only saved at teardown, rather than after every variant.
+    uint32_t variant_index = renderer->compiling_pipeline_variant_index;
+    PipelineVariant const* variant = &renderer->pipeline_variants[variant_index];
+    renderer->compiling_pipeline_variant_index = WO_MAX_PIPELINE_VARIANT_COUNT;
+
+    record_timing(&renderer->pipeline_variant_compile_timing, variant->compile_time_sec);
+    if (variant->pipeline == VK_NULL_HANDLE) {
+        printf("[Wololo] Failed to compile a pipeline variant of renderer \"%s\", using the generic pipeline.\n", renderer->name);
+    } else {
+        printf(
+            "[Wololo] Compiled pipeline variant %u of renderer \"%s\" (trace path %d, node types 0x%x, CSG stack %u, "
+            "%u bounces, debug view %u) in %.3lf sec.\n",
+            variant_index + 1,
+            renderer->name,
+            (int)variant->trace_path,
+            variant->key.node_type_mask,
+            variant->key.csg_stack_capacity,
+            variant->key.max_bounce_count,
+            variant->key.debug_view,
+            variant->compile_time_sec
+        );
+    }
+}
+void set_debug_view(Wo_Renderer* renderer, Wo_Debug_View debug_view) {
+    if (renderer->debug_view == debug_view) {
+        return;
+    }
+    renderer->debug_view = debug_view;
+    renderer->accumulated_sample_count = 0;
+    // (re-recorded with the debug view's pipelines before each image is next drawn)
+    for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+        renderer->vk_command_buffers_stale[i] = true;
+    }
+}
+void read_ray_counter(Wo_Renderer* renderer, uint32_t image_index) {
+    // NOTE: the last frame drawn with this image must have completed.
+    uint32_t* counter = (uint32_t*)(
+        renderer->ray_counter_buffer_allocation.mapped + image_index * renderer->ray_counter_stride
+    );
+    renderer->stats.traced_ray_count += *counter;
+    renderer->ray_rate_window_ray_count += *counter;
+    *counter = 0;
+
+    double now_sec = get_renderer_time_sec(renderer);
+    double window_sec = now_sec - renderer->ray_rate_window_start_sec;
+    if (window_sec >= 1.0) {
+        renderer->stats.traced_rays_per_sec = (double)renderer->ray_rate_window_ray_count / window_sec;
+        renderer->ray_rate_window_ray_count = 0;
+        renderer->ray_rate_window_start_sec = now_sec;
+    }
+}
+void del_renderer(Wo_Renderer* renderer) {
+    if (renderer != NULL) {
+        // Waiting for the pipeline worker (if initialization failed while it ran), then the device to idle:
+        vk_join_pipeline_worker(renderer);
+        if (renderer->vk_device != VK_NULL_HANDLE) {
+            vkDeviceWaitIdle(renderer->vk_device);
+        }
+        // (freeing uploads still pending, along with their staging buffers)
+        vk_retire_pending_uploads(renderer, 0);
+
+        // destroying semaphores required in 'draw_frame_from_renderer':
+        // see:
+        // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Rendering_and_presentation
+        for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+            if (renderer->vk_semaphores_oks[i]) {
+                vkDestroySemaphore(renderer->vk_device, renderer->vk_render_finished_semaphores[i], NULL);
+                vkDestroySemaphore(renderer->vk_device, renderer->vk_image_available_semaphores[i], NULL);
+                vkDestroyFence(renderer->vk_device, renderer->vk_inflight_fences[i], NULL);
+            }
+        }
+    
+        // destroying the command pool used to address the graphics queue:
+        // see:
+        // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Command_buffers
+        {
+            // (along with the per-swapchain-image command buffers, UBO and descriptor sets)
+            vk_destroy_swapchain_image_resources(renderer);
+            if (renderer->vk_command_buffer_pool_ok) {
+                vkDestroyCommandPool(
+                    renderer->vk_device,
+                    renderer->vk_command_buffer_pool,
+                    NULL
+                );
+                renderer->vk_command_buffer_pool_ok = false;
+            }
+            if (renderer->vk_transfer_command_pool_ok) {
+                vkDestroyCommandPool(
+                    renderer->vk_device,
+                    renderer->vk_transfer_command_pool,
+                    NULL
+                );
+                renderer->vk_transfer_command_pool_ok = false;
+            }
+        }
+
+        // destroying the framebuffers:
+        // see:
+        // https://vulkan-tutorial.com/Drawing_a_triangle/Drawing/Framebuffers
+        vk_destroy_framebuffers(renderer);
+
+        // destroying the pipeline object:
+        // see:
+        // https://vulkan-tutorial.com/en/Drawing_a_triangle/Graphics_pipeline_basics/Conclusion
+        for (uint32_t i = 0; i < renderer->pipeline_variant_count; i++) {
+            if (renderer->pipeline_variants[i].pipeline != VK_NULL_HANDLE) {
+                vkDestroyPipeline(
+                    renderer->vk_device,
+                    renderer->pipeline_variants[i].pipeline,
+                    NULL
+                );
+            }
+        }
+        renderer->pipeline_variant_count = 0;
+        if (renderer->vk_graphics_pipeline_ok) {
+            vkDestroyPipeline(
+                renderer->vk_device,
+                renderer->vk_graphics_pipeline,
+                NULL
+            );
+            renderer->vk_graphics_pipeline_ok = false;
+        }
+        if (renderer->vk_compute_pipeline_ok) {
+            vkDestroyPipeline(
+                renderer->vk_device,
+                renderer->vk_compute_pipeline,
+                NULL
+            );
+            renderer->vk_compute_pipeline_ok = false;
+        }
+        if (renderer->vk_ray_query_pipeline != VK_NULL_HANDLE) {
+            vkDestroyPipeline(
+                renderer->vk_device,
+                renderer->vk_ray_query_pipeline,
+                NULL
+            );
+            renderer->vk_ray_query_pipeline = VK_NULL_HANDLE;
+            renderer->vk_ray_query_pipeline_ok = false;
+        }
+
+        // saving anything compiled since initialization, then destroying the pipeline cache:
+        if (renderer->vk_pipeline_cache != VK_NULL_HANDLE) {
+            vk_save_pipeline_cache(renderer);
+            vkDestroyPipelineCache(
                 renderer->vk_device,
-                renderer->vk_graphics_pipeline,
+                renderer->vk_pipeline_cache,
                 NULL
             );
-            renderer->vk_graphics_pipeline_ok = false;
+            renderer->vk_pipeline_cache = VK_NULL_HANDLE;
         }
 
         // destroying the pipeline layout:
@@ -1975,6 +5874,22 @@ void del_renderer(Wo_Renderer* renderer) {
             );
             renderer->vk_shaders_loaded_ok = false;
         }
+        if (renderer->vk_comp_shader_module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(
+                renderer->vk_device,
+                renderer->vk_comp_shader_module,
+                NULL
+            );
+            renderer->vk_comp_shader_module = VK_NULL_HANDLE;
+        }
+        if (renderer->vk_rq_comp_shader_module != VK_NULL_HANDLE) {
+            vkDestroyShaderModule(
+                renderer->vk_device,
+                renderer->vk_rq_comp_shader_module,
+                NULL
+            );
+            renderer->vk_rq_comp_shader_module = VK_NULL_HANDLE;
+        }
 
         // destroying the swapchain image views, then the swapchain:
         if (renderer->vk_descriptor_set_layout) {
@@ -1984,47 +5899,46 @@ void del_renderer(Wo_Renderer* renderer) {
                 NULL
             );
         }
-        if (renderer->uniform_buffers) {
-            assert(renderer->uniform_buffers_memory);
-            for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
-                vkDestroyBuffer(
-                    renderer->vk_device,
-                    renderer->uniform_buffers[i],
-                    NULL
-                );
-                vkFreeMemory(
-                    renderer->vk_device,
-                    renderer->uniform_buffers_memory[i],
-                    NULL
-                );
-            }
-            free(renderer->uniform_buffers);
-            free(renderer->uniform_buffers_memory);
+        del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &renderer->scene_buffer, &renderer->scene_buffer_allocation);
+        del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &renderer->scene_accel_buffer, &renderer->scene_accel_buffer_allocation);
+        del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &renderer->material_buffer, &renderer->material_buffer_allocation);
+        if (renderer->vk_ray_query_supported) {
+            vk_destroy_scene_acceleration_structures(renderer);
         }
-        if (renderer->vk_descriptor_pool_ok) {
-            vkDestroyDescriptorPool(
-                renderer->vk_device,
-                renderer->vk_descriptor_pool,
-                NULL
-            );
-            renderer->vk_descriptor_pool_ok = false;
+        del_vk_buffer(renderer->vk_device, &renderer->gpu_arena, &renderer->update_staging_buffer, &renderer->update_staging_buffer_allocation);
+        if (renderer->vk_upload_timestamp_query_pool != VK_NULL_HANDLE) {
+            vkDestroyQueryPool(renderer->vk_device, renderer->vk_upload_timestamp_query_pool, NULL);
+            renderer->vk_upload_timestamp_query_pool = VK_NULL_HANDLE;
         }
-        if (renderer->vk_swapchain_image_views != NULL) {
-            for (size_t index = 0; index < renderer->vk_swapchain_images_count; index++) {
-                vkDestroyImageView(
-                    renderer->vk_device,
-                    renderer->vk_swapchain_image_views[index],
-                    NULL
-                );
-            }
-            free(renderer->vk_swapchain_image_views);
+        free_flat_scene(&renderer->committed_flat_scene);
+        free_scene_accel(&renderer->committed_scene_accel);
+        free(renderer->committed_flat_dirty_bitset);
+        free(renderer->committed_accel_gpu_data);
+        free(renderer->committed_component_aabbs);
+        renderer->committed_flat_dirty_bitset = NULL;
+        renderer->committed_accel_gpu_data = NULL;
+        renderer->committed_component_aabbs = NULL;
+        del_vk_buffer(
+            renderer->vk_device, &renderer->gpu_arena,
+            &renderer->scene_component_aabb_buffer, &renderer->scene_component_aabb_buffer_allocation
+        );
+        vk_destroy_trace_image(renderer);
+        if (renderer->is_headless) {
+            vk_destroy_offscreen_targets(renderer);
         }
+        vk_destroy_swapchain_image_views(renderer);
         if (renderer->vk_swapchain != VK_NULL_HANDLE) {
             vkDestroySwapchainKHR(renderer->vk_device, renderer->vk_swapchain, NULL);
-            free(renderer->vk_swapchain_images);
-            renderer->vk_swapchain_images_count = 0;
+            renderer->vk_swapchain = VK_NULL_HANDLE;
         }
+        renderer->vk_swapchain_images_count = 0;
         
+        // freeing the device memory blocks everything above was sub-allocated from:
+        if (renderer->gpu_arena_ok) {
+            del_gpu_arena(&renderer->gpu_arena);
+            renderer->gpu_arena_ok = false;
+        }
+
         // destroying the Vulkan logical device:
         if (renderer->vk_device != VK_NULL_HANDLE) {
             printf("[Wololo] Destroying Vulkan (logical) device\n");
@@ -2077,8 +5991,9 @@ void del_renderer(Wo_Renderer* renderer) {
             vkDestroyInstance(renderer->vk_instance, NULL);
         }
 
-        // finally, destroying the renderer struct:
+        // finally, destroying the node tables and the renderer struct:
         printf("[Wololo] Destroying renderer \"%s\"\n", renderer->name);
+        node_store_free(&renderer->node_store);
         free(renderer);
     }
 }
@@ -2096,29 +6011,86 @@ void draw_frame_with_renderer(Wo_Renderer* renderer) {
         1, &renderer->vk_inflight_fences[renderer->current_frame_index],
         VK_TRUE, UINT64_MAX
     );
-    
+    // freeing the uploads the graphics queue has acquired since: (see 'vk_submit_transfer_upload')
+    vk_retire_pending_uploads(renderer, WO_MAX_PENDING_UPLOAD_COUNT);
+
+    // recreating the swapchain if presentation asked for it, or the window was resized since:
+    // (retried every frame while that is impossible, e.g. while minimized)
+    if (!renderer->is_headless) {
+        int width = 0, height = 0;
+        glfwGetFramebufferSize(wo_app_glfw_window(renderer->app), &width, &height);
+        if (width != renderer->swapchain_window_width || height != renderer->swapchain_window_height) {
+            renderer->swapchain_needs_recreation = true;
+        }
+        if (renderer->swapchain_needs_recreation && !recreate_swapchain(renderer)) {
+            return;
+        }
+    }
+
     // When using multiple swapchain images, we need to acquire the index of a swapchain image
     // that is currently not being read from by the GPU, and is therefore writable.
     // 'renderer->current_frame_index' stripes through each
     // NOTE: updated at end of func.
+    // (headless renderers have one offscreen image per frame in flight instead)
     uint32_t image_index = -1;
-    vkAcquireNextImageKHR(
-        renderer->vk_device, 
-        renderer->vk_swapchain, 
-        UINT64_MAX,
-        renderer->vk_image_available_semaphores[renderer->current_frame_index],
-        VK_NULL_HANDLE,
-        &image_index
-    );
+    VkResult acquire_result = VK_SUCCESS;
+    if (renderer->is_headless) {
+        image_index = (uint32_t)renderer->current_frame_index;
+    } else {
+        acquire_result = vkAcquireNextImageKHR(
+            renderer->vk_device, 
+            renderer->vk_swapchain, 
+            UINT64_MAX,
+            renderer->vk_image_available_semaphores[renderer->current_frame_index],
+            VK_NULL_HANDLE,
+            &image_index
+        );
+    }
+    if (acquire_result == VK_ERROR_OUT_OF_DATE_KHR) {
+        // the swapchain can no longer be presented to: recreating it and skipping this frame.
+        // (the fence was not reset, so the next frame does not wait on it in vain)
+        recreate_swapchain(renderer);
+        return;
+    } else if (acquire_result == VK_SUBOPTIMAL_KHR) {
+        // still presentable: recreating once this frame is presented.
+        renderer->swapchain_needs_recreation = true;
+    } else if (acquire_result != VK_SUCCESS) {
+        printf("[Wololo] Failed to acquire a Vulkan swapchain image.\n");
+        return;
+    }
 
+    // timing the CPU's share of the frame from here to its submission, but for waits on the GPU:
+    // (this frame index's previous frame completed, so its upload's GPU time is known)
+    double submit_start_sec = get_renderer_time_sec(renderer);
+    double submit_waited_sec = 0.0;
+    read_gpu_upload_time(renderer, (uint32_t)renderer->current_frame_index);
+
+    // patching moved nodes into the scene buffers, or uploading the whole scene if nodes were
+    // added since the last commit (or the patch does not fit):
+    // (on failure, we keep drawing the last committed scene)
+    // any change to the scene invalidates the samples accumulated in progressive mode.
+    if (renderer->scene_has_dirty_nodes || renderer->scene_needs_commit) {
+        renderer->accumulated_sample_count = 0;
+    }
+    bool scene_updated = false;
+    if (!renderer->scene_needs_commit) {
+        scene_updated = update_scene(renderer);
+    }
+    if (renderer->scene_needs_commit) {
+        commit_scene(renderer);
+        scene_updated = false;
+    }
+    
     // check if a previous frame is using this image,
     // i.e. we must wait for its fence:
     if (renderer->vk_images_inflight_fences[image_index] != VK_NULL_HANDLE) {
+        double wait_start_sec = get_renderer_time_sec(renderer);
         vkWaitForFences(
             renderer->vk_device,
             1, &renderer->vk_images_inflight_fences[image_index],
             VK_TRUE, UINT64_MAX
         );
+        submit_waited_sec += get_renderer_time_sec(renderer) - wait_start_sec;
     }
     
     // mark the images_inflight_fences frame as 'in-use'
@@ -2126,6 +6098,21 @@ void draw_frame_with_renderer(Wo_Renderer* renderer) {
     renderer->vk_images_inflight_fences[image_index] = (
         renderer->vk_inflight_fences[renderer->current_frame_index]
     );
+
+    // the image's previous frame completed, so its GPU time is known (and may change the render
+    // scale), and its command buffer can be re-recorded if the render scale changed:
+    read_gpu_frame_time(renderer, image_index);
+    if (renderer->compiling_pipeline_variant_index < WO_MAX_PIPELINE_VARIANT_COUNT && vk_pipeline_worker_is_done(renderer)) {
+        // a pipeline variant is ready: re-recording the command buffers drawn with the generic one.
+        vk_join_pipeline_worker(renderer);
+        finish_pipeline_variant_compile(renderer);
+        for (uint32_t i = 0; i < renderer->vk_swapchain_images_count; i++) {
+            renderer->vk_command_buffers_stale[i] = true;
+        }
+    }
+    if (renderer->vk_command_buffers_stale[image_index]) {
+        vk_record_command_buffer(renderer, image_index);
+    }
     
     // using the acquired image_index, setting up synchronous chain of ops:
 
@@ -2133,24 +6120,43 @@ void draw_frame_with_renderer(Wo_Renderer* renderer) {
     {
         FragmentUniformBufferObject fubo;
         memset(&fubo, 0, sizeof(fubo));
-        fubo.time_since_start_sec = glfwGetTime();
-        fubo.resolution_x = (float)renderer->vk_frame_extent.width;
-        fubo.resolution_y = (float)renderer->vk_frame_extent.height;
-    
-        void* data = NULL;
-        VkResult map_ok = vkMapMemory(
-            renderer->vk_device,
-            renderer->uniform_buffers_memory[image_index],
-            0,
-            sizeof(fubo),
-            0,
-            &data
-        );
-        assert(map_ok == VK_SUCCESS && "Failed to map Vulkan UBO.");
-        memcpy(data, &fubo, sizeof(fubo));
-        vkUnmapMemory(
-            renderer->vk_device,
-            renderer->uniform_buffers_memory[image_index]
+        fubo.time_since_start_sec = get_renderer_time_sec(renderer);
+        VkExtent2D trace_extent = get_trace_extent(renderer);
+        fubo.resolution_x = (float)trace_extent.width;
+        fubo.resolution_y = (float)trace_extent.height;
+        fubo.camera_aspect_ratio = (float)renderer->vk_frame_extent.width / (float)renderer->vk_frame_extent.height;
+        fubo.region_st_offset_x = 0.0f;
+        fubo.region_st_offset_y = 0.0f;
+        fubo.region_st_scale_x = 1.0f;
+        fubo.region_st_scale_y = 1.0f;
+        if (renderer->has_frame_region) {
+            // the camera frames the whole frame, of which this one is the region at
+            // (x, y) from its top left corner: (while 'st' runs bottom to top)
+            float const full_width = (float)renderer->frame_region_full_width;
+            float const full_height = (float)renderer->frame_region_full_height;
+            fubo.camera_aspect_ratio = full_width / full_height;
+            fubo.region_st_offset_x = (float)renderer->frame_region_x / full_width;
+            fubo.region_st_offset_y = (full_height - (float)(renderer->frame_region_y + renderer->vk_frame_extent.height)) / full_height;
+            fubo.region_st_scale_x = (float)renderer->vk_frame_extent.width / full_width;
+            fubo.region_st_scale_y = (float)renderer->vk_frame_extent.height / full_height;
+        }
+        fubo.progressive = renderer->is_progressive && renderer->trace_path != WO_TRACE_PATH_FRAGMENT;
+        fubo.accumulated_sample_count = renderer->accumulated_sample_count;
+        fubo.path_tracing = renderer->is_path_tracing && renderer->trace_path != WO_TRACE_PATH_FRAGMENT;
+        fubo.samples_per_pixel = 1;
+        if (fubo.path_tracing) {
+            help_fit_ray_budget(renderer, &fubo.max_bounce_count, &fubo.samples_per_pixel);
+        }
+        if (fubo.progressive) {
+            renderer->accumulated_sample_count += fubo.samples_per_pixel;
+        }
+
+        // (the image's fence was waited on above, so its slot is no longer being read, and its
+        // ray count is final)
+        read_ray_counter(renderer, image_index);
+        memcpy(
+            renderer->uniform_buffer_allocation.mapped + image_index * renderer->uniform_buffer_stride,
+            &fubo, sizeof(fubo)
         );
     }
 
@@ -2164,20 +6170,29 @@ void draw_frame_with_renderer(Wo_Renderer* renderer) {
     VkSemaphore wait_semaphores[] = {
         renderer->vk_image_available_semaphores[renderer->current_frame_index]
     };
+    // (the compute path first writes to the swapchain image with its blit)
     VkPipelineStageFlags wait_stages[] = {
+        renderer->trace_path != WO_TRACE_PATH_FRAGMENT ?
+        VK_PIPELINE_STAGE_TRANSFER_BIT :
         VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
     };
-    submit_info.waitSemaphoreCount = 1;
+    // (headless frames do not wait on an acquired image, nor signal presentation)
+    submit_info.waitSemaphoreCount = renderer->is_headless ? 0 : 1;
     submit_info.pWaitSemaphores = wait_semaphores;
     submit_info.pWaitDstStageMask = wait_stages;
 
-    submit_info.commandBufferCount = 1;
-    submit_info.pCommandBuffers = &renderer->vk_command_buffers[image_index];
+    // (this frame's incremental update, if any, runs first)
+    VkCommandBuffer submit_command_buffers[2] = {
+        renderer->vk_update_command_buffers[renderer->current_frame_index],
+        renderer->vk_command_buffers[image_index]
+    };
+    submit_info.commandBufferCount = scene_updated ? 2 : 1;
+    submit_info.pCommandBuffers = scene_updated ? &submit_command_buffers[0] : &submit_command_buffers[1];
 
     VkSemaphore signal_semaphores[] = {
         renderer->vk_render_finished_semaphores[renderer->current_frame_index]
     };
-    submit_info.signalSemaphoreCount = 1;
+    submit_info.signalSemaphoreCount = renderer->is_headless ? 0 : 1;
     submit_info.pSignalSemaphores = signal_semaphores;
 
     // it is best to reset the fence in use before using it (i.e. submitting the queue):
@@ -2190,12 +6205,33 @@ void draw_frame_with_renderer(Wo_Renderer* renderer) {
         1, &submit_info, 
         renderer->vk_inflight_fences[renderer->current_frame_index]
     );
+    renderer->vk_timestamps_written[image_index] = (submit_ok == VK_SUCCESS);
+    renderer->upload_timestamps_written[renderer->current_frame_index] = (submit_ok == VK_SUCCESS && scene_updated);
+    record_timing(&renderer->cpu_submit_timing, get_renderer_time_sec(renderer) - submit_start_sec - submit_waited_sec);
     if (submit_ok != VK_SUCCESS) {
         printf("Failed to submit draw command buffer (image %u/%u)\n", image_index+1, renderer->vk_swapchain_images_count);
         fflush(stdout);
         assert(0 && "Failed to submit draw command buffer");
     }
 
+    // headless frames are queued up for 'read_frame' instead of presented:
+    // (once every frame in flight is unread, the oldest is overwritten by this one)
+    if (renderer->is_headless) {
+        if (renderer->readback_pending_frame_count == renderer->frames_in_flight) {
+            renderer->readback_first_pending_frame = (
+                (renderer->readback_first_pending_frame + 1) %
+                renderer->frames_in_flight
+            );
+            renderer->readback_pending_frame_count--;
+        }
+        renderer->readback_pending_frame_count++;
+        renderer->current_frame_index = (
+            (renderer->current_frame_index + 1) %
+            renderer->frames_in_flight
+        );
+        return;
+    }
+
     // setting up the second pass: present
     VkPresentInfoKHR present_info;
     memset(&present_info, 0, sizeof(present_info));
@@ -2206,82 +6242,759 @@ void draw_frame_with_renderer(Wo_Renderer* renderer) {
     present_info.pSwapchains = &renderer->vk_swapchain;
     present_info.pImageIndices = &image_index;
     present_info.pResults = NULL;
-    vkQueuePresentKHR(renderer->vk_present_queue, &present_info);
-
-    // sleeping while the submitted command buffer is being processed:
-    vkQueueWaitIdle(renderer->vk_present_queue);
+    VkResult present_result = vkQueuePresentKHR(renderer->vk_present_queue, &present_info);
+    if (present_result == VK_ERROR_OUT_OF_DATE_KHR || present_result == VK_SUBOPTIMAL_KHR) {
+        // (recreated at the start of the next frame)
+        renderer->swapchain_needs_recreation = true;
+    }
 
     // updating the current frame index:
+    // (no waiting here: the next frame only waits on its own fence, so up to 'frames_in_flight'
+    // frames are queued while the CPU prepares the next)
     renderer->current_frame_index = (
         (renderer->current_frame_index + 1) %
-        MAX_FRAMES_IN_FLIGHT
+        renderer->frames_in_flight
+    );
+}
+bool read_frame(Wo_Renderer* renderer, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size) {
+    if (!renderer->is_headless || renderer->readback_pending_frame_count == 0) {
+        return false;
+    }
+    size_t pixel_count = (size_t)renderer->vk_frame_extent.width * renderer->vk_frame_extent.height;
+    size_t pixel_size = (format == WO_PIXEL_FORMAT_RGBA8) ? 4 : 4 * sizeof(float);
+    if (out_pixels_size < pixel_count * pixel_size) {
+        printf(
+            "[Wololo] Cannot read back a %u x %u frame into %zu bytes.\n",
+            renderer->vk_frame_extent.width, renderer->vk_frame_extent.height, out_pixels_size
+        );
+        return false;
+    }
+
+    // waiting for the oldest unread frame's copy to land:
+    // (later frames keep rendering meanwhile)
+    uint32_t frame_index = renderer->readback_first_pending_frame;
+    vkWaitForFences(
+        renderer->vk_device,
+        1, &renderer->vk_inflight_fences[frame_index],
+        VK_TRUE, UINT64_MAX
     );
+    renderer->readback_first_pending_frame = (frame_index + 1) % renderer->frames_in_flight;
+    renderer->readback_pending_frame_count--;
+
+    uint8_t const* src = renderer->readback_buffer_allocations[frame_index].mapped;
+    if (format == WO_PIXEL_FORMAT_RGBA8) {
+        memcpy(out_pixels, src, pixel_count * 4);
+    } else {
+        // decoding the sRGB color channels (alpha is stored linearly):
+        float srgb_to_linear[256];
+        for (int value = 0; value < 256; value++) {
+            float c = (float)value / 255.0f;
+            srgb_to_linear[value] = (c <= 0.04045f) ? (c / 12.92f) : powf((c + 0.055f) / 1.055f, 2.4f);
+        }
+        float* dst = out_pixels;
+        for (size_t index = 0; index < pixel_count; index++) {
+            dst[4*index + 0] = srgb_to_linear[src[4*index + 0]];
+            dst[4*index + 1] = srgb_to_linear[src[4*index + 1]];
+            dst[4*index + 2] = srgb_to_linear[src[4*index + 2]];
+            dst[4*index + 3] = (float)src[4*index + 3] / 255.0f;
+        }
+    }
+    return true;
 }
 bool allocate_node(Wo_Renderer* renderer, Wo_Node* out_node) {
-    if (renderer->current_node_count == renderer->max_node_count) {
+    assert(!renderer->scene_build_in_progress && "[Wololo] Nodes are added by scene builders during a scene build.");
+    if (renderer->free_node_list_head != WO_NODE_NONE) {
+        // reusing the last node freed (non-root until now, so it was never flattened):
+        Wo_Node node = renderer->free_node_list_head;
+        renderer->free_node_list_head = node_info(&renderer->node_store, node)->free.next;
+        renderer->free_node_count--;
+        *node_nonroot_word(&renderer->node_store, node) &= ~node_bit(node);
+        *out_node = node;
+        return true;
+    }
+    size_t node = renderer->current_node_count;
+    if (node == WO_RENDERER_MAX_NODE_COUNT || !node_store_reserve(&renderer->node_store, node, node + 1)) {
         return false;
     } else {
         *out_node = (Wo_Node)renderer->current_node_count++;
         return true;
     }
 }
+void free_node(Wo_Renderer* renderer, Wo_Node node) {
+    // (free nodes are marked non-root, and no binop refers to them, so they are never flattened;
+    // their old operands are cleared, so a stale handle to the node matches none of them)
+    NodeInfo* info = node_info(&renderer->node_store, node);
+    *node_type(&renderer->node_store, node) = WO_NODE_FREE;
+    memset(info, 0, sizeof(NodeInfo));
+    info->binop_of.left.node = WO_NODE_NONE;
+    info->binop_of.right.node = WO_NODE_NONE;
+    info->free.next = renderer->free_node_list_head;
+    *node_reference_count(&renderer->node_store, node) = 0;
+    *node_nonroot_word(&renderer->node_store, node) |= node_bit(node);
+    *node_dirty_word(&renderer->node_store, node) &= ~node_bit(node);
+    renderer->free_node_list_head = node;
+    renderer->free_node_count++;
+}
+void clear_dirty_nodes(Wo_Renderer* renderer) {
+    for (size_t chunk_index = 0; chunk_index < WO_NODE_MAX_CHUNK_COUNT; chunk_index++) {
+        NodeChunk* chunk = renderer->node_store.chunks[chunk_index];
+        if (chunk != NULL) {
+            memset(chunk->is_dirty_bitset, 0, sizeof(chunk->is_dirty_bitset));
+        }
+    }
+}
 void set_nonroot_node(Wo_Renderer* renderer, Wo_Node node) {
-    renderer->node_is_nonroot_bitset[node/64] |= ((uint64_t)1) << (node%64);
+    // atomic, since scene builders on different threads may mark nodes sharing a word:
+    atomic_fetch_or_explicit(
+        node_nonroot_word(&renderer->node_store, node),
+        node_bit(node),
+        memory_order_relaxed
+    );
+}
+void add_node_reference(Wo_Renderer* renderer, Wo_Node node) {
+    atomic_fetch_add_explicit(node_reference_count(&renderer->node_store, node), 1, memory_order_relaxed);
+    set_nonroot_node(renderer, node);
+}
+void write_sphere_node(Wo_Renderer* renderer, Wo_Node node, Wo_Scalar radius) {
+    NodeInfo* info = node_info(&renderer->node_store, node);
+    *node_type(&renderer->node_store, node) = WO_LEAF_SPHERE;
+    info->sphere.radius = radius;
+    info->sphere.material = WO_MATERIAL_DEFAULT;
+}
+void write_infinite_planar_partition_node(Wo_Renderer* renderer, Wo_Node node, Wo_Vec3 outward_facing_normal) {
+    NodeInfo* info = node_info(&renderer->node_store, node);
+    *node_type(&renderer->node_store, node) = WO_LEAF_INFINITE_PLANAR_PARTITION;
+    info->infinite_planar_partition.normal = outward_facing_normal;
+    info->infinite_planar_partition.material = WO_MATERIAL_DEFAULT;
+}
+bool write_binop_node(Wo_Renderer* renderer, Wo_Node node, NodeType type, Wo_Node_Argument left, Wo_Node_Argument right) {
+    // (operands are WO_NODE_NONE if adding them failed, in which case the binop is not written)
+    if (left.node == WO_NODE_NONE || right.node == WO_NODE_NONE) {
+        return false;
+    }
+    NodeInfo* info = node_info(&renderer->node_store, node);
+    *node_type(&renderer->node_store, node) = type;
+    info->binop_of.left = left;
+    info->binop_of.right = right;
+    add_node_reference(renderer, left.node);
+    add_node_reference(renderer, right.node);
+    return true;
 }
 
 Wo_Node add_sphere_node(Wo_Renderer* renderer, Wo_Scalar radius) {
     Wo_Node node;
-    assert(allocate_node(renderer, &node) && "[Wololo] Failed to allocate a new sphere renderer node-- out of memory.");
-    renderer->node_type_table[node] = WO_LEAF_SPHERE;
-    renderer->node_info_table[node].sphere.radius = radius;
+    if (!allocate_node(renderer, &node)) {
+        printf("[Wololo] Renderer \"%s\" failed to allocate a new sphere node-- out of memory.\n", renderer->name);
+        return WO_NODE_NONE;
+    }
+    write_sphere_node(renderer, node, radius);
+    renderer->scene_needs_commit = true;
     return node;
 }
 Wo_Node add_infinite_planar_partition_node(Wo_Renderer* renderer, Wo_Vec3 outward_facing_normal) {
     Wo_Node node;
-    assert(allocate_node(renderer, &node) && "[Wololo] Failed to allocate a new infinite planar partition renderer node-- out of memory.");
-    renderer->node_type_table[node] = WO_LEAF_INFINITE_PLANAR_PARTITION;
-    renderer->node_info_table[node].infinite_planar_partition.normal = outward_facing_normal;
+    if (!allocate_node(renderer, &node)) {
+        printf("[Wololo] Renderer \"%s\" failed to allocate a new infinite planar partition node-- out of memory.\n", renderer->name);
+        return WO_NODE_NONE;
+    }
+    write_infinite_planar_partition_node(renderer, node, outward_facing_normal);
+    renderer->scene_needs_commit = true;
     return node;
 }
-Wo_Node add_union_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right) {
+Wo_Node add_binop_node(Wo_Renderer* renderer, NodeType type, Wo_Node_Argument left, Wo_Node_Argument right) {
     Wo_Node node;
-    assert(allocate_node(renderer, &node) && "[Wololo] Failed to allocate a new union-of renderer node-- out of memory.");
-    renderer->node_type_table[node] = WO_NODE_BINOP_UNION_OF;
-    renderer->node_info_table[node].binop_of.left = left;
-    renderer->node_info_table[node].binop_of.right = right;
-    set_nonroot_node(renderer, left.node);
-    set_nonroot_node(renderer, right.node);
+    if (left.node == WO_NODE_NONE || right.node == WO_NODE_NONE) {
+        printf("[Wololo] Renderer \"%s\" cannot add a binop node of a missing (WO_NODE_NONE) operand.\n", renderer->name);
+        return WO_NODE_NONE;
+    }
+    if (!allocate_node(renderer, &node)) {
+        printf("[Wololo] Renderer \"%s\" failed to allocate a new binop node-- out of memory.\n", renderer->name);
+        return WO_NODE_NONE;
+    }
+    write_binop_node(renderer, node, type, left, right);
+    renderer->scene_needs_commit = true;
     return node;
 }
+Wo_Node add_union_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right) {
+    return add_binop_node(renderer, WO_NODE_BINOP_UNION_OF, left, right);
+}
 Wo_Node add_intersection_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right) {
+    return add_binop_node(renderer, WO_NODE_BINOP_INTERSECTION_OF, left, right);
+}
+Wo_Node add_difference_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right) {
+    return add_binop_node(renderer, WO_NODE_BINOP_DIFFERENCE_OF, left, right);
+}
+
+bool begin_scene_build(Wo_Renderer* renderer) {
+    if (renderer->scene_build_in_progress) {
+        printf("[Wololo] Renderer \"%s\" is already building a scene.\n", renderer->name);
+        return false;
+    }
+    renderer->scene_build_in_progress = true;
+    atomic_store_explicit(&renderer->scene_build_reserved_node_count, renderer->current_node_count, memory_order_relaxed);
+    atomic_store_explicit(&renderer->scene_build_failed, false, memory_order_relaxed);
+    return true;
+}
+bool end_scene_build(Wo_Renderer* renderer) {
+    assert(renderer->scene_build_in_progress && "[Wololo] No scene build to end.");
+
+    // every reserved ID is either a node or still marked free from its reservation (see
+    // 'scene_builder_allocate_node'), put on the free-list below so it is never flattened, so the
+    // reserved count becomes the node count:
+    size_t reserved_node_count = MIN(
+        atomic_load_explicit(&renderer->scene_build_reserved_node_count, memory_order_relaxed),
+        WO_RENDERER_MAX_NODE_COUNT
+    );
+    renderer->scene_build_in_progress = false;
+    if (atomic_load_explicit(&renderer->scene_build_failed, memory_order_relaxed)) {
+        // a range whose chunk could not be allocated was never written (nor retired), so the
+        // build's nodes are discarded: the references they hold on nodes from before the build
+        // are dropped, and their slots cleared for the next nodes added.
+        printf("[Wololo] Renderer \"%s\" ran out of memory building a scene, discarding the build's nodes.\n", renderer->name);
+        size_t build_begin_node = renderer->current_node_count;
+        for (size_t node = build_begin_node; node < reserved_node_count; node++) {
+            if (node_chunk(&renderer->node_store, (Wo_Node)node) == NULL) {
+                continue;
+            }
+            NodeType type = *node_type(&renderer->node_store, (Wo_Node)node);
+            NodeInfo* info = node_info(&renderer->node_store, (Wo_Node)node);
+            if (!node_type_is_leaf(type) && type != WO_NODE_FREE) {
+                Wo_Node operands[2] = {info->binop_of.left.node, info->binop_of.right.node};
+                for (int i = 0; i < 2; i++) {
+                    if (operands[i] < build_begin_node && --*node_reference_count(&renderer->node_store, operands[i]) == 0) {
+                        *node_nonroot_word(&renderer->node_store, operands[i]) &= ~node_bit(operands[i]);
+                    }
+                }
+            }
+            *node_type(&renderer->node_store, (Wo_Node)node) = WO_LEAF_SPHERE;
+            memset(info, 0, sizeof(NodeInfo));
+            *node_reference_count(&renderer->node_store, (Wo_Node)node) = 0;
+            *node_nonroot_word(&renderer->node_store, (Wo_Node)node) &= ~node_bit((Wo_Node)node);
+        }
+        return false;
+    }
+    size_t build_begin_node = renderer->current_node_count;
+    renderer->current_node_count = reserved_node_count;
+    for (size_t node = build_begin_node; node < reserved_node_count; node++) {
+        if (*node_type(&renderer->node_store, (Wo_Node)node) == WO_NODE_FREE) {
+            free_node(renderer, (Wo_Node)node);
+        }
+    }
+    renderer->scene_needs_commit = true;
+    return commit_scene(renderer);
+}
+void init_scene_builder(Wo_Scene_Builder* builder, Wo_Renderer* renderer) {
+    assert(renderer->scene_build_in_progress && "[Wololo] Scene builders are only used during a scene build.");
+    builder->renderer = renderer;
+    builder->next_node = 0;
+    builder->end_node = 0;
+}
+void finish_scene_builder(Wo_Scene_Builder* builder) {
+    // dropping the unused IDs, still marked free to be put on the free-list once the build ends:
+    builder->next_node = builder->end_node;
+}
+bool scene_builder_allocate_node(Wo_Scene_Builder* builder, Wo_Node* out_node) {
+    if (builder->next_node == builder->end_node) {
+        // reserving a new range, which only this builder writes to (the bump may overshoot the
+        // node limit, in which case the range is cut short or empty), and the chunks holding it:
+        Wo_Renderer* renderer = builder->renderer;
+        size_t begin = atomic_fetch_add_explicit(
+            &renderer->scene_build_reserved_node_count,
+            WO_SCENE_BUILDER_RESERVATION_SIZE,
+            memory_order_relaxed
+        );
+        if (begin >= WO_RENDERER_MAX_NODE_COUNT) {
+            return false;
+        }
+        size_t end = MIN(begin + WO_SCENE_BUILDER_RESERVATION_SIZE, WO_RENDERER_MAX_NODE_COUNT);
+        if (!node_store_reserve(&renderer->node_store, begin, end)) {
+            // the range stays reserved, so it must still be retired: its chunks may be missing
+            // though, so the build cannot be committed.
+            atomic_store_explicit(&renderer->scene_build_failed, true, memory_order_relaxed);
+            return false;
+        }
+        // marking the range free until written, so that IDs never written (e.g. if the builder
+        // is never finished) are freed once the build ends, rather than left zeroed, which reads
+        // as an extra sphere root:
+        for (size_t node = begin; node < end; node++) {
+            *node_type(&renderer->node_store, (Wo_Node)node) = WO_NODE_FREE;
+        }
+        builder->next_node = (Wo_Node)begin;
+        builder->end_node = (Wo_Node)end;
+    }
+    *out_node = builder->next_node++;
+    return true;
+}
+Wo_Node scene_builder_add_sphere_node(Wo_Scene_Builder* builder, Wo_Scalar radius) {
     Wo_Node node;
-    assert(allocate_node(renderer, &node) && "[Wololo] Failed to allocate a new intersection-of renderer node-- out of memory.");
-    renderer->node_type_table[node] = WO_NODE_BINOP_INTERSECTION_OF;
-    renderer->node_info_table[node].binop_of.left = left;
-    renderer->node_info_table[node].binop_of.right = right;
-    set_nonroot_node(renderer, left.node);
-    set_nonroot_node(renderer, right.node);
+    if (!scene_builder_allocate_node(builder, &node)) {
+        return WO_NODE_NONE;
+    }
+    write_sphere_node(builder->renderer, node, radius);
     return node;
 }
-Wo_Node add_difference_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right) {
+Wo_Node scene_builder_add_infinite_planar_partition_node(Wo_Scene_Builder* builder, Wo_Vec3 outward_facing_normal) {
+    Wo_Node node;
+    if (!scene_builder_allocate_node(builder, &node)) {
+        return WO_NODE_NONE;
+    }
+    write_infinite_planar_partition_node(builder->renderer, node, outward_facing_normal);
+    return node;
+}
+Wo_Node scene_builder_add_binop_node(Wo_Scene_Builder* builder, NodeType type, Wo_Node_Argument left, Wo_Node_Argument right) {
     Wo_Node node;
-    assert(allocate_node(renderer, &node) && "[Wololo] Failed to allocate a new union renderer node-- out of memory.");
-    renderer->node_type_table[node] = WO_NODE_BINOP_DIFFERENCE_OF;
-    renderer->node_info_table[node].binop_of.left = left;
-    renderer->node_info_table[node].binop_of.right = right;
-    set_nonroot_node(renderer, left.node);
-    set_nonroot_node(renderer, right.node);
+    if (left.node == WO_NODE_NONE || right.node == WO_NODE_NONE) {
+        return WO_NODE_NONE;
+    }
+    if (!scene_builder_allocate_node(builder, &node)) {
+        return WO_NODE_NONE;
+    }
+    write_binop_node(builder->renderer, node, type, left, right);
     return node;
 }
+Wo_Material add_material(Wo_Renderer* renderer, GpuMaterial material) {
+    if (renderer->material_count == WO_RENDERER_MAX_MATERIAL_COUNT) {
+        printf("[Wololo] Renderer \"%s\" cannot add more than %d materials.\n", renderer->name, WO_RENDERER_MAX_MATERIAL_COUNT);
+        return WO_MATERIAL_NONE;
+    }
+    // (uploaded by the next commit, which assigning the material to a leaf requires anyway)
+    Wo_Material id = renderer->material_count++;
+    renderer->materials[id] = material;
+    return id;
+}
+Wo_Material add_lambertian_material(Wo_Renderer* renderer, Wo_Vec3 albedo) {
+    GpuMaterial material;
+    memset(&material, 0, sizeof(material));
+    material.kind = WO_GPU_MATERIAL_LAMBERTIAN;
+    material.albedo[0] = (float)albedo.x;
+    material.albedo[1] = (float)albedo.y;
+    material.albedo[2] = (float)albedo.z;
+    return add_material(renderer, material);
+}
+Wo_Material add_metal_material(Wo_Renderer* renderer, Wo_Vec3 albedo, Wo_Scalar fuzz) {
+    GpuMaterial material;
+    memset(&material, 0, sizeof(material));
+    material.kind = WO_GPU_MATERIAL_METAL;
+    material.albedo[0] = (float)albedo.x;
+    material.albedo[1] = (float)albedo.y;
+    material.albedo[2] = (float)albedo.z;
+    material.fuzz = (float)(fuzz < 0 ? 0 : (fuzz > 1 ? 1 : fuzz));
+    return add_material(renderer, material);
+}
+Wo_Material add_dielectric_material(Wo_Renderer* renderer, Wo_Scalar refraction_index) {
+    GpuMaterial material;
+    memset(&material, 0, sizeof(material));
+    material.kind = WO_GPU_MATERIAL_DIELECTRIC;
+    material.albedo[0] = 1.0f;
+    material.albedo[1] = 1.0f;
+    material.albedo[2] = 1.0f;
+    material.refraction_index = (float)refraction_index;
+    return add_material(renderer, material);
+}
+bool set_node_material(Wo_Renderer* renderer, Wo_Node node, Wo_Material material) {
+    if (node >= renderer->current_node_count || !node_type_is_leaf(*node_type(&renderer->node_store, node))) {
+        printf("[Wololo] Cannot set the material of node %u: not a leaf.\n", node);
+        return false;
+    }
+    if (material >= renderer->material_count) {
+        printf("[Wololo] Cannot set the material of node %u: no material %u.\n", node, material);
+        return false;
+    }
+    NodeInfo* info = node_info(&renderer->node_store, node);
+    if (*node_type(&renderer->node_store, node) == WO_LEAF_SPHERE) {
+        info->sphere.material = material;
+    } else {
+        info->infinite_planar_partition.material = material;
+    }
+    // (materials are flattened into the scene's leaves)
+    renderer->scene_needs_commit = true;
+    return true;
+}
+bool remove_subtree(Wo_Renderer* renderer, Wo_Node root) {
+    assert(!renderer->scene_build_in_progress && "[Wololo] Cannot remove nodes mid-build.");
+    NodeStore* store = &renderer->node_store;
+    if (root >= renderer->current_node_count || *node_type(store, root) == WO_NODE_FREE) {
+        printf("[Wololo] Cannot remove node %u: no such node.\n", root);
+        return false;
+    }
+    if (*node_reference_count(store, root) != 0) {
+        printf("[Wololo] Cannot remove node %u: it is an operand of %u binop(s).\n", root, *node_reference_count(store, root));
+        return false;
+    }
+
+    // freeing the root, then every operand no other binop refers to, depth-first:
+    // (an operand is pushed once, when its last reference is dropped)
+    size_t stack_capacity = 64;
+    size_t stack_count = 0;
+    Wo_Node* stack = malloc(stack_capacity * sizeof(Wo_Node));
+    if (stack == NULL) {
+        printf("[Wololo] Failed to allocate memory while removing node %u.\n", root);
+        return false;
+    }
+    stack[stack_count++] = root;
+    while (stack_count > 0) {
+        Wo_Node node = stack[--stack_count];
+        NodeType type = *node_type(store, node);
+        if (!node_type_is_leaf(type)) {
+            Wo_Node operands[2] = {
+                node_info(store, node)->binop_of.left.node,
+                node_info(store, node)->binop_of.right.node
+            };
+            for (int i = 0; i < 2; i++) {
+                if (--*node_reference_count(store, operands[i]) != 0) {
+                    continue;
+                }
+                if (stack_count == stack_capacity) {
+                    stack_capacity *= 2;
+                    Wo_Node* new_stack = realloc(stack, stack_capacity * sizeof(Wo_Node));
+                    if (new_stack == NULL) {
+                        // the operands left behind are non-roots no binop refers to: unreachable,
+                        // so they are dropped by the next compaction.
+                        printf("[Wololo] Failed to allocate memory while removing node %u.\n", root);
+                        free(stack);
+                        free_node(renderer, node);
+                        renderer->scene_needs_commit = true;
+                        return false;
+                    }
+                    stack = new_stack;
+                }
+                stack[stack_count++] = operands[i];
+            }
+        }
+        free_node(renderer, node);
+    }
+    free(stack);
+    renderer->scene_needs_commit = true;
+    return true;
+}
+bool compact_nodes(Wo_Renderer* renderer, Wo_Node* out_new_nodes, size_t out_new_node_count) {
+    assert(!renderer->scene_build_in_progress && "[Wololo] Cannot compact nodes mid-build.");
+    NodeStore* store = &renderer->node_store;
+    size_t const node_count = renderer->current_node_count;
+
+    // numbering the nodes reachable from roots in post-order, root by root, so each subtree's
+    // nodes are contiguous and operands precede the binops referring to them (as if
+    // they were just added). The DFS stack holds a path down the DAG, so it never holds more than
+    // 'node_count' nodes.
+    Wo_Node* new_nodes = malloc((node_count + 1) * sizeof(Wo_Node));
+    Wo_Node* stack = malloc((node_count + 1) * sizeof(Wo_Node));
+    NodeStore* new_store = calloc(1, sizeof(NodeStore));
+    if (new_nodes == NULL || stack == NULL || new_store == NULL) {
+        goto fatal_error;
+    }
+    for (size_t node = 0; node < node_count; node++) {
+        new_nodes[node] = WO_NODE_NONE;
+    }
+    Wo_Node new_node_count = 0;
+    for (Wo_Node root = 0; root < node_count; root++) {
+        if (*node_type(store, root) == WO_NODE_FREE || !node_is_root(store, root)) {
+            continue;
+        }
+        size_t stack_count = 1;
+        stack[0] = root;
+        while (stack_count > 0) {
+            Wo_Node node = stack[stack_count-1];
+            if (!node_type_is_leaf(*node_type(store, node))) {
+                NodeInfo const* info = node_info(store, node);
+                if (new_nodes[info->binop_of.left.node] == WO_NODE_NONE) {
+                    stack[stack_count++] = info->binop_of.left.node;
+                    continue;
+                }
+                if (new_nodes[info->binop_of.right.node] == WO_NODE_NONE) {
+                    stack[stack_count++] = info->binop_of.right.node;
+                    continue;
+                }
+            }
+            new_nodes[node] = new_node_count++;
+            stack_count--;
+        }
+    }
+
+    // copying the nodes into fresh chunks, renumbering operands (reference counts and non-root
+    // bits are recounted, dropping any held by unreachable nodes; dirty bits are dropped, since
+    // the scene is re-committed):
+    if (!node_store_reserve(new_store, 0, new_node_count)) {
+        goto fatal_error;
+    }
+    for (Wo_Node node = 0; node < node_count; node++) {
+        Wo_Node new_node = new_nodes[node];
+        if (new_node == WO_NODE_NONE) {
+            continue;
+        }
+        NodeType type = *node_type(store, node);
+        NodeInfo info = *node_info(store, node);
+        if (!node_type_is_leaf(type)) {
+            info.binop_of.left.node = new_nodes[info.binop_of.left.node];
+            info.binop_of.right.node = new_nodes[info.binop_of.right.node];
+            Wo_Node operands[2] = {info.binop_of.left.node, info.binop_of.right.node};
+            for (int i = 0; i < 2; i++) {
+                (*node_reference_count(new_store, operands[i]))++;
+                *node_nonroot_word(new_store, operands[i]) |= node_bit(operands[i]);
+            }
+        }
+        *node_type(new_store, new_node) = type;
+        *node_info(new_store, new_node) = info;
+    }
+    if (out_new_nodes != NULL) {
+        for (size_t node = 0; node < node_count && node < out_new_node_count; node++) {
+            out_new_nodes[node] = new_nodes[node];
+        }
+    }
+    printf(
+        "[Wololo] Compacted renderer \"%s\" from %zu to %u nodes.\n",
+        renderer->name, node_count, new_node_count
+    );
+
+    // swapping the chunks (freeing the old ones, and any left unused):
+    node_store_free(store);
+    *store = *new_store;
+    free(new_store);
+    free(new_nodes);
+    free(stack);
+    renderer->current_node_count = new_node_count;
+    renderer->free_node_list_head = WO_NODE_NONE;
+    renderer->free_node_count = 0;
+
+    // the committed scene's emissions refer to the old nodes: re-committing it uploads the
+    // renumbered scene at once (into the existing buffers, if it fits):
+    renderer->scene_needs_commit = true;
+    return commit_scene(renderer);
+
+  fatal_error:
+    printf("[Wololo] Failed to allocate memory while compacting renderer \"%s\".\n", renderer->name);
+    if (new_store != NULL) {
+        node_store_free(new_store);
+    }
+    free(new_store);
+    free(new_nodes);
+    free(stack);
+    return false;
+}
+
+bool save_scene(Wo_Renderer* renderer, char const* file_path) {
+    assert(!renderer->scene_build_in_progress && "[Wololo] Cannot save a scene mid-build: end the build first.");
+    NodeStore const* store = &renderer->node_store;
+    size_t const node_count = renderer->current_node_count;
+    size_t const nonroot_word_count = (node_count + 63) / 64;
+
+    // the prebuilt GPU scene is the committed one, once it holds every change to the tables:
+    // (moved nodes are patched into its CPU copies, which scenes loaded prebuilt lack, at the
+    // next frame, and a commit subsumes that)
+    bool has_gpu_scene = true;
+    if (renderer->scene_needs_commit || renderer->scene_has_dirty_nodes || renderer->is_committed_scene_prebuilt) {
+        renderer->scene_needs_commit = true;
+        has_gpu_scene = commit_scene(renderer);
+    }
+    has_gpu_scene = has_gpu_scene && (renderer->committed_flat_dirty_bitset != NULL);
+
+    SceneFileHeader header;
+    init_scene_file_header(&header);
+    header.node_count = (uint32_t)node_count;
+    header.free_node_list_head = renderer->free_node_list_head;
+    header.free_node_count = (uint32_t)renderer->free_node_count;
+    header.material_count = renderer->material_count;
+    header.sections[WO_SCENE_FILE_SECTION_NODE_TYPES].size = node_count * sizeof(NodeType);
+    header.sections[WO_SCENE_FILE_SECTION_NODE_INFOS].size = node_count * sizeof(NodeInfo);
+    header.sections[WO_SCENE_FILE_SECTION_NODE_REFERENCE_COUNTS].size = node_count * sizeof(uint32_t);
+    header.sections[WO_SCENE_FILE_SECTION_NONROOT_BITSET].size = nonroot_word_count * sizeof(uint64_t);
+    header.sections[WO_SCENE_FILE_SECTION_MATERIALS].size = renderer->material_count * sizeof(GpuMaterial);
+
+    // gathering the chunks' slices of each table into contiguous sections:
+    size_t const table_capacity = (node_count > 0 ? node_count : 1);
+    NodeType* types = malloc(sizeof(NodeType) * table_capacity);
+    NodeInfo* infos = malloc(sizeof(NodeInfo) * table_capacity);
+    uint32_t* reference_counts = malloc(sizeof(uint32_t) * table_capacity);
+    uint64_t* nonroot_words = malloc(sizeof(uint64_t) * (nonroot_word_count > 0 ? nonroot_word_count : 1));
+    void* gpu_scene_data = NULL;
+    if (has_gpu_scene) {
+        size_t const gpu_scene_size = flat_scene_gpu_size_in_bytes(&renderer->committed_flat_scene);
+        uint32_t const aabb_count = renderer->committed_component_aabb_count;
+        gpu_scene_data = malloc(gpu_scene_size);
+        if (gpu_scene_data != NULL) {
+            flat_scene_write_gpu_layout(&renderer->committed_flat_scene, gpu_scene_data);
+        }
+        header.gpu_node_type_mask = renderer->scene_node_type_mask;
+        header.gpu_unoptimized_node_count = renderer->scene_unoptimized_gpu_node_count;
+        header.gpu_prototype_count = renderer->scene_prototype_count;
+        header.gpu_instance_count = renderer->scene_instance_count;
+        header.sections[WO_SCENE_FILE_SECTION_GPU_SCENE].size = gpu_scene_size;
+        header.sections[WO_SCENE_FILE_SECTION_GPU_ACCEL].size = renderer->committed_accel_gpu_size;
+        header.sections[WO_SCENE_FILE_SECTION_GPU_COMPONENT_AABBS].size = sizeof(GpuComponentAabb) * (aabb_count > 0 ? aabb_count : 1);
+    }
+    bool ok = (
+        types != NULL &&
+        infos != NULL &&
+        reference_counts != NULL &&
+        nonroot_words != NULL &&
+        (!has_gpu_scene || gpu_scene_data != NULL)
+    );
+    if (ok) {
+        for (size_t first_node = 0; first_node < node_count; first_node += WO_NODE_CHUNK_SIZE) {
+            NodeChunk const* chunk = node_chunk(store, (Wo_Node)first_node);
+            size_t const chunk_node_count = MIN(WO_NODE_CHUNK_SIZE, node_count - first_node);
+            memcpy(types + first_node, chunk->type_table, chunk_node_count * sizeof(NodeType));
+            memcpy(infos + first_node, chunk->info_table, chunk_node_count * sizeof(NodeInfo));
+            memcpy(reference_counts + first_node, chunk->reference_count_table, chunk_node_count * sizeof(uint32_t));
+            memcpy(nonroot_words + first_node/64, chunk->is_nonroot_bitset, (chunk_node_count + 63) / 64 * sizeof(uint64_t));
+        }
+        void const* section_data[WO_SCENE_FILE_SECTION_COUNT] = {
+            [WO_SCENE_FILE_SECTION_NODE_TYPES] = types,
+            [WO_SCENE_FILE_SECTION_NODE_INFOS] = infos,
+            [WO_SCENE_FILE_SECTION_NODE_REFERENCE_COUNTS] = reference_counts,
+            [WO_SCENE_FILE_SECTION_NONROOT_BITSET] = nonroot_words,
+            [WO_SCENE_FILE_SECTION_MATERIALS] = renderer->materials,
+            [WO_SCENE_FILE_SECTION_GPU_SCENE] = gpu_scene_data,
+            [WO_SCENE_FILE_SECTION_GPU_ACCEL] = renderer->committed_accel_gpu_data,
+            [WO_SCENE_FILE_SECTION_GPU_COMPONENT_AABBS] = renderer->committed_component_aabbs
+        };
+        ok = write_scene_file(file_path, &header, section_data);
+        if (ok) {
+            printf(
+                "[Wololo] Saved scene of renderer \"%s\" to '%s': %zu nodes, %u materials%s.\n",
+                renderer->name,
+                file_path,
+                node_count,
+                renderer->material_count,
+                has_gpu_scene ? ", prebuilt GPU scene" : ""
+            );
+        } else {
+            printf("[Wololo] Failed to save the scene of renderer \"%s\" to '%s'.\n", renderer->name, file_path);
+        }
+    } else {
+        printf("[Wololo] Failed to allocate memory while saving the scene of renderer \"%s\".\n", renderer->name);
+    }
+    free(types);
+    free(infos);
+    free(reference_counts);
+    free(nonroot_words);
+    free(gpu_scene_data);
+    return ok;
+}
+bool load_scene_mmap(Wo_Renderer* renderer, char const* file_path) {
+    assert(!renderer->scene_build_in_progress && "[Wololo] Cannot load a scene mid-build: end the build first.");
+    double load_start_sec = get_renderer_time_sec(renderer);
+    SceneFile file;
+    if (!map_scene_file(file_path, &file)) {
+        return false;
+    }
+    SceneFileHeader const* header = file.header;
+    size_t const node_count = header->node_count;
+
+    // copying each table into fresh chunks a chunk's slice at a time, straight from the mapping:
+    // (dirty bits start cleared, as after a commit)
+    NodeStore* new_store = calloc(1, sizeof(NodeStore));
+    if (new_store == NULL || !node_store_reserve(new_store, 0, node_count)) {
+        printf("[Wololo] Failed to allocate memory while loading scene file '%s'.\n", file_path);
+        if (new_store != NULL) {
+            node_store_free(new_store);
+        }
+        free(new_store);
+        unmap_scene_file(&file);
+        return false;
+    }
+    NodeType const* types = scene_file_section(&file, WO_SCENE_FILE_SECTION_NODE_TYPES);
+    NodeInfo const* infos = scene_file_section(&file, WO_SCENE_FILE_SECTION_NODE_INFOS);
+    uint32_t const* reference_counts = scene_file_section(&file, WO_SCENE_FILE_SECTION_NODE_REFERENCE_COUNTS);
+    uint64_t const* nonroot_words = scene_file_section(&file, WO_SCENE_FILE_SECTION_NONROOT_BITSET);
+    for (size_t first_node = 0; first_node < node_count; first_node += WO_NODE_CHUNK_SIZE) {
+        NodeChunk* chunk = node_chunk(new_store, (Wo_Node)first_node);
+        size_t const chunk_node_count = MIN(WO_NODE_CHUNK_SIZE, node_count - first_node);
+        memcpy(chunk->type_table, types + first_node, chunk_node_count * sizeof(NodeType));
+        memcpy(chunk->info_table, infos + first_node, chunk_node_count * sizeof(NodeInfo));
+        memcpy(chunk->reference_count_table, reference_counts + first_node, chunk_node_count * sizeof(uint32_t));
+        memcpy(chunk->is_nonroot_bitset, nonroot_words + first_node/64, (chunk_node_count + 63) / 64 * sizeof(uint64_t));
+    }
+
+    // swapping the chunks and materials in (every Wo_Node and Wo_Material is the file's):
+    node_store_free(&renderer->node_store);
+    renderer->node_store = *new_store;
+    free(new_store);
+    renderer->current_node_count = node_count;
+    renderer->free_node_list_head = header->free_node_list_head;
+    renderer->free_node_count = header->free_node_count;
+    memcpy(renderer->materials, scene_file_section(&file, WO_SCENE_FILE_SECTION_MATERIALS), header->material_count * sizeof(GpuMaterial));
+    renderer->material_count = header->material_count;
+    renderer->scene_has_dirty_nodes = false;
+    renderer->scene_needs_commit = true;
+    renderer->accumulated_sample_count = 0;
+
+    // uploading the prebuilt GPU scene straight from the mapping (into the staging buffers), or
+    // flattening the tables if there is none (or it no longer fits the ubershader):
+    GpuSceneHeader const* gpu_scene_header = scene_file_section(&file, WO_SCENE_FILE_SECTION_GPU_SCENE);
+    bool is_prebuilt = (
+        scene_file_has_gpu_scene(&file) &&
+        gpu_scene_header->stack_depth <= WO_CSG_STACK_CAPACITY
+    );
+    bool commit_ok;
+    if (is_prebuilt) {
+        GpuSceneAccelHeader const* gpu_accel_header = scene_file_section(&file, WO_SCENE_FILE_SECTION_GPU_ACCEL);
+
+        // the committed scene's CPU copies refer to the old nodes: (see 'update_scene')
+        free_flat_scene(&renderer->committed_flat_scene);
+        free_scene_accel(&renderer->committed_scene_accel);
+        free(renderer->committed_flat_dirty_bitset);
+        free(renderer->committed_accel_gpu_data);
+        free(renderer->committed_component_aabbs);
+        renderer->committed_flat_dirty_bitset = NULL;
+        renderer->committed_accel_gpu_data = NULL;
+        renderer->committed_accel_gpu_size = 0;
+        renderer->committed_component_aabbs = NULL;
+        renderer->committed_component_aabb_count = 0;
+
+        renderer->scene_gpu_node_count = gpu_scene_header->node_count;
+        renderer->scene_unoptimized_gpu_node_count = header->gpu_unoptimized_node_count;
+        renderer->scene_prototype_count = header->gpu_prototype_count;
+        renderer->scene_instance_count = header->gpu_instance_count;
+        renderer->scene_node_type_mask = header->gpu_node_type_mask;
+        renderer->scene_stack_depth = gpu_scene_header->stack_depth;
+        renderer->scene_bvh_node_count = gpu_accel_header->bvh_node_count;
+        renderer->scene_bounded_component_count = gpu_accel_header->bounded_component_count;
+        renderer->scene_unbounded_component_count = gpu_accel_header->unbounded_component_count;
+        renderer->is_committed_scene_prebuilt = true;
+        commit_ok = upload_scene(
+            renderer,
+            gpu_scene_header, (size_t)header->sections[WO_SCENE_FILE_SECTION_GPU_SCENE].size,
+            gpu_accel_header, (size_t)header->sections[WO_SCENE_FILE_SECTION_GPU_ACCEL].size,
+            scene_file_section(&file, WO_SCENE_FILE_SECTION_GPU_COMPONENT_AABBS),
+            gpu_accel_header->bounded_component_count
+        );
+        if (commit_ok) {
+            renderer->scene_needs_commit = false;
+        }
+    } else {
+        commit_ok = commit_scene(renderer);
+    }
 
+    printf(
+        "[Wololo] Loaded scene of renderer \"%s\" from '%s': %zu nodes, %u materials%s (%zu bytes in %.3f sec).\n",
+        renderer->name,
+        file_path,
+        node_count,
+        renderer->material_count,
+        is_prebuilt ? ", prebuilt GPU scene" : "",
+        file.size,
+        get_renderer_time_sec(renderer) - load_start_sec
+    );
+    unmap_scene_file(&file);
+    return commit_ok;
+}
 //
 //
 // Interface:
 //
 //
 
-Wo_Renderer* wo_renderer_new(Wo_App* app, char const* name, size_t max_renderer_count) {
-    return new_renderer(app, name, max_renderer_count);
+Wo_Renderer* wo_renderer_new(Wo_App* app, char const* name, size_t initial_node_capacity, uint32_t frames_in_flight) {
+    return new_renderer(app, name, initial_node_capacity, frames_in_flight);
+}
+Wo_Renderer* wo_renderer_new_headless(char const* name, size_t initial_node_capacity, uint32_t width, uint32_t height, uint32_t frames_in_flight) {
+    return new_headless_renderer(name, initial_node_capacity, width, height, frames_in_flight, 0);
+}
+Wo_Renderer* wo_renderer_new_headless_on_device(char const* name, size_t initial_node_capacity, uint32_t width, uint32_t height, uint32_t frames_in_flight, uint32_t device_index) {
+    return new_headless_renderer(name, initial_node_capacity, width, height, frames_in_flight, device_index);
+}
+uint32_t wo_renderer_device_count(void) {
+    return count_vk_physical_devices();
 }
 void wo_renderer_del(Wo_Renderer* renderer) {
     del_renderer(renderer);
@@ -2289,6 +7002,51 @@ void wo_renderer_del(Wo_Renderer* renderer) {
 void wo_renderer_draw_frame(Wo_Renderer* renderer) {
     draw_frame_with_renderer(renderer);
 }
+bool wo_renderer_commit_scene(Wo_Renderer* renderer) {
+    return commit_scene(renderer);
+}
+bool wo_renderer_read_frame(Wo_Renderer* renderer, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size) {
+    return read_frame(renderer, format, out_pixels, out_pixels_size);
+}
+void wo_renderer_get_stats(Wo_Renderer* renderer, Wo_Renderer_Stats* out_stats) {
+    get_stats(renderer, out_stats);
+}
+bool wo_renderer_set_node_argument(Wo_Renderer* renderer, Wo_Node node, Wo_Node_Side side, Wo_Node_Argument arg) {
+    return set_node_argument(renderer, node, side, arg);
+}
+bool wo_renderer_set_trace_path(Wo_Renderer* renderer, Wo_Trace_Path trace_path) {
+    return set_trace_path(renderer, trace_path);
+}
+Wo_Trace_Path wo_renderer_get_trace_path(Wo_Renderer* renderer) {
+    return renderer->trace_path;
+}
+bool wo_renderer_set_progressive(Wo_Renderer* renderer, bool progressive) {
+    return set_progressive(renderer, progressive);
+}
+bool wo_renderer_set_frame_region(Wo_Renderer* renderer, uint32_t full_width, uint32_t full_height, uint32_t x, uint32_t y) {
+    return set_frame_region(renderer, full_width, full_height, x, y);
+}
+void wo_renderer_set_debug_view(Wo_Renderer* renderer, Wo_Debug_View debug_view) {
+    set_debug_view(renderer, debug_view);
+}
+Wo_Material wo_renderer_add_lambertian_material(Wo_Renderer* renderer, Wo_Vec3 albedo) {
+    return add_lambertian_material(renderer, albedo);
+}
+Wo_Material wo_renderer_add_metal_material(Wo_Renderer* renderer, Wo_Vec3 albedo, Wo_Scalar fuzz) {
+    return add_metal_material(renderer, albedo, fuzz);
+}
+Wo_Material wo_renderer_add_dielectric_material(Wo_Renderer* renderer, Wo_Scalar refraction_index) {
+    return add_dielectric_material(renderer, refraction_index);
+}
+bool wo_renderer_set_node_material(Wo_Renderer* renderer, Wo_Node node, Wo_Material material) {
+    return set_node_material(renderer, node, material);
+}
+bool wo_renderer_set_path_tracing(Wo_Renderer* renderer, bool path_tracing, uint32_t max_bounce_count, uint64_t ray_budget_per_frame) {
+    return set_path_tracing(renderer, path_tracing, max_bounce_count, ray_budget_per_frame);
+}
+bool wo_renderer_set_frame_time_target(Wo_Renderer* renderer, double target_frame_time_sec) {
+    return set_frame_time_target(renderer, target_frame_time_sec);
+}
 
 Wo_Node wo_renderer_add_sphere_node(Wo_Renderer* renderer, Wo_Scalar radius) {
     return add_sphere_node(renderer, radius);
@@ -2306,8 +7064,50 @@ Wo_Node wo_renderer_add_difference_of_node(Wo_Renderer* renderer, Wo_Node_Argume
     return add_difference_of_node(renderer, left, right);
 }
 
+bool wo_renderer_remove_subtree(Wo_Renderer* renderer, Wo_Node root) {
+    return remove_subtree(renderer, root);
+}
+bool wo_renderer_compact(Wo_Renderer* renderer, Wo_Node* out_new_nodes, size_t out_new_node_count) {
+    return compact_nodes(renderer, out_new_nodes, out_new_node_count);
+}
+bool wo_renderer_save_scene(Wo_Renderer* renderer, char const* file_path) {
+    return save_scene(renderer, file_path);
+}
+bool wo_renderer_load_scene_mmap(Wo_Renderer* renderer, char const* file_path) {
+    return load_scene_mmap(renderer, file_path);
+}
+
+bool wo_renderer_begin_scene_build(Wo_Renderer* renderer) {
+    return begin_scene_build(renderer);
+}
+bool wo_renderer_end_scene_build(Wo_Renderer* renderer) {
+    return end_scene_build(renderer);
+}
+void wo_scene_builder_init(Wo_Scene_Builder* builder, Wo_Renderer* renderer) {
+    init_scene_builder(builder, renderer);
+}
+void wo_scene_builder_finish(Wo_Scene_Builder* builder) {
+    finish_scene_builder(builder);
+}
+Wo_Node wo_scene_builder_add_sphere_node(Wo_Scene_Builder* builder, Wo_Scalar radius) {
+    return scene_builder_add_sphere_node(builder, radius);
+}
+Wo_Node wo_scene_builder_add_infinite_planar_partition_node(Wo_Scene_Builder* builder, Wo_Vec3 outward_facing_normal) {
+    return scene_builder_add_infinite_planar_partition_node(builder, outward_facing_normal);
+}
+Wo_Node wo_scene_builder_add_union_of_node(Wo_Scene_Builder* builder, Wo_Node_Argument left, Wo_Node_Argument right) {
+    return scene_builder_add_binop_node(builder, WO_NODE_BINOP_UNION_OF, left, right);
+}
+Wo_Node wo_scene_builder_add_intersection_of_node(Wo_Scene_Builder* builder, Wo_Node_Argument left, Wo_Node_Argument right) {
+    return scene_builder_add_binop_node(builder, WO_NODE_BINOP_INTERSECTION_OF, left, right);
+}
+Wo_Node wo_scene_builder_add_difference_of_node(Wo_Scene_Builder* builder, Wo_Node_Argument left, Wo_Node_Argument right) {
+    return scene_builder_add_binop_node(builder, WO_NODE_BINOP_DIFFERENCE_OF, left, right);
+}
+
 bool wo_renderer_isroot(Wo_Renderer* renderer, Wo_Node node) {
-    uint64_t cmp_word = renderer->node_is_nonroot_bitset[node/64];
-    uint64_t is_nonroot = cmp_word & ((size_t)1 << (size_t)(node%64));
-    return !is_nonroot;
+    if (node >= renderer->current_node_count) {
+        return false;
+    }
+    return node_is_root(&renderer->node_store, node);
 }
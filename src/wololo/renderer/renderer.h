@@ -15,19 +15,364 @@ typedef struct Wo_Renderer Wo_Renderer;
 typedef uint32_t Wo_Node;
 typedef uint32_t Wo_Material;
 
-Wo_Renderer* wo_renderer_new(Wo_App* app, char const* name, size_t max_node_count);
+// 'frames_in_flight' frames may be queued on the GPU while the CPU prepares the next one,
+// up to WO_RENDERER_MAX_FRAMES_IN_FLIGHT (0 selects WO_RENDERER_DEFAULT_FRAMES_IN_FLIGHT).
+// More frames hide more CPU work behind GPU work, at the cost of latency.
+#define WO_RENDERER_MAX_FRAMES_IN_FLIGHT (4)
+#define WO_RENDERER_DEFAULT_FRAMES_IN_FLIGHT (2)
+
+// Nodes are stored in chunks allocated as they are added, up to WO_RENDERER_MAX_NODE_COUNT;
+// 'initial_node_capacity' nodes' worth are allocated up front.
+#define WO_RENDERER_MAX_NODE_COUNT ((size_t)1 << 26)
+
+Wo_Renderer* wo_renderer_new(Wo_App* app, char const* name, size_t initial_node_capacity, uint32_t frames_in_flight);
 void wo_renderer_del(Wo_Renderer* renderer);
 void wo_renderer_draw_frame(Wo_Renderer* renderer);
 
+// Headless renderers need no app, window or display: they draw 'width' x 'height' frames into
+// offscreen images instead of a swapchain, and copy each into host memory to be read back.
+Wo_Renderer* wo_renderer_new_headless(char const* name, size_t initial_node_capacity, uint32_t width, uint32_t height, uint32_t frames_in_flight);
+
+// Headless renderers may be created on any of the machine's Vulkan devices (GPUs), numbered from
+// 0 to 'wo_renderer_device_count() - 1' in the order Vulkan enumerates them; the others use
+// device 0. Each renderer holds its own copy of the scene. (see 'Wo_Render_Farm' to share frames
+// between them)
+uint32_t wo_renderer_device_count(void);
+Wo_Renderer* wo_renderer_new_headless_on_device(char const* name, size_t initial_node_capacity, uint32_t width, uint32_t height, uint32_t frames_in_flight, uint32_t device_index);
+
+// Frame regions: a headless renderer may draw the ('width' x 'height', as created) region at
+// ('x', 'y') from the top left corner of a larger 'full_width' x 'full_height' frame, as the
+// camera sees it in that frame. Returns false if not headless, or if the region does not fit.
+bool wo_renderer_set_frame_region(Wo_Renderer* renderer, uint32_t full_width, uint32_t full_height, uint32_t x, uint32_t y);
+
+// Reads back the oldest frame drawn by a headless renderer and not read yet, waiting for it if
+// still in flight; rows are written top to bottom and tightly packed into 'out_pixels'.
+// Readbacks are buffered per frame in flight, so drawing frame N+1 before reading frame N lets
+// the GPU work on one while the other is copied out (unread frames beyond that are dropped).
+// Returns false if there is no frame to read, or it does not fit in 'out_pixels_size' bytes.
+typedef enum Wo_Pixel_Format Wo_Pixel_Format;
+enum Wo_Pixel_Format {
+    // 4 x uint8_t per pixel, sRGB-encoded (as presented):
+    WO_PIXEL_FORMAT_RGBA8,
+    // 4 x float per pixel, linear:
+    WO_PIXEL_FORMAT_RGBA32F
+};
+bool wo_renderer_read_frame(Wo_Renderer* renderer, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size);
+
+// Flattens the node tables and uploads them to the GPU.
+// Called implicitly by 'wo_renderer_draw_frame' if nodes were added since the last commit.
+bool wo_renderer_commit_scene(Wo_Renderer* renderer);
+
+// Selects how the scene is traced: with a fragment shader over a fullscreen quad, with a
+// compute shader over screen tiles whose output is blitted to the swapchain, or with that
+// compute shader using hardware ray queries (VK_KHR_ray_query) in place of the software BVH.
+// Defaults to the ray query path where the device supports it, else to the fragment path.
+// Returns false (and keeps the current path) if the device does not support 'trace_path'.
+typedef enum Wo_Trace_Path Wo_Trace_Path;
+enum Wo_Trace_Path {
+    WO_TRACE_PATH_FRAGMENT,
+    WO_TRACE_PATH_COMPUTE,
+    WO_TRACE_PATH_RAY_QUERY
+};
+bool wo_renderer_set_trace_path(Wo_Renderer* renderer, Wo_Trace_Path trace_path);
+Wo_Trace_Path wo_renderer_get_trace_path(Wo_Renderer* renderer);
+
+// Progressive mode: the compute paths trace one jittered sample per pixel per frame and display
+// the running average of every sample since the scene, trace path or resolution last changed,
+// converging to an anti-aliased image while the scene is still. (The fragment path is unaffected.)
+// Returns false if the device supports no compute path. Off by default.
+bool wo_renderer_set_progressive(Wo_Renderer* renderer, bool progressive);
+
+// Debug views replace the shading of every trace path:
+// - screen coordinates: each pixel's horizontal and vertical position in [0,1] as red and green,
+// - hit distance: the distance of each pixel's first hit, brighter when nearer (black on a miss).
+// Like every trace pipeline, each view's is specialized to the scene (see the stats' pipeline
+// variants). WO_DEBUG_VIEW_NONE by default.
+typedef enum Wo_Debug_View Wo_Debug_View;
+enum Wo_Debug_View {
+    WO_DEBUG_VIEW_NONE,
+    WO_DEBUG_VIEW_SCREEN_COORDINATES,
+    WO_DEBUG_VIEW_HIT_DISTANCE
+};
+void wo_renderer_set_debug_view(Wo_Renderer* renderer, Wo_Debug_View debug_view);
+
+// Materials describe how light scatters off the surface of leaves, as in the "Ray Tracing in
+// One Weekend" series: lambertian (diffuse), metal (reflective, blurred by 'fuzz' in [0,1]) and
+// dielectric (glass-like, refracting by 'refraction_index').
+// Every leaf starts with WO_MATERIAL_DEFAULT, a grey lambertian; materials cannot be removed.
+// Returns WO_MATERIAL_NONE once WO_RENDERER_MAX_MATERIAL_COUNT materials were added.
+#define WO_RENDERER_MAX_MATERIAL_COUNT (256)
+#define WO_MATERIAL_DEFAULT ((Wo_Material)0)
+#define WO_MATERIAL_NONE ((Wo_Material)0xFFFFFFFFu)
+Wo_Material wo_renderer_add_lambertian_material(Wo_Renderer* renderer, Wo_Vec3 albedo);
+Wo_Material wo_renderer_add_metal_material(Wo_Renderer* renderer, Wo_Vec3 albedo, Wo_Scalar fuzz);
+Wo_Material wo_renderer_add_dielectric_material(Wo_Renderer* renderer, Wo_Scalar refraction_index);
+// Returns false if 'node' is not a leaf or 'material' was not added to this renderer.
+bool wo_renderer_set_node_material(Wo_Renderer* renderer, Wo_Node node, Wo_Material material);
+
+// Path tracing (compute paths only): rather than shading the first hit by its normal (the fast
+// preview, and the fragment path's only mode), light is gathered from the sky along paths
+// scattered by each surface's material, of up to 'max_bounce_count' bounces
+// (at most WO_RENDERER_MAX_BOUNCE_COUNT). Paths whose contribution fades are ended early by
+// Russian roulette.
+// 'ray_budget_per_frame' bounds the rays traced per frame: it buys several samples per pixel per
+// frame if large, and fewer bounces if too small for one full-length path per pixel (0 traces
+// one sample per pixel). Best combined with progressive mode, which averages the noise away.
+// Returns false if the device supports no compute path.
+#define WO_RENDERER_MAX_BOUNCE_COUNT (32)
+bool wo_renderer_set_path_tracing(Wo_Renderer* renderer, bool path_tracing, uint32_t max_bounce_count, uint64_t ray_budget_per_frame);
+
+// Adaptive resolution (compute paths only): holds the GPU time of each frame (measured with
+// timestamp queries) under 'target_frame_time_sec' by tracing fewer pixels, between
+// WO_RENDERER_MIN_RENDER_SCALE and all of the frame's width and height, then upscaling them onto
+// the frame. The scale drops as soon as the target is missed, and rises once well under it.
+// 0 disables it, returning to full resolution. Returns false if the device supports no compute
+// path or no timestamps. Disabled by default.
+#define WO_RENDERER_MIN_RENDER_SCALE (0.25f)
+bool wo_renderer_set_frame_time_target(Wo_Renderer* renderer, double target_frame_time_sec);
+
 typedef struct Wo_Node_Argument Wo_Node_Argument;
 struct Wo_Node_Argument {
     Wo_Quaternion orientation;
     Wo_Vec3 offset;
     Wo_Node node;
 };
+// Adding nodes returns WO_NODE_NONE (rather than asserting) once WO_RENDERER_MAX_NODE_COUNT
+// nodes were added, if out of memory, or (for binops) if an operand is WO_NODE_NONE, so failures
+// propagate up a tree being built.
 Wo_Node wo_renderer_add_sphere_node(Wo_Renderer* renderer, Wo_Scalar radius);
 Wo_Node wo_renderer_add_infinite_planar_partition_node(Wo_Renderer* renderer, Wo_Vec3 outward_facing_normal);
 Wo_Node wo_renderer_add_union_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right);
 Wo_Node wo_renderer_add_intersection_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right);
 Wo_Node wo_renderer_add_difference_of_node(Wo_Renderer* renderer, Wo_Node_Argument left, Wo_Node_Argument right);
 bool wo_renderer_isroot(Wo_Renderer* renderer, Wo_Node node);
+
+// Removes root 'root' and every node in its subtree that no other binop refers to (shared
+// subtrees stay as long as another binop uses them). Removed nodes' IDs are reused by the next
+// nodes added. Returns false if 'root' does not exist or is an operand.
+bool wo_renderer_remove_subtree(Wo_Renderer* renderer, Wo_Node root);
+
+// Renumbers the nodes reachable from roots into depth-first (post-)order, root by root, freeing
+// the chunks left unused by removed nodes, and re-commits the scene. Every Wo_Node changes: if
+// 'out_new_nodes' is not NULL, node N's new ID is written to 'out_new_nodes[N]' (or WO_NODE_NONE
+// if it was removed), for all N below 'out_new_node_count'; size it from 'node_count' plus
+// 'free_node_count' in the stats. Explicit rather than in the background, since the caller must
+// update the IDs it holds. Returns false if out of memory (leaving the nodes as they were) or
+// if the scene could not be committed.
+bool wo_renderer_compact(Wo_Renderer* renderer, Wo_Node* out_new_nodes, size_t out_new_node_count);
+
+// Scene files store the node tables (and materials) as laid out in memory, along with the
+// committed GPU scene (the flattened nodes, BVH and component AABBs) unless it could not be
+// committed: loading one maps the file and copies the tables in a chunk at a time, then uploads
+// the GPU scene straight from the mapping, so no node is added, parsed or flattened one by one.
+// - saving commits the scene first if it changed since the last commit.
+// - loading replaces every node and material: Wo_Nodes and Wo_Materials are the ones they had
+//   when saved. The first node moved after loading re-commits the scene (it was never flattened
+//   here, so there is nothing to patch). Files lacking a GPU scene are committed as they load.
+// Files are only read back by builds laying the tables out the same way (byte order, scalar
+// precision), and are otherwise trusted. Both return false if the file could not be written or
+// read (leaving the scene as it was), or if the loaded scene could not be committed.
+bool wo_renderer_save_scene(Wo_Renderer* renderer, char const* file_path);
+bool wo_renderer_load_scene_mmap(Wo_Renderer* renderer, char const* file_path);
+
+// Scene builders add nodes from several threads at once (e.g. to import a large scene across
+// cores), between 'wo_renderer_begin_scene_build' and 'wo_renderer_end_scene_build':
+// - each thread adds nodes through its own builder, which reserves node IDs
+//   WO_SCENE_BUILDER_RESERVATION_SIZE at a time with an atomic bump, so threads rarely contend.
+// - a binop's operands may have been added by any thread, once their IDs were handed over.
+// - each builder is finished once its thread is done, retiring the IDs it reserved but did not use.
+// - the build is ended (committing the scene) once every builder finished and its writes are
+//   visible to the ending thread (e.g. once the builders' threads were joined).
+// During a build, the renderer's other functions must not be called. Builders' nodes are
+// WO_NODE_NONE once WO_RENDERER_MAX_NODE_COUNT IDs were reserved, if an operand was
+// WO_NODE_NONE, or if out of memory (in which case ending the build discards its nodes).
+#define WO_NODE_NONE ((Wo_Node)0xFFFFFFFFu)
+#define WO_SCENE_BUILDER_RESERVATION_SIZE (1024)
+typedef struct Wo_Scene_Builder Wo_Scene_Builder;
+struct Wo_Scene_Builder {
+    Wo_Renderer* renderer;
+    // the reserved IDs not used yet:
+    Wo_Node next_node;
+    Wo_Node end_node;
+};
+// Returns false if a build is already in progress.
+bool wo_renderer_begin_scene_build(Wo_Renderer* renderer);
+// Returns false if the scene could not be committed.
+bool wo_renderer_end_scene_build(Wo_Renderer* renderer);
+void wo_scene_builder_init(Wo_Scene_Builder* builder, Wo_Renderer* renderer);
+void wo_scene_builder_finish(Wo_Scene_Builder* builder);
+Wo_Node wo_scene_builder_add_sphere_node(Wo_Scene_Builder* builder, Wo_Scalar radius);
+Wo_Node wo_scene_builder_add_infinite_planar_partition_node(Wo_Scene_Builder* builder, Wo_Vec3 outward_facing_normal);
+Wo_Node wo_scene_builder_add_union_of_node(Wo_Scene_Builder* builder, Wo_Node_Argument left, Wo_Node_Argument right);
+Wo_Node wo_scene_builder_add_intersection_of_node(Wo_Scene_Builder* builder, Wo_Node_Argument left, Wo_Node_Argument right);
+Wo_Node wo_scene_builder_add_difference_of_node(Wo_Scene_Builder* builder, Wo_Node_Argument left, Wo_Node_Argument right);
+
+// Moves the 'side' operand of binop 'node' to 'arg' (its orientation and offset; 'arg.node' must
+// be the node's existing operand). Cheap enough to call every frame: moved nodes are patched into
+// the GPU scene at the start of the next frame, uploading only the records that changed.
+typedef enum Wo_Node_Side Wo_Node_Side;
+enum Wo_Node_Side {
+    WO_NODE_SIDE_LEFT,
+    WO_NODE_SIDE_RIGHT
+};
+bool wo_renderer_set_node_argument(Wo_Renderer* renderer, Wo_Node node, Wo_Node_Side side, Wo_Node_Argument arg);
+
+// GPU memory is sub-allocated from a few large blocks, accounted for by what it holds:
+typedef enum Wo_Gpu_Memory_Category Wo_Gpu_Memory_Category;
+enum Wo_Gpu_Memory_Category {
+    WO_GPU_MEMORY_UNIFORMS,
+    WO_GPU_MEMORY_SCENE,
+    WO_GPU_MEMORY_STAGING,
+    WO_GPU_MEMORY_IMAGES,
+    WO_GPU_MEMORY_CATEGORY_COUNT
+};
+
+// Counters and timings accumulated since the renderer was created.
+// - device: the index (see 'wo_renderer_device_count') and name of the renderer's device.
+// - BVH refits: incremental updates refit the scene's BVH to moved nodes...
+// - BVH rebuilds: ...unless a refit would degrade it too much. Commits always rebuild it.
+// - GPU memory, per category: bytes in use by live buffers and images, and bytes reserved by
+//   the device memory blocks they are sub-allocated from (as of the call).
+// - traced rays: primary and bounce rays counted by the compute paths (the fragment path is not
+//   counted), and their rate over the last second or so, as read back from completed frames.
+// - GPU timings, per pass of the frame (measured with timestamp queries, so all 0 if the device
+//   supports none): the whole frame, tracing (the trace path's dispatch or render pass, which
+//   also accumulates samples in progressive mode), blitting the traced image onto the frame,
+//   the headless readback copy, and incremental scene updates' uploads.
+// - CPU submit time: preparing and submitting a frame (including scene updates and commits, but
+//   not waiting on the GPU).
+// - uploaded bytes: by commits and incremental updates.
+// - scene: nodes in use, removed nodes awaiting reuse, the capacity of the chunks allocated for
+//   them, and flattened GPU nodes, BVH nodes and components of the last committed scene.
+// - pipeline variants: trace pipelines specialized to the committed scene (the node types it
+//   contains and its CSG stack depth), the path tracer's max bounce count and the debug view,
+//   compiled in the background the first time each combination is drawn on a trace path (the
+//   generic pipeline draws until then): how many were compiled (and their compile times), and
+//   how many times one was reused from the cache instead.
+// - render scale: the current one (see 'wo_renderer_set_frame_time_target'), how often it
+//   changed, and the last WO_RENDERER_RENDER_SCALE_HISTORY_LENGTH scales it changed to, oldest
+//   first.
+#define WO_RENDERER_RENDER_SCALE_HISTORY_LENGTH (16)
+#define WO_RENDERER_DEVICE_NAME_CAPACITY (256)
+
+// a timing of the last sample, the mean and max of the last 64 samples, and the sum of them all:
+typedef struct Wo_Renderer_Timing Wo_Renderer_Timing;
+struct Wo_Renderer_Timing {
+    double last_sec;
+    double mean_sec;
+    double max_sec;
+    uint64_t sample_count;
+    double total_sec;
+};
+typedef struct Wo_Renderer_Stats Wo_Renderer_Stats;
+struct Wo_Renderer_Stats {
+    uint32_t device_index;
+    char device_name[WO_RENDERER_DEVICE_NAME_CAPACITY];
+
+    uint64_t bvh_refit_count;
+    double bvh_refit_last_time_sec;
+    double bvh_refit_total_time_sec;
+    uint64_t bvh_rebuild_count;
+    double bvh_rebuild_last_time_sec;
+    double bvh_rebuild_total_time_sec;
+
+    uint64_t gpu_memory_in_use_bytes[WO_GPU_MEMORY_CATEGORY_COUNT];
+    uint64_t gpu_memory_reserved_bytes[WO_GPU_MEMORY_CATEGORY_COUNT];
+    uint32_t gpu_memory_allocation_count[WO_GPU_MEMORY_CATEGORY_COUNT];
+    uint32_t gpu_memory_block_count;
+
+    uint64_t traced_ray_count;
+    double traced_rays_per_sec;
+
+    Wo_Renderer_Timing gpu_frame_time;
+    Wo_Renderer_Timing gpu_trace_time;
+    Wo_Renderer_Timing gpu_blit_time;
+    Wo_Renderer_Timing gpu_readback_time;
+    Wo_Renderer_Timing gpu_upload_time;
+    Wo_Renderer_Timing cpu_submit_time;
+    uint64_t uploaded_bytes;
+
+    uint32_t node_count;
+    uint32_t free_node_count;
+    uint32_t node_capacity;
+    uint32_t gpu_node_count;
+    // before pruning, deduplicating and rebalancing (see 'WO_OPTIMIZE_SCENES'):
+    uint32_t unoptimized_gpu_node_count;
+    // shared components flattened once, and their references (see 'Instancing' in 'scene.h'):
+    uint32_t prototype_count;
+    uint32_t instance_count;
+    uint32_t bvh_node_count;
+    uint32_t bounded_component_count;
+    uint32_t unbounded_component_count;
+
+    uint32_t pipeline_variant_count;
+    uint64_t pipeline_variant_hit_count;
+    Wo_Renderer_Timing pipeline_variant_compile_time;
+
+    float render_scale;
+    uint32_t render_scale_change_count;
+    float render_scale_history[WO_RENDERER_RENDER_SCALE_HISTORY_LENGTH];
+    uint32_t render_scale_history_count;
+};
+void wo_renderer_get_stats(Wo_Renderer* renderer, Wo_Renderer_Stats* out_stats);
+
+// Render farms draw frames with a headless renderer on each of the machine's devices (up to
+// WO_RENDER_FARM_MAX_DEVICE_COUNT, or 'max_device_count' if not 0), each holding its own copy of
+// the scene: loaded into every one with 'wo_render_farm_load_scene_mmap', or built by making the
+// same calls on each renderer (nodes get the same Wo_Nodes on every one, added in the same order).
+// - split frames: each device draws a band of rows of every frame (see
+//   'wo_renderer_set_frame_region'), read back into one frame.
+// - alternate frames: frames are drawn by each device in turn, and read back in order.
+// Devices work in parallel: drawing only waits on the device drawn on, for its oldest frame in
+// flight. As with headless renderers, frames are read back oldest first, and unread frames are
+// dropped once every device has 'frames_in_flight' frames buffered.
+// Device renderers may also run independent jobs, drawn and read through their own functions
+// (between, not during, the farm's frames).
+// Returns NULL if no renderer could be created on any device.
+#define WO_RENDER_FARM_MAX_DEVICE_COUNT (8)
+typedef struct Wo_Render_Farm Wo_Render_Farm;
+typedef enum Wo_Render_Farm_Mode Wo_Render_Farm_Mode;
+enum Wo_Render_Farm_Mode {
+    WO_RENDER_FARM_SPLIT_FRAME,
+    WO_RENDER_FARM_ALTERNATE_FRAMES
+};
+Wo_Render_Farm* wo_render_farm_new(
+    char const* name, size_t initial_node_capacity,
+    uint32_t width, uint32_t height, uint32_t frames_in_flight,
+    Wo_Render_Farm_Mode mode, uint32_t max_device_count
+);
+void wo_render_farm_del(Wo_Render_Farm* farm);
+uint32_t wo_render_farm_device_count(Wo_Render_Farm* farm);
+// the renderer of the farm's 'device'-th device (NULL past 'wo_render_farm_device_count'):
+Wo_Renderer* wo_render_farm_renderer(Wo_Render_Farm* farm, uint32_t device);
+// Returns false if the scene could not be loaded on every device.
+bool wo_render_farm_load_scene_mmap(Wo_Render_Farm* farm, char const* file_path);
+void wo_render_farm_draw_frame(Wo_Render_Farm* farm);
+// Returns false if there is no frame to read, or it does not fit in 'out_pixels_size' bytes.
+bool wo_render_farm_read_frame(Wo_Render_Farm* farm, Wo_Pixel_Format format, void* out_pixels, size_t out_pixels_size);
+
+// Per device, since the farm was created: the frames (or bands) it drew, its GPU time (the sum of
+// its frames' GPU frame times, so 0 without timestamp queries), and its utilization, that time
+// over the farm's running time.
+typedef struct Wo_Render_Farm_Device_Stats Wo_Render_Farm_Device_Stats;
+struct Wo_Render_Farm_Device_Stats {
+    uint32_t device_index;
+    char device_name[WO_RENDERER_DEVICE_NAME_CAPACITY];
+    // the band of rows drawn: (the whole frame, but for split frames)
+    uint32_t region_y;
+    uint32_t region_height;
+    uint64_t drawn_frame_count;
+    double gpu_busy_sec;
+    double utilization;
+};
+typedef struct Wo_Render_Farm_Stats Wo_Render_Farm_Stats;
+struct Wo_Render_Farm_Stats {
+    Wo_Render_Farm_Mode mode;
+    uint32_t device_count;
+    uint64_t drawn_frame_count;
+    uint64_t read_frame_count;
+    uint64_t dropped_frame_count;
+    double running_time_sec;
+    Wo_Render_Farm_Device_Stats devices[WO_RENDER_FARM_MAX_DEVICE_COUNT];
+};
+void wo_render_farm_get_stats(Wo_Render_Farm* farm, Wo_Render_Farm_Stats* out_stats);
@@ -0,0 +1,622 @@
+#include "scene.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <assert.h>
+
+#include "wololo/wmath.h"
+#include "wololo/wmath.batch.h"
+
+//
+// Local implementation:
+//
+
+// a frame of the explicit DFS stack used to emit nodes in post-order.
+// (explicit so deep difference chains cannot overflow the C stack)
+typedef struct FlattenFrame FlattenFrame;
+struct FlattenFrame {
+    Wo_Node node;
+    Wo_Node_Argument const* arg;    // NULL for roots: identity transform
+    uint32_t first_flat_index;          // index of the first node emitted in this subtree
+    uint32_t visited_child_count;
+    uint32_t child_flat_indices[2];     // in visiting order
+    bool operands_swapped;              // right operand visited first
+    bool is_component_candidate;        // reached through unions only, from a root
+};
+
+// 'find_prototypes' marks the prototypes to emit with this, before they are emitted:
+#define WO_FLATTEN_PROTOTYPE_PENDING (0xFFFFFFFEu)
+
+// the transforms of the last few nodes emitted, which are converted to 'parent_to_local' rows
+// in batches rather than one at a time:
+#define WO_FLATTEN_TRANSFORM_BATCH_SIZE (256)
+typedef struct PendingTransforms PendingTransforms;
+struct PendingTransforms {
+    uint32_t first_flat_index;
+    uint32_t count;
+    float orientation_real[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+    float orientation_x[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+    float orientation_y[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+    float orientation_z[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+    float offset_x[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+    float offset_y[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+    float offset_z[WO_FLATTEN_TRANSFORM_BATCH_SIZE];
+};
+
+static bool push_flat_node(FlatScene* flat_scene, Wo_Node source_node, uint32_t* out_index);
+static void set_argument_transform(float parent_to_local[3][4], Wo_Node_Argument const* arg);
+static void push_pending_transform(
+    FlatScene* flat_scene, PendingTransforms* pending,
+    uint32_t flat_index, Wo_Node_Argument const* opt_arg
+);
+static void flush_pending_transforms(FlatScene* flat_scene, PendingTransforms* pending);
+static void compose_world_transform(FlatScene* flat_scene, uint32_t node_index);
+static bool compute_node_stack_depths(
+    NodeStore const* node_store,
+    size_t node_count,
+    uint32_t* out_stack_depths
+);
+static bool find_prototypes(
+    NodeStore const* node_store,
+    size_t node_count,
+    uint32_t* out_prototype_roots
+);
+static bool compute_flat_stack_depths(FlatScene* flat_scene);
+
+static bool push_flat_node(FlatScene* flat_scene, Wo_Node source_node, uint32_t* out_index) {
+    if (flat_scene->node_count == flat_scene->node_capacity) {
+        uint32_t new_capacity = flat_scene->node_capacity == 0 ? 64 : 2*flat_scene->node_capacity;
+        GpuSceneNode* new_nodes = realloc(flat_scene->nodes, new_capacity * sizeof(GpuSceneNode));
+        if (new_nodes == NULL) {
+            return false;
+        }
+        flat_scene->nodes = new_nodes;
+        uint32_t* new_source_nodes = realloc(flat_scene->source_nodes, new_capacity * sizeof(uint32_t));
+        if (new_source_nodes == NULL) {
+            return false;
+        }
+        flat_scene->source_nodes = new_source_nodes;
+        uint32_t* new_next_emissions = realloc(flat_scene->next_emissions, new_capacity * sizeof(uint32_t));
+        if (new_next_emissions == NULL) {
+            return false;
+        }
+        flat_scene->next_emissions = new_next_emissions;
+        float (*new_parent_to_local)[3][4] = realloc(flat_scene->parent_to_local, new_capacity * sizeof(float[3][4]));
+        if (new_parent_to_local == NULL) {
+            return false;
+        }
+        flat_scene->parent_to_local = new_parent_to_local;
+        flat_scene->node_capacity = new_capacity;
+    }
+    uint32_t index = flat_scene->node_count++;
+    memset(&flat_scene->nodes[index], 0, sizeof(GpuSceneNode));
+    flat_scene->nodes[index].parent_index = WO_GPU_NODE_NO_PARENT;
+
+    // prepending to the source node's emission chain:
+    flat_scene->source_nodes[index] = source_node;
+    flat_scene->next_emissions[index] = WO_FLAT_NODE_NONE;
+    if (source_node != WO_FLAT_NODE_NONE) {
+        flat_scene->next_emissions[index] = flat_scene->first_emissions[source_node];
+        flat_scene->first_emissions[source_node] = index;
+    }
+    *out_index = index;
+    return true;
+}
+static void set_argument_transform(float parent_to_local[3][4], Wo_Node_Argument const* arg) {
+    // the argument places the child in its parent's space: p_parent = R * p_child + offset,
+    // so the parent-to-local map is p_child = R^T * (p_parent - offset).
+    // (converted like the batches 'flatten_scene' converts, so refreshed nodes match re-flattened ones)
+    float real = (float)arg->orientation.real;
+    float imaginary[3] = {(float)arg->orientation.imaginary.x, (float)arg->orientation.imaginary.y, (float)arg->orientation.imaginary.z};
+    float offset[3] = {(float)arg->offset.x, (float)arg->offset.y, (float)arg->offset.z};
+    Wo_Rigid_Batch transform = {
+        .orientation = {.real = &real, .imaginary = {&imaginary[0], &imaginary[1], &imaginary[2]}},
+        .offset = {&offset[0], &offset[1], &offset[2]}
+    };
+    wo_rigid_batch_write_inverse_rows(transform, parent_to_local, sizeof(float[3][4]), 1);
+}
+static void push_pending_transform(
+    FlatScene* flat_scene, PendingTransforms* pending,
+    uint32_t flat_index, Wo_Node_Argument const* opt_arg
+) {
+    // nodes are emitted in order, so each batch covers a contiguous range of flat indices:
+    assert(flat_index == pending->first_flat_index + pending->count);
+    uint32_t i = pending->count++;
+    Wo_Quaternion orientation = opt_arg != NULL ? opt_arg->orientation : wo_quaternion_identity();
+    Wo_Vec3 offset = opt_arg != NULL ? opt_arg->offset : wo_vec3_0();
+    pending->orientation_real[i] = (float)orientation.real;
+    pending->orientation_x[i] = (float)orientation.imaginary.x;
+    pending->orientation_y[i] = (float)orientation.imaginary.y;
+    pending->orientation_z[i] = (float)orientation.imaginary.z;
+    pending->offset_x[i] = (float)offset.x;
+    pending->offset_y[i] = (float)offset.y;
+    pending->offset_z[i] = (float)offset.z;
+    if (pending->count == WO_FLATTEN_TRANSFORM_BATCH_SIZE) {
+        flush_pending_transforms(flat_scene, pending);
+    }
+}
+static void flush_pending_transforms(FlatScene* flat_scene, PendingTransforms* pending) {
+    Wo_Rigid_Batch transforms = {
+        .orientation = {
+            .real = pending->orientation_real,
+            .imaginary = {pending->orientation_x, pending->orientation_y, pending->orientation_z}
+        },
+        .offset = {pending->offset_x, pending->offset_y, pending->offset_z}
+    };
+    if (pending->count > 0) {
+        wo_rigid_batch_write_inverse_rows(
+            transforms,
+            flat_scene->parent_to_local[pending->first_flat_index],
+            sizeof(float[3][4]),
+            pending->count
+        );
+    }
+    pending->first_flat_index += pending->count;
+    pending->count = 0;
+}
+static void compose_world_transform(FlatScene* flat_scene, uint32_t node_index) {
+    // world_to_local = parent_to_local * parent's world_to_local, i.e. applying the parent's first:
+    // (parents follow their children in post-order, so must be composed first)
+    GpuSceneNode* node = &flat_scene->nodes[node_index];
+    float (*a)[4] = flat_scene->parent_to_local[node_index];
+    if (node->parent_index == WO_GPU_NODE_NO_PARENT) {
+        memcpy(node->world_to_local, a, sizeof(node->world_to_local));
+        return;
+    }
+    assert(node->parent_index > node_index);
+    float (*b)[4] = flat_scene->nodes[node->parent_index].world_to_local;
+    for (int row = 0; row < 3; row++) {
+        for (int col = 0; col < 4; col++) {
+            float v = (col == 3) ? a[row][3] : 0.0f;
+            for (int k = 0; k < 3; k++) {
+                v += a[row][k] * b[k][col];
+            }
+            node->world_to_local[row][col] = v;
+        }
+    }
+}
+static bool compute_node_stack_depths(
+    NodeStore const* node_store,
+    size_t node_count,
+    uint32_t* out_stack_depths
+) {
+    // operands can only refer to existing nodes, so children usually precede their parents and
+    // one forward pass suffices, even though shared subtrees are emitted many times. Nodes added by
+    // scene builders on other threads may have higher IDs than their parents though, so those
+    // are computed first, depth-first (a 0 depth marks nodes not computed yet).
+    // see: https://en.wikipedia.org/wiki/Strahler_number (Sethi-Ullman register allocation)
+    size_t stack_capacity = 64;
+    Wo_Node* stack = malloc(stack_capacity * sizeof(Wo_Node));
+    if (stack == NULL) {
+        return false;
+    }
+    memset(out_stack_depths, 0, node_count * sizeof(uint32_t));
+    for (size_t node = 0; node < node_count; node++) {
+        size_t stack_count = 1;
+        stack[0] = (Wo_Node)node;
+        while (stack_count > 0) {
+            Wo_Node top = stack[stack_count-1];
+            if (out_stack_depths[top] != 0) {
+                stack_count--;
+                continue;
+            }
+            NodeType type = *node_type(node_store, top);
+            // (free nodes are never flattened, so any depth will do)
+            if (node_type_is_leaf(type) || type == WO_NODE_FREE) {
+                out_stack_depths[top] = 1;
+                stack_count--;
+                continue;
+            }
+            NodeInfo const* info = node_info(node_store, top);
+            Wo_Node left = info->binop_of.left.node;
+            Wo_Node right = info->binop_of.right.node;
+            assert(left < node_count && right < node_count);
+            uint32_t left_depth = out_stack_depths[left];
+            uint32_t right_depth = out_stack_depths[right];
+            if (left_depth == 0 || right_depth == 0) {
+                if (stack_count + 2 > stack_capacity) {
+                    stack_capacity *= 2;
+                    Wo_Node* new_stack = realloc(stack, stack_capacity * sizeof(Wo_Node));
+                    if (new_stack == NULL) {
+                        free(stack);
+                        return false;
+                    }
+                    stack = new_stack;
+                }
+                if (left_depth == 0) {
+                    stack[stack_count++] = left;
+                }
+                if (right_depth == 0) {
+                    stack[stack_count++] = right;
+                }
+                continue;
+            }
+            out_stack_depths[top] = (
+                left_depth == right_depth ?
+                left_depth + 1 :
+                (left_depth > right_depth ? left_depth : right_depth)
+            );
+            stack_count--;
+        }
+    }
+    free(stack);
+    return true;
+}
+
+static bool find_prototypes(
+    NodeStore const* node_store,
+    size_t node_count,
+    uint32_t* out_prototype_roots
+) {
+    // the scene's components are found by descending through the unions below each root (see
+    // 'build_scene_accel'): binops referenced more than once end the descent there, and are
+    // instanced rather than re-emitted.
+    // (each union is referenced once, so is visited once)
+    size_t stack_capacity = 64;
+    Wo_Node* stack = malloc(stack_capacity * sizeof(Wo_Node));
+    if (stack == NULL) {
+        return false;
+    }
+    for (size_t node = 0; node < node_count; node++) {
+        out_prototype_roots[node] = WO_FLAT_NODE_NONE;
+    }
+    for (Wo_Node root = 0; root < node_count; root++) {
+        if (!node_is_root(node_store, root)) {
+            continue;
+        }
+        size_t stack_count = 1;
+        stack[0] = root;
+        while (stack_count > 0) {
+            Wo_Node node = stack[--stack_count];
+            NodeType type = *node_type(node_store, node);
+            if (node_type_is_leaf(type) || out_prototype_roots[node] != WO_FLAT_NODE_NONE) {
+                continue;
+            }
+            if (node != root && *node_reference_count(node_store, node) > 1) {
+                out_prototype_roots[node] = WO_FLATTEN_PROTOTYPE_PENDING;
+                continue;
+            }
+            if (type != WO_NODE_BINOP_UNION_OF) {
+                continue;
+            }
+            if (stack_count + 2 > stack_capacity) {
+                stack_capacity *= 2;
+                Wo_Node* new_stack = realloc(stack, stack_capacity * sizeof(Wo_Node));
+                if (new_stack == NULL) {
+                    free(stack);
+                    return false;
+                }
+                stack = new_stack;
+            }
+            NodeInfo const* info = node_info(node_store, node);
+            stack[stack_count++] = info->binop_of.right.node;
+            stack[stack_count++] = info->binop_of.left.node;
+        }
+    }
+    free(stack);
+    return true;
+}
+static bool compute_flat_stack_depths(FlatScene* flat_scene) {
+    // the stack depth and height of each tree as emitted, children first: an instance
+    // takes one entry, however deep its prototype.
+    uint32_t node_count = flat_scene->node_count;
+    uint32_t* depths = malloc((node_count + 1) * sizeof(uint32_t));
+    uint32_t* heights = malloc((node_count + 1) * sizeof(uint32_t));
+    if (depths == NULL || heights == NULL) {
+        free(depths);
+        free(heights);
+        return false;
+    }
+    flat_scene->stack_depth = 0;
+    flat_scene->tree_height = 0;
+    for (uint32_t i = 0; i < node_count; i++) {
+        GpuSceneNode const* node = &flat_scene->nodes[i];
+        if (node_type_is_leaf((NodeType)node->type)) {
+            depths[i] = 1;
+            heights[i] = 1;
+        } else {
+            // the operand visited first keeps its entry while the second is evaluated:
+            uint32_t second_child = i - 1;
+            uint32_t first_child = second_child - flat_scene->nodes[second_child].subtree_size;
+            uint32_t first_depth = depths[first_child];
+            uint32_t second_depth = depths[second_child] + 1;
+            depths[i] = first_depth > second_depth ? first_depth : second_depth;
+            heights[i] = 1 + (heights[first_child] > heights[second_child] ? heights[first_child] : heights[second_child]);
+        }
+        if (node->parent_index == WO_GPU_NODE_NO_PARENT) {
+            if (flat_scene->stack_depth < depths[i]) {
+                flat_scene->stack_depth = depths[i];
+            }
+            if (flat_scene->tree_height < heights[i]) {
+                flat_scene->tree_height = heights[i];
+            }
+        }
+    }
+    free(depths);
+    free(heights);
+    return true;
+}
+
+//
+// Implementation:
+//
+
+bool flatten_scene(
+    NodeStore const* node_store,
+    size_t node_count,
+    FlatScene* out_flat_scene
+) {
+    memset(out_flat_scene, 0, sizeof(FlatScene));
+
+    PendingTransforms pending_transforms;
+    pending_transforms.first_flat_index = 0;
+    pending_transforms.count = 0;
+
+    size_t stack_capacity = 64;
+    FlattenFrame* stack = malloc(stack_capacity * sizeof(FlattenFrame));
+    uint32_t* node_stack_depths = malloc((node_count + 1) * sizeof(uint32_t));
+    // per Wo_Node: the flat index of its prototype's root, if it is instanced
+    uint32_t* prototype_roots = malloc((node_count + 1) * sizeof(uint32_t));
+    out_flat_scene->first_emissions = malloc((node_count + 1) * sizeof(uint32_t));
+    out_flat_scene->source_node_count = node_count;
+    if (
+        stack == NULL || node_stack_depths == NULL ||
+        prototype_roots == NULL || out_flat_scene->first_emissions == NULL
+    ) {
+        goto fatal_error;
+    }
+    for (size_t node = 0; node < node_count; node++) {
+        out_flat_scene->first_emissions[node] = WO_FLAT_NODE_NONE;
+    }
+    bool depths_ok = compute_node_stack_depths(
+        node_store, node_count,
+        node_stack_depths
+    );
+    if (!depths_ok || !find_prototypes(node_store, node_count, prototype_roots)) {
+        goto fatal_error;
+    }
+
+    // flat index of the union of all roots emitted so far, and of the first node of its tree
+    // (following the prototypes):
+    uint32_t scene_root_index = WO_GPU_NODE_NO_PARENT;
+    uint32_t scene_tree_first_index = 0;
+
+    // emitting the prototypes first, then the roots (among which the instances):
+    for (size_t emission = 0; emission < 2*node_count; emission++) {
+        bool is_prototype = emission < node_count;
+        Wo_Node root = (Wo_Node)(is_prototype ? emission : emission - node_count);
+        if (is_prototype ? prototype_roots[root] == WO_FLAT_NODE_NONE : !node_is_root(node_store, root)) {
+            continue;
+        }
+
+        // emitting this root's subtree in post-order:
+        size_t stack_count = 1;
+        stack[0].node = root;
+        stack[0].arg = NULL;
+        stack[0].first_flat_index = out_flat_scene->node_count;
+        stack[0].visited_child_count = 0;
+        stack[0].operands_swapped = false;
+        stack[0].is_component_candidate = !is_prototype;
+        uint32_t root_flat_index = WO_GPU_NODE_NO_PARENT;
+        while (stack_count > 0) {
+            FlattenFrame* frame = &stack[stack_count-1];
+            NodeType type = *node_type(node_store, frame->node);
+            NodeInfo const* info = node_info(node_store, frame->node);
+            if (frame->is_component_candidate && frame->node != root && prototype_roots[frame->node] != WO_FLAT_NODE_NONE) {
+                type = WO_NODE_INSTANCE;
+            }
+
+            // descending into the next unvisited child, if any:
+            if (!node_type_is_leaf(type) && frame->visited_child_count < 2) {
+                if (stack_count == stack_capacity) {
+                    stack_capacity *= 2;
+                    FlattenFrame* new_stack = realloc(stack, stack_capacity * sizeof(FlattenFrame));
+                    if (new_stack == NULL) {
+                        goto fatal_error;
+                    }
+                    stack = new_stack;
+                    frame = &stack[stack_count-1];
+                }
+                if (frame->visited_child_count == 0) {
+                    // visiting the operand needing the deeper stack first:
+                    frame->operands_swapped = (
+                        node_stack_depths[info->binop_of.right.node] >
+                        node_stack_depths[info->binop_of.left.node]
+                    );
+                }
+                bool visit_left = (frame->visited_child_count == 0) != frame->operands_swapped;
+                Wo_Node_Argument const* child_arg = (
+                    visit_left ?
+                    &info->binop_of.left :
+                    &info->binop_of.right
+                );
+                FlattenFrame* child_frame = &stack[stack_count++];
+                child_frame->node = child_arg->node;
+                child_frame->arg = child_arg;
+                child_frame->first_flat_index = out_flat_scene->node_count;
+                child_frame->visited_child_count = 0;
+                child_frame->operands_swapped = false;
+                child_frame->is_component_candidate = frame->is_component_candidate && type == WO_NODE_BINOP_UNION_OF;
+                continue;
+            }
+
+            // all children emitted, emitting this node:
+            // (instances are not emissions of their Wo_Node: there is nothing to patch in them)
+            uint32_t flat_index;
+            if (!push_flat_node(out_flat_scene, type == WO_NODE_INSTANCE ? WO_FLAT_NODE_NONE : frame->node, &flat_index)) {
+                goto fatal_error;
+            }
+            GpuSceneNode* gpu_node = &out_flat_scene->nodes[flat_index];
+            gpu_node->type = (uint32_t)type;
+            out_flat_scene->node_type_mask |= 1u << type;
+            gpu_node->subtree_size = flat_index - frame->first_flat_index + 1;
+            push_pending_transform(out_flat_scene, &pending_transforms, flat_index, frame->arg);
+            switch (type) {
+                case WO_LEAF_SPHERE: {
+                    gpu_node->params[0] = (float)info->sphere.radius;
+                    gpu_node->flags |= info->sphere.material << WO_GPU_NODE_MATERIAL_SHIFT;
+                } break;
+                case WO_LEAF_INFINITE_PLANAR_PARTITION: {
+                    Wo_Vec3 normal = wo_vec3_normalized(info->infinite_planar_partition.normal);
+                    gpu_node->params[0] = (float)normal.x;
+                    gpu_node->params[1] = (float)normal.y;
+                    gpu_node->params[2] = (float)normal.z;
+                    gpu_node->flags |= info->infinite_planar_partition.material << WO_GPU_NODE_MATERIAL_SHIFT;
+                } break;
+                case WO_NODE_BINOP_UNION_OF:
+                case WO_NODE_BINOP_INTERSECTION_OF:
+                case WO_NODE_BINOP_DIFFERENCE_OF: {
+                    out_flat_scene->nodes[frame->child_flat_indices[0]].parent_index = flat_index;
+                    out_flat_scene->nodes[frame->child_flat_indices[1]].parent_index = flat_index;
+                    if (frame->operands_swapped) {
+                        gpu_node->flags |= WO_GPU_NODE_FLAG_OPERANDS_SWAPPED;
+                    }
+                } break;
+                case WO_NODE_INSTANCE: {
+                    gpu_node_set_prototype_root(gpu_node, prototype_roots[frame->node]);
+                    out_flat_scene->instance_count++;
+                } break;
+                case WO_NODE_FREE: {
+                    // (free nodes are non-roots that no binop refers to: unreachable)
+                    assert(false && "[Wololo] Free nodes cannot be flattened.");
+                } break;
+            }
+
+            // popping, reporting the emitted index to the parent frame:
+            stack_count--;
+            if (stack_count > 0) {
+                FlattenFrame* parent_frame = &stack[stack_count-1];
+                parent_frame->child_flat_indices[parent_frame->visited_child_count++] = flat_index;
+            } else {
+                root_flat_index = flat_index;
+            }
+        }
+
+        if (is_prototype) {
+            prototype_roots[root] = root_flat_index;
+            out_flat_scene->prototype_count++;
+            continue;
+        }
+
+        // joining this root with all previous roots using a synthetic union:
+        // (the union of previous roots stays on the stack while this root is evaluated)
+        if (scene_root_index == WO_GPU_NODE_NO_PARENT) {
+            scene_root_index = root_flat_index;
+            scene_tree_first_index = root_flat_index + 1 - out_flat_scene->nodes[root_flat_index].subtree_size;
+        } else {
+            uint32_t union_index;
+            if (!push_flat_node(out_flat_scene, WO_FLAT_NODE_NONE, &union_index)) {
+                goto fatal_error;
+            }
+            GpuSceneNode* union_node = &out_flat_scene->nodes[union_index];
+            union_node->type = (uint32_t)WO_NODE_BINOP_UNION_OF;
+            out_flat_scene->node_type_mask |= 1u << WO_NODE_BINOP_UNION_OF;
+            union_node->subtree_size = union_index + 1 - scene_tree_first_index;
+            push_pending_transform(out_flat_scene, &pending_transforms, union_index, NULL);
+            out_flat_scene->nodes[scene_root_index].parent_index = union_index;
+            out_flat_scene->nodes[root_flat_index].parent_index = union_index;
+            scene_root_index = union_index;
+        }
+    }
+    flush_pending_transforms(out_flat_scene, &pending_transforms);
+    if (!compute_flat_stack_depths(out_flat_scene)) {
+        goto fatal_error;
+    }
+
+    // pre-composing the transforms down the tree, parents (which follow their children in
+    // post-order) first:
+    for (uint32_t i = out_flat_scene->node_count; i-- > 0;) {
+        compose_world_transform(out_flat_scene, i);
+    }
+
+    free(stack);
+    free(node_stack_depths);
+    free(prototype_roots);
+    return true;
+
+  fatal_error:
+    fprintf(stderr, "[Wololo] Failed to allocate memory while flattening the scene.\n");
+    free(stack);
+    free(node_stack_depths);
+    free(prototype_roots);
+    free_flat_scene(out_flat_scene);
+    return false;
+}
+void free_flat_scene(FlatScene* flat_scene) {
+    free(flat_scene->nodes);
+    free(flat_scene->source_nodes);
+    free(flat_scene->next_emissions);
+    free(flat_scene->first_emissions);
+    free(flat_scene->parent_to_local);
+    free(flat_scene->optimized_source_bitset);
+    memset(flat_scene, 0, sizeof(FlatScene));
+}
+
+bool flat_scene_refresh_operand_transforms(
+    FlatScene* flat_scene,
+    NodeStore const* node_store,
+    Wo_Node node,
+    uint64_t* flat_dirty_bitset
+) {
+    if (node >= flat_scene->source_node_count) {
+        return false;
+    }
+    assert(!flat_scene_source_is_optimized(flat_scene, node));
+    NodeInfo const* info = node_info(node_store, node);
+    for (
+        uint32_t i = flat_scene->first_emissions[node];
+        i != WO_FLAT_NODE_NONE;
+        i = flat_scene->next_emissions[i]
+    ) {
+        // in post-order, the operand emitted second ends right before its parent, and the
+        // one emitted first right before that:
+        uint32_t second_child = i - 1;
+        uint32_t first_child = second_child - flat_scene->nodes[second_child].subtree_size;
+        bool swapped = (flat_scene->nodes[i].flags & WO_GPU_NODE_FLAG_OPERANDS_SWAPPED) != 0;
+        uint32_t left_child = swapped ? second_child : first_child;
+        uint32_t right_child = swapped ? first_child : second_child;
+        set_argument_transform(flat_scene->parent_to_local[left_child], &info->binop_of.left);
+        set_argument_transform(flat_scene->parent_to_local[right_child], &info->binop_of.right);
+        flat_dirty_bitset[left_child/64] |= ((uint64_t)1) << (left_child%64);
+        flat_dirty_bitset[right_child/64] |= ((uint64_t)1) << (right_child%64);
+    }
+    return flat_scene->first_emissions[node] != WO_FLAT_NODE_NONE;
+}
+void flat_scene_compose_world_transforms(FlatScene* flat_scene, uint64_t* flat_dirty_bitset) {
+    // a node must be re-composed if it moved or its parent was re-composed: visiting parents
+    // first, the parent's bit tells.
+    for (uint32_t i = flat_scene->node_count; i-- > 0;) {
+        uint32_t parent_index = flat_scene->nodes[i].parent_index;
+        bool moved = (flat_dirty_bitset[i/64] >> (i%64)) & 1;
+        if (!moved && parent_index != WO_GPU_NODE_NO_PARENT) {
+            moved = (flat_dirty_bitset[parent_index/64] >> (parent_index%64)) & 1;
+        }
+        if (moved) {
+            compose_world_transform(flat_scene, i);
+            flat_dirty_bitset[i/64] |= ((uint64_t)1) << (i%64);
+        }
+    }
+}
+
+size_t flat_scene_gpu_size_in_bytes(FlatScene const* flat_scene) {
+    return (
+        sizeof(GpuSceneHeader) +
+        sizeof(GpuSceneNode) * flat_scene->node_count
+    );
+}
+void flat_scene_write_gpu_layout(FlatScene const* flat_scene, void* dst) {
+    GpuSceneHeader header;
+    memset(&header, 0, sizeof(header));
+    header.node_count = flat_scene->node_count;
+    header.tree_height = flat_scene->tree_height;
+    header.stack_depth = flat_scene->stack_depth;
+    memcpy(dst, &header, sizeof(header));
+    if (flat_scene->node_count > 0) {
+        memcpy(
+            (uint8_t*)dst + sizeof(header),
+            flat_scene->nodes,
+            sizeof(GpuSceneNode) * flat_scene->node_count
+        );
+    }
+}
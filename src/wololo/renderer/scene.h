@@ -0,0 +1,177 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "node.h"
+
+//
+// SCENE flattens the renderer's node tables into the layout read by the ubershader.
+//
+// The GPU layout is a post-order array of fixed-size, 16-byte aligned nodes (std430),
+// so the shader can evaluate the whole expression with one forward pass and a small
+// operand stack. Each node's Wo_Node_Argument transform is folded into a 3x4 affine
+// matrix mapping its parent's space into its own, and those are pre-composed down the tree
+// into a map from world space into each node's space: shaders transform rays into a leaf's
+// space with one matrix multiply, however deep the leaf is.
+// All roots are joined by synthetic unions, so the last node is always the scene root.
+//
+// Instancing: binops referenced more than once that are components of the scene (operands
+// of its top-level unions, see 'bvh.h') are emitted once, as 'prototypes' in their own space
+// ahead of the scene tree, and each reference as a WO_NODE_INSTANCE leaf carrying only its
+// world-to-local transform: shaders trace a prototype with the ray mapped into the instance's
+// space. Prototypes are trees of their own (their roots have no parent).
+//
+// Children are emitted in Sethi-Ullman order (the child needing the deeper operand stack
+// goes first), so the stack depth only grows with the number of *balanced* levels: left- or
+// right-deep chains of any height evaluate with a stack of 2.
+// The depth is computed here and rejected at commit if it exceeds WO_CSG_STACK_CAPACITY.
+//
+
+// NOTE: these are mirrored by 'CSG_STACK_CAPACITY' and 'CSG_MAX_SPANS' in the ubershader;
+//       keep both in sync.
+// - WO_CSG_STACK_CAPACITY: max operand stack depth (interval lists) of the shader's evaluator.
+// - WO_CSG_MAX_SPANS: max disjoint spans per interval list (clipped to the traced segment);
+//   rays whose hit may depend on dropped spans are shown as errors.
+#define WO_CSG_STACK_CAPACITY (8)
+#define WO_CSG_MAX_SPANS (4)
+
+#define WO_GPU_NODE_NO_PARENT (0xFFFFFFFFu)
+// source node of synthetic unions, end of emission chains:
+#define WO_FLAT_NODE_NONE (0xFFFFFFFFu)
+
+// set on binops whose right operand was emitted (and so pushed) before the left one:
+#define WO_GPU_NODE_FLAG_OPERANDS_SWAPPED (0x1u)
+// leaves keep their Wo_Material in the flags' upper bits:
+#define WO_GPU_NODE_MATERIAL_SHIFT (8)
+
+typedef struct GpuSceneHeader GpuSceneHeader;
+struct GpuSceneHeader {
+    uint32_t node_count;
+    uint32_t tree_height;
+    uint32_t stack_depth;
+    uint32_t _pad;
+};
+
+typedef struct GpuSceneNode GpuSceneNode;
+struct GpuSceneNode {
+    // NodeType value, index of the parent in the flattened array, WO_GPU_NODE_FLAG_* bits (and
+    // the material of leaves, see WO_GPU_NODE_MATERIAL_SHIFT),
+    // number of nodes in this node's subtree (in post-order, the subtree of node 'i' is
+    // the range '[i - subtree_size + 1, i]')
+    uint32_t type;
+    uint32_t parent_index;
+    uint32_t flags;
+    uint32_t subtree_size;
+
+    // primitive parameters:
+    // - sphere: {radius, 0, 0, 0}
+    // - infinite planar partition: {normal.x, normal.y, normal.z, 0}
+    // - instance: {bits of the prototype's root index, 0, 0, 0} (see 'gpu_node_prototype_root')
+    float params[4];
+
+    // rows of the affine transform from world space into this node's space (i.e. the
+    // composition of every ancestor's parent-to-local map, see 'flat_scene_compose_world_transforms'):
+    float world_to_local[3][4];
+};
+
+// NOTE: these values are mirrored by the 'MATERIAL_KIND_*' constants in 'ubershader1.comp';
+//       keep both in sync.
+#define WO_GPU_MATERIAL_LAMBERTIAN (0u)
+#define WO_GPU_MATERIAL_METAL (1u)
+#define WO_GPU_MATERIAL_DIELECTRIC (2u)
+
+// one entry of the material buffer, indexed by Wo_Material:
+typedef struct GpuMaterial GpuMaterial;
+struct GpuMaterial {
+    float albedo[3];
+    uint32_t kind;
+    // metal only, dielectric only:
+    float fuzz;
+    float refraction_index;
+    float _pad[2];
+};
+
+_Static_assert(sizeof(GpuSceneHeader) % 16 == 0, "GpuSceneHeader must be 16-byte aligned for std430.");
+_Static_assert(sizeof(GpuSceneNode) % 16 == 0, "GpuSceneNode must be 16-byte aligned for std430.");
+_Static_assert(sizeof(GpuMaterial) % 16 == 0, "GpuMaterial must be 16-byte aligned for std430.");
+
+typedef struct FlatScene FlatScene;
+struct FlatScene {
+    GpuSceneNode* nodes;
+    uint32_t node_count;
+    uint32_t node_capacity;
+
+    // height of the tallest tree (the scene root's or a prototype's, a lone leaf has height 1),
+    // operand stack depth required to evaluate any of them:
+    uint32_t tree_height;
+    uint32_t stack_depth;
+    // prototypes emitted at the start of 'nodes', instance leaves referring to them:
+    uint32_t prototype_count;
+    uint32_t instance_count;
+    // bit '1 << type' set for every NodeType emitted (trace pipelines are specialized to it):
+    uint32_t node_type_mask;
+
+    // where every Wo_Node was emitted, so transforms can be patched in place:
+    // - 'source_nodes[i]': the Wo_Node flattened node 'i' was emitted for (or WO_FLAT_NODE_NONE),
+    // - 'first_emissions[node]': its first flattened node (or WO_FLAT_NODE_NONE),
+    // - 'next_emissions[i]': the next flattened node emitted for the same Wo_Node: shared
+    //   subtrees are emitted once per reference.
+    uint32_t* source_nodes;
+    uint32_t* next_emissions;
+    uint32_t* first_emissions;
+    size_t source_node_count;
+    // bit per Wo_Node whose emissions were rewritten by 'optimize_flat_scene' (or lie below a
+    // rewrite): moving those cannot be patched in place, so needs a commit. NULL if none were.
+    uint64_t* optimized_source_bitset;
+
+    // CPU-only: rows of the affine transform from each node's parent's space into its own,
+    // kept to re-compose 'world_to_local' when nodes move:
+    float (*parent_to_local)[3][4];
+};
+
+// flattens nodes [0, node_count) of 'node_store', composing every node's 'world_to_local':
+bool flatten_scene(
+    NodeStore const* node_store,
+    size_t node_count,
+    FlatScene* out_flat_scene
+);
+void free_flat_scene(FlatScene* flat_scene);
+
+// re-derives the parent-to-local transforms of every emission of binop 'node''s operands from
+// its node info (e.g. after its Wo_Node_Arguments were moved), setting the bit of each patched
+// flattened node in 'flat_dirty_bitset'. Returns false if 'node' was not part of the flattened scene.
+// NOTE: call 'flat_scene_compose_world_transforms' once all moved nodes are refreshed.
+// NOTE: nodes for which 'flat_scene_source_is_optimized' holds cannot be refreshed.
+bool flat_scene_refresh_operand_transforms(
+    FlatScene* flat_scene,
+    NodeStore const* node_store,
+    Wo_Node node,
+    uint64_t* flat_dirty_bitset
+);
+
+inline static uint32_t gpu_node_prototype_root(GpuSceneNode const* instance) {
+    uint32_t root;
+    memcpy(&root, &instance->params[0], sizeof(root));
+    return root;
+}
+inline static void gpu_node_set_prototype_root(GpuSceneNode* instance, uint32_t root) {
+    memcpy(&instance->params[0], &root, sizeof(root));
+}
+
+inline static bool flat_scene_source_is_optimized(FlatScene const* flat_scene, Wo_Node node) {
+    return (
+        flat_scene->optimized_source_bitset != NULL &&
+        node < flat_scene->source_node_count &&
+        (flat_scene->optimized_source_bitset[node/64] >> (node%64)) & 1
+    );
+}
+
+// re-composes the 'world_to_local' maps of the nodes set in 'flat_dirty_bitset' and of their
+// descendants, setting the descendants' bits too (their GPU records changed with them).
+void flat_scene_compose_world_transforms(FlatScene* flat_scene, uint64_t* flat_dirty_bitset);
+
+size_t flat_scene_gpu_size_in_bytes(FlatScene const* flat_scene);
+void flat_scene_write_gpu_layout(FlatScene const* flat_scene, void* dst);
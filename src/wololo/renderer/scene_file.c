@@ -0,0 +1,240 @@
+#include "scene_file.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+//
+// Local implementation:
+//
+
+static uint64_t align_section_offset(uint64_t offset);
+static bool check_scene_file(SceneFile const* file, char const* file_path);
+
+static uint64_t align_section_offset(uint64_t offset) {
+    return (offset + WO_SCENE_FILE_SECTION_ALIGNMENT - 1) / WO_SCENE_FILE_SECTION_ALIGNMENT * WO_SCENE_FILE_SECTION_ALIGNMENT;
+}
+static bool check_scene_file(SceneFile const* file, char const* file_path) {
+    // checking the header's layout, then that every section lies within the file and holds
+    // what the header's counts call for:
+    SceneFileHeader const* header = file->header;
+    SceneFileHeader expected_header;
+    init_scene_file_header(&expected_header);
+    bool const layout_ok = (
+        header->magic == expected_header.magic &&
+        header->version == expected_header.version &&
+        header->node_type_size == expected_header.node_type_size &&
+        header->node_info_size == expected_header.node_info_size &&
+        header->gpu_node_size == expected_header.gpu_node_size &&
+        header->gpu_bvh_node_size == expected_header.gpu_bvh_node_size
+    );
+    if (!layout_ok) {
+        printf("[Wololo] Scene file '%s' was written by an incompatible build (or is not a scene file).\n", file_path);
+        return false;
+    }
+    bool const counts_ok = (
+        header->node_count <= WO_RENDERER_MAX_NODE_COUNT &&
+        header->free_node_count <= header->node_count &&
+        (header->free_node_list_head == WO_NODE_NONE || header->free_node_list_head < header->node_count) &&
+        header->material_count > 0 &&
+        header->material_count <= WO_RENDERER_MAX_MATERIAL_COUNT
+    );
+    if (!counts_ok) {
+        printf("[Wololo] Scene file '%s' has invalid node or material counts.\n", file_path);
+        return false;
+    }
+    for (int section_kind = 0; section_kind < WO_SCENE_FILE_SECTION_COUNT; section_kind++) {
+        SceneFileSection const* section = &header->sections[section_kind];
+        bool const bounds_ok = (
+            section->size == 0 || (
+                section->offset % WO_SCENE_FILE_SECTION_ALIGNMENT == 0 &&
+                section->offset >= sizeof(SceneFileHeader) &&
+                section->offset <= file->size &&
+                section->size <= file->size - section->offset
+            )
+        );
+        if (!bounds_ok) {
+            printf("[Wololo] Scene file '%s' is truncated or corrupt.\n", file_path);
+            return false;
+        }
+    }
+
+    uint64_t const node_count = header->node_count;
+    bool sizes_ok = (
+        header->sections[WO_SCENE_FILE_SECTION_NODE_TYPES].size == node_count * sizeof(NodeType) &&
+        header->sections[WO_SCENE_FILE_SECTION_NODE_INFOS].size == node_count * sizeof(NodeInfo) &&
+        header->sections[WO_SCENE_FILE_SECTION_NODE_REFERENCE_COUNTS].size == node_count * sizeof(uint32_t) &&
+        header->sections[WO_SCENE_FILE_SECTION_NONROOT_BITSET].size == (node_count + 63) / 64 * sizeof(uint64_t) &&
+        header->sections[WO_SCENE_FILE_SECTION_MATERIALS].size == header->material_count * sizeof(GpuMaterial)
+    );
+    // the prebuilt GPU scene: its buffers' sizes follow from their headers' counts.
+    uint64_t const gpu_scene_size = header->sections[WO_SCENE_FILE_SECTION_GPU_SCENE].size;
+    uint64_t const gpu_accel_size = header->sections[WO_SCENE_FILE_SECTION_GPU_ACCEL].size;
+    uint64_t const gpu_aabbs_size = header->sections[WO_SCENE_FILE_SECTION_GPU_COMPONENT_AABBS].size;
+    if (sizes_ok && (gpu_scene_size > 0 || gpu_accel_size > 0 || gpu_aabbs_size > 0)) {
+        sizes_ok = (
+            gpu_scene_size >= sizeof(GpuSceneHeader) &&
+            gpu_accel_size >= sizeof(GpuSceneAccelHeader)
+        );
+        if (sizes_ok) {
+            GpuSceneHeader const* gpu_scene_header = scene_file_section(file, WO_SCENE_FILE_SECTION_GPU_SCENE);
+            GpuSceneAccelHeader const* gpu_accel_header = scene_file_section(file, WO_SCENE_FILE_SECTION_GPU_ACCEL);
+            uint64_t const component_aabb_count = gpu_accel_header->bounded_component_count;
+            sizes_ok = (
+                gpu_scene_header->node_count > 0 &&
+                gpu_scene_size == sizeof(GpuSceneHeader) + (uint64_t)gpu_scene_header->node_count * sizeof(GpuSceneNode) &&
+                gpu_accel_header->node_count == gpu_scene_header->node_count &&
+                gpu_accel_size == (
+                    sizeof(GpuSceneAccelHeader) +
+                    (uint64_t)gpu_accel_header->node_count * sizeof(GpuNodeBounds) +
+                    (uint64_t)gpu_accel_header->bvh_node_count * sizeof(GpuBvhNode) +
+                    (uint64_t)gpu_accel_header->unbounded_component_count * sizeof(GpuBvhNode)
+                ) &&
+                gpu_aabbs_size == sizeof(GpuComponentAabb) * (component_aabb_count > 0 ? component_aabb_count : 1)
+            );
+        }
+    }
+    if (!sizes_ok) {
+        printf("[Wololo] Scene file '%s' has sections that do not match its counts.\n", file_path);
+        return false;
+    }
+    return true;
+}
+
+//
+// Implementation:
+//
+
+void init_scene_file_header(SceneFileHeader* header) {
+    memset(header, 0, sizeof(SceneFileHeader));
+    header->magic = WO_SCENE_FILE_MAGIC;
+    header->version = WO_SCENE_FILE_VERSION;
+    header->node_type_size = sizeof(NodeType);
+    header->node_info_size = sizeof(NodeInfo);
+    header->gpu_node_size = sizeof(GpuSceneNode);
+    header->gpu_bvh_node_size = sizeof(GpuBvhNode);
+}
+bool map_scene_file(char const* file_path, SceneFile* out_file) {
+    memset(out_file, 0, sizeof(SceneFile));
+
+    // mapping the whole file read-only: (pages are aligned far beyond what the sections need)
+    void const* data = NULL;
+    size_t size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(file_path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file != INVALID_HANDLE_VALUE) {
+        LARGE_INTEGER file_size;
+        HANDLE mapping = NULL;
+        if (GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0 && (uint64_t)file_size.QuadPart <= SIZE_MAX) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        }
+        if (mapping != NULL) {
+            data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            size = (size_t)file_size.QuadPart;
+            // (the view keeps the file mapped once both handles are closed)
+            CloseHandle(mapping);
+        }
+        CloseHandle(file);
+    }
+#else
+    int file = open(file_path, O_RDONLY);
+    if (file >= 0) {
+        struct stat file_stat;
+        if (fstat(file, &file_stat) == 0 && file_stat.st_size > 0) {
+            void* mapping = mmap(NULL, (size_t)file_stat.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+            if (mapping != MAP_FAILED) {
+                // the sections are read front to back, once:
+                madvise(mapping, (size_t)file_stat.st_size, MADV_SEQUENTIAL);
+                data = mapping;
+                size = (size_t)file_stat.st_size;
+            }
+        }
+        // (the mapping outlives the file descriptor)
+        close(file);
+    }
+#endif
+    if (data == NULL) {
+        printf("[Wololo] Could not map scene file '%s'.\n", file_path);
+        return false;
+    }
+    out_file->header = data;
+    out_file->data = data;
+    out_file->size = size;
+
+    if (size < sizeof(SceneFileHeader)) {
+        printf("[Wololo] Scene file '%s' is truncated or corrupt.\n", file_path);
+        unmap_scene_file(out_file);
+        return false;
+    }
+    if (!check_scene_file(out_file, file_path)) {
+        unmap_scene_file(out_file);
+        return false;
+    }
+    return true;
+}
+void unmap_scene_file(SceneFile* file) {
+    if (file->data != NULL) {
+#if defined(_WIN32)
+        UnmapViewOfFile(file->data);
+#else
+        munmap((void*)file->data, file->size);
+#endif
+    }
+    memset(file, 0, sizeof(SceneFile));
+}
+bool write_scene_file(char const* file_path, SceneFileHeader* header, void const* const section_data[WO_SCENE_FILE_SECTION_COUNT]) {
+    // laying the sections out back to back, in order:
+    uint64_t offset = align_section_offset(sizeof(SceneFileHeader));
+    for (int section_kind = 0; section_kind < WO_SCENE_FILE_SECTION_COUNT; section_kind++) {
+        SceneFileSection* section = &header->sections[section_kind];
+        section->offset = (section->size > 0 ? offset : 0);
+        offset = align_section_offset(offset + section->size);
+    }
+
+    // writing a temporary file and renaming it over the old one, as with the pipeline cache:
+    static uint8_t const padding[WO_SCENE_FILE_SECTION_ALIGNMENT] = {0};
+    char temp_file_path[1024];
+    snprintf(temp_file_path, sizeof(temp_file_path), "%s.tmp", file_path);
+    bool write_ok = false;
+    FILE* temp_file = fopen(temp_file_path, "wb");
+    if (temp_file != NULL) {
+        write_ok = (fwrite(header, sizeof(SceneFileHeader), 1, temp_file) == 1);
+        uint64_t written_size = sizeof(SceneFileHeader);
+        for (int section_kind = 0; write_ok && section_kind < WO_SCENE_FILE_SECTION_COUNT; section_kind++) {
+            SceneFileSection const* section = &header->sections[section_kind];
+            if (section->size == 0) {
+                continue;
+            }
+            size_t const padding_size = (size_t)(section->offset - written_size);
+            write_ok = (
+                (padding_size == 0 || fwrite(padding, padding_size, 1, temp_file) == 1) &&
+                fwrite(section_data[section_kind], (size_t)section->size, 1, temp_file) == 1
+            );
+            written_size = section->offset + section->size;
+        }
+        write_ok = (fclose(temp_file) == 0) && write_ok;
+    }
+#if defined(_WIN32)
+    // ('rename' does not replace existing files on Windows)
+    if (write_ok) {
+        remove(file_path);
+    }
+#endif
+    if (write_ok && rename(temp_file_path, file_path) == 0) {
+        return true;
+    } else {
+        remove(temp_file_path);
+        return false;
+    }
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "node.h"
+#include "scene.h"
+#include "bvh.h"
+
+//
+// SCENE FILES store a renderer's node tables in their in-memory (SoA) layout, so loading one
+// copies each table into the node chunks a chunk at a time rather than adding nodes one by
+// one, and nothing is parsed per node: files are memory-mapped, and each section is used where
+// it lies in the mapping (see 'wo_renderer_load_scene_mmap').
+//
+// A file is a SceneFileHeader followed by its sections, each at an offset aligned to
+// WO_SCENE_FILE_SECTION_ALIGNMENT:
+// - node types, infos and reference counts: 'node_count' NodeTypes, NodeInfos and uint32_ts,
+//   indexed by Wo_Node (free nodes included, chained from 'free_node_list_head'),
+// - the non-root bitset: a bit per node, in uint64_t words,
+// - materials: 'material_count' GpuMaterials, indexed by Wo_Material,
+// - optionally, the prebuilt GPU scene: the scene, BVH and component AABB buffers of the
+//   flattened scene exactly as committed (see 'flat_scene_write_gpu_layout' and
+//   'scene_accel_write_gpu_layout'), uploaded straight from the mapping instead of flattening
+//   the node tables again. Either all three are present, or none is.
+//
+// Files hold the tables as this build lays them out (byte order, Wo_Scalar precision, struct
+// padding), so only files written by a compatible build are accepted: the header records the
+// layout they were written with. Beyond that, sections are trusted, not validated node by node.
+//
+
+// "WOSC" (which files written on a machine of the other byte order read byte-swapped):
+#define WO_SCENE_FILE_MAGIC (0x43534F57u)
+#define WO_SCENE_FILE_VERSION (1u)
+#define WO_SCENE_FILE_SECTION_ALIGNMENT (64)
+
+typedef enum SceneFileSectionKind SceneFileSectionKind;
+enum SceneFileSectionKind {
+    WO_SCENE_FILE_SECTION_NODE_TYPES,
+    WO_SCENE_FILE_SECTION_NODE_INFOS,
+    WO_SCENE_FILE_SECTION_NODE_REFERENCE_COUNTS,
+    WO_SCENE_FILE_SECTION_NONROOT_BITSET,
+    WO_SCENE_FILE_SECTION_MATERIALS,
+    WO_SCENE_FILE_SECTION_GPU_SCENE,
+    WO_SCENE_FILE_SECTION_GPU_ACCEL,
+    WO_SCENE_FILE_SECTION_GPU_COMPONENT_AABBS,
+    WO_SCENE_FILE_SECTION_COUNT
+};
+
+// absent sections have size 0:
+typedef struct SceneFileSection SceneFileSection;
+struct SceneFileSection {
+    uint64_t offset;
+    uint64_t size;
+};
+
+typedef struct SceneFileHeader SceneFileHeader;
+struct SceneFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    // the layout the tables were written with:
+    uint32_t node_type_size;
+    uint32_t node_info_size;
+    uint32_t gpu_node_size;
+    uint32_t gpu_bvh_node_size;
+
+    uint32_t node_count;
+    uint32_t free_node_list_head;
+    uint32_t free_node_count;
+    uint32_t material_count;
+
+    // the prebuilt GPU scene's properties not recorded by its buffers' own headers:
+    // (0 if absent)
+    uint32_t gpu_node_type_mask;
+    uint32_t gpu_unoptimized_node_count;
+    uint32_t gpu_prototype_count;
+    uint32_t gpu_instance_count;
+
+    SceneFileSection sections[WO_SCENE_FILE_SECTION_COUNT];
+};
+
+// a file mapped read-only, whose header and section bounds were checked:
+typedef struct SceneFile SceneFile;
+struct SceneFile {
+    SceneFileHeader const* header;
+    uint8_t const* data;
+    size_t size;
+};
+
+// fills in 'header''s layout fields (see above) and zeroes the others:
+void init_scene_file_header(SceneFileHeader* header);
+
+// Returns false (printing why) if the file cannot be mapped, or was not written by a
+// compatible build, or its sections do not fit in it or do not match its counts.
+bool map_scene_file(char const* file_path, SceneFile* out_file);
+void unmap_scene_file(SceneFile* file);
+
+// writes 'header' and 'section_data[k]' (of 'header->sections[k].size' bytes) for each
+// section 'k', computing the sections' offsets. Written to a temporary file renamed over
+// 'file_path', so a file being replaced is never seen partially written.
+// Returns false if the file could not be written.
+bool write_scene_file(char const* file_path, SceneFileHeader* header, void const* const section_data[WO_SCENE_FILE_SECTION_COUNT]);
+
+inline static void const* scene_file_section(SceneFile const* file, SceneFileSectionKind section_kind) {
+    SceneFileSection const* section = &file->header->sections[section_kind];
+    return section->size > 0 ? file->data + section->offset : NULL;
+}
+inline static bool scene_file_has_gpu_scene(SceneFile const* file) {
+    return file->header->sections[WO_SCENE_FILE_SECTION_GPU_SCENE].size > 0;
+}
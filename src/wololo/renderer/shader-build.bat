@@ -1,2 +1,4 @@
 CALL glslc ubershader1.frag -o ubershader1.frag.spv
 CALL glslc ubershader1.vert -o ubershader1.vert.spv
+CALL glslc ubershader1.comp -o ubershader1.comp.spv
+CALL glslc --target-env=vulkan1.2 -DWO_RAY_QUERY ubershader1.comp -o ubershader1-rq.comp.spv
\ No newline at end of file
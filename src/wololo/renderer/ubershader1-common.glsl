@@ -0,0 +1,690 @@
+// Shared by every ubershader1 stage: included (GL_GOOGLE_include_directive) by
+// 'ubershader1.frag' and 'ubershader1.comp' after their '#version' line.
+// Run 'shader-build.sh' after editing this file.
+
+// Adding a shared Fragment Uniform Buffer Object:
+// the primary way to communicate between CPU and GPU.
+// see:
+// https://vulkan-tutorial.com/Uniform_buffers/Descriptor_layout_and_buffer
+layout(binding = 0) uniform FragmentUniformBufferObject {
+    float time_since_start_sec;
+    float resolution_x;
+    float resolution_y;
+    // progressive mode (compute paths only): non-zero if samples are accumulated across frames,
+    // and how many were accumulated before this frame.
+    uint progressive;
+    uint accumulated_sample_count;
+    // path tracing (compute paths only): non-zero if paths are traced rather than shading the
+    // first hit by its normal, their max length and how many are traced per pixel this frame.
+    uint path_tracing;
+    uint max_bounce_count;
+    uint samples_per_pixel;
+    // the camera's aspect ratio, and the region of its frame drawn (see 'frame_st'):
+    float camera_aspect_ratio;
+    float region_st_offset_x;
+    float region_st_offset_y;
+    float region_st_scale_x;
+    float region_st_scale_y;
+} fubo;
+
+// Color constants:
+vec3 COLOR_black = vec3(0,0,0);
+vec3 COLOR_white = vec3(1,1,1);
+vec3 COLOR_sky_blue = vec3(0.5, 0.7, 1.0);
+vec3 COLOR_error = vec3(1.0, 0.0, 1.0);
+
+//
+//
+// Raytracing:
+// https://raytracing.github.io/books/RayTracingInOneWeekend.html#rays,asimplecamera,andbackground
+//
+//
+
+struct RT_Ray {
+    vec3 origin_pt;
+    vec3 direction;
+};
+
+RT_Ray rt_ray(vec3 origin_pt, vec3 direction) {
+    RT_Ray ray;
+    ray.origin_pt = origin_pt;
+    ray.direction = normalize(direction);
+    return ray;
+}
+
+// maps 'st' over the image drawn to 'st' over the camera's whole frame, of which renderers
+// drawing a region (see 'wo_renderer_set_frame_region') draw only part:
+vec2 frame_st(vec2 region_st) {
+    return (
+        vec2(fubo.region_st_offset_x, fubo.region_st_offset_y) +
+        region_st * vec2(fubo.region_st_scale_x, fubo.region_st_scale_y)
+    );
+}
+
+// a pinhole camera at the origin looking down -Z, for 'st' in [0,1]x[0,1] over its frame
+// (see 'ubershader1.frag' for the orientation of 'st')
+RT_Ray rt_camera_ray(vec2 st) {
+    float aspect_ratio = fubo.camera_aspect_ratio;
+    float focal_length = 1.0;
+
+    vec3 origin = vec3(0,0,0);
+    vec3 horizontal = vec3(aspect_ratio, 0, 0);
+    vec3 vertical = vec3(0, 1.0, 0);
+    vec3 lower_left_corner = (
+        origin
+        - (horizontal / 2)
+        - (vertical / 2)
+        - vec3(0, 0, focal_length)
+    );
+    return rt_ray(
+        origin,
+        lower_left_corner +
+        st.x * horizontal +
+        st.y * vertical
+        - origin
+    );
+}
+
+//
+//
+// Scene:
+// a post-order array of CSG nodes flattened by 'scene.c'.
+//
+//
+
+// NOTE: these values mirror 'NodeType' in 'node.h'; keep both in sync.
+const uint NODE_TYPE_SPHERE = 0;
+const uint NODE_TYPE_INFINITE_PLANAR_PARTITION = 1;
+const uint NODE_TYPE_UNION_OF = 2;
+const uint NODE_TYPE_INTERSECTION_OF = 3;
+const uint NODE_TYPE_DIFFERENCE_OF = 4;
+const uint NODE_TYPE_INSTANCE = 5;
+const uint NO_PARENT = 0xFFFFFFFFu;
+
+// Specialization constants: the renderer compiles a variant of each pipeline per scene, so that
+// branches a scene never takes are compiled out (see 'PipelineVariantKey' in 'renderer.c').
+// The defaults (the generic pipelines) support every scene.
+// - SCENE_NODE_TYPES: bit '1 << type' set for every node type in the scene.
+// - DEBUG_VIEW: mirrors 'Wo_Debug_View' in 'renderer.h'.
+// ('CSG_STACK_CAPACITY' below is constant 1, and 'MAX_BOUNCE_COUNT' in 'ubershader1.comp' 2)
+layout(constant_id = 0) const uint SCENE_NODE_TYPES = 0x3Fu;
+layout(constant_id = 3) const uint DEBUG_VIEW = 0u;
+const uint DEBUG_VIEW_NONE = 0u;
+const uint DEBUG_VIEW_SCREEN_COORDINATES = 1u;
+const uint DEBUG_VIEW_HIT_DISTANCE = 2u;
+
+bool scene_has_node_type(uint type) {
+    return (SCENE_NODE_TYPES & (1u << type)) != 0u;
+}
+
+// mirrors 'GpuSceneNode' in 'scene.h':
+struct SceneNode {
+    uint type;
+    uint parent_index;
+    uint flags;
+    uint subtree_size;
+    vec4 params;
+    vec4 world_to_local[3];
+};
+
+layout(std430, binding = 1) readonly buffer SceneNodeBuffer {
+    uint node_count;
+    uint tree_height;
+    uint stack_depth;
+    uint _pad;
+    SceneNode nodes[];
+} scene;
+
+// an affine map 'p -> lin * p + t'
+struct Affine {
+    mat3 lin;
+    vec3 t;
+};
+
+// maps world space into the space of the given node: every ancestor's transform is composed on
+// the CPU (see 'flat_scene_compose_world_transforms'), so this costs the same at any depth.
+// (nodes of prototypes map their prototype's space instead, see 'trace_component')
+Affine node_world_to_local(uint node_index) {
+    vec4 r0 = scene.nodes[node_index].world_to_local[0];
+    vec4 r1 = scene.nodes[node_index].world_to_local[1];
+    vec4 r2 = scene.nodes[node_index].world_to_local[2];
+    Affine a;
+    // GLSL matrices are column-major, so we transpose the rows:
+    a.lin = transpose(mat3(r0.xyz, r1.xyz, r2.xyz));
+    a.t = vec3(r0.w, r1.w, r2.w);
+    return a;
+}
+
+//
+//
+// Interval lists:
+// the sorted, disjoint spans in which a ray is inside a solid.
+// Boundaries alternate entry/exit ('t[2i]' enters, 't[2i+1]' exits) and each one records the
+// surface it lies on, so normals are only computed once, for the final hit.
+// Leaf spans are clipped to the traced segment '[T_EPSILON, t_max]' so spans behind the ray or
+// past the nearest hit don't use up capacity (CSG is pointwise along the ray, so clipping the
+// operands clips the result; the clipped ends themselves are never reported as hits).
+// Lists hold at most 'CSG_MAX_SPANS' spans; farther ones are dropped, and since a dropped
+// span of a subtrahend or intersection operand can uncover (or hide) a boundary of the other
+// one, a list is only exact in front of its 'truncated_t': hits beyond it are reported as
+// errors, like stack overflows.
+//
+//
+
+// NOTE: these mirror 'WO_CSG_STACK_CAPACITY' and 'WO_CSG_MAX_SPANS' in 'scene.h';
+//       keep both in sync.
+// The stack capacity is specialized down to the scene's stack depth (rounded up to a power of
+// two), so shallow scenes keep fewer interval lists live.
+layout(constant_id = 1) const int CSG_STACK_CAPACITY = 8;
+const int CSG_MAX_SPANS = 4;
+const int CSG_MAX_BOUNDARIES = 2 * CSG_MAX_SPANS;
+
+const uint NODE_FLAG_OPERANDS_SWAPPED = 0x1u;
+// NOTE: mirrors 'WO_GPU_NODE_MATERIAL_SHIFT' in 'scene.h'.
+const uint NODE_MATERIAL_SHIFT = 8u;
+
+const float T_INFINITY = 1e30;
+const float T_EPSILON = 1e-4;
+
+// a surface is the index of the leaf a boundary lies on; the top bit flips its normal
+// (set on boundaries of subtracted solids).
+const uint SURFACE_FLIPPED = 0x80000000u;
+const uint SURFACE_NONE = 0x7FFFFFFFu;
+
+struct IntervalList {
+    int boundary_count;
+    // where spans started being dropped, or 'T_INFINITY' if the list is exact
+    float truncated_t;
+    float t[CSG_MAX_BOUNDARIES];
+    uint surface[CSG_MAX_BOUNDARIES];
+};
+
+IntervalList empty_interval_list() {
+    IntervalList l;
+    l.boundary_count = 0;
+    l.truncated_t = T_INFINITY;
+    return l;
+}
+
+IntervalList single_interval_list(float t_in, float t_out, uint surface) {
+    IntervalList l;
+    l.boundary_count = 2;
+    l.truncated_t = T_INFINITY;
+    l.t[0] = t_in;
+    l.t[1] = t_out;
+    l.surface[0] = surface;
+    l.surface[1] = surface;
+    return l;
+}
+
+IntervalList hit_sphere(float radius, vec3 o, vec3 d, uint surface) {
+    float b = dot(o, d);
+    float c = dot(o, o) - radius * radius;
+    float discriminant = b*b - c;
+    if (discriminant < 0) {
+        return empty_interval_list();
+    }
+    float sqrt_discriminant = sqrt(discriminant);
+    return single_interval_list(-b - sqrt_discriminant, -b + sqrt_discriminant, surface);
+}
+
+// the solid is the half-space 'dot(normal, p) <= 0'
+IntervalList hit_infinite_planar_partition(vec3 normal, vec3 o, vec3 d, uint surface) {
+    float dn = dot(normal, d);
+    float on = dot(normal, o);
+    if (dn == 0) {
+        if (on <= 0) {
+            return single_interval_list(-T_INFINITY, T_INFINITY, SURFACE_NONE);
+        } else {
+            return empty_interval_list();
+        }
+    }
+    float t = -on / dn;
+    if (dn < 0) {
+        return single_interval_list(t, T_INFINITY, surface);
+    } else {
+        return single_interval_list(-T_INFINITY, t, surface);
+    }
+}
+
+// restricts a leaf's list (a single span, see above) to '[T_EPSILON, t_max]'
+IntervalList clip_interval_list(IntervalList l, float t_max) {
+    if (l.boundary_count == 0) {
+        return l;
+    }
+    if (l.t[1] <= T_EPSILON || l.t[0] >= t_max) {
+        return empty_interval_list();
+    }
+    l.t[0] = max(l.t[0], T_EPSILON);
+    l.t[1] = min(l.t[1], t_max);
+    return l;
+}
+
+bool csg_op_is_inside(uint type, bool inside_a, bool inside_b) {
+    if (scene_has_node_type(NODE_TYPE_UNION_OF) && type == NODE_TYPE_UNION_OF) {
+        return inside_a || inside_b;
+    } else if (scene_has_node_type(NODE_TYPE_INTERSECTION_OF) && type == NODE_TYPE_INTERSECTION_OF) {
+        return inside_a && inside_b;
+    } else {
+        return inside_a && !inside_b;
+    }
+}
+
+// merges the boundaries of 'a' and 'b' in order, keeping only those where the result's
+// inside-ness changes.
+// Cost is linear in the boundary counts, so per-pixel cost is bounded by the node count.
+IntervalList combine_interval_lists(uint type, IntervalList a, IntervalList b) {
+    IntervalList r;
+    r.boundary_count = 0;
+    r.truncated_t = min(a.truncated_t, b.truncated_t);
+
+    bool inside_a = false;
+    bool inside_b = false;
+    bool inside = false;
+    int ia = 0;
+    int ib = 0;
+    while (ia < a.boundary_count || ib < b.boundary_count) {
+        float t;
+        uint surface;
+        if (ib >= b.boundary_count || (ia < a.boundary_count && a.t[ia] <= b.t[ib])) {
+            t = a.t[ia];
+            surface = a.surface[ia];
+            inside_a = (ia % 2 == 0);
+            ia++;
+        } else {
+            t = b.t[ib];
+            surface = b.surface[ib];
+            if (scene_has_node_type(NODE_TYPE_DIFFERENCE_OF) && type == NODE_TYPE_DIFFERENCE_OF) {
+                surface ^= SURFACE_FLIPPED;
+            }
+            inside_b = (ib % 2 == 0);
+            ib++;
+        }
+
+        bool new_inside = csg_op_is_inside(type, inside_a, inside_b);
+        if (new_inside != inside) {
+            if (new_inside && r.boundary_count + 2 > CSG_MAX_BOUNDARIES) {
+                // out of spans: dropping all farther ones.
+                r.truncated_t = min(r.truncated_t, t);
+                break;
+            }
+            r.t[r.boundary_count] = t;
+            r.surface[r.boundary_count] = surface;
+            r.boundary_count++;
+            inside = new_inside;
+        }
+    }
+    return r;
+}
+
+// 'component_root' is the component the surface was hit in, see 'trace_component'.
+vec3 surface_normal(uint surface, uint component_root, RT_Ray ray, float t) {
+    uint node_index = surface & ~SURFACE_FLIPPED;
+    Affine world_to_local = node_world_to_local(node_index);
+    if (scene_has_node_type(NODE_TYPE_INSTANCE) && scene.nodes[component_root].type == NODE_TYPE_INSTANCE) {
+        // composing the leaf's map in its prototype with the instance's:
+        Affine world_to_instance = node_world_to_local(component_root);
+        world_to_local.t = world_to_local.lin * world_to_instance.t + world_to_local.t;
+        world_to_local.lin = world_to_local.lin * world_to_instance.lin;
+    }
+    vec3 p = world_to_local.lin * (ray.origin_pt + t * ray.direction) + world_to_local.t;
+    vec4 params = scene.nodes[node_index].params;
+    vec3 n;
+    // (a leaf is a sphere in scenes without planes)
+    bool is_sphere = scene_has_node_type(NODE_TYPE_SPHERE) && (
+        !scene_has_node_type(NODE_TYPE_INFINITE_PLANAR_PARTITION) ||
+        scene.nodes[node_index].type == NODE_TYPE_SPHERE
+    );
+    if (is_sphere) {
+        n = p / params.x;
+    } else {
+        n = params.xyz;
+    }
+    // transforming the normal back into world space:
+    n = normalize(transpose(world_to_local.lin) * n);
+    return ((surface & SURFACE_FLIPPED) != 0) ? -n : n;
+}
+
+//
+//
+// Acceleration structures:
+// conservative world-space boxes for every node, and a BVH over the scene's components (the
+// operands of its top-level unions) built by 'bvh.c'.
+//
+//
+
+// mirrors 'GpuNodeBounds' and 'GpuBvhNode' in 'bvh.h':
+// - node bounds: 'a' is the cull root, 'b' the first child.
+// - BVH nodes (and unbounded components): 'a' is the left child or the component root, 'b' is
+//   non-zero for leaves.
+struct AccelRecord {
+    vec3 min;
+    uint a;
+    vec3 max;
+    uint b;
+};
+
+layout(std430, binding = 2) readonly buffer SceneAccelBuffer {
+    uint node_count;
+    uint bvh_node_count;
+    uint bounded_component_count;
+    uint unbounded_component_count;
+    AccelRecord records[];   // [node bounds] [BVH nodes] [unbounded components]
+} accel;
+
+#ifdef WO_RAY_QUERY
+// the TLAS over the bounded components, and the AABBs its BLAS was built from: a reported
+// primitive index maps back to its component's root node.
+// see 'GpuComponentAabb' in 'bvh.h'
+layout(binding = 4) uniform accelerationStructureEXT scene_tlas;
+struct ComponentAabb {
+    float min_x, min_y, min_z;
+    float max_x, max_y, max_z;
+    uint component_root;
+    uint _pad;
+};
+layout(std430, binding = 5) readonly buffer SceneComponentAabbBuffer {
+    ComponentAabb aabbs[];
+} scene_components;
+#endif
+
+// median splits keep the BVH's depth at most 'ceil(log2(component_count))'.
+const int BVH_STACK_CAPACITY = 32;
+
+// true if the ray passes through the box somewhere in '[0, t_max]'
+bool ray_hits_box(vec3 box_min, vec3 box_max, RT_Ray ray, vec3 inv_direction, float t_max, out float t_near) {
+    vec3 t0 = (box_min - ray.origin_pt) * inv_direction;
+    vec3 t1 = (box_max - ray.origin_pt) * inv_direction;
+    vec3 t_small = min(t0, t1);
+    vec3 t_large = max(t0, t1);
+    t_near = max(max(t_small.x, t_small.y), max(t_small.z, 0.0));
+    float t_far = min(min(t_large.x, t_large.y), min(t_large.z, t_max));
+    // the intersection of disjoint boxes is empty:
+    return t_near <= t_far && all(lessThanEqual(box_min, box_max));
+}
+
+//
+//
+// CSG evaluation:
+// a single forward pass over a component's post-order node range with a bounded operand
+// stack, skipping every subtree whose box the ray misses (its interval list is empty).
+// No recursion: the depth required is precomputed by the CPU ('scene.stack_depth'), and
+// scenes needing more than 'CSG_STACK_CAPACITY' are rejected at commit.
+//
+//
+
+// returns the first entry of the ray into the subtree in '(T_EPSILON, t_max)' (or its first
+// entry or exit, if 'include_exits', for rays that may start inside it), or 'T_INFINITY' if
+// there is none.
+// 'out_truncated_t' is where the result stops being exact (see 'IntervalList'): a (nearer)
+// hit may have been lost beyond it, unless it's 'T_INFINITY'.
+float trace_subtree(uint root_index, RT_Ray ray, vec3 inv_direction, float t_max, bool include_exits, out uint out_surface, out float out_truncated_t) {
+    out_surface = SURFACE_NONE;
+    out_truncated_t = T_INFINITY;
+
+    IntervalList stack[CSG_STACK_CAPACITY];
+    int stack_count = 0;
+    uint node_index = root_index + 1 - scene.nodes[root_index].subtree_size;
+    while (node_index <= root_index) {
+        uint type = scene.nodes[node_index].type;
+        bool is_sphere = scene_has_node_type(NODE_TYPE_SPHERE) && type == NODE_TYPE_SPHERE;
+        bool is_plane = scene_has_node_type(NODE_TYPE_INFINITE_PLANAR_PARTITION) && type == NODE_TYPE_INFINITE_PLANAR_PARTITION;
+        if (is_sphere || is_plane) {
+            // a subtree starts here: finding the largest one (within this component) the ray
+            // misses, if any.
+            uint cull_index = accel.records[node_index].a;
+            while (cull_index > root_index) {
+                cull_index = accel.records[cull_index].b;
+            }
+            bool culled = false;
+            for (;;) {
+                float t_near;
+                if (!ray_hits_box(accel.records[cull_index].min, accel.records[cull_index].max, ray, inv_direction, t_max, t_near)) {
+                    culled = true;
+                    break;
+                }
+                if (cull_index == node_index) {
+                    break;
+                }
+                cull_index = accel.records[cull_index].b;
+            }
+            if (culled) {
+                stack[stack_count++] = empty_interval_list();
+                node_index = cull_index + 1;
+                continue;
+            }
+
+            Affine world_to_local = node_world_to_local(node_index);
+            vec3 o = world_to_local.lin * ray.origin_pt + world_to_local.t;
+            vec3 d = world_to_local.lin * ray.direction;
+            vec4 params = scene.nodes[node_index].params;
+            if (is_sphere) {
+                stack[stack_count] = hit_sphere(params.x, o, d, node_index);
+            } else {
+                stack[stack_count] = hit_infinite_planar_partition(params.xyz, o, d, node_index);
+            }
+            stack[stack_count] = clip_interval_list(stack[stack_count], t_max);
+            stack_count++;
+        } else {
+            // operands are pushed in visiting order, which is swapped when the right operand
+            // needed the deeper stack:
+            bool swapped = (scene.nodes[node_index].flags & NODE_FLAG_OPERANDS_SWAPPED) != 0;
+            int top = stack_count - 1;
+            int below = stack_count - 2;
+            stack[below] = combine_interval_lists(
+                type,
+                stack[swapped ? top : below],
+                stack[swapped ? below : top]
+            );
+            stack_count--;
+        }
+        node_index++;
+    }
+
+    // the first entry in front of the camera:
+    for (int i = 0; i < stack[0].boundary_count; i += (include_exits ? 1 : 2)) {
+        float t = stack[0].t[i];
+        if (t > T_EPSILON && t < t_max) {
+            if (t >= stack[0].truncated_t) {
+                break;
+            }
+            out_surface = stack[0].surface[i];
+            return t;
+        }
+    }
+    if (stack[0].truncated_t < t_max) {
+        out_truncated_t = stack[0].truncated_t;
+    }
+    return T_INFINITY;
+}
+
+// like 'trace_subtree' for a component of the scene (see 'bvh.h'): instances trace their
+// prototype with the ray mapped into its space, where the prototype's nodes are placed.
+// World-to-local maps are rigid, so distances along the ray are the same in both spaces.
+float trace_component(uint component_root, RT_Ray ray, vec3 inv_direction, float t_max, bool include_exits, out uint out_surface, out float out_truncated_t) {
+    if (scene_has_node_type(NODE_TYPE_INSTANCE) && scene.nodes[component_root].type == NODE_TYPE_INSTANCE) {
+        Affine world_to_instance = node_world_to_local(component_root);
+        RT_Ray instance_ray;
+        instance_ray.origin_pt = world_to_instance.lin * ray.origin_pt + world_to_instance.t;
+        instance_ray.direction = world_to_instance.lin * ray.direction;
+        uint prototype_root = floatBitsToUint(scene.nodes[component_root].params.x);
+        return trace_subtree(prototype_root, instance_ray, 1.0 / instance_ray.direction, t_max, include_exits, out_surface, out_truncated_t);
+    }
+    return trace_subtree(component_root, ray, inv_direction, t_max, include_exits, out_surface, out_truncated_t);
+}
+
+// 'surface' is the hit leaf's surface (see 'SURFACE_FLIPPED'), 'normal' faces out of the solid.
+// 'stack_overflow' is set for scenes too deep for the evaluator and for rays whose nearest hit
+// may have been lost to dropped spans (see 'IntervalList'), both shown as errors.
+struct Hit {
+    bool ok;
+    bool stack_overflow;
+    float t;
+    vec3 normal;
+    uint surface;
+};
+
+// see 'trace_component' for 'include_exits'
+Hit trace_scene_boundaries(RT_Ray ray, bool include_exits) {
+    Hit hit;
+    hit.ok = false;
+    hit.stack_overflow = false;
+    hit.t = T_INFINITY;
+    hit.normal = vec3(0);
+    hit.surface = SURFACE_NONE;
+
+    if (scene.stack_depth > uint(CSG_STACK_CAPACITY)) {
+        hit.stack_overflow = true;
+        return hit;
+    }
+
+    // the first hit of a union is the nearest first hit of its operands, so each component is
+    // traced on its own, and only up to the nearest hit found so far:
+    vec3 inv_direction = 1.0 / ray.direction;
+    float best_t = T_INFINITY;
+    uint best_surface = SURFACE_NONE;
+    uint best_component = 0u;
+    float truncated_t = T_INFINITY;
+
+    // unbounded components are traced by every ray:
+    uint unbounded_offset = accel.node_count + accel.bvh_node_count;
+    for (uint i = 0; i < accel.unbounded_component_count; i++) {
+        uint surface;
+        float component_truncated_t;
+        uint component = accel.records[unbounded_offset + i].a;
+        float t = trace_component(component, ray, inv_direction, best_t, include_exits, surface, component_truncated_t);
+        truncated_t = min(truncated_t, component_truncated_t);
+        if (t < best_t) {
+            best_t = t;
+            best_surface = surface;
+            best_component = component;
+        }
+    }
+
+#ifdef WO_RAY_QUERY
+    // bounded ones by querying the TLAS: every AABB it reports is traced like a BVH leaf, and
+    // each hit committed shortens the query so farther AABBs are skipped.
+    if (accel.bounded_component_count > 0) {
+        rayQueryEXT query;
+        rayQueryInitializeEXT(
+            query, scene_tlas,
+            gl_RayFlagsNoneEXT, 0xFF,
+            ray.origin_pt, 0.0, ray.direction, best_t
+        );
+        while (rayQueryProceedEXT(query)) {
+            if (rayQueryGetIntersectionTypeEXT(query, false) != gl_RayQueryCandidateIntersectionAABBEXT) {
+                continue;
+            }
+            uint component = scene_components.aabbs[rayQueryGetIntersectionPrimitiveIndexEXT(query, false)].component_root;
+            uint surface;
+            float component_truncated_t;
+            float t = trace_component(component, ray, inv_direction, best_t, include_exits, surface, component_truncated_t);
+            truncated_t = min(truncated_t, component_truncated_t);
+            if (t < best_t) {
+                best_t = t;
+                best_surface = surface;
+                best_component = component;
+                rayQueryGenerateIntersectionEXT(query, t);
+            }
+        }
+    }
+#else
+    // bounded ones by traversing the BVH, nearest child first:
+    if (accel.bvh_node_count > 0) {
+        uint bvh_stack[BVH_STACK_CAPACITY];
+        int bvh_stack_count = 0;
+        bvh_stack[bvh_stack_count++] = 0;
+        while (bvh_stack_count > 0) {
+            AccelRecord bvh_node = accel.records[accel.node_count + bvh_stack[--bvh_stack_count]];
+            float t_near;
+            if (!ray_hits_box(bvh_node.min, bvh_node.max, ray, inv_direction, best_t, t_near)) {
+                continue;
+            }
+            if (bvh_node.b != 0) {
+                uint surface;
+                float component_truncated_t;
+                float t = trace_component(bvh_node.a, ray, inv_direction, best_t, include_exits, surface, component_truncated_t);
+                truncated_t = min(truncated_t, component_truncated_t);
+                if (t < best_t) {
+                    best_t = t;
+                    best_surface = surface;
+                    best_component = bvh_node.a;
+                }
+            } else {
+                AccelRecord left = accel.records[accel.node_count + bvh_node.a];
+                AccelRecord right = accel.records[accel.node_count + bvh_node.a + 1];
+                float t_left;
+                float t_right;
+                bool hits_left = ray_hits_box(left.min, left.max, ray, inv_direction, best_t, t_left);
+                bool hits_right = ray_hits_box(right.min, right.max, ray, inv_direction, best_t, t_right);
+                if (hits_left && hits_right) {
+                    // pushing the farther child first, so the nearer one is popped next:
+                    bool left_first = t_left <= t_right;
+                    bvh_stack[bvh_stack_count++] = bvh_node.a + (left_first ? 1u : 0u);
+                    bvh_stack[bvh_stack_count++] = bvh_node.a + (left_first ? 0u : 1u);
+                } else if (hits_left) {
+                    bvh_stack[bvh_stack_count++] = bvh_node.a;
+                } else if (hits_right) {
+                    bvh_stack[bvh_stack_count++] = bvh_node.a + 1;
+                }
+            }
+        }
+    }
+#endif
+
+    // a component whose list was truncated in front of the nearest hit may have hidden a
+    // nearer one:
+    if (truncated_t < best_t) {
+        hit.stack_overflow = true;
+        return hit;
+    }
+    if (best_t < T_INFINITY) {
+        hit.ok = true;
+        hit.t = best_t;
+        hit.normal = surface_normal(best_surface, best_component, ray, best_t);
+        hit.surface = best_surface;
+    }
+    return hit;
+}
+Hit trace_scene(RT_Ray ray) {
+    return trace_scene_boundaries(ray, false);
+}
+
+vec3 background_color(RT_Ray ray) {
+    vec3 unit_direction = normalize(ray.direction);
+    float t = unit_direction.y;
+    return (
+        (1.0 - t) * COLOR_white +
+        (t)       * COLOR_sky_blue
+    );
+}
+
+vec3 ray_color(RT_Ray ray) {
+    // checking the scene:
+    {
+        Hit hit = trace_scene(ray);
+        if (hit.stack_overflow) {
+            return COLOR_error;
+        }
+        if (hit.ok) {
+            return (
+                0.5 * (hit.normal + vec3(1.0, 1.0, 1.0))
+            );
+        }
+    }
+
+    // else background:
+    return background_color(ray);
+}
+
+// the color of 'DEBUG_VIEW' (unless DEBUG_VIEW_NONE) for a ray through screen coordinates 'st':
+vec3 debug_view_color(RT_Ray ray, vec2 st) {
+    if (DEBUG_VIEW == DEBUG_VIEW_SCREEN_COORDINATES) {
+        return vec3(st.x, st.y, 0);
+    }
+    Hit hit = trace_scene(ray);
+    if (hit.stack_overflow) {
+        return COLOR_error;
+    }
+    return hit.ok ? vec3(1.0 / (1.0 + hit.t)) : COLOR_black;
+}
@@ -0,0 +1,314 @@
+#include "wmath.batch.h"
+
+#include <string.h>
+#include <assert.h>
+
+//
+// Lanes:
+// a minimal vector abstraction, so every kernel is written once for all instruction sets.
+//
+
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define LANE_COUNT (8)
+    typedef __m256 Lanes;
+    inline static Lanes lanes_load(float const* p) { return _mm256_loadu_ps(p); }
+    inline static void lanes_store(float* p, Lanes v) { _mm256_storeu_ps(p, v); }
+    inline static Lanes lanes_set1(float v) { return _mm256_set1_ps(v); }
+    inline static Lanes lanes_add(Lanes a, Lanes b) { return _mm256_add_ps(a, b); }
+    inline static Lanes lanes_sub(Lanes a, Lanes b) { return _mm256_sub_ps(a, b); }
+    inline static Lanes lanes_mul(Lanes a, Lanes b) { return _mm256_mul_ps(a, b); }
+    inline static Lanes lanes_div(Lanes a, Lanes b) { return _mm256_div_ps(a, b); }
+    inline static Lanes lanes_sqrt(Lanes a) { return _mm256_sqrt_ps(a); }
+    inline static Lanes lanes_max(Lanes a, Lanes b) { return _mm256_max_ps(a, b); }
+    inline static Lanes lanes_is_zero(Lanes a) {
+        return _mm256_and_ps(_mm256_cmp_ps(a, _mm256_setzero_ps(), _CMP_EQ_OQ), _mm256_set1_ps(1.0f));
+    }
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define LANE_COUNT (4)
+    typedef __m128 Lanes;
+    inline static Lanes lanes_load(float const* p) { return _mm_loadu_ps(p); }
+    inline static void lanes_store(float* p, Lanes v) { _mm_storeu_ps(p, v); }
+    inline static Lanes lanes_set1(float v) { return _mm_set1_ps(v); }
+    inline static Lanes lanes_add(Lanes a, Lanes b) { return _mm_add_ps(a, b); }
+    inline static Lanes lanes_sub(Lanes a, Lanes b) { return _mm_sub_ps(a, b); }
+    inline static Lanes lanes_mul(Lanes a, Lanes b) { return _mm_mul_ps(a, b); }
+    inline static Lanes lanes_div(Lanes a, Lanes b) { return _mm_div_ps(a, b); }
+    inline static Lanes lanes_sqrt(Lanes a) { return _mm_sqrt_ps(a); }
+    inline static Lanes lanes_max(Lanes a, Lanes b) { return _mm_max_ps(a, b); }
+    inline static Lanes lanes_is_zero(Lanes a) {
+        return _mm_and_ps(_mm_cmpeq_ps(a, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+    }
+#elif (defined(__ARM_NEON) && defined(__aarch64__)) || defined(_M_ARM64)
+    // (AArch64 only: 32-bit NEON has no exact 'vdivq_f32' or 'vsqrtq_f32')
+    #include <arm_neon.h>
+    #define LANE_COUNT (4)
+    typedef float32x4_t Lanes;
+    inline static Lanes lanes_load(float const* p) { return vld1q_f32(p); }
+    inline static void lanes_store(float* p, Lanes v) { vst1q_f32(p, v); }
+    inline static Lanes lanes_set1(float v) { return vdupq_n_f32(v); }
+    inline static Lanes lanes_add(Lanes a, Lanes b) { return vaddq_f32(a, b); }
+    inline static Lanes lanes_sub(Lanes a, Lanes b) { return vsubq_f32(a, b); }
+    inline static Lanes lanes_mul(Lanes a, Lanes b) { return vmulq_f32(a, b); }
+    inline static Lanes lanes_div(Lanes a, Lanes b) { return vdivq_f32(a, b); }
+    inline static Lanes lanes_sqrt(Lanes a) { return vsqrtq_f32(a); }
+    inline static Lanes lanes_max(Lanes a, Lanes b) { return vmaxq_f32(a, b); }
+    inline static Lanes lanes_is_zero(Lanes a) {
+        uint32x4_t mask = vceqq_f32(a, vdupq_n_f32(0.0f));
+        return vreinterpretq_f32_u32(vandq_u32(mask, vreinterpretq_u32_f32(vdupq_n_f32(1.0f))));
+    }
+#else
+    #include <math.h>
+    #define LANE_COUNT (1)
+    typedef float Lanes;
+    inline static Lanes lanes_load(float const* p) { return *p; }
+    inline static void lanes_store(float* p, Lanes v) { *p = v; }
+    inline static Lanes lanes_set1(float v) { return v; }
+    inline static Lanes lanes_add(Lanes a, Lanes b) { return a + b; }
+    inline static Lanes lanes_sub(Lanes a, Lanes b) { return a - b; }
+    inline static Lanes lanes_mul(Lanes a, Lanes b) { return a * b; }
+    inline static Lanes lanes_div(Lanes a, Lanes b) { return a / b; }
+    inline static Lanes lanes_sqrt(Lanes a) { return sqrtf(a); }
+    inline static Lanes lanes_max(Lanes a, Lanes b) { return a > b ? a : b; }
+    inline static Lanes lanes_is_zero(Lanes a) { return a == 0.0f ? 1.0f : 0.0f; }
+#endif
+
+size_t const WO_BATCH_LANE_COUNT = LANE_COUNT;
+
+// a group of up to 'LANE_COUNT' consecutive elements starting at 'first':
+// the last group of a batch is padded with zeros, which every kernel maps to finite values.
+typedef struct LaneGroup LaneGroup;
+struct LaneGroup {
+    size_t first;
+    size_t count;
+};
+
+inline static Lanes lanes_abs(Lanes a) {
+    return lanes_max(a, lanes_sub(lanes_set1(0.0f), a));
+}
+inline static Lanes group_load(LaneGroup group, float const* p) {
+    if (group.count == LANE_COUNT) {
+        return lanes_load(p + group.first);
+    } else {
+        float padded[LANE_COUNT] = {0};
+        memcpy(padded, p + group.first, group.count * sizeof(float));
+        return lanes_load(padded);
+    }
+}
+inline static void group_store(LaneGroup group, float* p, Lanes v) {
+    if (group.count == LANE_COUNT) {
+        lanes_store(p + group.first, v);
+    } else {
+        float padded[LANE_COUNT];
+        lanes_store(padded, v);
+        memcpy(p + group.first, padded, group.count * sizeof(float));
+    }
+}
+inline static LaneGroup group_at(size_t first, size_t count) {
+    LaneGroup group = {first, (count - first < LANE_COUNT) ? (count - first) : LANE_COUNT};
+    return group;
+}
+
+typedef struct QuaternionLanes QuaternionLanes;
+struct QuaternionLanes {
+    Lanes w, x, y, z;
+};
+
+static QuaternionLanes group_load_quaternion(LaneGroup group, Wo_Quaternion_Batch q);
+static void group_store_quaternion(LaneGroup group, Wo_Quaternion_Batch q, QuaternionLanes v);
+static void quaternion_lanes_to_matrix(QuaternionLanes q, Lanes out_rows[3][3]);
+
+static QuaternionLanes group_load_quaternion(LaneGroup group, Wo_Quaternion_Batch q) {
+    QuaternionLanes v = {
+        .w = group_load(group, q.real),
+        .x = group_load(group, q.imaginary.x),
+        .y = group_load(group, q.imaginary.y),
+        .z = group_load(group, q.imaginary.z)
+    };
+    return v;
+}
+static void group_store_quaternion(LaneGroup group, Wo_Quaternion_Batch q, QuaternionLanes v) {
+    group_store(group, q.real, v.w);
+    group_store(group, q.imaginary.x, v.x);
+    group_store(group, q.imaginary.y, v.y);
+    group_store(group, q.imaginary.z, v.z);
+}
+static void quaternion_lanes_to_matrix(QuaternionLanes q, Lanes out_rows[3][3]) {
+    // mirrors 'wo_quaternion_to_matrix', zero quaternions (and padding) becoming the identity:
+    Lanes norm_sq = lanes_add(
+        lanes_add(lanes_mul(q.w, q.w), lanes_mul(q.x, q.x)),
+        lanes_add(lanes_mul(q.y, q.y), lanes_mul(q.z, q.z))
+    );
+    Lanes is_zero = lanes_is_zero(norm_sq);
+    Lanes w = lanes_add(q.w, is_zero);
+    Lanes s = lanes_div(lanes_set1(2.0f), lanes_add(norm_sq, is_zero));
+    Lanes one = lanes_set1(1.0f);
+
+    Lanes xx = lanes_mul(q.x, q.x), yy = lanes_mul(q.y, q.y), zz = lanes_mul(q.z, q.z);
+    Lanes xy = lanes_mul(q.x, q.y), xz = lanes_mul(q.x, q.z), yz = lanes_mul(q.y, q.z);
+    Lanes wx = lanes_mul(w, q.x), wy = lanes_mul(w, q.y), wz = lanes_mul(w, q.z);
+    out_rows[0][0] = lanes_sub(one, lanes_mul(s, lanes_add(yy, zz)));
+    out_rows[0][1] = lanes_mul(s, lanes_sub(xy, wz));
+    out_rows[0][2] = lanes_mul(s, lanes_add(xz, wy));
+    out_rows[1][0] = lanes_mul(s, lanes_add(xy, wz));
+    out_rows[1][1] = lanes_sub(one, lanes_mul(s, lanes_add(xx, zz)));
+    out_rows[1][2] = lanes_mul(s, lanes_sub(yz, wx));
+    out_rows[2][0] = lanes_mul(s, lanes_sub(xz, wy));
+    out_rows[2][1] = lanes_mul(s, lanes_add(yz, wx));
+    out_rows[2][2] = lanes_sub(one, lanes_mul(s, lanes_add(xx, yy)));
+}
+
+//
+// Kernels:
+//
+
+void wo_vec3_batch_normalize(Wo_Vec3_Batch v, size_t count) {
+    for (size_t i = 0; i < count; i += LANE_COUNT) {
+        LaneGroup group = group_at(i, count);
+        Lanes x = group_load(group, v.x);
+        Lanes y = group_load(group, v.y);
+        Lanes z = group_load(group, v.z);
+        Lanes length_sq = lanes_add(lanes_add(lanes_mul(x, x), lanes_mul(y, y)), lanes_mul(z, z));
+        // (zero vectors are scaled by 1)
+        Lanes length = lanes_sqrt(lanes_add(length_sq, lanes_is_zero(length_sq)));
+        group_store(group, v.x, lanes_div(x, length));
+        group_store(group, v.y, lanes_div(y, length));
+        group_store(group, v.z, lanes_div(z, length));
+    }
+}
+
+void wo_quaternion_batch_normalize(Wo_Quaternion_Batch q, size_t count) {
+    for (size_t i = 0; i < count; i += LANE_COUNT) {
+        LaneGroup group = group_at(i, count);
+        QuaternionLanes v = group_load_quaternion(group, q);
+        Lanes length_sq = lanes_add(
+            lanes_add(lanes_mul(v.w, v.w), lanes_mul(v.x, v.x)),
+            lanes_add(lanes_mul(v.y, v.y), lanes_mul(v.z, v.z))
+        );
+        // (zero quaternions become '{1, 0}', whose length is 1)
+        Lanes is_zero = lanes_is_zero(length_sq);
+        Lanes length = lanes_sqrt(lanes_add(length_sq, is_zero));
+        v.w = lanes_div(lanes_add(v.w, is_zero), length);
+        v.x = lanes_div(v.x, length);
+        v.y = lanes_div(v.y, length);
+        v.z = lanes_div(v.z, length);
+        group_store_quaternion(group, q, v);
+    }
+}
+
+void wo_quaternion_batch_multiply(
+    Wo_Quaternion_Batch q, Wo_Quaternion_Batch r,
+    Wo_Quaternion_Batch out,
+    size_t count
+) {
+    for (size_t i = 0; i < count; i += LANE_COUNT) {
+        LaneGroup group = group_at(i, count);
+        QuaternionLanes a = group_load_quaternion(group, q);
+        QuaternionLanes b = group_load_quaternion(group, r);
+        QuaternionLanes product = {
+            .w = lanes_sub(
+                lanes_mul(a.w, b.w),
+                lanes_add(lanes_add(lanes_mul(a.x, b.x), lanes_mul(a.y, b.y)), lanes_mul(a.z, b.z))
+            ),
+            .x = lanes_add(
+                lanes_add(lanes_mul(a.w, b.x), lanes_mul(a.x, b.w)),
+                lanes_sub(lanes_mul(a.y, b.z), lanes_mul(a.z, b.y))
+            ),
+            .y = lanes_add(
+                lanes_add(lanes_mul(a.w, b.y), lanes_mul(a.y, b.w)),
+                lanes_sub(lanes_mul(a.z, b.x), lanes_mul(a.x, b.z))
+            ),
+            .z = lanes_add(
+                lanes_add(lanes_mul(a.w, b.z), lanes_mul(a.z, b.w)),
+                lanes_sub(lanes_mul(a.x, b.y), lanes_mul(a.y, b.x))
+            )
+        };
+        group_store_quaternion(group, out, product);
+    }
+}
+
+void wo_rigid_batch_transform_bounds(
+    Wo_Rigid_Batch transform,
+    Wo_Vec3_Batch min, Wo_Vec3_Batch max,
+    Wo_Vec3_Batch out_min, Wo_Vec3_Batch out_max,
+    size_t count
+) {
+    Lanes half = lanes_set1(0.5f);
+    for (size_t i = 0; i < count; i += LANE_COUNT) {
+        LaneGroup group = group_at(i, count);
+        Lanes rows[3][3];
+        quaternion_lanes_to_matrix(group_load_quaternion(group, transform.orientation), rows);
+        Lanes offset[3] = {
+            group_load(group, transform.offset.x),
+            group_load(group, transform.offset.y),
+            group_load(group, transform.offset.z)
+        };
+        Lanes lo[3] = {group_load(group, min.x), group_load(group, min.y), group_load(group, min.z)};
+        Lanes hi[3] = {group_load(group, max.x), group_load(group, max.y), group_load(group, max.z)};
+        Lanes center[3], extent[3];
+        for (int axis = 0; axis < 3; axis++) {
+            center[axis] = lanes_mul(half, lanes_add(lo[axis], hi[axis]));
+            extent[axis] = lanes_mul(half, lanes_sub(hi[axis], lo[axis]));
+        }
+
+        // the image's center is 'R * center + offset', its extent '|R| * extent':
+        Lanes new_lo[3], new_hi[3];
+        for (int row = 0; row < 3; row++) {
+            Lanes new_center = offset[row];
+            Lanes new_extent = lanes_set1(0.0f);
+            for (int col = 0; col < 3; col++) {
+                new_center = lanes_add(new_center, lanes_mul(rows[row][col], center[col]));
+                new_extent = lanes_add(new_extent, lanes_mul(lanes_abs(rows[row][col]), extent[col]));
+            }
+            new_lo[row] = lanes_sub(new_center, new_extent);
+            new_hi[row] = lanes_add(new_center, new_extent);
+        }
+        group_store(group, out_min.x, new_lo[0]);
+        group_store(group, out_min.y, new_lo[1]);
+        group_store(group, out_min.z, new_lo[2]);
+        group_store(group, out_max.x, new_hi[0]);
+        group_store(group, out_max.y, new_hi[1]);
+        group_store(group, out_max.z, new_hi[2]);
+    }
+}
+
+void wo_rigid_batch_write_inverse_rows(
+    Wo_Rigid_Batch transform,
+    void* dst, size_t dst_stride,
+    size_t count
+) {
+    assert(dst_stride >= sizeof(float[3][4]));
+    for (size_t i = 0; i < count; i += LANE_COUNT) {
+        LaneGroup group = group_at(i, count);
+        Lanes rows[3][3];
+        quaternion_lanes_to_matrix(group_load_quaternion(group, transform.orientation), rows);
+        Lanes offset[3] = {
+            group_load(group, transform.offset.x),
+            group_load(group, transform.offset.y),
+            group_load(group, transform.offset.z)
+        };
+
+        // the inverse's rows are R's columns, its translation '-R^T * offset':
+        float inverse[3][4][LANE_COUNT];
+        for (int row = 0; row < 3; row++) {
+            Lanes translation = lanes_set1(0.0f);
+            for (int col = 0; col < 3; col++) {
+                lanes_store(inverse[row][col], rows[col][row]);
+                translation = lanes_sub(translation, lanes_mul(rows[col][row], offset[col]));
+            }
+            lanes_store(inverse[row][3], translation);
+        }
+
+        // scattering each element's rows into the (AoS) destination:
+        for (size_t lane = 0; lane < group.count; lane++) {
+            float element_rows[3][4];
+            for (int row = 0; row < 3; row++) {
+                for (int col = 0; col < 4; col++) {
+                    element_rows[row][col] = inverse[row][col][lane];
+                }
+            }
+            memcpy((char*)dst + (group.first + lane) * dst_stride, element_rows, sizeof(element_rows));
+        }
+    }
+}
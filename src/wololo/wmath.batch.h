@@ -0,0 +1,94 @@
+#pragma once
+
+#include <stddef.h>
+
+#include "wmath.h"
+
+//
+// Batches
+// Float32 kernels over structure-of-arrays (SoA) data, for preprocessing whole node arrays
+// at once: each kernel runs several elements per instruction with AVX2, SSE2 or NEON when the
+// compiler targets them (see 'WO_BATCH_LANE_COUNT'), and one at a time otherwise.
+// Unless noted otherwise, outputs may alias inputs exactly (but not partially).
+//
+
+typedef struct Wo_Vec3_Batch Wo_Vec3_Batch;
+struct Wo_Vec3_Batch {
+    float* x;
+    float* y;
+    float* z;
+};
+
+typedef struct Wo_Quaternion_Batch Wo_Quaternion_Batch;
+struct Wo_Quaternion_Batch {
+    float* real;
+    Wo_Vec3_Batch imaginary;
+};
+
+// rigid transforms 'p -> rotate(orientation, p) + offset', like 'Wo_Node_Argument'.
+typedef struct Wo_Rigid_Batch Wo_Rigid_Batch;
+struct Wo_Rigid_Batch {
+    Wo_Quaternion_Batch orientation;
+    Wo_Vec3_Batch offset;
+};
+
+// the number of elements processed per instruction by the compiled kernels:
+extern size_t const WO_BATCH_LANE_COUNT;
+
+inline static void wo_vec3_batch_set(Wo_Vec3_Batch batch, size_t index, Wo_Vec3 v);
+inline static Wo_Vec3 wo_vec3_batch_get(Wo_Vec3_Batch batch, size_t index);
+inline static void wo_quaternion_batch_set(Wo_Quaternion_Batch batch, size_t index, Wo_Quaternion q);
+inline static Wo_Quaternion wo_quaternion_batch_get(Wo_Quaternion_Batch batch, size_t index);
+
+// zero vectors are left as-is, like 'wo_vec3_normalized':
+void wo_vec3_batch_normalize(Wo_Vec3_Batch v, size_t count);
+
+// zero quaternions become the identity, like 'wo_quaternion_normalized':
+void wo_quaternion_batch_normalize(Wo_Quaternion_Batch q, size_t count);
+
+// 'out[i] = q[i] * r[i]', like 'wo_quaternion_multiply':
+void wo_quaternion_batch_multiply(
+    Wo_Quaternion_Batch q, Wo_Quaternion_Batch r,
+    Wo_Quaternion_Batch out,
+    size_t count
+);
+
+// bounds the image of each box '[min[i], max[i]]' under 'transform[i]'.
+// Boxes must be finite: an infinite extent times a zero rotation entry is NaN.
+// see: Arvo, 'Transforming Axis-Aligned Bounding Boxes' (Graphics Gems, 1990)
+void wo_rigid_batch_transform_bounds(
+    Wo_Rigid_Batch transform,
+    Wo_Vec3_Batch min, Wo_Vec3_Batch max,
+    Wo_Vec3_Batch out_min, Wo_Vec3_Batch out_max,
+    size_t count
+);
+
+// writes the rows of each transform's inverse, 'p -> R^T * (p - offset)', as 'float[3][4]' at
+// 'dst + i*dst_stride' (i.e. the GPU's 'parent_to_local' layout when given a node argument).
+void wo_rigid_batch_write_inverse_rows(
+    Wo_Rigid_Batch transform,
+    void* dst, size_t dst_stride,
+    size_t count
+);
+
+//
+// Inline implementation:
+//
+
+inline static void wo_vec3_batch_set(Wo_Vec3_Batch batch, size_t index, Wo_Vec3 v) {
+    batch.x[index] = (float)v.x;
+    batch.y[index] = (float)v.y;
+    batch.z[index] = (float)v.z;
+}
+inline static Wo_Vec3 wo_vec3_batch_get(Wo_Vec3_Batch batch, size_t index) {
+    Wo_Vec3 v = {batch.x[index], batch.y[index], batch.z[index]};
+    return v;
+}
+inline static void wo_quaternion_batch_set(Wo_Quaternion_Batch batch, size_t index, Wo_Quaternion q) {
+    batch.real[index] = (float)q.real;
+    wo_vec3_batch_set(batch.imaginary, index, q.imaginary);
+}
+inline static Wo_Quaternion wo_quaternion_batch_get(Wo_Quaternion_Batch batch, size_t index) {
+    Wo_Quaternion q = {batch.real[index], wo_vec3_batch_get(batch.imaginary, index)};
+    return q;
+}
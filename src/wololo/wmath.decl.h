@@ -39,5 +39,13 @@ struct Wo_Quaternion {
 };
 
 inline static Wo_Quaternion wo_quaternion_identity();
+inline static Wo_Quaternion wo_quaternion_multiply(Wo_Quaternion q, Wo_Quaternion r);
+inline static Wo_Quaternion wo_quaternion_conjugate(Wo_Quaternion q);
+inline static Wo_Scalar wo_quaternion_lengthsqr(Wo_Quaternion q);
+inline static Wo_Quaternion wo_quaternion_normalized(Wo_Quaternion q);
+inline static Wo_Vec3 wo_quaternion_rotate(Wo_Quaternion q, Wo_Vec3 v);
+
+// the rotation matrix of 'q' (which need not be normalized: its length is divided out),
+// s.t. 'rotate(q, v) == out_rows * v'. The zero quaternion is treated as the identity.
+inline static void wo_quaternion_to_matrix(Wo_Quaternion q, Wo_Scalar out_rows[3][3]);
 
-// todo
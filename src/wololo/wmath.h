@@ -1,6 +1,7 @@
 #pragma once
 
-// read types.decl.h for documentation.
-// read types.impl.h for inline implementations.
+// read wmath.decl.h for documentation.
+// read wmath.impl.h for inline implementations.
+// read wmath.batch.h for float32 batch kernels over SoA arrays.
 
 #include "wmath.impl.h"
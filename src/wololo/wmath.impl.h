@@ -46,7 +46,7 @@ inline static Wo_Scalar wo_vec3_length(Wo_Vec3 v) {
     return sqrt(wo_vec3_lengthsqr(v));
 }
 inline static Wo_Vec3 wo_vec3_normalized(Wo_Vec3 v) {
-    Wo_Scalar length = wo_vec3_lengthsqr(v);
+    Wo_Scalar length = wo_vec3_length(v);
     if (length == 0.0) {
         return v;
     } else {
@@ -67,4 +67,64 @@ inline static Wo_Vec3 wo_vec3_0() {
 inline static Wo_Quaternion wo_quaternion_identity() {
     Wo_Quaternion quat = {1,wo_vec3_0()};
     return quat;
-}
\ No newline at end of file
+}
+inline static Wo_Quaternion wo_quaternion_multiply(Wo_Quaternion q, Wo_Quaternion r) {
+    // the Hamilton product: rotating by 'q * r' rotates by 'r', then by 'q'.
+    Wo_Vec3 cross = {
+        .x = q.imaginary.y * r.imaginary.z - q.imaginary.z * r.imaginary.y,
+        .y = q.imaginary.z * r.imaginary.x - q.imaginary.x * r.imaginary.z,
+        .z = q.imaginary.x * r.imaginary.y - q.imaginary.y * r.imaginary.x
+    };
+    Wo_Quaternion product = {
+        .real = q.real * r.real - wo_vec3_dot(q.imaginary, r.imaginary),
+        .imaginary = wo_vec3_add(
+            wo_vec3_add(
+                wo_vec3_scale(r.imaginary, q.real),
+                wo_vec3_scale(q.imaginary, r.real)
+            ),
+            cross
+        )
+    };
+    return product;
+}
+inline static Wo_Quaternion wo_quaternion_conjugate(Wo_Quaternion q) {
+    Wo_Quaternion conjugate = {q.real, wo_vec3_scale(q.imaginary, -1.0)};
+    return conjugate;
+}
+inline static Wo_Scalar wo_quaternion_lengthsqr(Wo_Quaternion q) {
+    return q.real * q.real + wo_vec3_lengthsqr(q.imaginary);
+}
+inline static Wo_Quaternion wo_quaternion_normalized(Wo_Quaternion q) {
+    Wo_Scalar length = sqrt(wo_quaternion_lengthsqr(q));
+    if (length == 0.0) {
+        return wo_quaternion_identity();
+    } else {
+        Wo_Quaternion r = {q.real / length, wo_vec3_scale(q.imaginary, 1.0/length)};
+        return r;
+    }
+}
+inline static Wo_Vec3 wo_quaternion_rotate(Wo_Quaternion q, Wo_Vec3 v) {
+    Wo_Scalar rows[3][3];
+    wo_quaternion_to_matrix(q, rows);
+    Wo_Vec3 r = {
+        .x = rows[0][0] * v.x + rows[0][1] * v.y + rows[0][2] * v.z,
+        .y = rows[1][0] * v.x + rows[1][1] * v.y + rows[1][2] * v.z,
+        .z = rows[2][0] * v.x + rows[2][1] * v.y + rows[2][2] * v.z
+    };
+    return r;
+}
+inline static void wo_quaternion_to_matrix(Wo_Quaternion q, Wo_Scalar out_rows[3][3]) {
+    // see: https://www.3dgep.com/understanding-quaternions/#Quaternion_to_Matrix
+    Wo_Scalar w = q.real;
+    Wo_Scalar x = q.imaginary.x;
+    Wo_Scalar y = q.imaginary.y;
+    Wo_Scalar z = q.imaginary.z;
+    Wo_Scalar norm_sq = w*w + x*x + y*y + z*z;
+    if (norm_sq == 0.0) {
+        w = 1.0; norm_sq = 1.0;
+    }
+    Wo_Scalar s = 2.0 / norm_sq;
+    out_rows[0][0] = 1.0 - s*(y*y + z*z); out_rows[0][1] = s*(x*y - w*z);       out_rows[0][2] = s*(x*z + w*y);
+    out_rows[1][0] = s*(x*y + w*z);       out_rows[1][1] = 1.0 - s*(x*x + z*z); out_rows[1][2] = s*(y*z - w*x);
+    out_rows[2][0] = s*(x*z - w*y);       out_rows[2][1] = s*(y*z + w*x);       out_rows[2][2] = 1.0 - s*(x*x + y*y);
+}
@@ -0,0 +1,466 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#include <wololo/wololo.h>
+#include <wololo/wmath.h>
+#include <wololo/renderer/renderer.h>
+
+//
+// wololo_bench: renders canned, procedurally generated CSG scenes headless, at fixed resolutions
+// and on every trace path the device supports, and prints their GPU frame-time percentiles, ray
+// throughput and upload volume as JSON, to compare across driver and renderer changes.
+// The renderer logs to stdout, so the JSON is written to a file ('--out', by default
+// BENCH_DEFAULT_OUT_PATH) to keep it parseable.
+//
+// usage: wololo_bench [--frames N] [--warmup N] [--path-tracing] [--out FILE]
+//
+
+#define BENCH_DEFAULT_FRAME_COUNT (120)
+#define BENCH_DEFAULT_WARMUP_FRAME_COUNT (16)
+#define BENCH_DEFAULT_OUT_PATH "wololo-bench.json"
+// binops whose right operand is moved every frame by 'moving' cases:
+#define BENCH_MAX_MOVING_NODE_COUNT (64)
+// scenes are centered in front of the camera, which looks down -Z:
+#define BENCH_SCENE_DEPTH (-8.0)
+
+typedef struct BenchScene BenchScene;
+struct BenchScene {
+    Wo_Node root;
+    uint32_t moving_node_count;
+    Wo_Node moving_nodes[BENCH_MAX_MOVING_NODE_COUNT];
+    Wo_Node_Argument moving_node_args[BENCH_MAX_MOVING_NODE_COUNT];
+};
+typedef void(*BenchSceneBuilderPtr)(Wo_Renderer* renderer, uint32_t size, BenchScene* out_scene);
+
+typedef struct BenchCase BenchCase;
+struct BenchCase {
+    char const* name;
+    BenchSceneBuilderPtr build_scene_cb;
+    uint32_t size;
+    size_t node_count;
+    bool moving;
+};
+
+typedef struct BenchResolution BenchResolution;
+struct BenchResolution {
+    uint32_t width;
+    uint32_t height;
+};
+
+typedef struct BenchConfig BenchConfig;
+struct BenchConfig {
+    uint32_t frame_count;
+    uint32_t warmup_frame_count;
+    bool path_tracing;
+    char const* out_path;
+};
+
+void build_difference_chain(Wo_Renderer* renderer, uint32_t depth, BenchScene* out_scene);
+void build_union_forest(Wo_Renderer* renderer, uint32_t sphere_count, BenchScene* out_scene);
+void build_planar_intersection(Wo_Renderer* renderer, uint32_t plane_count, BenchScene* out_scene);
+void move_scene(Wo_Renderer* renderer, BenchScene* scene, uint32_t frame_index);
+
+Wo_Vec3 fibonacci_sphere_point(uint32_t index, uint32_t count);
+
+bool run_case(
+    FILE* out, bool* is_first_run,
+    BenchConfig const* config, BenchCase const* bench_case, BenchResolution resolution
+);
+bool run_trace_path(
+    FILE* out, bool is_first_run,
+    BenchConfig const* config, BenchCase const* bench_case, BenchResolution resolution,
+    Wo_Renderer* renderer, BenchScene* scene, Wo_Trace_Path trace_path,
+    void* pixels, size_t pixels_size
+);
+int compare_doubles(void const* a, void const* b);
+double percentile(double const* sorted_samples, uint32_t sample_count, double p);
+char const* trace_path_name(Wo_Trace_Path trace_path);
+double wall_time_sec(void);
+
+static BenchCase const bench_cases[] = {
+    {"difference_chain_64", build_difference_chain, 64, 1 + 2*64, false},
+    {"union_forest_256", build_union_forest, 256, 2*256 - 1, false},
+    {"union_forest_256_moving", build_union_forest, 256, 2*256 - 1, true},
+    {"planar_intersection_48", build_planar_intersection, 48, 1 + 2*48, false}
+};
+static BenchResolution const bench_resolutions[] = {
+    {640, 360},
+    {1280, 720},
+    {1920, 1080}
+};
+static Wo_Trace_Path const bench_trace_paths[] = {
+    WO_TRACE_PATH_FRAGMENT,
+    WO_TRACE_PATH_COMPUTE,
+    WO_TRACE_PATH_RAY_QUERY
+};
+
+//
+// Scenes:
+//
+
+// a large sphere with 'depth' small spheres carved out of its surface, one difference at a time,
+// so that every ray walks the whole chain:
+void build_difference_chain(Wo_Renderer* renderer, uint32_t depth, BenchScene* out_scene) {
+    Wo_Vec3 center = {0.0, 0.0, BENCH_SCENE_DEPTH};
+    Wo_Scalar radius = 2.0;
+    Wo_Node node = wo_renderer_add_sphere_node(renderer, radius);
+    Wo_Vec3 node_offset = center;
+    for (uint32_t i = 0; i < depth; i++) {
+        Wo_Node hole = wo_renderer_add_sphere_node(renderer, 0.35);
+        Wo_Node_Argument hole_arg = {
+            wo_quaternion_identity(),
+            wo_vec3_add(center, wo_vec3_scale(fibonacci_sphere_point(i, depth), radius)),
+            hole
+        };
+        node = wo_renderer_add_difference_of_node(renderer,
+            (Wo_Node_Argument) {wo_quaternion_identity(), node_offset, node},
+            hole_arg
+        );
+        node_offset = wo_vec3_0();
+        if (out_scene->moving_node_count < BENCH_MAX_MOVING_NODE_COUNT) {
+            out_scene->moving_nodes[out_scene->moving_node_count] = node;
+            out_scene->moving_node_args[out_scene->moving_node_count] = hole_arg;
+            out_scene->moving_node_count++;
+        }
+    }
+    out_scene->root = node;
+}
+
+// a square grid of 'sphere_count' spheres, joined by a balanced tree of unions:
+void build_union_forest(Wo_Renderer* renderer, uint32_t sphere_count, BenchScene* out_scene) {
+    uint32_t side = (uint32_t)ceil(sqrt((double)sphere_count));
+    Wo_Scalar spacing = 0.5;
+    Wo_Node* nodes = malloc(sizeof(Wo_Node) * sphere_count);
+    Wo_Vec3* offsets = malloc(sizeof(Wo_Vec3) * sphere_count);
+    for (uint32_t i = 0; i < sphere_count; i++) {
+        nodes[i] = wo_renderer_add_sphere_node(renderer, 0.2);
+        offsets[i] = (Wo_Vec3) {
+            ((Wo_Scalar)(i % side) - 0.5 * (side - 1)) * spacing,
+            ((Wo_Scalar)(i / side) - 0.5 * (side - 1)) * spacing,
+            BENCH_SCENE_DEPTH
+        };
+    }
+
+    // joining pairs level by level: unions sit at the origin, offsetting the spheres they join
+    // (an odd node out is carried up to the next level as is).
+    uint32_t level_count = sphere_count;
+    while (level_count > 1) {
+        uint32_t next_level_count = 0;
+        for (uint32_t i = 0; i + 1 < level_count; i += 2) {
+            Wo_Node_Argument left = {wo_quaternion_identity(), offsets[i], nodes[i]};
+            Wo_Node_Argument right = {wo_quaternion_identity(), offsets[i+1], nodes[i+1]};
+            Wo_Node node = wo_renderer_add_union_of_node(renderer, left, right);
+            if (level_count == sphere_count && out_scene->moving_node_count < BENCH_MAX_MOVING_NODE_COUNT) {
+                out_scene->moving_nodes[out_scene->moving_node_count] = node;
+                out_scene->moving_node_args[out_scene->moving_node_count] = right;
+                out_scene->moving_node_count++;
+            }
+            nodes[next_level_count] = node;
+            offsets[next_level_count] = wo_vec3_0();
+            next_level_count++;
+        }
+        if (level_count % 2 == 1) {
+            nodes[next_level_count] = nodes[level_count - 1];
+            offsets[next_level_count] = offsets[level_count - 1];
+            next_level_count++;
+        }
+        level_count = next_level_count;
+    }
+    out_scene->root = nodes[0];
+    free(nodes);
+    free(offsets);
+}
+
+// a sphere cut down to a convex polyhedron by 'plane_count' planar partitions, facing the points
+// of a fibonacci sphere:
+void build_planar_intersection(Wo_Renderer* renderer, uint32_t plane_count, BenchScene* out_scene) {
+    Wo_Vec3 center = {0.0, 0.0, BENCH_SCENE_DEPTH};
+    Wo_Scalar inradius = 1.5;
+    Wo_Node node = wo_renderer_add_sphere_node(renderer, 1.15 * inradius);
+    Wo_Vec3 node_offset = center;
+    for (uint32_t i = 0; i < plane_count; i++) {
+        Wo_Vec3 normal = fibonacci_sphere_point(i, plane_count);
+        Wo_Node plane = wo_renderer_add_infinite_planar_partition_node(renderer, normal);
+        Wo_Node_Argument plane_arg = {
+            wo_quaternion_identity(),
+            wo_vec3_add(center, wo_vec3_scale(normal, inradius)),
+            plane
+        };
+        node = wo_renderer_add_intersection_of_node(renderer,
+            (Wo_Node_Argument) {wo_quaternion_identity(), node_offset, node},
+            plane_arg
+        );
+        node_offset = wo_vec3_0();
+        if (out_scene->moving_node_count < BENCH_MAX_MOVING_NODE_COUNT) {
+            out_scene->moving_nodes[out_scene->moving_node_count] = node;
+            out_scene->moving_node_args[out_scene->moving_node_count] = plane_arg;
+            out_scene->moving_node_count++;
+        }
+    }
+    out_scene->root = node;
+}
+
+// bobs every moving node's right operand up and down, deterministically by frame:
+void move_scene(Wo_Renderer* renderer, BenchScene* scene, uint32_t frame_index) {
+    for (uint32_t i = 0; i < scene->moving_node_count; i++) {
+        Wo_Node_Argument arg = scene->moving_node_args[i];
+        arg.offset.y += 0.1 * sin(0.1 * frame_index + i);
+        wo_renderer_set_node_argument(renderer, scene->moving_nodes[i], WO_NODE_SIDE_RIGHT, arg);
+    }
+}
+
+Wo_Vec3 fibonacci_sphere_point(uint32_t index, uint32_t count) {
+    double golden_angle = 3.14159265358979323846 * (3.0 - sqrt(5.0));
+    double y = 1.0 - 2.0 * (index + 0.5) / count;
+    double ring_radius = sqrt(1.0 - y * y);
+    double theta = golden_angle * index;
+    return (Wo_Vec3) {ring_radius * cos(theta), y, ring_radius * sin(theta)};
+}
+
+//
+// Running:
+//
+
+bool run_case(
+    FILE* out, bool* is_first_run,
+    BenchConfig const* config, BenchCase const* bench_case, BenchResolution resolution
+) {
+    Wo_Renderer* renderer = wo_renderer_new_headless(
+        bench_case->name, bench_case->node_count,
+        resolution.width, resolution.height,
+        WO_RENDERER_DEFAULT_FRAMES_IN_FLIGHT
+    );
+    if (renderer == NULL) {
+        printf("[Bench] Failed to create a %u x %u headless renderer!\n", resolution.width, resolution.height);
+        return false;
+    }
+
+    BenchScene scene;
+    memset(&scene, 0, sizeof(scene));
+    bench_case->build_scene_cb(renderer, bench_case->size, &scene);
+    if (!bench_case->moving) {
+        scene.moving_node_count = 0;
+    }
+    if (config->path_tracing) {
+        wo_renderer_set_path_tracing(renderer, true, 8, 0);
+    }
+
+    size_t pixels_size = (size_t)resolution.width * resolution.height * 4;
+    void* pixels = malloc(pixels_size);
+    bool ok = true;
+    for (size_t i = 0; i < sizeof(bench_trace_paths) / sizeof(bench_trace_paths[0]); i++) {
+        if (!wo_renderer_set_trace_path(renderer, bench_trace_paths[i])) {
+            continue;
+        }
+        ok = run_trace_path(
+            out, *is_first_run,
+            config, bench_case, resolution,
+            renderer, &scene, bench_trace_paths[i],
+            pixels, pixels_size
+        );
+        if (!ok) {
+            break;
+        }
+        *is_first_run = false;
+    }
+    free(pixels);
+    wo_renderer_del(renderer);
+    return ok;
+}
+
+bool run_trace_path(
+    FILE* out, bool is_first_run,
+    BenchConfig const* config, BenchCase const* bench_case, BenchResolution resolution,
+    Wo_Renderer* renderer, BenchScene* scene, Wo_Trace_Path trace_path,
+    void* pixels, size_t pixels_size
+) {
+    // each frame is read back before the next is drawn, so frames never overlap on the GPU and
+    // their timings are independent of the CPU's pace:
+    uint32_t frame_index = 0;
+    for (uint32_t i = 0; i < config->warmup_frame_count; i++, frame_index++) {
+        move_scene(renderer, scene, frame_index);
+        wo_renderer_draw_frame(renderer);
+        wo_renderer_read_frame(renderer, WO_PIXEL_FORMAT_RGBA8, pixels, pixels_size);
+    }
+
+    Wo_Renderer_Stats stats_before;
+    wo_renderer_get_stats(renderer, &stats_before);
+    double wall_start_sec = wall_time_sec();
+
+    // a frame's GPU time is read back once its swapchain image comes round again, a few frames
+    // after it was drawn, so drawing continues until 'frame_count' timings came in (or, if the
+    // device has no timestamps, for 'frame_count' frames):
+    double* samples = malloc(sizeof(double) * config->frame_count);
+    uint32_t sample_count = 0;
+    uint64_t last_sample_count = stats_before.gpu_frame_time.sample_count;
+    uint32_t drawn_frame_count = 0;
+    while (drawn_frame_count < config->frame_count || (
+        sample_count < config->frame_count &&
+        drawn_frame_count < 2 * config->frame_count + WO_RENDERER_MAX_FRAMES_IN_FLIGHT
+    )) {
+        move_scene(renderer, scene, frame_index);
+        wo_renderer_draw_frame(renderer);
+        if (!wo_renderer_read_frame(renderer, WO_PIXEL_FORMAT_RGBA8, pixels, pixels_size)) {
+            printf("[Bench] Failed to read back frame %u!\n", frame_index);
+            free(samples);
+            return false;
+        }
+        frame_index++;
+        drawn_frame_count++;
+
+        Wo_Renderer_Stats stats;
+        wo_renderer_get_stats(renderer, &stats);
+        if (stats.gpu_frame_time.sample_count != last_sample_count && sample_count < config->frame_count) {
+            samples[sample_count++] = stats.gpu_frame_time.last_sec;
+        }
+        last_sample_count = stats.gpu_frame_time.sample_count;
+    }
+
+    double wall_sec = wall_time_sec() - wall_start_sec;
+    Wo_Renderer_Stats stats_after;
+    wo_renderer_get_stats(renderer, &stats_after);
+
+    qsort(samples, sample_count, sizeof(double), compare_doubles);
+    double gpu_sec = 0.0;
+    for (uint32_t i = 0; i < sample_count; i++) {
+        gpu_sec += samples[i];
+    }
+    // rays per second of GPU time where timed (extrapolating the timed frames' GPU time to all
+    // drawn frames), else of wall time:
+    uint64_t ray_count = stats_after.traced_ray_count - stats_before.traced_ray_count;
+    double rays_per_sec = ray_count / (sample_count > 0 ? gpu_sec * drawn_frame_count / sample_count : wall_sec);
+    uint64_t upload_bytes = stats_after.uploaded_bytes - stats_before.uploaded_bytes;
+
+    fprintf(out, "%s\n    {\n", is_first_run ? "" : ",");
+    fprintf(out, "      \"scene\": \"%s\",\n", bench_case->name);
+    fprintf(out, "      \"node_count\": %u,\n", stats_after.node_count);
+    fprintf(out, "      \"gpu_node_count\": %u,\n", stats_after.gpu_node_count);
+    fprintf(out, "      \"unoptimized_gpu_node_count\": %u,\n", stats_after.unoptimized_gpu_node_count);
+    fprintf(out, "      \"bvh_node_count\": %u,\n", stats_after.bvh_node_count);
+    fprintf(out, "      \"width\": %u,\n", resolution.width);
+    fprintf(out, "      \"height\": %u,\n", resolution.height);
+    fprintf(out, "      \"trace_path\": \"%s\",\n", trace_path_name(trace_path));
+    fprintf(out, "      \"frame_count\": %u,\n", drawn_frame_count);
+    fprintf(out, "      \"wall_time_sec\": %.6f,\n", wall_sec);
+    if (sample_count > 0) {
+        fprintf(
+            out, "      \"gpu_frame_time_sec\": {\"p50\": %.6f, \"p95\": %.6f, \"p99\": %.6f, \"sample_count\": %u},\n",
+            percentile(samples, sample_count, 0.50),
+            percentile(samples, sample_count, 0.95),
+            percentile(samples, sample_count, 0.99),
+            sample_count
+        );
+    } else {
+        fprintf(out, "      \"gpu_frame_time_sec\": null,\n");
+    }
+    if (trace_path != WO_TRACE_PATH_FRAGMENT) {
+        fprintf(out, "      \"rays_per_sec\": %.1f,\n", rays_per_sec);
+    } else {
+        // (the fragment path does not count its rays)
+        fprintf(out, "      \"rays_per_sec\": null,\n");
+    }
+    fprintf(out, "      \"upload_bytes\": %llu,\n", (unsigned long long)upload_bytes);
+    fprintf(out, "      \"upload_bytes_per_frame\": %.1f,\n", (double)upload_bytes / drawn_frame_count);
+    fprintf(out, "      \"total_upload_bytes\": %llu,\n", (unsigned long long)stats_after.uploaded_bytes);
+    fprintf(out, "      \"pipeline_variant_count\": %u,\n", stats_after.pipeline_variant_count);
+    fprintf(out, "      \"pipeline_variant_compile_time_sec\": %.6f\n", stats_after.pipeline_variant_compile_time.last_sec);
+    fprintf(out, "    }");
+    fflush(out);
+
+    free(samples);
+    return true;
+}
+
+int compare_doubles(void const* a, void const* b) {
+    double x = *(double const*)a;
+    double y = *(double const*)b;
+    return (x > y) - (x < y);
+}
+
+// nearest-rank percentile:
+double percentile(double const* sorted_samples, uint32_t sample_count, double p) {
+    uint32_t rank = (uint32_t)ceil(p * sample_count);
+    if (rank == 0) {
+        rank = 1;
+    }
+    return sorted_samples[rank - 1];
+}
+
+char const* trace_path_name(Wo_Trace_Path trace_path) {
+    switch (trace_path) {
+        case WO_TRACE_PATH_FRAGMENT: return "fragment";
+        case WO_TRACE_PATH_COMPUTE: return "compute";
+        case WO_TRACE_PATH_RAY_QUERY: return "ray_query";
+    }
+    return "unknown";
+}
+
+double wall_time_sec(void) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)now.tv_sec + (double)now.tv_nsec * 1e-9;
+}
+
+//
+// Main:
+//
+
+int main(int argc, char const* argv[]) {
+    BenchConfig config = {
+        BENCH_DEFAULT_FRAME_COUNT,
+        BENCH_DEFAULT_WARMUP_FRAME_COUNT,
+        false,
+        BENCH_DEFAULT_OUT_PATH
+    };
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            config.frame_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--warmup") == 0 && i + 1 < argc) {
+            config.warmup_frame_count = (uint32_t)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--path-tracing") == 0) {
+            config.path_tracing = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            config.out_path = argv[++i];
+        } else {
+            printf("usage: %s [--frames N] [--warmup N] [--path-tracing] [--out FILE (default: '%s')]\n", argv[0], BENCH_DEFAULT_OUT_PATH);
+            return -1;
+        }
+    }
+    if (config.frame_count == 0) {
+        printf("[Bench] '--frames' must be at least 1.\n");
+        return -1;
+    }
+
+    // (never stdout, which the renderer logs to)
+    FILE* out = fopen(config.out_path, "w");
+    if (out == NULL) {
+        printf("[Bench] Could not open '%s' for writing.\n", config.out_path);
+        return -1;
+    }
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"frame_count\": %u,\n", config.frame_count);
+    fprintf(out, "  \"warmup_frame_count\": %u,\n", config.warmup_frame_count);
+    fprintf(out, "  \"path_tracing\": %s,\n", config.path_tracing ? "true" : "false");
+    fprintf(out, "  \"runs\": [");
+    bool ok = true;
+    bool is_first_run = true;
+    for (size_t i = 0; ok && i < sizeof(bench_cases) / sizeof(bench_cases[0]); i++) {
+        for (size_t j = 0; ok && j < sizeof(bench_resolutions) / sizeof(bench_resolutions[0]); j++) {
+            ok = run_case(out, &is_first_run, &config, &bench_cases[i], bench_resolutions[j]);
+        }
+    }
+    fprintf(out, "\n  ]\n}\n");
+
+    bool close_ok = (fclose(out) == 0);
+    if (ok && close_ok) {
+        printf("[Bench] Wrote the results to '%s'.\n", config.out_path);
+    } else if (!close_ok) {
+        printf("[Bench] Could not write the results to '%s'.\n", config.out_path);
+    }
+    return ok && close_ok ? 0 : -1;
+}
@@ -1,6 +1,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdint.h>
+#include <math.h>
 
 #include <wololo/wololo.h>
 #include <wololo/wmath.h>
@@ -13,8 +14,18 @@ bool test1_init_cb(
     double target_frame_time_sec
 );
 void test1_update_cb(Wo_App* app, double elapsed_time_in_sec);
+void test1_apply_snapshot_cb(Wo_App* app, Wo_Renderer* renderer, void const* snapshot);
 void test1_de_init_cb(Wo_App* app);
 
+// the update thread only advances the snapshot's clock; the render loop moves the spheres:
+typedef struct Test1Snapshot Test1Snapshot;
+struct Test1Snapshot {
+    double time_sec;
+};
+static Wo_Node test1_sphere1 = WO_NODE_NONE;
+static Wo_Node test1_sphere2 = WO_NODE_NONE;
+static Wo_Node test1_blob = WO_NODE_NONE;
+
 int main_test1() {
     Wo_App* app = wo_app_new(
         60.0,
@@ -35,13 +46,13 @@ bool test1_init_cb(
     double target_frame_time_sec
 ) {
     size_t max_item_count = 8;
-    Wo_Renderer* renderer = wo_renderer_new(app, "Test1Render", max_item_count);
+    Wo_Renderer* renderer = wo_renderer_new(app, "Test1Render", max_item_count, WO_RENDERER_DEFAULT_FRAMES_IN_FLIGHT);
     if (renderer != NULL) {
         Wo_Node sphere1 = wo_renderer_add_sphere_node(renderer, 1.0);
         Wo_Node sphere2 = wo_renderer_add_sphere_node(renderer, 1.0);
         Wo_Node blob = wo_renderer_add_union_of_node(renderer,
-            (Wo_Node_Argument) {wo_quaternion_identity(), wo_vec3_0(), sphere1},
-            (Wo_Node_Argument) {wo_quaternion_identity(), wo_vec3_0(), sphere2}
+            (Wo_Node_Argument) {wo_quaternion_identity(), (Wo_Vec3) {-0.5, 0.0, -4.0}, sphere1},
+            (Wo_Node_Argument) {wo_quaternion_identity(), (Wo_Vec3) {+0.5, 0.0, -4.0}, sphere2}
         );
         printf("Sphere1 is root: %d\nSphere2 is root: %d\nBlob is root: %d\n", 
             wo_renderer_isroot(renderer,sphere1),
@@ -49,13 +60,38 @@ bool test1_init_cb(
             wo_renderer_isroot(renderer,blob)
         );
         wo_app_swap_scene(app, renderer);
+
+        test1_sphere1 = sphere1;
+        test1_sphere2 = sphere2;
+        test1_blob = blob;
+        if (!wo_app_set_update_snapshots(app, sizeof(Test1Snapshot), NULL, test1_apply_snapshot_cb, true)) {
+            printf("[Test1] Failed to set up update snapshots, the spheres stay put.\n");
+        }
     } else {
         printf("[Test1] Failed to create renderer!\n");
     }
     return true;
 }
 void test1_update_cb(Wo_App* app, double elapsed_time_in_sec) {
-    // printf("Hello!\n");
+    // (possibly on the update thread: only touching the snapshot)
+    Test1Snapshot* snapshot = wo_app_update_snapshot(app);
+    if (snapshot != NULL) {
+        snapshot->time_sec += elapsed_time_in_sec;
+    }
+}
+void test1_apply_snapshot_cb(Wo_App* app, Wo_Renderer* renderer, void const* snapshot_p) {
+    Test1Snapshot const* snapshot = snapshot_p;
+    if (renderer == NULL || test1_blob == WO_NODE_NONE) {
+        return;
+    }
+    // the spheres drift apart and back together:
+    Wo_Scalar const spread = (Wo_Scalar)(0.5 + 0.25 * sin(snapshot->time_sec));
+    wo_renderer_set_node_argument(renderer, test1_blob, WO_NODE_SIDE_LEFT,
+        (Wo_Node_Argument) {wo_quaternion_identity(), (Wo_Vec3) {-spread, 0.0, -4.0}, test1_sphere1}
+    );
+    wo_renderer_set_node_argument(renderer, test1_blob, WO_NODE_SIDE_RIGHT,
+        (Wo_Node_Argument) {wo_quaternion_identity(), (Wo_Vec3) {+spread, 0.0, -4.0}, test1_sphere2}
+    );
 }
 void test1_de_init_cb(Wo_App* app) {
     printf("Quitting...\n");